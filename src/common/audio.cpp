@@ -89,65 +89,93 @@ AudioBuffer::AudioBuffer(size_t size) : m_buffer(size) {}
 
 size_t AudioBuffer::GetBufferUsed() const
 {
-  return m_used;
+  return static_cast<size_t>(m_write_position.load(std::memory_order_acquire) -
+                             m_read_position.load(std::memory_order_acquire));
+}
+
+size_t AudioBuffer::GetBufferSpace() const
+{
+  return m_buffer.size() - GetBufferUsed();
 }
 
 size_t AudioBuffer::GetContiguousBufferSpace() const
 {
-  return m_buffer.size() - m_used;
+  const size_t write_offset = static_cast<size_t>(m_write_position.load(std::memory_order_relaxed) % m_buffer.size());
+  return std::min(GetBufferSpace(), m_buffer.size() - write_offset);
 }
 
-void AudioBuffer::Clear()
+bool AudioBuffer::GetWritePointer(void** ptr, size_t* len)
 {
-  m_used = 0;
+  size_t free = GetContiguousBufferSpace();
+  if (*len > free)
+    return false;
+
+  *len = free;
+  *ptr = m_buffer.data() + static_cast<size_t>(m_write_position.load(std::memory_order_relaxed) % m_buffer.size());
+  return true;
 }
 
-bool AudioBuffer::Read(void* dst, size_t len)
+void AudioBuffer::MoveWritePointer(size_t len)
+{
+  DebugAssert(len <= GetBufferSpace());
+  m_write_position.store(m_write_position.load(std::memory_order_relaxed) + len, std::memory_order_release);
+}
+
+bool AudioBuffer::Write(const void* src, size_t len)
 {
-  if (len > m_used)
+  if (len > GetBufferSpace())
     return false;
 
-  std::memcpy(dst, m_buffer.data(), len);
-  m_used -= len;
-  if (m_used > 0)
-    std::memmove(m_buffer.data(), m_buffer.data() + len, m_used);
+  // Copy up to the end of the buffer, then the remainder to the start.
+  const size_t write_offset = static_cast<size_t>(m_write_position.load(std::memory_order_relaxed) % m_buffer.size());
+  const size_t first_part = std::min(len, m_buffer.size() - write_offset);
+  std::memcpy(m_buffer.data() + write_offset, src, first_part);
+  if (first_part < len)
+    std::memcpy(m_buffer.data(), static_cast<const byte*>(src) + first_part, len - first_part);
 
+  MoveWritePointer(len);
   return true;
 }
 
-bool AudioBuffer::GetWritePointer(void** ptr, size_t* len)
+bool AudioBuffer::GetReadPointer(const void** ppReadPointer, size_t* pByteCount) const
 {
-  size_t free = GetContiguousBufferSpace();
-  if (*len > free)
+  const size_t used = GetBufferUsed();
+  if (used == 0)
     return false;
 
-  *len = free;
-  *ptr = m_buffer.data() + m_used;
+  // Only the part before the end of the buffer is returned, the rest follows once this has been consumed.
+  const size_t read_offset = static_cast<size_t>(m_read_position.load(std::memory_order_relaxed) % m_buffer.size());
+  *ppReadPointer = m_buffer.data() + read_offset;
+  *pByteCount = std::min(used, m_buffer.size() - read_offset);
   return true;
 }
 
-void AudioBuffer::MoveWritePointer(size_t len)
+void AudioBuffer::MoveReadPointer(size_t byteCount)
 {
-  DebugAssert(m_used + len <= m_buffer.size());
-  m_used += len;
+  DebugAssert(byteCount <= GetBufferUsed());
+  m_read_position.store(m_read_position.load(std::memory_order_relaxed) + byteCount, std::memory_order_release);
 }
 
-bool AudioBuffer::GetReadPointer(const void** ppReadPointer, size_t* pByteCount) const
+bool AudioBuffer::Read(void* dst, size_t len)
 {
-  if (m_used == 0)
+  if (len > GetBufferUsed())
     return false;
 
-  *ppReadPointer = m_buffer.data();
-  *pByteCount = m_used;
+  const size_t read_offset = static_cast<size_t>(m_read_position.load(std::memory_order_relaxed) % m_buffer.size());
+  const size_t first_part = std::min(len, m_buffer.size() - read_offset);
+  std::memcpy(dst, m_buffer.data() + read_offset, first_part);
+  if (first_part < len)
+    std::memcpy(static_cast<byte*>(dst) + first_part, m_buffer.data(), len - first_part);
+
+  MoveReadPointer(len);
   return true;
 }
 
-void AudioBuffer::MoveReadPointer(size_t byteCount)
+void AudioBuffer::DiscardUntil(uint64 position)
 {
-  DebugAssert(byteCount <= m_used);
-  m_used -= byteCount;
-  if (m_used > 0)
-    std::memmove(m_buffer.data(), m_buffer.data() + byteCount, m_used);
+  // The position may already have been passed if it was read before the discard was applied.
+  if (position > m_read_position.load(std::memory_order_relaxed))
+    m_read_position.store(position, std::memory_order_release);
 }
 
 Channel::Channel(const char* name, float output_sample_rate, float input_sample_rate, SampleFormat format,
@@ -160,7 +188,7 @@ Channel::Channel(const char* name, float output_sample_rate, float input_sample_
                     sizeof(OutputFormatType)),
     m_resample_buffer(uint32(float(InputBufferLengthInSeconds* output_sample_rate)) * channels),
     m_resample_ratio(double(output_sample_rate) / double(input_sample_rate)),
-    m_resampler_state(src_new(SRC_SINC_FASTEST, int(channels), nullptr))
+    m_resampler_state(src_new(SRC_SINC_FASTEST, int(channels), nullptr)), m_pending_resample_ratio(m_resample_ratio)
 {
   Assert(m_resampler_state != nullptr);
 }
@@ -172,8 +200,7 @@ Channel::~Channel()
 
 size_t Channel::GetFreeInputSamples()
 {
-  MutexLock lock(m_lock);
-  return m_input_buffer.GetContiguousBufferSpace() / m_input_frame_size;
+  return m_input_buffer.GetBufferSpace() / m_input_frame_size;
 }
 
 void* Channel::ReserveInputSamples(size_t sample_count)
@@ -181,30 +208,39 @@ void* Channel::ReserveInputSamples(size_t sample_count)
   void* write_ptr;
   size_t byte_count = sample_count * m_input_frame_size;
 
-  m_lock.Lock();
+  // Write straight into the ring when there is space before it wraps around.
+  m_input_reserved_in_place = m_input_buffer.GetWritePointer(&write_ptr, &byte_count);
+  if (m_input_reserved_in_place)
+    return write_ptr;
 
-  // When the speed limiter is off, we can easily exceed the audio buffer length.
-  // In this case, just destroy the oldest samples, wrapping around.
-  while (!m_input_buffer.GetWritePointer(&write_ptr, &byte_count))
-  {
-    size_t bytes_to_remove = byte_count - m_input_buffer.GetContiguousBufferSpace();
-    m_input_buffer.MoveReadPointer(bytes_to_remove);
-  }
+  if (m_input_staging_buffer.size() < byte_count)
+    m_input_staging_buffer.resize(byte_count);
 
-  return write_ptr;
+  return m_input_staging_buffer.data();
 }
 
 void Channel::CommitInputSamples(size_t sample_count)
 {
   size_t byte_count = sample_count * m_input_frame_size;
-  m_input_buffer.MoveWritePointer(byte_count);
+  if (m_input_reserved_in_place)
+  {
+    m_input_buffer.MoveWritePointer(byte_count);
+    return;
+  }
 
-  m_lock.Unlock();
+  // When the speed limiter is off, we can easily exceed the audio buffer length. Only the reading thread can move the
+  // read pointer, so in this case the newest samples are dropped instead of the oldest.
+  byte_count = std::min(byte_count, (m_input_buffer.GetBufferSpace() / m_input_frame_size) * m_input_frame_size);
+  m_input_buffer.Write(m_input_staging_buffer.data(), byte_count);
 }
 
 void Channel::ReadSamples(float* destination, size_t num_samples)
 {
-  MutexLock lock(m_lock);
+  if (m_clear_pending.exchange(false, std::memory_order_acquire))
+  {
+    m_resample_ratio = m_pending_resample_ratio.load(std::memory_order_relaxed);
+    InternalClearBuffer();
+  }
 
   while (num_samples > 0)
   {
@@ -235,23 +271,27 @@ void Channel::ReadSamples(float* destination, size_t num_samples)
 
 void Channel::ChangeSampleRate(float new_sample_rate)
 {
-  MutexLock lock(m_lock);
-  InternalClearBuffer();
-
   // Calculate the new ratio.
   m_input_sample_rate = new_sample_rate;
-  m_resample_ratio = double(m_output_sample_rate) / double(new_sample_rate);
+  m_pending_resample_ratio.store(double(m_output_sample_rate) / double(new_sample_rate), std::memory_order_relaxed);
+  RequestClearBuffer();
 }
 
 void Channel::ClearBuffer()
 {
-  MutexLock lock(m_lock);
-  InternalClearBuffer();
+  RequestClearBuffer();
+}
+
+void Channel::RequestClearBuffer()
+{
+  // Samples written after this point are kept.
+  m_clear_position.store(m_input_buffer.GetWritePosition(), std::memory_order_relaxed);
+  m_clear_pending.store(true, std::memory_order_release);
 }
 
 void Channel::InternalClearBuffer()
 {
-  m_input_buffer.Clear();
+  m_input_buffer.DiscardUntil(m_clear_position.load(std::memory_order_relaxed));
   src_reset(reinterpret_cast<SRC_STATE*>(m_resampler_state));
   m_output_buffer.Clear();
 }
@@ -349,7 +389,9 @@ bool Channel::ResampleInput(size_t num_output_samples)
   // Update buffer pointers.
   m_input_buffer.MoveReadPointer(size_t(resample_data.input_frames_used) * m_input_frame_size);
   m_output_buffer.MoveWritePointer(size_t(resample_data.output_frames_gen) * m_output_frame_size);
-  return true;
+
+  // The input can stop short of the end of the data when it wraps around, make sure that we are making progress.
+  return (resample_data.input_frames_used > 0 || resample_data.output_frames_gen > 0);
 }
 
 NullMixer::NullMixer() : Mixer(44100) {}
@@ -1,12 +1,11 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <vector>
 
 #include "YBaseLib/CircularBuffer.h"
-#include "YBaseLib/Mutex.h"
-#include "YBaseLib/MutexLock.h"
 #include "YBaseLib/String.h"
 #include "types.h"
 
@@ -88,29 +87,38 @@ protected:
   std::unique_ptr<CircularBuffer> m_output_buffer;
 };
 
+// Single producer, single consumer ring buffer. The write methods must only be called from the producer thread, and
+// the read methods from the consumer thread. Positions only ever increase, and are wrapped when indexing the buffer.
 class AudioBuffer
 {
 public:
   AudioBuffer(size_t size);
 
   size_t GetBufferUsed() const;
-  size_t GetContiguousBufferSpace() const;
-
-  void Clear();
+  size_t GetBufferSpace() const;
 
-  bool Read(void* dst, size_t len);
+  // Space which can be written without wrapping around.
+  size_t GetContiguousBufferSpace() const;
 
+  // Producer side.
+  uint64 GetWritePosition() const { return m_write_position.load(std::memory_order_relaxed); }
   bool GetWritePointer(void** ptr, size_t* len);
-
   void MoveWritePointer(size_t len);
+  bool Write(const void* src, size_t len);
 
+  // Consumer side.
   bool GetReadPointer(const void** ppReadPointer, size_t* pByteCount) const;
-
   void MoveReadPointer(size_t byteCount);
+  bool Read(void* dst, size_t len);
+
+  // Drops everything written before position. Consumer side.
+  void DiscardUntil(uint64 position);
+  void Clear() { DiscardUntil(GetWritePosition()); }
 
 private:
   std::vector<byte> m_buffer;
-  size_t m_used = 0;
+  std::atomic<uint64> m_read_position{0};
+  std::atomic<uint64> m_write_position{0};
 };
 
 // A channel, or source of audio for the mixer.
@@ -130,6 +138,7 @@ public:
   void SetEnabled(bool enabled) { m_enabled = enabled; }
 
   // This sample_count is the number of samples per channel, so two-channel will be half of the total values.
+  // Input samples are written from the emulation thread, and output samples read from the host audio thread.
   size_t GetFreeInputSamples();
   void* ReserveInputSamples(size_t sample_count);
   void CommitInputSamples(size_t sample_count);
@@ -144,9 +153,11 @@ public:
   void ChangeSampleRate(float new_sample_rate);
 
   // Clears the buffer. Use when loading state or changing speed limiter.
+  // The reading thread owns the resampler, so both of these are applied by it before the next read.
   void ClearBuffer();
 
 private:
+  void RequestClearBuffer();
   void InternalClearBuffer();
 
   String m_name;
@@ -156,8 +167,6 @@ private:
   size_t m_channels;
   bool m_enabled;
 
-  Mutex m_lock;
-  // std::unique_ptr<CircularBuffer> m_input_buffer;
   size_t m_input_sample_size;
   size_t m_input_frame_size;
   size_t m_output_frame_size;
@@ -166,6 +175,15 @@ private:
   std::vector<float> m_resample_buffer;
   double m_resample_ratio;
   void* m_resampler_state;
+
+  // Samples which don't fit before the end of the input ring are reserved here, and copied in on commit.
+  std::vector<byte> m_input_staging_buffer;
+  bool m_input_reserved_in_place = true;
+
+  // Clears requested by the writing thread, applied by the reading thread.
+  std::atomic<double> m_pending_resample_ratio;
+  std::atomic<uint64> m_clear_position{0};
+  std::atomic_bool m_clear_pending{false};
 };
 
 // Null audio sink/mixer
@@ -0,0 +1,419 @@
+#include "common/block_image.h"
+#include "YBaseLib/Log.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <limits>
+Log_SetChannel(BlockImage);
+
+BlockImage::BlockImage(ByteStream* stream, const HEADER& header, std::vector<INDEX_ENTRY> index)
+  : m_stream(stream), m_image_size(header.image_size), m_block_size(header.block_size), m_index(std::move(index))
+{
+  m_stream->AddRef();
+  SetCacheBlockCount(DefaultCacheBlockCount);
+}
+
+BlockImage::~BlockImage()
+{
+  m_stream->Release();
+}
+
+bool BlockImage::IsBlockImage(ByteStream* stream)
+{
+  u32 magic;
+  return (stream->SeekAbsolute(0) && stream->Read2(&magic, sizeof(magic)) && magic == HEADER_MAGIC);
+}
+
+std::unique_ptr<BlockImage> BlockImage::Open(ByteStream* stream)
+{
+  HEADER header;
+  if (!stream->SeekAbsolute(0) || !stream->Read2(&header, sizeof(header)) || header.magic != HEADER_MAGIC)
+    return nullptr;
+
+  if (header.version != HEADER_VERSION || header.block_size == 0 || (header.block_size % 512) != 0 ||
+      header.block_count != ((header.image_size + header.block_size - 1) / header.block_size))
+  {
+    Log_ErrorPrintf("Unsupported or corrupted block image header (version %u, block size %u, %u blocks)",
+                    header.version, header.block_size, header.block_count);
+    return nullptr;
+  }
+
+  // Make sure the index is actually in the stream before allocating it, the block count can't be trusted.
+  const u64 stream_size = stream->GetSize();
+  const u64 index_size = u64(sizeof(INDEX_ENTRY)) * header.block_count;
+  if (header.index_offset > stream_size || index_size > (stream_size - header.index_offset) ||
+      index_size > std::numeric_limits<u32>::max())
+  {
+    Log_ErrorPrintf("Block index (%u entries at offset %" PRIu64 ") does not fit in the image", header.block_count,
+                    header.index_offset);
+    return nullptr;
+  }
+
+  std::vector<INDEX_ENTRY> index(header.block_count);
+  if (!stream->SeekAbsolute(header.index_offset) || !stream->Read2(index.data(), static_cast<u32>(index_size)))
+  {
+    Log_ErrorPrintf("Failed to read block index");
+    return nullptr;
+  }
+
+  for (const INDEX_ENTRY& entry : index)
+  {
+    if (entry.compression >= Compression::Count || entry.offset > stream_size ||
+        entry.stored_size > (stream_size - entry.offset) ||
+        (entry.compression == Compression::None && entry.stored_size != header.block_size))
+    {
+      Log_ErrorPrintf("Corrupted block index entry");
+      return nullptr;
+    }
+  }
+
+  return std::unique_ptr<BlockImage>(new BlockImage(stream, header, std::move(index)));
+}
+
+bool BlockImage::Create(ByteStream* src, u64 image_size, ByteStream* dst, u32 block_size /* = DefaultBlockSize */)
+{
+  if (block_size == 0 || (block_size % 512) != 0)
+    return false;
+
+  HEADER header = {};
+  header.magic = HEADER_MAGIC;
+  header.version = HEADER_VERSION;
+  header.image_size = image_size;
+  header.block_size = block_size;
+  header.block_count = static_cast<u32>((image_size + block_size - 1) / block_size);
+  header.index_offset = sizeof(HEADER);
+
+  // The index is rewritten after the blocks, once their sizes are known.
+  std::vector<INDEX_ENTRY> index(header.block_count);
+  const u32 index_size = static_cast<u32>(sizeof(INDEX_ENTRY) * index.size());
+  const u64 first_block_offset = header.index_offset + index_size;
+  if (!dst->SeekAbsolute(0) || !dst->Write2(&header, sizeof(header)) || !dst->Write2(index.data(), index_size))
+    return false;
+
+  std::vector<byte> block(block_size);
+  std::vector<byte> compressed(block_size);
+  u64 current_offset = first_block_offset;
+  u32 zero_blocks = 0;
+  u32 compressed_blocks = 0;
+  for (u32 block_index = 0; block_index < header.block_count; block_index++)
+  {
+    // The last block is padded with zeros.
+    const u64 block_start = static_cast<u64>(block_index) * block_size;
+    const u32 size = static_cast<u32>(std::min(image_size - block_start, u64(block_size)));
+    if (!src->SeekAbsolute(block_start) || !src->Read2(block.data(), size))
+      return false;
+    std::fill(block.begin() + size, block.end(), byte(0));
+
+    INDEX_ENTRY& entry = index[block_index];
+    entry.offset = current_offset;
+    if (std::all_of(block.begin(), block.end(), [](byte b) { return b == 0; }))
+    {
+      entry.stored_size = 0;
+      entry.compression = Compression::Zero;
+      zero_blocks++;
+      continue;
+    }
+
+    const u32 compressed_size = CompressLZ4(block.data(), block_size, compressed.data(), block_size - 1);
+    if (compressed_size > 0)
+    {
+      entry.stored_size = compressed_size;
+      entry.compression = Compression::LZ4;
+      compressed_blocks++;
+      if (!dst->Write2(compressed.data(), compressed_size))
+        return false;
+    }
+    else
+    {
+      entry.stored_size = block_size;
+      entry.compression = Compression::None;
+      if (!dst->Write2(block.data(), block_size))
+        return false;
+    }
+
+    current_offset += entry.stored_size;
+  }
+
+  if (!dst->SeekAbsolute(header.index_offset) || !dst->Write2(index.data(), index_size))
+    return false;
+
+  Log_InfoPrintf("Created block image: %u blocks, %u zero, %u compressed, %" PRIu64 " bytes", header.block_count,
+                 zero_blocks, compressed_blocks, current_offset);
+  return true;
+}
+
+void BlockImage::SetCacheBlockCount(u32 count)
+{
+  m_cache.resize(std::max(count, 1u));
+  for (CachedBlock& block : m_cache)
+  {
+    if (!block.data)
+      block.data = std::make_unique<byte[]>(m_block_size);
+  }
+}
+
+bool BlockImage::Read(void* buffer, u64 offset, u32 size)
+{
+  if (offset > m_image_size || size > (m_image_size - offset))
+    return false;
+
+  byte* buf = static_cast<byte*>(buffer);
+  while (size > 0)
+  {
+    const u32 block_index = static_cast<u32>(offset / m_block_size);
+    const u32 offset_in_block = static_cast<u32>(offset % m_block_size);
+    const u32 size_in_block = std::min(size, m_block_size - offset_in_block);
+
+    // Elided blocks don't take up any room in the cache.
+    if (m_index[block_index].compression == Compression::Zero)
+    {
+      std::memset(buf, 0, size_in_block);
+    }
+    else
+    {
+      const byte* block = GetBlock(block_index);
+      if (!block)
+        return false;
+
+      std::memcpy(buf, block + offset_in_block, size_in_block);
+    }
+
+    buf += size_in_block;
+    offset += size_in_block;
+    size -= size_in_block;
+  }
+
+  return true;
+}
+
+const byte* BlockImage::GetBlock(u32 block_index)
+{
+  CachedBlock* victim = &m_cache[0];
+  for (CachedBlock& block : m_cache)
+  {
+    if (block.block_index == block_index)
+    {
+      block.last_used = ++m_cache_clock;
+      return block.data.get();
+    }
+    if (block.last_used < victim->last_used)
+      victim = &block;
+  }
+
+  if (!LoadBlock(block_index, victim->data.get()))
+  {
+    victim->block_index = 0xFFFFFFFFu;
+    victim->last_used = 0;
+    return nullptr;
+  }
+
+  victim->block_index = block_index;
+  victim->last_used = ++m_cache_clock;
+  return victim->data.get();
+}
+
+bool BlockImage::LoadBlock(u32 block_index, byte* data)
+{
+  const INDEX_ENTRY& entry = m_index[block_index];
+  if (!m_stream->SeekAbsolute(entry.offset))
+    return false;
+
+  switch (entry.compression)
+  {
+    case Compression::None:
+      return m_stream->Read2(data, m_block_size);
+
+    case Compression::LZ4:
+    {
+      if (m_compressed_buffer.size() < entry.stored_size)
+        m_compressed_buffer.resize(entry.stored_size);
+      if (!m_stream->Read2(m_compressed_buffer.data(), entry.stored_size) ||
+          !DecompressLZ4(m_compressed_buffer.data(), entry.stored_size, data, m_block_size))
+      {
+        Log_ErrorPrintf("Failed to decompress block %u", block_index);
+        return false;
+      }
+      return true;
+    }
+
+    default:
+      std::memset(data, 0, m_block_size);
+      return true;
+  }
+}
+
+static constexpr u32 LZ4_MIN_MATCH = 4;
+static constexpr u32 LZ4_LAST_LITERALS = 5;
+static constexpr u32 LZ4_MATCH_FIND_LIMIT = 12;
+static constexpr u32 LZ4_MAX_OFFSET = 65535;
+static constexpr u32 LZ4_HASH_BITS = 12;
+
+static u32 ReadU32(const byte* ptr)
+{
+  u32 value;
+  std::memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+static u32 LZ4Hash(u32 sequence)
+{
+  return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+// Writes the 15+ extension bytes for a literal or match length.
+static byte* LZ4WriteLength(byte* op, u32 length)
+{
+  for (; length >= 255; length -= 255)
+    *(op++) = 255;
+  *(op++) = static_cast<byte>(length);
+  return op;
+}
+
+static byte* LZ4WriteSequence(byte* op, byte* op_end, const byte* literals, u32 literal_length, u32 offset,
+                              u32 match_length)
+{
+  // Worst case size, including the extension bytes for both lengths.
+  const u32 required = 1 + (literal_length / 255 + 1) + literal_length + 2 + (match_length / 255 + 1);
+  if (static_cast<u32>(op_end - op) < required)
+    return nullptr;
+
+  byte* token = op++;
+  *token = static_cast<byte>(std::min(literal_length, 15u) << 4);
+  if (literal_length >= 15)
+    op = LZ4WriteLength(op, literal_length - 15);
+  std::memcpy(op, literals, literal_length);
+  op += literal_length;
+
+  // The final sequence has literals only.
+  if (match_length == 0)
+    return op;
+
+  *(op++) = static_cast<byte>(offset);
+  *(op++) = static_cast<byte>(offset >> 8);
+
+  const u32 encoded_match_length = match_length - LZ4_MIN_MATCH;
+  *token |= static_cast<byte>(std::min(encoded_match_length, 15u));
+  if (encoded_match_length >= 15)
+    op = LZ4WriteLength(op, encoded_match_length - 15);
+
+  return op;
+}
+
+u32 BlockImage::CompressLZ4(const byte* src, u32 src_size, byte* dst, u32 dst_capacity)
+{
+  // Greedy single-probe matcher. Blocks are compressed once when the image is created, so ratio matters less than
+  // keeping this short, and disk images are mostly long runs which any matcher finds.
+  const byte* ip = src;
+  const byte* anchor = src;
+  const byte* const src_end = src + src_size;
+  const byte* const match_end_limit = src_end - std::min(src_size, LZ4_LAST_LITERALS);
+  byte* op = dst;
+  byte* const op_end = dst + dst_capacity;
+
+  if (src_size > LZ4_MATCH_FIND_LIMIT)
+  {
+    std::vector<u32> hash_table(1u << LZ4_HASH_BITS, 0);
+    const byte* const match_find_limit = src_end - LZ4_MATCH_FIND_LIMIT;
+    while (ip <= match_find_limit)
+    {
+      const u32 sequence = ReadU32(ip);
+      const u32 hash = LZ4Hash(sequence);
+      const byte* candidate = src + hash_table[hash];
+      hash_table[hash] = static_cast<u32>(ip - src);
+      if (candidate >= ip || static_cast<u32>(ip - candidate) > LZ4_MAX_OFFSET || ReadU32(candidate) != sequence)
+      {
+        ip++;
+        continue;
+      }
+
+      u32 match_length = LZ4_MIN_MATCH;
+      while ((ip + match_length) < match_end_limit && candidate[match_length] == ip[match_length])
+        match_length++;
+
+      op = LZ4WriteSequence(op, op_end, anchor, static_cast<u32>(ip - anchor), static_cast<u32>(ip - candidate),
+                            match_length);
+      if (!op)
+        return 0;
+
+      ip += match_length;
+      anchor = ip;
+    }
+  }
+
+  op = LZ4WriteSequence(op, op_end, anchor, static_cast<u32>(src_end - anchor), 0, 0);
+  return op ? static_cast<u32>(op - dst) : 0;
+}
+
+bool BlockImage::DecompressLZ4(const byte* src, u32 src_size, byte* dst, u32 dst_size)
+{
+  const byte* ip = src;
+  const byte* const ip_end = src + src_size;
+  byte* op = dst;
+  byte* const op_end = dst + dst_size;
+
+  for (;;)
+  {
+    if (ip >= ip_end)
+      return false;
+
+    const u32 token = *(ip++);
+    u32 literal_length = token >> 4;
+    if (literal_length == 15)
+    {
+      u32 value;
+      do
+      {
+        if (ip >= ip_end)
+          return false;
+        value = *(ip++);
+        literal_length += value;
+      } while (value == 255);
+    }
+
+    if (literal_length > static_cast<u32>(ip_end - ip) || literal_length > static_cast<u32>(op_end - op))
+      return false;
+    std::memcpy(op, ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+
+    // The last sequence ends after its literals.
+    if (ip == ip_end)
+      return (op == op_end);
+
+    if ((ip_end - ip) < 2)
+      return false;
+    const u32 offset = ZeroExtend32(ip[0]) | (ZeroExtend32(ip[1]) << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<u32>(op - dst))
+      return false;
+
+    u32 match_length = token & 15;
+    if (match_length == 15)
+    {
+      u32 value;
+      do
+      {
+        if (ip >= ip_end)
+          return false;
+        value = *(ip++);
+        match_length += value;
+      } while (value == 255);
+    }
+    match_length += LZ4_MIN_MATCH;
+    if (match_length > static_cast<u32>(op_end - op))
+      return false;
+
+    // Matches may overlap their own output, which is how runs are encoded.
+    const byte* match = op - offset;
+    if (offset >= match_length)
+    {
+      std::memcpy(op, match, match_length);
+      op += match_length;
+    }
+    else
+    {
+      for (u32 i = 0; i < match_length; i++)
+        *(op++) = match[i];
+    }
+  }
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "YBaseLib/ByteStream.h"
+#include "common/types.h"
+#include <memory>
+#include <vector>
+
+// Read-only disk image which is stored as fixed-size blocks, each either elided (all zeros), stored as-is, or
+// LZ4-compressed. A block index follows the header, so any block can be located without scanning the file.
+// Decompressed blocks are kept in a small LRU cache, since disk accesses rarely span more than a few blocks.
+// HDDImage uses these as a base image, with writes going to the replay log as for raw images.
+class BlockImage
+{
+public:
+  static constexpr u32 DefaultBlockSize = 65536;
+  static constexpr u32 DefaultCacheBlockCount = 8;
+
+  enum class Compression : u32
+  {
+    Zero,
+    None,
+    LZ4,
+    Count
+  };
+
+  ~BlockImage();
+
+  // Returns true if the stream starts with a block image header. The stream position is not preserved.
+  static bool IsBlockImage(ByteStream* stream);
+
+  // Takes a reference to the stream, which must be seekable.
+  static std::unique_ptr<BlockImage> Open(ByteStream* stream);
+
+  // Writes a block image containing the first image_size bytes of src to dst. Blocks which do not shrink when
+  // compressed are stored uncompressed.
+  static bool Create(ByteStream* src, u64 image_size, ByteStream* dst, u32 block_size = DefaultBlockSize);
+
+  u64 GetImageSize() const { return m_image_size; }
+  u32 GetBlockSize() const { return m_block_size; }
+  u32 GetBlockCount() const { return static_cast<u32>(m_index.size()); }
+
+  u32 GetCacheBlockCount() const { return static_cast<u32>(m_cache.size()); }
+  void SetCacheBlockCount(u32 count);
+
+  bool Read(void* buffer, u64 offset, u32 size);
+
+  // LZ4 block format, without the frame header. Compress returns the compressed size, or zero if the output did not
+  // fit in dst_capacity bytes. Decompress fails unless the input decodes to exactly dst_size bytes.
+  static u32 CompressLZ4(const byte* src, u32 src_size, byte* dst, u32 dst_capacity);
+  static bool DecompressLZ4(const byte* src, u32 src_size, byte* dst, u32 dst_size);
+
+private:
+  static constexpr u32 HEADER_MAGIC = 0x42454350; // PCEB
+  static constexpr u32 HEADER_VERSION = 1;
+
+#pragma pack(push, 1)
+  struct HEADER
+  {
+    u32 magic;
+    u32 version;
+    u64 image_size;
+    u32 block_size;
+    u32 block_count;
+    u64 index_offset;
+  };
+  struct INDEX_ENTRY
+  {
+    u64 offset;
+    u32 stored_size;
+    Compression compression;
+  };
+#pragma pack(pop)
+
+  struct CachedBlock
+  {
+    std::unique_ptr<byte[]> data;
+    u32 block_index = 0xFFFFFFFFu;
+    u64 last_used = 0;
+  };
+
+  BlockImage(ByteStream* stream, const HEADER& header, std::vector<INDEX_ENTRY> index);
+
+  const byte* GetBlock(u32 block_index);
+  bool LoadBlock(u32 block_index, byte* data);
+
+  ByteStream* m_stream;
+  u64 m_image_size;
+  u32 m_block_size;
+  std::vector<INDEX_ENTRY> m_index;
+
+  std::vector<CachedBlock> m_cache;
+  u64 m_cache_clock = 0;
+  std::vector<byte> m_compressed_buffer;
+};
@@ -0,0 +1,476 @@
+#include "cd_image.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/Log.h"
+#include "common/block_image.h"
+#include "common/mapped_file.h"
+#include <algorithm>
+#include <cctype>
+#include <cinttypes>
+#include <cstring>
+Log_SetChannel(CDImage);
+
+CDImage::File::~File()
+{
+  block_image.reset();
+  if (stream)
+    stream->Release();
+}
+
+bool CDImage::File::Read(u64 offset, u32 size, void* buffer)
+{
+  if (block_image)
+    return block_image->Read(buffer, offset, size);
+
+  if (mapping)
+  {
+    const byte* data = mapping->GetPointer(offset, size);
+    if (!data)
+      return false;
+
+    std::memcpy(buffer, data, size);
+    return true;
+  }
+
+  return stream->SeekAbsolute(offset) && stream->Read2(buffer, size);
+}
+
+CDImage::CDImage() = default;
+
+CDImage::~CDImage() = default;
+
+std::unique_ptr<CDImage> CDImage::Open(const char* filename)
+{
+  const size_t length = std::strlen(filename);
+  const char* extension = (length >= 4) ? (filename + length - 4) : "";
+  if (extension[0] == '.' && std::tolower(extension[1]) == 'c' && std::tolower(extension[2]) == 'u' &&
+      std::tolower(extension[3]) == 'e')
+  {
+    return OpenCueSheet(filename);
+  }
+
+  return OpenFlat(filename);
+}
+
+const CDImage::Track* CDImage::GetTrackForLBA(u64 lba) const
+{
+  for (const Track& track : m_tracks)
+  {
+    if ((lba + track.pregap) >= track.start_lba && lba < track.GetEndLBA())
+      return &track;
+  }
+
+  return nullptr;
+}
+
+bool CDImage::ReadDataSectors(u64 lba, u32 sector_count, void* buffer)
+{
+  byte* buffer_ptr = static_cast<byte*>(buffer);
+  while (sector_count > 0)
+  {
+    if (lba >= m_sector_count)
+      return false;
+
+    const Track* track = GetTrackForLBA(lba);
+    if (!track)
+    {
+      std::memset(buffer_ptr, 0, DATA_SECTOR_SIZE);
+      buffer_ptr += DATA_SECTOR_SIZE;
+      lba++;
+      sector_count--;
+      continue;
+    }
+
+    if (track->IsAudio())
+    {
+      Log_DevPrintf("Data read of audio sector %" PRIu64 " in track %u", lba, track->number);
+      return false;
+    }
+
+    const u32 count = static_cast<u32>(std::min(ZeroExtend64(sector_count), track->GetEndLBA() - lba));
+    if (!ReadSectorRange(*track, lba, count, GetUserDataOffset(track->mode), DATA_SECTOR_SIZE, buffer_ptr))
+      return false;
+
+    buffer_ptr += count * DATA_SECTOR_SIZE;
+    lba += count;
+    sector_count -= count;
+  }
+
+  return true;
+}
+
+bool CDImage::ReadRawSector(u64 lba, void* buffer)
+{
+  if (lba >= m_sector_count)
+    return false;
+
+  const Track* track = GetTrackForLBA(lba);
+  if (!track)
+  {
+    std::memset(buffer, 0, RAW_SECTOR_SIZE);
+    return true;
+  }
+
+  if (track->mode != TrackMode::Mode1)
+    return ReadSectorRange(*track, lba, 1, 0, RAW_SECTOR_SIZE, static_cast<byte*>(buffer));
+
+  // Sync pattern, then the address in BCD and the mode.
+  byte* sector = static_cast<byte*>(buffer);
+  std::memset(sector, 0, RAW_SECTOR_SIZE);
+  std::memset(sector + 1, 0xFF, 10);
+
+  u8 minute, second, frame;
+  LBAToMSF(lba, &minute, &second, &frame);
+  sector[12] = static_cast<byte>(((minute / 10) << 4) | (minute % 10));
+  sector[13] = static_cast<byte>(((second / 10) << 4) | (second % 10));
+  sector[14] = static_cast<byte>(((frame / 10) << 4) | (frame % 10));
+  sector[15] = 1;
+  return ReadSectorRange(*track, lba, 1, 0, DATA_SECTOR_SIZE, sector + 16);
+}
+
+u32 CDImage::GetUserDataOffset(TrackMode mode)
+{
+  switch (mode)
+  {
+    case TrackMode::Mode1Raw:
+      return 16;
+
+    case TrackMode::Mode2Raw:
+      return 24;
+
+    default:
+      return 0;
+  }
+}
+
+void CDImage::LBAToMSF(u64 lba, u8* minute, u8* second, u8* frame)
+{
+  const u64 position = lba + LEAD_IN_SECTORS;
+  *minute = static_cast<u8>(position / (FRAMES_PER_SECOND * SECONDS_PER_MINUTE));
+  *second = static_cast<u8>((position / FRAMES_PER_SECOND) % SECONDS_PER_MINUTE);
+  *frame = static_cast<u8>(position % FRAMES_PER_SECOND);
+}
+
+bool CDImage::ReadSectorRange(const Track& track, u64 lba, u32 sector_count, u32 offset_in_sector, u32 size,
+                              byte* buffer)
+{
+  File* file = m_files[track.file_index].get();
+  const u32 sector_size = GetSectorSize(track.mode);
+  const u64 offset = track.file_offset + (lba + track.pregap - track.start_lba) * sector_size;
+
+  // Whole sectors are contiguous in the file.
+  if (offset_in_sector == 0 && size == sector_size)
+    return file->Read(offset, sector_count * sector_size, buffer);
+
+  for (u32 i = 0; i < sector_count; i++)
+  {
+    if (!file->Read(offset + ZeroExtend64(i) * sector_size + offset_in_sector, size, buffer + i * size))
+      return false;
+  }
+
+  return true;
+}
+
+bool CDImage::AddFile(const char* filename)
+{
+  std::unique_ptr<File> file = std::make_unique<File>();
+  file->filename = filename;
+  file->stream = FileSystem::OpenFile(filename, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_SEEKABLE);
+  if (!file->stream)
+  {
+    Log_ErrorPrintf("Failed to open CD image file '%s'", filename);
+    return false;
+  }
+
+  if (BlockImage::IsBlockImage(file->stream))
+  {
+    file->block_image = BlockImage::Open(file->stream);
+    if (!file->block_image)
+    {
+      Log_ErrorPrintf("Failed to open block image '%s'", filename);
+      return false;
+    }
+
+    file->size = file->block_image->GetImageSize();
+  }
+  else
+  {
+    file->mapping = MappedFile::Open(filename);
+    file->size = file->stream->GetSize();
+  }
+
+  m_files.push_back(std::move(file));
+  return true;
+}
+
+std::unique_ptr<CDImage> CDImage::OpenFlat(const char* filename)
+{
+  std::unique_ptr<CDImage> image(new CDImage());
+  if (!image->AddFile(filename))
+    return nullptr;
+
+  const u64 file_size = image->m_files[0]->size;
+  if (file_size < DATA_SECTOR_SIZE)
+  {
+    Log_ErrorPrintf("File '%s' does not contain at least one sector", filename);
+    return nullptr;
+  }
+
+  if ((file_size % DATA_SECTOR_SIZE) != 0)
+  {
+    Log_WarningPrintf("File '%s' is not aligned to sector size. (%" PRIu64 " vs %u bytes)", filename, file_size,
+                      DATA_SECTOR_SIZE);
+  }
+
+  Track track = {};
+  track.number = 1;
+  track.mode = TrackMode::Mode1;
+  track.length = file_size / DATA_SECTOR_SIZE;
+  image->m_tracks.push_back(track);
+  image->m_sector_count = track.length;
+  return image;
+}
+
+// Splits a CUE sheet line into words, keeping quoted strings together.
+static std::vector<std::string> TokenizeCueLine(const std::string& line)
+{
+  std::vector<std::string> tokens;
+  size_t pos = 0;
+  while (pos < line.length())
+  {
+    if (std::isspace(static_cast<unsigned char>(line[pos])))
+    {
+      pos++;
+      continue;
+    }
+
+    if (line[pos] == '"')
+    {
+      const size_t end = line.find('"', pos + 1);
+      tokens.push_back(line.substr(pos + 1, (end == std::string::npos) ? std::string::npos : (end - pos - 1)));
+      pos = (end == std::string::npos) ? line.length() : (end + 1);
+      continue;
+    }
+
+    size_t end = pos;
+    while (end < line.length() && !std::isspace(static_cast<unsigned char>(line[end])))
+      end++;
+    tokens.push_back(line.substr(pos, end - pos));
+    pos = end;
+  }
+
+  return tokens;
+}
+
+// Parses a mm:ss:ff time, which in CUE sheets is relative to the start of the file.
+static bool ParseCueTime(const std::string& str, u64* frames)
+{
+  unsigned minute, second, frame;
+  if (std::sscanf(str.c_str(), "%u:%u:%u", &minute, &second, &frame) != 3 ||
+      second >= CDImage::SECONDS_PER_MINUTE || frame >= CDImage::FRAMES_PER_SECOND)
+  {
+    return false;
+  }
+
+  *frames = (ZeroExtend64(minute) * CDImage::SECONDS_PER_MINUTE + second) * CDImage::FRAMES_PER_SECOND + frame;
+  return true;
+}
+
+std::unique_ptr<CDImage> CDImage::OpenCueSheet(const char* filename)
+{
+  ByteStream* stream = FileSystem::OpenFile(filename, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_SEEKABLE);
+  if (!stream)
+  {
+    Log_ErrorPrintf("Failed to open CUE sheet '%s'", filename);
+    return nullptr;
+  }
+
+  std::string text(static_cast<size_t>(stream->GetSize()), '\0');
+  const bool read_result = text.empty() || stream->Read2(&text[0], static_cast<u32>(text.size()));
+  stream->Release();
+  if (!read_result)
+    return nullptr;
+
+  // Files referenced by the sheet are relative to it.
+  const std::string cue_filename(filename);
+  const size_t separator_pos = cue_filename.find_last_of("/\\");
+  const std::string directory =
+    (separator_pos == std::string::npos) ? std::string() : cue_filename.substr(0, separator_pos + 1);
+
+  struct CueTrack
+  {
+    u32 number;
+    TrackMode mode;
+    u32 file_index;
+    u64 index0;
+    u64 index1;
+    u64 unstored_pregap;
+    bool has_index0;
+    bool has_index1;
+  };
+  std::vector<CueTrack> cue_tracks;
+
+  std::unique_ptr<CDImage> image(new CDImage());
+  u32 line_number = 0;
+  size_t line_start = 0;
+  while (line_start < text.length())
+  {
+    size_t line_end = text.find_first_of("\r\n", line_start);
+    if (line_end == std::string::npos)
+      line_end = text.length();
+
+    const std::vector<std::string> tokens = TokenizeCueLine(text.substr(line_start, line_end - line_start));
+    line_start = line_end + 1;
+    line_number++;
+    if (tokens.empty())
+      continue;
+
+    std::string command = tokens[0];
+    std::transform(command.begin(), command.end(), command.begin(), ::toupper);
+    if (command == "FILE")
+    {
+      // Only little-endian raw images are supported. MOTOROLA files store audio big-endian and WAVE files have a
+      // header, neither of which is handled by the sector reader.
+      if (tokens.size() < 3 || tokens[2] != "BINARY")
+      {
+        Log_ErrorPrintf("%s:%u: unsupported FILE type '%s', only BINARY files are supported", filename, line_number,
+                        tokens.size() < 3 ? "" : tokens[2].c_str());
+        return nullptr;
+      }
+
+      const std::string& file_name = tokens[1];
+      const bool absolute = (!file_name.empty() && (file_name[0] == '/' || file_name[0] == '\\')) ||
+                            (file_name.length() > 1 && file_name[1] == ':');
+      if (!image->AddFile((absolute ? file_name : (directory + file_name)).c_str()))
+        return nullptr;
+    }
+    else if (command == "TRACK")
+    {
+      CueTrack track = {};
+      if (image->m_files.empty() || tokens.size() < 3 || std::sscanf(tokens[1].c_str(), "%u", &track.number) != 1)
+      {
+        Log_ErrorPrintf("%s:%u: invalid TRACK", filename, line_number);
+        return nullptr;
+      }
+
+      if (tokens[2] == "MODE1/2048")
+        track.mode = TrackMode::Mode1;
+      else if (tokens[2] == "MODE1/2352")
+        track.mode = TrackMode::Mode1Raw;
+      else if (tokens[2] == "MODE2/2352")
+        track.mode = TrackMode::Mode2Raw;
+      else if (tokens[2] == "AUDIO")
+        track.mode = TrackMode::Audio;
+      else
+      {
+        Log_ErrorPrintf("%s:%u: unsupported track mode '%s'", filename, line_number, tokens[2].c_str());
+        return nullptr;
+      }
+
+      track.file_index = static_cast<u32>(image->m_files.size() - 1);
+      cue_tracks.push_back(track);
+    }
+    else if (command == "INDEX" || command == "PREGAP")
+    {
+      const bool is_index = (command == "INDEX");
+      unsigned index_number = 0;
+      u64 frames;
+      if (cue_tracks.empty() || tokens.size() < (is_index ? 3u : 2u) ||
+          (is_index && std::sscanf(tokens[1].c_str(), "%u", &index_number) != 1) ||
+          !ParseCueTime(tokens[is_index ? 2 : 1], &frames))
+      {
+        Log_ErrorPrintf("%s:%u: invalid %s", filename, line_number, command.c_str());
+        return nullptr;
+      }
+
+      CueTrack& track = cue_tracks.back();
+      if (!is_index)
+      {
+        track.unstored_pregap = frames;
+      }
+      else if (index_number == 0)
+      {
+        track.index0 = frames;
+        track.has_index0 = true;
+      }
+      else if (index_number == 1)
+      {
+        track.index1 = frames;
+        track.has_index1 = true;
+      }
+    }
+
+    // Everything else (REM, TITLE, FLAGS, etc.) only describes the disc.
+  }
+
+  if (cue_tracks.empty())
+  {
+    Log_ErrorPrintf("CUE sheet '%s' has no tracks", filename);
+    return nullptr;
+  }
+
+  // Lay the tracks out on the disc. Within a file, each track runs up to the first index of the next one. Pregaps
+  // which are not stored in the file shift everything after them.
+  u64 file_base_lba = 0;
+  u64 unstored_sectors = 0;
+  for (size_t i = 0; i < cue_tracks.size(); i++)
+  {
+    const CueTrack& ct = cue_tracks[i];
+    const u64 first_index = ct.has_index0 ? ct.index0 : ct.index1;
+    if (!ct.has_index1 || first_index > ct.index1)
+    {
+      Log_ErrorPrintf("Track %u in CUE sheet '%s' has invalid indices", ct.number, filename);
+      return nullptr;
+    }
+
+    const u32 sector_size = GetSectorSize(ct.mode);
+    const bool first_in_file = (i == 0 || cue_tracks[i - 1].file_index != ct.file_index);
+    const bool last_in_file = (i == (cue_tracks.size() - 1) || cue_tracks[i + 1].file_index != ct.file_index);
+
+    Track track = {};
+    track.number = ct.number;
+    track.mode = ct.mode;
+    track.pregap = ct.index1 - first_index;
+    track.file_index = ct.file_index;
+    if (first_in_file)
+    {
+      if (i > 0)
+        file_base_lba = image->m_tracks.back().GetEndLBA() - unstored_sectors;
+      track.file_offset = first_index * sector_size;
+    }
+    else
+    {
+      const Track& previous = image->m_tracks.back();
+      track.file_offset = previous.file_offset + (previous.pregap + previous.length) * GetSectorSize(previous.mode);
+    }
+
+    unstored_sectors += ct.unstored_pregap;
+    track.start_lba = file_base_lba + unstored_sectors + ct.index1;
+
+    const u64 file_size = image->m_files[ct.file_index]->size;
+    if (!last_in_file)
+    {
+      const CueTrack& next = cue_tracks[i + 1];
+      const u64 next_first_index = next.has_index0 ? next.index0 : next.index1;
+      track.length = (next_first_index >= ct.index1) ? (next_first_index - ct.index1) : 0;
+    }
+    else
+    {
+      const u64 stored_sectors = (file_size > track.file_offset) ? ((file_size - track.file_offset) / sector_size) : 0;
+      track.length = (stored_sectors > track.pregap) ? (stored_sectors - track.pregap) : 0;
+    }
+
+    if (track.length == 0)
+    {
+      Log_ErrorPrintf("Track %u in CUE sheet '%s' is empty", ct.number, filename);
+      return nullptr;
+    }
+
+    Log_DevPrintf("Track %u: mode %u, LBA %" PRIu64 ", %" PRIu64 " sectors, pregap %" PRIu64, track.number,
+                  static_cast<u32>(track.mode), track.start_lba, track.length, track.pregap);
+    image->m_tracks.push_back(track);
+  }
+
+  image->m_sector_count = image->m_tracks.back().GetEndLBA();
+  return image;
+}
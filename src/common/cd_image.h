@@ -0,0 +1,100 @@
+#pragma once
+#include "common/types.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+class BlockImage;
+class ByteStream;
+class MappedFile;
+
+// Read-only CD image, made up of tracks which are each backed by a region of a file. Supported are flat images of
+// 2048-byte sectors (ISO), and CUE sheets referencing BIN files with 2048 or 2352-byte sectors, which can hold audio
+// tracks. Any of the files can be a block image instead, in which case sectors are decompressed on demand.
+// Sectors which are not backed by a file, e.g. a pregap which is not stored, read as zeros.
+class CDImage
+{
+public:
+  static constexpr u32 DATA_SECTOR_SIZE = 2048;
+  static constexpr u32 RAW_SECTOR_SIZE = 2352;
+  static constexpr u32 FRAMES_PER_SECOND = 75;
+  static constexpr u32 SECONDS_PER_MINUTE = 60;
+
+  // LBA 0 is at 00:02:00 on the disc.
+  static constexpr u32 LEAD_IN_SECTORS = 2 * FRAMES_PER_SECOND;
+
+  enum class TrackMode : u32
+  {
+    Mode1,    // 2048-byte user data only
+    Mode1Raw, // 2352-byte sectors, with user data at offset 16
+    Mode2Raw, // 2352-byte sectors, with form 1 user data at offset 24
+    Audio     // 2352-byte sectors of 16-bit stereo samples
+  };
+
+  struct Track
+  {
+    u32 number;
+    TrackMode mode;
+    u64 start_lba; // index 01
+    u64 length;    // from start_lba
+    u64 pregap;    // sectors before start_lba which are stored in the file
+    u32 file_index;
+    u64 file_offset; // of start_lba - pregap
+
+    bool IsAudio() const { return (mode == TrackMode::Audio); }
+    u64 GetEndLBA() const { return start_lba + length; }
+  };
+
+  ~CDImage();
+
+  // Opens a CUE sheet when the filename ends with .cue, otherwise a flat image of 2048-byte sectors.
+  static std::unique_ptr<CDImage> Open(const char* filename);
+
+  u64 GetSectorCount() const { return m_sector_count; }
+  u32 GetTrackCount() const { return static_cast<u32>(m_tracks.size()); }
+  const Track& GetTrack(u32 index) const { return m_tracks[index]; }
+
+  // Returns the track containing the sector, including its stored pregap, or null if it is not backed by a track.
+  const Track* GetTrackForLBA(u64 lba) const;
+
+  // Reads the 2048 bytes of user data of each sector. Fails if any sector is in an audio track.
+  bool ReadDataSectors(u64 lba, u32 sector_count, void* buffer);
+
+  // Reads whole 2352-byte sectors. For tracks stored as user data only, the sync pattern and header are generated,
+  // and the EDC/ECC bytes are left as zero.
+  bool ReadRawSector(u64 lba, void* buffer);
+
+  static u32 GetSectorSize(TrackMode mode) { return (mode == TrackMode::Mode1) ? DATA_SECTOR_SIZE : RAW_SECTOR_SIZE; }
+  static u32 GetUserDataOffset(TrackMode mode);
+
+  // Converts an LBA to an absolute MSF address, which includes the lead-in.
+  static void LBAToMSF(u64 lba, u8* minute, u8* second, u8* frame);
+
+private:
+  struct File
+  {
+    std::string filename;
+    ByteStream* stream = nullptr;
+    std::unique_ptr<MappedFile> mapping;
+    std::unique_ptr<BlockImage> block_image;
+    u64 size = 0;
+
+    ~File();
+
+    bool Read(u64 offset, u32 size, void* buffer);
+  };
+
+  CDImage();
+
+  static std::unique_ptr<CDImage> OpenFlat(const char* filename);
+  static std::unique_ptr<CDImage> OpenCueSheet(const char* filename);
+
+  bool AddFile(const char* filename);
+
+  // Reads size bytes from each sector, starting at offset within the sector.
+  bool ReadSectorRange(const Track& track, u64 lba, u32 sector_count, u32 offset_in_sector, u32 size, byte* buffer);
+
+  std::vector<std::unique_ptr<File>> m_files;
+  std::vector<Track> m_tracks;
+  u64 m_sector_count = 0;
+};
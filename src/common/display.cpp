@@ -2,6 +2,7 @@
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/Math.h"
 #include "display_renderer.h"
+#include "framebuffer_convert.h"
 #include <algorithm>
 #include <cstring>
 
@@ -13,14 +14,12 @@ Display::Display(DisplayRenderer* manager, const String& name, Type type, u8 pri
 Display::~Display()
 {
   m_renderer->RemoveDisplay(this);
-  DestroyFramebuffer(&m_front_buffer);
-  DestroyFramebuffer(&m_back_buffers[0]);
-  DestroyFramebuffer(&m_back_buffers[1]);
+  for (u32 i = 0; i < 3; i++)
+    DestroyFramebuffer(&m_framebuffers.GetBuffer(i));
 }
 
 void Display::SetEnable(bool enabled)
 {
-  std::lock_guard<std::mutex> guard(m_buffer_lock);
   if (m_enabled == enabled)
     return;
 
@@ -56,14 +55,16 @@ void Display::ResizeDisplay(u32 width /*= 0*/, u32 height /*= 0*/)
     float display_aspect_ratio =
       static_cast<float>(m_display_aspect_numerator) / static_cast<float>(m_display_aspect_denominator);
     // float ratio = pixel_aspect_ratio / display_aspect_ratio;
-    m_display_width = std::max(1u, m_framebuffer_width * m_display_scale);
-    m_display_height = std::max(1u, static_cast<u32>(static_cast<float>(m_display_width) / display_aspect_ratio));
+    const u32 display_width = std::max(1u, m_framebuffer_width * m_display_scale);
+    m_display_width.store(display_width, std::memory_order_relaxed);
+    m_display_height.store(std::max(1u, static_cast<u32>(static_cast<float>(display_width) / display_aspect_ratio)),
+                           std::memory_order_relaxed);
   }
   else
   {
     DebugAssert(width > 0 && height > 0);
-    m_display_width = width * m_display_scale;
-    m_display_height = height * m_display_scale;
+    m_display_width.store(width * m_display_scale, std::memory_order_relaxed);
+    m_display_height.store(height * m_display_scale, std::memory_order_relaxed);
   }
 
   m_renderer->DisplayResized(this);
@@ -71,52 +72,38 @@ void Display::ResizeDisplay(u32 width /*= 0*/, u32 height /*= 0*/)
 
 void Display::ClearFramebuffer()
 {
-  if (m_back_buffers[0].width > 0 && m_back_buffers[0].height > 0)
-    std::memset(m_back_buffers[0].data, 0, m_back_buffers[0].stride * m_back_buffers[0].height);
+  Framebuffer& back = GetBackbuffer();
+  if (back.width > 0 && back.height > 0)
+    std::memset(back.data, 0, back.stride * back.height);
 
   SwapFramebuffer();
 }
 
-void Display::SwapFramebuffer()
+void Display::SwapFramebuffer(bool preserve_contents /* = false */)
 {
-  // Make it visible to the render thread.
-  {
-    std::lock_guard<std::mutex> guard(m_buffer_lock);
-    std::swap(m_back_buffers[0].data, m_back_buffers[1].data);
-    std::swap(m_back_buffers[0].width, m_back_buffers[1].width);
-    std::swap(m_back_buffers[0].height, m_back_buffers[1].height);
-    std::swap(m_back_buffers[0].stride, m_back_buffers[1].stride);
-    std::swap(m_back_buffers[0].format, m_back_buffers[1].format);
-    m_back_buffers[1].dirty = true;
-    m_renderer->DisplayFramebufferSwapped(this);
-  }
+  // Make it visible to the renderer. The buffer we get back is either the one the renderer has finished with, or
+  // a frame it never picked up, so it may be stale or a different size.
+  const u32 presented_index = m_framebuffers.GetWriteIndex();
+  m_framebuffers.Publish();
+  m_renderer->DisplayFramebufferSwapped(this);
 
   // Ensure backbuffer is up to date.
-  if (m_back_buffers[0].width != m_framebuffer_width || m_back_buffers[0].height != m_framebuffer_height ||
-      m_back_buffers[0].format != m_framebuffer_format)
+  Framebuffer& back = GetBackbuffer();
+  if (back.width != m_framebuffer_width || back.height != m_framebuffer_height || back.format != m_framebuffer_format)
+    AllocateFramebuffer(&back);
+
+  // Carry the frame we just presented over to the new backbuffer, so that callers which only redraw changed regions
+  // still see the complete image. The renderer only ever reads the presented buffer, so no lock is needed.
+  const Framebuffer& presented = m_framebuffers.GetBuffer(presented_index);
+  if (preserve_contents && presented.data && back.width == presented.width && back.height == presented.height &&
+      back.format == presented.format)
   {
-    AllocateFramebuffer(&m_back_buffers[0]);
+    std::memcpy(back.data, presented.data, back.stride * back.height);
   }
 
   AddFrameRendered();
 }
 
-bool Display::UpdateFrontbuffer()
-{
-  std::lock_guard<std::mutex> guard(m_buffer_lock);
-  if (!m_back_buffers[1].dirty)
-    return false;
-
-  std::swap(m_front_buffer.data, m_back_buffers[1].data);
-  std::swap(m_front_buffer.width, m_back_buffers[1].width);
-  std::swap(m_front_buffer.height, m_back_buffers[1].height);
-  std::swap(m_front_buffer.stride, m_back_buffers[1].stride);
-  std::swap(m_front_buffer.format, m_back_buffers[1].format);
-  m_back_buffers[1].dirty = false;
-  m_front_buffer.dirty = true;
-  return true;
-}
-
 void Display::AllocateFramebuffer(Framebuffer* fbuf)
 {
   DestroyFramebuffer(fbuf);
@@ -128,25 +115,7 @@ void Display::AllocateFramebuffer(Framebuffer* fbuf)
 
   if (m_framebuffer_width > 0 && m_framebuffer_height > 0)
   {
-    switch (m_framebuffer_format)
-    {
-      case FramebufferFormat::RGB8:
-      case FramebufferFormat::BGR8:
-        fbuf->stride = m_framebuffer_width * 3;
-        break;
-
-      case FramebufferFormat::RGBX8:
-      case FramebufferFormat::BGRX8:
-        fbuf->stride = m_framebuffer_width * 4;
-        break;
-
-      case FramebufferFormat::RGB565:
-      case FramebufferFormat::BGR555:
-      case FramebufferFormat::BGR565:
-        fbuf->stride = m_framebuffer_width * 2;
-        break;
-    }
-
+    fbuf->stride = m_framebuffer_width * FramebufferConvert::GetBytesPerPixel(m_framebuffer_format);
     fbuf->data = new byte[fbuf->stride * m_framebuffer_height];
   }
 }
@@ -167,7 +136,7 @@ void Display::ResizeFramebuffer(u32 width, u32 height)
 
   m_framebuffer_width = width;
   m_framebuffer_height = height;
-  AllocateFramebuffer(&m_back_buffers[0]);
+  AllocateFramebuffer(&GetBackbuffer());
 }
 
 void Display::ChangeFramebufferFormat(FramebufferFormat new_format)
@@ -176,7 +145,7 @@ void Display::ChangeFramebufferFormat(FramebufferFormat new_format)
     return;
 
   m_framebuffer_format = new_format;
-  AllocateFramebuffer(&m_back_buffers[0]);
+  AllocateFramebuffer(&GetBackbuffer());
 }
 
 void Display::SetPixel(u32 x, u32 y, u8 r, u8 g, u8 b)
@@ -187,26 +156,27 @@ void Display::SetPixel(u32 x, u32 y, u8 r, u8 g, u8 b)
 void Display::SetPixel(u32 x, u32 y, u32 rgb)
 {
   DebugAssert(x < m_framebuffer_width && y < m_framebuffer_height);
+  Framebuffer& back = GetBackbuffer();
 
   // Assumes LE order in rgb and framebuffer.
   switch (m_framebuffer_format)
   {
     case FramebufferFormat::RGB8:
     {
-      std::memcpy(&m_back_buffers[0].data[y * m_back_buffers[0].stride + x * 3], &rgb, 3);
+      std::memcpy(&back.data[y * back.stride + x * 3], &rgb, 3);
     }
     break;
 
     case FramebufferFormat::RGBX8:
     {
       rgb |= 0xFF000000;
-      std::memcpy(&m_back_buffers[0].data[y * m_back_buffers[0].stride + x * 4], &rgb, 4);
+      std::memcpy(&back.data[y * back.stride + x * 4], &rgb, 4);
     }
     break;
 
     case FramebufferFormat::RGB565:
     {
-      std::memcpy(&m_back_buffers[0].data[y * m_back_buffers[0].stride + x * 2], &rgb, 2);
+      std::memcpy(&back.data[y * back.stride + x * 2], &rgb, 2);
       break;
     }
     break;
@@ -215,20 +185,21 @@ void Display::SetPixel(u32 x, u32 y, u32 rgb)
 
 void Display::CopyFrame(const void* pixels, u32 stride)
 {
-  if (stride == m_back_buffers[0].stride)
+  Framebuffer& back = GetBackbuffer();
+  if (stride == back.stride)
   {
-    std::memcpy(m_back_buffers[0].data, pixels, stride * m_framebuffer_height);
+    std::memcpy(back.data, pixels, stride * m_framebuffer_height);
     return;
   }
 
   const byte* pixels_src = reinterpret_cast<const byte*>(pixels);
-  byte* pixels_dst = m_back_buffers[0].data;
-  u32 copy_stride = std::min(m_back_buffers[0].stride, stride);
+  byte* pixels_dst = back.data;
+  u32 copy_stride = std::min(back.stride, stride);
   for (u32 i = 0; i < m_framebuffer_height; i++)
   {
     std::memcpy(pixels_dst, pixels_src, copy_stride);
     pixels_src += stride;
-    pixels_dst += m_back_buffers[0].stride;
+    pixels_dst += back.stride;
   }
 }
 
@@ -246,201 +217,21 @@ void Display::AddFrameRendered()
   float dt = float(m_frame_counter_timer.GetTimeSeconds());
   if (dt >= 1.0f)
   {
-    m_fps = float(m_frames_rendered) * (1.0f / dt);
+    m_fps.store(float(m_frames_rendered) * (1.0f / dt), std::memory_order_relaxed);
     m_frames_rendered = 0;
     m_frame_counter_timer.Reset();
   }
 }
 
-inline u32 ConvertRGB565ToRGBX8888(u16 color)
-{
-  u8 r = Truncate8(color & 31);
-  u8 g = Truncate8((color >> 5) & 63);
-  u8 b = Truncate8((color >> 11) & 31);
-
-  // 00012345 -> 1234545 / 00123456 -> 12345656
-  r = (r << 3) | (r >> 3);
-  g = (g << 2) | (g >> 4);
-  b = (b << 3) | (b >> 3);
-
-  return UINT32_C(0xFF000000) | ZeroExtend32(r) | (ZeroExtend32(g) << 8) | (ZeroExtend32(b) << 16);
-}
-
-inline u32 ConvertBGR555ToRGBX8888(u16 color)
-{
-  u8 b = Truncate8(color & 31);
-  u8 g = Truncate8((color >> 5) & 31);
-  u8 r = Truncate8((color >> 10) & 31);
-
-  // 00012345 -> 1234545
-  b = (b << 3) | (b >> 3);
-  g = (g << 3) | (g >> 3);
-  r = (r << 3) | (r >> 3);
-
-  return UINT32_C(0xFF000000) | ZeroExtend32(r) | (ZeroExtend32(g) << 8) | (ZeroExtend32(b) << 16);
-}
-
-inline u32 ConvertBGR565ToRGBX8888(u16 color)
+void Display::CopyFramebufferToRGBA8Buffer(const Framebuffer* fbuf, void* dst, u32 dst_stride)
 {
-  u8 b = Truncate8(color & 31);
-  u8 g = Truncate8((color >> 5) & 63);
-  u8 r = Truncate8((color >> 11) & 31);
-
-  // 00012345 -> 1234545 / 00123456 -> 12345656
-  b = (b << 3) | (b >> 3);
-  g = (g << 2) | (g >> 4);
-  r = (r << 3) | (r >> 3);
-
-  return UINT32_C(0xFF000000) | ZeroExtend32(r) | (ZeroExtend32(g) << 8) | (ZeroExtend32(b) << 16);
+  FramebufferConvert::Convert(dst, dst_stride, FramebufferFormat::RGBX8, fbuf->data, fbuf->stride, fbuf->format,
+                              fbuf->width, fbuf->height);
 }
 
-void Display::CopyFramebufferToRGBA8Buffer(const Framebuffer* fbuf, void* dst, u32 dst_stride)
+void Display::CopyFramebufferToRGBA8BufferScaled(const Framebuffer* fbuf, void* dst, u32 dst_stride, u32 dst_width,
+                                                 u32 dst_height)
 {
-  const byte* src_ptr = reinterpret_cast<const byte*>(fbuf->data);
-  byte* dst_ptr = reinterpret_cast<byte*>(dst);
-
-  switch (fbuf->format)
-  {
-    case FramebufferFormat::RGB8:
-    {
-      // yuck.. TODO optimize this, using vectorization?
-      for (u32 row = 0; row < fbuf->height; row++)
-      {
-        const byte* src_row_ptr = src_ptr;
-        byte* dst_row_ptr = dst_ptr;
-        for (u32 col = 0; col < fbuf->width; col++)
-        {
-          u32 ocol = 0xFF000000;
-          ocol |= ZeroExtend32(*(src_row_ptr++));       // R
-          ocol |= ZeroExtend32(*(src_row_ptr++)) << 8;  // G
-          ocol |= ZeroExtend32(*(src_row_ptr++)) << 16; // B
-          std::memcpy(&ocol, dst_row_ptr, sizeof(ocol));
-          dst_row_ptr += sizeof(ocol);
-        }
-
-        src_ptr += fbuf->stride;
-        dst_ptr += dst_stride;
-      }
-    }
-    break;
-
-    case FramebufferFormat::RGBX8:
-    {
-      const u32 copy_size = std::min(fbuf->stride, dst_stride);
-      for (u32 row = 0; row < fbuf->height; row++)
-      {
-        std::memcpy(dst_ptr, src_ptr, copy_size);
-        src_ptr += fbuf->stride;
-        dst_ptr += dst_stride;
-      }
-    }
-    break;
-
-    case FramebufferFormat::BGR8:
-    {
-      // yuck.. TODO optimize this, using vectorization?
-      for (u32 row = 0; row < fbuf->height; row++)
-      {
-        const byte* src_row_ptr = src_ptr;
-        byte* dst_row_ptr = dst_ptr;
-        for (u32 col = 0; col < fbuf->width; col++)
-        {
-          u32 ocol = 0xFF000000;
-          ocol |= ZeroExtend32(*(src_row_ptr++)) << 16; // B
-          ocol |= ZeroExtend32(*(src_row_ptr++)) << 8;  // G
-          ocol |= ZeroExtend32(*(src_row_ptr++));       // R
-          std::memcpy(&ocol, dst_row_ptr, sizeof(ocol));
-          dst_row_ptr += sizeof(ocol);
-        }
-
-        src_ptr += fbuf->stride;
-        dst_ptr += dst_stride;
-      }
-    }
-    break;
-
-    case FramebufferFormat::BGRX8:
-    {
-      for (u32 row = 0; row < fbuf->height; row++)
-      {
-        const u32* row_src_ptr = reinterpret_cast<const u32*>(src_ptr);
-        u32* row_dst_ptr = reinterpret_cast<u32*>(dst_ptr);
-        for (u32 col = 0; col < fbuf->width; col++)
-        {
-          const u32 pix = *(row_src_ptr++);
-          *(row_dst_ptr++) =
-            (pix & UINT32_C(0xFF00FF00)) | ((pix & UINT32_C(0xFF)) << 16) | ((pix >> 16) & UINT32_C(0xFF));
-        }
-        src_ptr += fbuf->stride;
-        dst_ptr += dst_stride;
-      }
-    }
-    break;
-
-    case FramebufferFormat::RGB565:
-    {
-      for (u32 row = 0; row < fbuf->height; row++)
-      {
-        const byte* src_row_ptr = src_ptr;
-        byte* dst_row_ptr = dst_ptr;
-        for (u32 col = 0; col < fbuf->width; col++)
-        {
-          u16 icol;
-          std::memcpy(&icol, src_row_ptr, sizeof(icol));
-          src_row_ptr += sizeof(icol);
-          u32 ocol = ConvertRGB565ToRGBX8888(icol);
-          std::memcpy(dst_row_ptr, &ocol, sizeof(ocol));
-          dst_row_ptr += sizeof(ocol);
-        }
-
-        src_ptr += fbuf->stride;
-        dst_ptr += dst_stride;
-      }
-    }
-    break;
-
-    case FramebufferFormat::BGR555:
-    {
-      for (u32 row = 0; row < fbuf->height; row++)
-      {
-        const byte* src_row_ptr = src_ptr;
-        byte* dst_row_ptr = dst_ptr;
-        for (u32 col = 0; col < fbuf->width; col++)
-        {
-          u16 icol;
-          std::memcpy(&icol, src_row_ptr, sizeof(icol));
-          src_row_ptr += sizeof(icol);
-          u32 ocol = ConvertBGR555ToRGBX8888(icol);
-          std::memcpy(dst_row_ptr, &ocol, sizeof(ocol));
-          dst_row_ptr += sizeof(ocol);
-        }
-
-        src_ptr += fbuf->stride;
-        dst_ptr += dst_stride;
-      }
-    }
-    break;
-
-    case FramebufferFormat::BGR565:
-    {
-      for (u32 row = 0; row < fbuf->height; row++)
-      {
-        const byte* src_row_ptr = src_ptr;
-        byte* dst_row_ptr = dst_ptr;
-        for (u32 col = 0; col < fbuf->width; col++)
-        {
-          u16 icol;
-          std::memcpy(&icol, src_row_ptr, sizeof(icol));
-          src_row_ptr += sizeof(icol);
-          u32 ocol = ConvertBGR565ToRGBX8888(icol);
-          std::memcpy(dst_row_ptr, &ocol, sizeof(ocol));
-          dst_row_ptr += sizeof(ocol);
-        }
-
-        src_ptr += fbuf->stride;
-        dst_ptr += dst_stride;
-      }
-    }
-    break;
-  }
+  FramebufferConvert::ConvertScaled(dst, dst_stride, FramebufferFormat::RGBX8, dst_width, dst_height, fbuf->data,
+                                    fbuf->stride, fbuf->format, fbuf->width, fbuf->height);
 }
@@ -2,9 +2,10 @@
 #include "YBaseLib/Common.h"
 #include "YBaseLib/String.h"
 #include "YBaseLib/Timer.h"
+#include "triple_buffer.h"
 #include "types.h"
+#include <atomic>
 #include <memory>
-#include <mutex>
 
 class DisplayRenderer;
 
@@ -45,22 +46,35 @@ public:
   void SetActive(bool active);
 
   u32 GetFramesRendered() const { return m_frames_rendered; }
-  float GetFramesPerSecond() const { return m_fps; }
+  float GetFramesPerSecond() const { return m_fps.load(std::memory_order_relaxed); }
   void ResetFramesRendered() { m_frames_rendered = 0; }
 
-  u32 GetDisplayWidth() const { return m_display_width; }
-  u32 GetDisplayHeight() const { return m_display_height; }
+  // The framebuffer and display size belong to whichever thread produces frames, which is not necessarily the
+  // emulation thread: VGA and ET4000 draw on their own render thread. ResizeFramebuffer, ChangeFramebufferFormat,
+  // ResizeDisplay and SwapFramebuffer must all be called from that thread, and the renderer's DisplayResized and
+  // DisplayFramebufferSwapped notifications are made on it too. The display size and frame rate may be read from the
+  // host thread while it runs, so they are atomic; the framebuffer itself only crosses over through the triple buffer.
+  u32 GetDisplayWidth() const { return m_display_width.load(std::memory_order_relaxed); }
+  u32 GetDisplayHeight() const { return m_display_height.load(std::memory_order_relaxed); }
+  u32 GetDisplayScale() const { return m_display_scale; }
   void SetDisplayScale(u32 scale) { m_display_scale = scale; }
   void SetDisplayAspectRatio(u32 numerator, u32 denominator);
   void ResizeDisplay(u32 width = 0, u32 height = 0);
 
   u32 GetFramebufferWidth() const { return m_framebuffer_width; }
   u32 GetFramebufferHeight() const { return m_framebuffer_height; }
+  FramebufferFormat GetFramebufferFormat() const { return m_framebuffer_format; }
 
   void ClearFramebuffer();
   void ResizeFramebuffer(u32 width, u32 height);
   void ChangeFramebufferFormat(FramebufferFormat new_format);
-  void SwapFramebuffer();
+
+  // Presents the backbuffer. If preserve_contents is set, the new backbuffer starts with a copy of the presented
+  // frame, which allows the caller to only redraw the regions which have changed. That copy is of the whole frame, so
+  // it is only worth it when the caller does redraw a small part of the screen; otherwise redraw everything.
+  // Never blocks: the buffers are handed to the renderer through a lock-free triple buffer, and if the renderer
+  // has not picked up the previous frame yet, that frame is dropped in favour of this one.
+  void SwapFramebuffer(bool preserve_contents = false);
 
   static constexpr u32 PackRGBX(u8 r, u8 g, u8 b)
   {
@@ -69,16 +83,16 @@ public:
   }
 
   // Changes pixels in the backbuffer.
-  byte* GetFramebufferPointer() const { return m_back_buffers[0].data; }
-  u32 GetFramebufferStride() const { return m_back_buffers[0].stride; }
+  byte* GetFramebufferPointer() const { return m_framebuffers.GetWriteBuffer().data; }
+  u32 GetFramebufferStride() const { return m_framebuffers.GetWriteBuffer().stride; }
   void SetPixel(u32 x, u32 y, u8 r, u8 g, u8 b);
   void SetPixel(u32 x, u32 y, u32 rgb);
   void CopyFrame(const void* pixels, u32 stride);
+
+  // Counts a frame without presenting a new image, for when the caller knows nothing has changed.
   void RepeatFrame();
 
 protected:
-  static constexpr u32 NUM_BACK_BUFFERS = 2;
-
   struct Framebuffer
   {
     byte* data = nullptr;
@@ -86,18 +100,25 @@ protected:
     u32 height = 0;
     u32 stride = 0;
     FramebufferFormat format = FramebufferFormat::RGBX8;
-    bool dirty = false;
   };
 
   void AddFrameRendered();
   void AllocateFramebuffer(Framebuffer* fbuf);
   void DestroyFramebuffer(Framebuffer* fbuf);
 
-  // Updates the front buffer. Returns false if the no swap has occurred.
-  bool UpdateFrontbuffer();
+  // Consumer side, normally the renderer's thread. Updates the front buffer, returns false if no new frame has been
+  // presented since the last call. The front buffer is owned by the consumer until the next successful update, so it
+  // can be uploaded directly without copying it out first.
+  bool UpdateFrontbuffer() { return m_framebuffers.Acquire(); }
+  const Framebuffer& GetFrontbuffer() const { return m_framebuffers.GetReadBuffer(); }
+
+  // Producer thread side, the buffer currently being drawn to.
+  Framebuffer& GetBackbuffer() { return m_framebuffers.GetWriteBuffer(); }
 
-  // Helper for converting/copying a framebuffer.
+  // Helpers for converting/copying a framebuffer, see FramebufferConvert.
   static void CopyFramebufferToRGBA8Buffer(const Framebuffer* fbuf, void* dst, u32 dst_stride);
+  static void CopyFramebufferToRGBA8BufferScaled(const Framebuffer* fbuf, void* dst, u32 dst_stride, u32 dst_width,
+                                                 u32 dst_height);
 
   DisplayRenderer* m_renderer;
   String m_name;
@@ -109,12 +130,10 @@ protected:
   u32 m_framebuffer_height = 0;
   FramebufferFormat m_framebuffer_format = FramebufferFormat::RGBX8;
 
-  Framebuffer m_front_buffer;
-  Framebuffer m_back_buffers[NUM_BACK_BUFFERS];
-  std::mutex m_buffer_lock;
+  TripleBuffer<Framebuffer> m_framebuffers;
 
-  u32 m_display_width = 640;
-  u32 m_display_height = 480;
+  std::atomic<u32> m_display_width{640};
+  std::atomic<u32> m_display_height{480};
   u32 m_display_scale = 1;
   u32 m_display_aspect_numerator = 1;
   u32 m_display_aspect_denominator = 1;
@@ -122,7 +141,7 @@ protected:
   static constexpr u32 FRAME_COUNTER_FRAME_COUNT = 100;
   Timer m_frame_counter_timer;
   u32 m_frames_rendered = 0;
-  float m_fps = 0.0f;
+  std::atomic<float> m_fps{0.0f};
 
   bool m_enabled = true;
   bool m_active = true;
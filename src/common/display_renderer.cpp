@@ -1,6 +1,7 @@
 #include "display_renderer.h"
 #include "display_renderer_d3d.h"
 #include "display_renderer_gl.h"
+#include "display_renderer_headless.h"
 
 DisplayRenderer::DisplayRenderer(WindowHandleType window_handle, u32 window_width, u32 window_height)
   : m_window_handle(window_handle), m_window_width(window_width), m_window_height(window_height)
@@ -185,6 +186,10 @@ std::unique_ptr<DisplayRenderer> DisplayRenderer::Create(BackendType backend, Wi
       renderer = std::make_unique<DisplayRendererGL>(window_handle, window_width, window_height);
       break;
 
+    case BackendType::Headless:
+      renderer = std::make_unique<DisplayRendererHeadless>(window_handle, window_width, window_height);
+      break;
+
     default:
       return nullptr;
   }
@@ -14,7 +14,8 @@ public:
   {
     Null,
     Direct3D,
-    OpenGL
+    OpenGL,
+    Headless
   };
 
   DisplayRenderer(WindowHandleType window_handle, u32 window_width, u32 window_height);
@@ -37,6 +38,8 @@ public:
 
   virtual void DisplayEnabled(Display* display);
   virtual void DisplayDisabled(Display* display);
+  // Called on the display's producer thread, which may be a device's render thread rather than the emulation or
+  // host thread. Implementations must not touch state used by RenderDisplays() without synchronizing with it.
   virtual void DisplayResized(Display* display);
   virtual void DisplayFramebufferSwapped(Display* display);
 
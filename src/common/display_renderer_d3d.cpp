@@ -107,11 +107,12 @@ void DisplayGL::UpdateFramebufferTexture()
 {
   ID3D11Device* d3d_device = static_cast<DisplayRendererD3D*>(m_renderer)->GetD3DDevice();
   ID3D11DeviceContext* d3d_context = static_cast<DisplayRendererD3D*>(m_renderer)->GetD3DContext();
+  const Framebuffer& front = GetFrontbuffer();
 
-  if (m_framebuffer_texture_width != m_front_buffer.width || m_framebuffer_texture_height != m_front_buffer.height)
+  if (m_framebuffer_texture_width != front.width || m_framebuffer_texture_height != front.height)
   {
-    m_framebuffer_texture_width = m_front_buffer.width;
-    m_framebuffer_texture_height = m_front_buffer.height;
+    m_framebuffer_texture_width = front.width;
+    m_framebuffer_texture_height = front.height;
     m_framebuffer_texture.Reset();
     m_framebuffer_texture_srv.Reset();
 
@@ -151,7 +152,7 @@ void DisplayGL::UpdateFramebufferTexture()
     return;
   }
 
-  CopyFramebufferToRGBA8Buffer(&m_front_buffer, sr.pData, sr.RowPitch);
+  CopyFramebufferToRGBA8Buffer(&front, sr.pData, sr.RowPitch);
 
   d3d_context->Unmap(m_framebuffer_texture.Get(), 0);
 }
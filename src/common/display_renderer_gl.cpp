@@ -17,13 +17,28 @@ public:
   void Render();
 
 private:
+  // Number of slots in the persistently-mapped upload buffer. The GPU can still be reading from a slot for a frame or
+  // two after it is queued, so with three slots we should never have to wait on a fence in practice.
+  static constexpr u32 NUM_UPLOAD_SLOTS = 3;
+
   void UpdateFramebufferTexture();
+  bool UploadWithPersistentBuffer(const Framebuffer& front);
+  bool AllocatePersistentBuffer(u32 slot_size);
+  void DestroyPersistentBuffer();
 
   GLuint m_framebuffer_texture_id = 0;
 
   u32 m_framebuffer_texture_width = 0;
   u32 m_framebuffer_texture_height = 0;
 
+  // Ring of upload slots in a single buffer, mapped once for the lifetime of the buffer. Each slot has a fence so we
+  // don't overwrite data the GPU has not consumed yet.
+  GLuint m_upload_buffer_id = 0;
+  byte* m_upload_buffer_pointer = nullptr;
+  u32 m_upload_buffer_slot_size = 0;
+  u32 m_upload_buffer_next_slot = 0;
+  std::array<GLsync, NUM_UPLOAD_SLOTS> m_upload_buffer_fences = {};
+
   std::vector<byte> m_framebuffer_texture_upload_buffer;
 };
 
@@ -35,6 +50,7 @@ DisplayGL::DisplayGL(DisplayRenderer* display_manager, const String& name, Type
 
 DisplayGL::~DisplayGL()
 {
+  DestroyPersistentBuffer();
   if (m_framebuffer_texture_id != 0)
     glDeleteTextures(1, &m_framebuffer_texture_id);
 }
@@ -54,10 +70,11 @@ void DisplayGL::Render()
 
 void DisplayGL::UpdateFramebufferTexture()
 {
-  if (m_framebuffer_texture_width != m_front_buffer.width || m_framebuffer_texture_height != m_front_buffer.height)
+  const Framebuffer& front = GetFrontbuffer();
+  if (m_framebuffer_texture_width != front.width || m_framebuffer_texture_height != front.height)
   {
-    m_framebuffer_texture_width = m_front_buffer.width;
-    m_framebuffer_texture_height = m_front_buffer.height;
+    m_framebuffer_texture_width = front.width;
+    m_framebuffer_texture_height = front.height;
 
     if (m_framebuffer_texture_width > 0 && m_framebuffer_texture_height > 0)
     {
@@ -86,18 +103,116 @@ void DisplayGL::UpdateFramebufferTexture()
   if (m_framebuffer_texture_id == 0)
     return;
 
+  if (UploadWithPersistentBuffer(front))
+    return;
+
+  glBindTexture(GL_TEXTURE_2D, m_framebuffer_texture_id);
+
+  // RGBX8 is already in the texture format, so hand the emulator's buffer straight to the driver.
+  if (front.format == FramebufferFormat::RGBX8)
+  {
+    const u32 row_length = front.stride / sizeof(u32);
+    if (row_length != m_framebuffer_texture_width)
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
+
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_framebuffer_texture_width, m_framebuffer_texture_height, GL_RGBA,
+                    GL_UNSIGNED_BYTE, front.data);
+
+    if (row_length != m_framebuffer_texture_width)
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    return;
+  }
+
   const u32 upload_stride = m_framebuffer_texture_width * sizeof(u32);
   const size_t required_bytes = size_t(upload_stride) * m_framebuffer_texture_height;
   if (m_framebuffer_texture_upload_buffer.size() != required_bytes)
     m_framebuffer_texture_upload_buffer.resize(required_bytes);
 
-  CopyFramebufferToRGBA8Buffer(&m_front_buffer, m_framebuffer_texture_upload_buffer.data(), upload_stride);
+  CopyFramebufferToRGBA8Buffer(&front, m_framebuffer_texture_upload_buffer.data(), upload_stride);
 
-  glBindTexture(GL_TEXTURE_2D, m_framebuffer_texture_id);
   glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_framebuffer_texture_width, m_framebuffer_texture_height, GL_RGBA,
                   GL_UNSIGNED_BYTE, m_framebuffer_texture_upload_buffer.data());
 }
 
+bool DisplayGL::UploadWithPersistentBuffer(const Framebuffer& front)
+{
+  if (!(GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) || !(GLAD_GL_VERSION_3_2 || GLAD_GL_ARB_sync))
+    return false;
+
+  // Slots are kept 256-byte aligned, which satisfies the alignment requirements of every driver for unpack offsets.
+  const u32 upload_stride = m_framebuffer_texture_width * sizeof(u32);
+  const u32 slot_size = (upload_stride * m_framebuffer_texture_height + 255u) & ~255u;
+  if (m_upload_buffer_slot_size != slot_size && !AllocatePersistentBuffer(slot_size))
+    return false;
+
+  const u32 slot = m_upload_buffer_next_slot;
+  m_upload_buffer_next_slot = (m_upload_buffer_next_slot + 1) % NUM_UPLOAD_SLOTS;
+  if (m_upload_buffer_fences[slot])
+  {
+    glClientWaitSync(m_upload_buffer_fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(m_upload_buffer_fences[slot]);
+    m_upload_buffer_fences[slot] = nullptr;
+  }
+
+  // The mapping is coherent, so the conversion writes straight into memory the GPU can DMA from.
+  const u32 slot_offset = slot * slot_size;
+  CopyFramebufferToRGBA8Buffer(&front, m_upload_buffer_pointer + slot_offset, upload_stride);
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_upload_buffer_id);
+  glBindTexture(GL_TEXTURE_2D, m_framebuffer_texture_id);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_framebuffer_texture_width, m_framebuffer_texture_height, GL_RGBA,
+                  GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(static_cast<uintptr_t>(slot_offset)));
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  m_upload_buffer_fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  return true;
+}
+
+bool DisplayGL::AllocatePersistentBuffer(u32 slot_size)
+{
+  DestroyPersistentBuffer();
+
+  const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  const GLsizeiptr buffer_size = static_cast<GLsizeiptr>(slot_size) * NUM_UPLOAD_SLOTS;
+  glGenBuffers(1, &m_upload_buffer_id);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_upload_buffer_id);
+  glBufferStorage(GL_PIXEL_UNPACK_BUFFER, buffer_size, nullptr, flags);
+  m_upload_buffer_pointer = static_cast<byte*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, buffer_size, flags));
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  if (!m_upload_buffer_pointer)
+  {
+    DestroyPersistentBuffer();
+    return false;
+  }
+
+  m_upload_buffer_slot_size = slot_size;
+  return true;
+}
+
+void DisplayGL::DestroyPersistentBuffer()
+{
+  for (GLsync& fence : m_upload_buffer_fences)
+  {
+    if (fence)
+    {
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+
+  if (m_upload_buffer_id != 0)
+  {
+    // Deleting a mapped buffer implicitly unmaps it.
+    glDeleteBuffers(1, &m_upload_buffer_id);
+    m_upload_buffer_id = 0;
+  }
+
+  m_upload_buffer_pointer = nullptr;
+  m_upload_buffer_slot_size = 0;
+  m_upload_buffer_next_slot = 0;
+}
+
 } // namespace
 
 DisplayRendererGL::DisplayRendererGL(WindowHandleType window_handle, u32 window_width, u32 window_height)
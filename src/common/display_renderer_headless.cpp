@@ -0,0 +1,487 @@
+#define XXH_STATIC_LINKING_ONLY
+#include "display_renderer_headless.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/Log.h"
+#include "xxhash.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+Log_SetChannel(DisplayRendererHeadless);
+
+namespace {
+
+// Minimal PNG writer. The image data is compressed with fixed Huffman codes and a greedy LZ77 matcher, which is a
+// long way from zlib's ratios but does well on emulator output, where most of the screen is flat colour or repeats
+// the row above, and needs no external dependency.
+class PNGWriter
+{
+public:
+  static bool Write(ByteStream* stream, const byte* rgba, u32 width, u32 height, u32 stride)
+  {
+    PNGWriter writer;
+
+    // Each row is stored unfiltered as RGB8.
+    std::vector<byte> raw;
+    raw.reserve(size_t(width * 3 + 1) * height);
+    for (u32 row = 0; row < height; row++)
+    {
+      const byte* src = rgba + size_t(row) * stride;
+      raw.push_back(0);
+      for (u32 col = 0; col < width; col++, src += 4)
+        raw.insert(raw.end(), src, src + 3);
+    }
+
+    std::vector<byte> zlib_data;
+    zlib_data.reserve(raw.size() / 2);
+    zlib_data.push_back(0x78);
+    zlib_data.push_back(0x01);
+    writer.Deflate(&zlib_data, raw.data(), raw.size());
+    PutBE32(&zlib_data, Adler32(raw.data(), raw.size()));
+
+    static const byte signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<byte> ihdr;
+    PutBE32(&ihdr, width);
+    PutBE32(&ihdr, height);
+    ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0}); // 8-bit RGB, deflate, no filtering, no interlace
+
+    return stream->Write2(signature, sizeof(signature)) && WriteChunk(stream, "IHDR", ihdr) &&
+           WriteChunk(stream, "IDAT", zlib_data) && WriteChunk(stream, "IEND", {});
+  }
+
+private:
+  static constexpr u32 HASH_BITS = 15;
+  static constexpr u32 WINDOW_SIZE = 32768;
+  static constexpr u32 MIN_MATCH = 3;
+  static constexpr u32 MAX_MATCH = 258;
+
+  void PutBits(u32 bits, u32 count)
+  {
+    m_bit_buffer |= bits << m_bit_count;
+    m_bit_count += count;
+    while (m_bit_count >= 8)
+    {
+      m_out->push_back(Truncate8(m_bit_buffer));
+      m_bit_buffer >>= 8;
+      m_bit_count -= 8;
+    }
+  }
+
+  // Huffman codes are packed starting from the most significant bit.
+  void PutCode(u32 code, u32 length)
+  {
+    u32 reversed = 0;
+    for (u32 i = 0; i < length; i++)
+      reversed |= ((code >> i) & 1) << (length - 1 - i);
+    PutBits(reversed, length);
+  }
+
+  void PutLiteral(u32 symbol)
+  {
+    if (symbol < 144)
+      PutCode(0x30 + symbol, 8);
+    else if (symbol < 256)
+      PutCode(0x190 + (symbol - 144), 9);
+    else if (symbol < 280)
+      PutCode(symbol - 256, 7);
+    else
+      PutCode(0xC0 + (symbol - 280), 8);
+  }
+
+  void PutMatch(u32 length, u32 distance)
+  {
+    static constexpr u16 length_base[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                            31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static constexpr u8 length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                            2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static constexpr u16 distance_base[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                              33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                              1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static constexpr u8 distance_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                              6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    u32 length_code = 28;
+    while (length_base[length_code] > length)
+      length_code--;
+    PutLiteral(257 + length_code);
+    PutBits(length - length_base[length_code], length_extra[length_code]);
+
+    u32 distance_code = 29;
+    while (distance_base[distance_code] > distance)
+      distance_code--;
+    PutCode(distance_code, 5);
+    PutBits(distance - distance_base[distance_code], distance_extra[distance_code]);
+  }
+
+  static u32 Hash(const byte* p)
+  {
+    const u32 v = ZeroExtend32(p[0]) | (ZeroExtend32(p[1]) << 8) | (ZeroExtend32(p[2]) << 16);
+    return (v * UINT32_C(2654435761)) >> (32 - HASH_BITS);
+  }
+
+  // Writes the data as a single fixed Huffman block.
+  void Deflate(std::vector<byte>* out, const byte* data, size_t size)
+  {
+    m_out = out;
+    PutBits(1, 1); // BFINAL
+    PutBits(1, 2); // BTYPE = fixed Huffman
+
+    std::vector<s32> head(size_t(1) << HASH_BITS, -1);
+    size_t pos = 0;
+    while (pos < size)
+    {
+      u32 best_length = 0;
+      u32 best_distance = 0;
+      if ((size - pos) >= MIN_MATCH)
+      {
+        const u32 hash = Hash(data + pos);
+        const s32 candidate = head[hash];
+        head[hash] = static_cast<s32>(pos);
+        if (candidate >= 0 && (pos - size_t(candidate)) <= WINDOW_SIZE)
+        {
+          const u32 max_length = static_cast<u32>(std::min<size_t>(MAX_MATCH, size - pos));
+          const byte* match = data + candidate;
+          u32 length = 0;
+          while (length < max_length && match[length] == data[pos + length])
+            length++;
+          if (length >= MIN_MATCH)
+          {
+            best_length = length;
+            best_distance = static_cast<u32>(pos - size_t(candidate));
+          }
+        }
+      }
+
+      if (best_length == 0)
+      {
+        PutLiteral(data[pos]);
+        pos++;
+        continue;
+      }
+
+      PutMatch(best_length, best_distance);
+
+      // Keep the hash chain heads current through the match, so the following rows can refer back into it.
+      const size_t match_end = pos + best_length;
+      for (pos++; pos < match_end; pos++)
+      {
+        if ((size - pos) >= MIN_MATCH)
+          head[Hash(data + pos)] = static_cast<s32>(pos);
+      }
+    }
+
+    PutLiteral(256);
+    if (m_bit_count > 0)
+      PutBits(0, 8 - m_bit_count);
+  }
+
+  static void PutBE32(std::vector<byte>* out, u32 value)
+  {
+    out->push_back(Truncate8(value >> 24));
+    out->push_back(Truncate8(value >> 16));
+    out->push_back(Truncate8(value >> 8));
+    out->push_back(Truncate8(value));
+  }
+
+  static u32 Adler32(const byte* data, size_t size)
+  {
+    u32 a = 1, b = 0;
+    while (size > 0)
+    {
+      // 5552 is the largest block which can't overflow before the modulo.
+      const size_t block = std::min<size_t>(size, 5552);
+      for (size_t i = 0; i < block; i++)
+      {
+        a += data[i];
+        b += a;
+      }
+      a %= 65521;
+      b %= 65521;
+      data += block;
+      size -= block;
+    }
+    return (b << 16) | a;
+  }
+
+  static u32 CRC32(u32 crc, const byte* data, size_t size)
+  {
+    static const std::array<u32, 256> table = []() {
+      std::array<u32, 256> t = {};
+      for (u32 i = 0; i < 256; i++)
+      {
+        u32 c = i;
+        for (u32 k = 0; k < 8; k++)
+          c = (c & 1) ? (UINT32_C(0xEDB88320) ^ (c >> 1)) : (c >> 1);
+        t[i] = c;
+      }
+      return t;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+      crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+  }
+
+  static bool WriteChunk(ByteStream* stream, const char* type, const std::vector<byte>& data)
+  {
+    std::vector<byte> header;
+    PutBE32(&header, static_cast<u32>(data.size()));
+    header.insert(header.end(), type, type + 4);
+
+    std::vector<byte> footer;
+    PutBE32(&footer, CRC32(CRC32(0, header.data() + 4, 4), data.data(), data.size()));
+    return stream->Write2(header.data(), static_cast<u32>(header.size())) &&
+           (data.empty() || stream->Write2(data.data(), static_cast<u32>(data.size()))) &&
+           stream->Write2(footer.data(), static_cast<u32>(footer.size()));
+  }
+
+  std::vector<byte>* m_out = nullptr;
+  u32 m_bit_buffer = 0;
+  u32 m_bit_count = 0;
+};
+
+} // namespace
+
+class DisplayHeadless final : public Display
+{
+public:
+  DisplayHeadless(DisplayRendererHeadless* renderer, const String& name, Type type, u8 priority);
+  ~DisplayHeadless();
+
+  u64 GetFrameHash() const { return m_frame_hash.load(std::memory_order_acquire); }
+  u32 GetFrameCount() const { return m_frame_count.load(std::memory_order_acquire); }
+
+  // Called on the display's producer thread, straight after the framebuffer is published.
+  void FramebufferSwapped();
+
+private:
+  // Frames waiting to be written. Each slot keeps its allocation, so once the framebuffer size has settled, queueing a
+  // capture is a copy into an existing buffer.
+  static constexpr u32 NUM_CAPTURE_SLOTS = 3;
+  struct CaptureSlot
+  {
+    DisplayHeadless* display = nullptr;
+    Framebuffer frame;
+    std::vector<byte> pixels;
+    u32 frame_number = 0;
+    u32 scale = 1;
+    DisplayRendererHeadless::CaptureFormat format = DisplayRendererHeadless::CaptureFormat::None;
+    String directory;
+    std::atomic<bool> busy{false};
+  };
+
+  static u64 HashFramebuffer(const Framebuffer& fbuf);
+
+  void QueueCapture(const Framebuffer& fbuf, u32 frame_number);
+  void WriteCapture(CaptureSlot* slot);
+
+  DisplayRendererHeadless* m_headless_renderer;
+  std::array<CaptureSlot, NUM_CAPTURE_SLOTS> m_capture_slots;
+
+  // Only touched by the capture thread.
+  std::vector<byte> m_capture_rgba_buffer;
+
+  std::atomic<u64> m_frame_hash{0};
+  std::atomic<u32> m_frame_count{0};
+};
+
+DisplayHeadless::DisplayHeadless(DisplayRendererHeadless* renderer, const String& name, Type type, u8 priority)
+  : Display(renderer, name, type, priority), m_headless_renderer(renderer)
+{
+  for (CaptureSlot& slot : m_capture_slots)
+    slot.display = this;
+}
+
+DisplayHeadless::~DisplayHeadless()
+{
+  // Queued captures refer to our slots.
+  m_headless_renderer->FlushCapture();
+}
+
+u64 DisplayHeadless::HashFramebuffer(const Framebuffer& fbuf)
+{
+  // Framebuffers are allocated without row padding, so the whole buffer can be hashed in one go. The dimensions and
+  // format go in the seed, so that e.g. a blank 640x400 and blank 640x480 frame do not compare equal.
+  const u64 seed = (ZeroExtend64(fbuf.width) << 32) | (ZeroExtend64(fbuf.height) << 8) | static_cast<u64>(fbuf.format);
+  if (!fbuf.data)
+    return seed;
+
+  return XXH64(fbuf.data, size_t(fbuf.stride) * fbuf.height, seed);
+}
+
+void DisplayHeadless::FramebufferSwapped()
+{
+  // We are the only consumer, so the frame just published is always there to take.
+  if (!UpdateFrontbuffer())
+    return;
+
+  const Framebuffer& front = GetFrontbuffer();
+  const u32 frame_number = m_frame_count.load(std::memory_order_relaxed) + 1;
+  m_frame_hash.store(HashFramebuffer(front), std::memory_order_relaxed);
+  m_frame_count.store(frame_number, std::memory_order_release);
+
+  std::lock_guard<std::mutex> guard(m_headless_renderer->m_capture_lock);
+  if (m_headless_renderer->m_capture_format != DisplayRendererHeadless::CaptureFormat::None && front.data &&
+      (frame_number % m_headless_renderer->m_capture_decimation) == 0)
+  {
+    QueueCapture(front, frame_number);
+  }
+}
+
+void DisplayHeadless::QueueCapture(const Framebuffer& fbuf, u32 frame_number)
+{
+  auto iter = std::find_if(m_capture_slots.begin(), m_capture_slots.end(),
+                           [](const CaptureSlot& slot) { return !slot.busy.load(std::memory_order_acquire); });
+  if (iter == m_capture_slots.end())
+  {
+    m_headless_renderer->m_dropped_capture_count.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // Conversion is left to the capture thread, we only take a copy of the pixels here.
+  CaptureSlot* slot = &(*iter);
+  const size_t frame_size = size_t(fbuf.stride) * fbuf.height;
+  if (slot->pixels.size() < frame_size)
+    slot->pixels.resize(frame_size);
+  std::memcpy(slot->pixels.data(), fbuf.data, frame_size);
+  slot->frame = fbuf;
+  slot->frame.data = slot->pixels.data();
+  slot->frame_number = frame_number;
+  slot->scale = std::max(GetDisplayScale(), 1u);
+  slot->format = m_headless_renderer->m_capture_format;
+  slot->directory = m_headless_renderer->m_capture_directory;
+  slot->busy.store(true, std::memory_order_release);
+
+  m_headless_renderer->m_capture_thread.QueueLambdaTask([slot]() { slot->display->WriteCapture(slot); });
+}
+
+void DisplayHeadless::WriteCapture(CaptureSlot* slot)
+{
+  // Captures are written at the display scale, so they match what a windowed renderer would show.
+  const u32 width = slot->frame.width * slot->scale;
+  const u32 height = slot->frame.height * slot->scale;
+  const u32 frame_number = slot->frame_number;
+  const DisplayRendererHeadless::CaptureFormat format = slot->format;
+  PathString filename;
+  if (format == DisplayRendererHeadless::CaptureFormat::PNG)
+  {
+    filename.Format("%s/%s_%06u.png", slot->directory.GetCharArray(), m_name.GetCharArray(), frame_number);
+  }
+  else
+  {
+    filename.Format("%s/%s_%06u_%ux%u.rgba", slot->directory.GetCharArray(), m_name.GetCharArray(), frame_number,
+                    width, height);
+  }
+
+  const u32 rgba_stride = width * sizeof(u32);
+  m_capture_rgba_buffer.resize(size_t(rgba_stride) * height);
+  CopyFramebufferToRGBA8BufferScaled(&slot->frame, m_capture_rgba_buffer.data(), rgba_stride, width, height);
+  slot->busy.store(false, std::memory_order_release);
+
+  ByteStream* stream =
+    FileSystem::OpenFile(filename, BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_TRUNCATE);
+  if (!stream)
+  {
+    Log_ErrorPrintf("Failed to open capture file '%s'", filename.GetCharArray());
+    return;
+  }
+
+  bool result;
+  if (format == DisplayRendererHeadless::CaptureFormat::PNG)
+    result = PNGWriter::Write(stream, m_capture_rgba_buffer.data(), width, height, rgba_stride);
+  else
+    result = stream->Write2(m_capture_rgba_buffer.data(), static_cast<u32>(m_capture_rgba_buffer.size()));
+
+  if (!result)
+    Log_ErrorPrintf("Failed to write capture file '%s'", filename.GetCharArray());
+
+  stream->Release();
+}
+
+DisplayRendererHeadless::DisplayRendererHeadless(WindowHandleType window_handle, u32 window_width, u32 window_height)
+  : DisplayRenderer(window_handle, window_width, window_height)
+{
+}
+
+DisplayRendererHeadless::~DisplayRendererHeadless()
+{
+  m_capture_thread.ExitWorkers();
+}
+
+DisplayRenderer::BackendType DisplayRendererHeadless::GetBackendType()
+{
+  return DisplayRenderer::BackendType::Headless;
+}
+
+bool DisplayRendererHeadless::Initialize()
+{
+  if (!DisplayRenderer::Initialize())
+    return false;
+
+  if (!m_capture_thread.Initialize(TaskQueue::DefaultQueueSize, 1))
+  {
+    Panic("Failed to start capture thread");
+    return false;
+  }
+
+  return true;
+}
+
+std::unique_ptr<Display> DisplayRendererHeadless::CreateDisplay(const char* name, Display::Type type,
+                                                                u8 priority /*= Display::DEFAULT_PRIORITY*/)
+{
+  std::unique_ptr<DisplayHeadless> display = std::make_unique<DisplayHeadless>(this, name, type, priority);
+  AddDisplay(display.get());
+  return display;
+}
+
+void DisplayRendererHeadless::DisplayFramebufferSwapped(Display* display)
+{
+  static_cast<DisplayHeadless*>(display)->FramebufferSwapped();
+}
+
+bool DisplayRendererHeadless::BeginFrame()
+{
+  return true;
+}
+
+void DisplayRendererHeadless::RenderDisplays() {}
+
+void DisplayRendererHeadless::EndFrame() {}
+
+void DisplayRendererHeadless::SetCapture(CaptureFormat format, const char* directory, u32 decimation /* = 1 */)
+{
+  FlushCapture();
+
+  std::lock_guard<std::mutex> guard(m_capture_lock);
+  m_capture_format = format;
+  m_capture_directory = directory ? directory : ".";
+  m_capture_decimation = std::max(decimation, 1u);
+  if (format != CaptureFormat::None && !FileSystem::DirectoryExists(m_capture_directory))
+    FileSystem::CreateDirectory(m_capture_directory, true);
+}
+
+void DisplayRendererHeadless::FlushCapture()
+{
+  m_capture_thread.QueueBlockingLambdaTask([]() {});
+}
+
+u64 DisplayRendererHeadless::GetPrimaryDisplayFrameHash()
+{
+  std::lock_guard<std::mutex> guard(m_display_lock);
+  if (m_active_displays.empty() || m_active_displays.front()->GetType() != Display::Type::Primary)
+    return 0;
+
+  return static_cast<const DisplayHeadless*>(m_active_displays.front())->GetFrameHash();
+}
+
+u32 DisplayRendererHeadless::GetPrimaryDisplayFrameCount()
+{
+  std::lock_guard<std::mutex> guard(m_display_lock);
+  if (m_active_displays.empty() || m_active_displays.front()->GetType() != Display::Type::Primary)
+    return 0;
+
+  return static_cast<const DisplayHeadless*>(m_active_displays.front())->GetFrameCount();
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "YBaseLib/String.h"
+#include "YBaseLib/TaskQueue.h"
+#include "display_renderer.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+// Renderer without a window, for running automated tests. Each presented frame is picked up on the display's
+// producer thread as soon as it is swapped, and its hash is recorded so that screen output can be compared between
+// runs. Optionally, every Nth frame is written to disk, with conversion and encoding done on a worker thread.
+class DisplayRendererHeadless final : public DisplayRenderer
+{
+public:
+  enum class CaptureFormat : u8
+  {
+    None,
+    Raw,
+    PNG
+  };
+
+  DisplayRendererHeadless(WindowHandleType window_handle, u32 window_width, u32 window_height);
+  ~DisplayRendererHeadless();
+
+  BackendType GetBackendType() override;
+
+  std::unique_ptr<Display> CreateDisplay(const char* name, Display::Type type,
+                                         u8 priority = Display::DEFAULT_PRIORITY) override;
+
+  void DisplayFramebufferSwapped(Display* display) override;
+
+  bool BeginFrame() override;
+  void RenderDisplays() override;
+  void EndFrame() override;
+
+  // Frames are written to <directory>/<display name>_<frame number>.<ext>. Raw frames are RGBA8 with no header, and
+  // the dimensions are appended to the file name. A decimation of N writes every Nth frame. Can be changed while
+  // frames are being presented; frames which are already queued keep the settings they were captured under.
+  void SetCapture(CaptureFormat format, const char* directory, u32 decimation = 1);
+
+  // Only valid on the thread which calls SetCapture().
+  CaptureFormat GetCaptureFormat() const { return m_capture_format; }
+  const String& GetCaptureDirectory() const { return m_capture_directory; }
+  u32 GetCaptureDecimation() const { return m_capture_decimation; }
+
+  // Blocks until all queued frames have been written.
+  void FlushCapture();
+
+  // Hash and count of frames presented by the active primary display. Safe to call from any thread.
+  u64 GetPrimaryDisplayFrameHash();
+  u32 GetPrimaryDisplayFrameCount();
+
+  // Number of frames which were due to be captured but skipped because the writer thread was behind.
+  u32 GetDroppedCaptureCount() const { return m_dropped_capture_count.load(std::memory_order_relaxed); }
+
+protected:
+  bool Initialize() override;
+
+private:
+  friend class DisplayHeadless;
+
+  // Written by SetCapture(), and read on the producer thread of each display when a frame is presented.
+  std::mutex m_capture_lock;
+  CaptureFormat m_capture_format = CaptureFormat::None;
+  String m_capture_directory;
+  u32 m_capture_decimation = 1;
+  std::atomic<u32> m_dropped_capture_count{0};
+
+  TaskQueue m_capture_thread;
+};
@@ -0,0 +1,667 @@
+#include "framebuffer_convert.h"
+#include "YBaseLib/Assert.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRAMEBUFFER_CONVERT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define FRAMEBUFFER_CONVERT_X86 1
+#include <immintrin.h>
+#ifdef Y_COMPILER_MSVC
+#include <intrin.h>
+#define SSSE3_FUNCTION
+#define AVX2_FUNCTION
+#else
+#define SSSE3_FUNCTION __attribute__((target("ssse3")))
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace FramebufferConvert {
+
+static constexpr u32 NUM_FORMATS = static_cast<u32>(Format::BGR555) + 1;
+static constexpr u32 ALPHA_MASK = UINT32_C(0xFF000000);
+
+// Pixels converted at a time when going between two formats which are not RGBX8.
+static constexpr u32 CHUNK_SIZE = 256;
+
+// Converts a row to RGBX8 (decode) or from RGBX8 (encode).
+using RowFunction = void (*)(void* dst, const void* src, u32 width);
+
+// The 16-bit formats, described by the position of each channel. Red and blue are always 5 bits.
+template<u32 RShift, u32 GShift, u32 GBits, u32 BShift>
+struct PackedFormat
+{
+  static constexpr u32 R_SHIFT = RShift;
+  static constexpr u32 G_SHIFT = GShift;
+  static constexpr u32 G_BITS = GBits;
+  static constexpr u32 G_MASK = (1u << GBits) - 1;
+  static constexpr u32 B_SHIFT = BShift;
+};
+using RGB565 = PackedFormat<0, 5, 6, 11>;
+using BGR565 = PackedFormat<11, 5, 6, 0>;
+using BGR555 = PackedFormat<10, 5, 5, 0>;
+
+// Replicates the top bits into the bottom, so that full intensity maps to 0xFF.
+static inline u32 Expand5(u32 value)
+{
+  return (value << 3) | (value >> 2);
+}
+static inline u32 Expand6(u32 value)
+{
+  return (value << 2) | (value >> 4);
+}
+
+static void CopyRGBX8(void* dst, const void* src, u32 width)
+{
+  std::memcpy(dst, src, width * sizeof(u32));
+}
+
+template<typename F>
+static void DecodePacked_Scalar(void* dst, const void* src, u32 width)
+{
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+  for (u32 i = 0; i < width; i++)
+  {
+    u16 pix;
+    std::memcpy(&pix, src_ptr, sizeof(pix));
+    src_ptr += sizeof(pix);
+
+    const u32 r = Expand5((pix >> F::R_SHIFT) & 0x1F);
+    const u32 g_bits = (pix >> F::G_SHIFT) & F::G_MASK;
+    const u32 g = (F::G_BITS == 6) ? Expand6(g_bits) : Expand5(g_bits);
+    const u32 b = Expand5((pix >> F::B_SHIFT) & 0x1F);
+    const u32 out = r | (g << 8) | (b << 16) | ALPHA_MASK;
+    std::memcpy(dst_ptr, &out, sizeof(out));
+    dst_ptr += sizeof(out);
+  }
+}
+
+template<typename F>
+static void EncodePacked_Scalar(void* dst, const void* src, u32 width)
+{
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+  for (u32 i = 0; i < width; i++)
+  {
+    u32 pix;
+    std::memcpy(&pix, src_ptr, sizeof(pix));
+    src_ptr += sizeof(pix);
+
+    const u16 out = static_cast<u16>((((pix >> 3) & 0x1F) << F::R_SHIFT) |
+                                     (((pix >> (16 - F::G_BITS)) & F::G_MASK) << F::G_SHIFT) |
+                                     (((pix >> 19) & 0x1F) << F::B_SHIFT));
+    std::memcpy(dst_ptr, &out, sizeof(out));
+    dst_ptr += sizeof(out);
+  }
+}
+
+// Swap selects BGR byte order.
+template<bool Swap>
+static void Decode24_Scalar(void* dst, const void* src, u32 width)
+{
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+  for (u32 i = 0; i < width; i++)
+  {
+    const u32 r = src_ptr[Swap ? 2 : 0];
+    const u32 g = src_ptr[1];
+    const u32 b = src_ptr[Swap ? 0 : 2];
+    const u32 out = r | (g << 8) | (b << 16) | ALPHA_MASK;
+    std::memcpy(dst_ptr, &out, sizeof(out));
+    src_ptr += 3;
+    dst_ptr += sizeof(out);
+  }
+}
+
+template<bool Swap>
+static void Encode24_Scalar(void* dst, const void* src, u32 width)
+{
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+  for (u32 i = 0; i < width; i++)
+  {
+    dst_ptr[Swap ? 2 : 0] = src_ptr[0];
+    dst_ptr[1] = src_ptr[1];
+    dst_ptr[Swap ? 0 : 2] = src_ptr[2];
+    src_ptr += sizeof(u32);
+    dst_ptr += 3;
+  }
+}
+
+// BGRX8 <-> RGBX8, the same operation in both directions.
+static void SwapRB_Scalar(void* dst, const void* src, u32 width)
+{
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+  for (u32 i = 0; i < width; i++)
+  {
+    u32 pix;
+    std::memcpy(&pix, src_ptr, sizeof(pix));
+    pix = (pix & UINT32_C(0xFF00FF00)) | ((pix & UINT32_C(0xFF)) << 16) | ((pix >> 16) & UINT32_C(0xFF));
+    std::memcpy(dst_ptr, &pix, sizeof(pix));
+    src_ptr += sizeof(pix);
+    dst_ptr += sizeof(pix);
+  }
+}
+
+#ifdef FRAMEBUFFER_CONVERT_SSE2
+
+template<typename F>
+static void DecodePacked_SSE2(void* dst, const void* src, u32 width)
+{
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+  const __m128i mask5 = _mm_set1_epi16(0x1F);
+  const __m128i mask_g = _mm_set1_epi16(F::G_MASK);
+  const __m128i alpha = _mm_set1_epi16(static_cast<s16>(0xFF00));
+
+  // The channels are widened to 8 bits in 16-bit lanes, then R|G and B|A are interleaved to form the output dwords.
+  u32 i = 0;
+  for (; (i + 8) <= width; i += 8)
+  {
+    const __m128i pix = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_ptr));
+    __m128i r = _mm_and_si128(_mm_srli_epi16(pix, F::R_SHIFT), mask5);
+    __m128i g = _mm_and_si128(_mm_srli_epi16(pix, F::G_SHIFT), mask_g);
+    __m128i b = _mm_and_si128(_mm_srli_epi16(pix, F::B_SHIFT), mask5);
+    r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+    g = (F::G_BITS == 6) ? _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4)) :
+                           _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+    b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+    const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+    const __m128i ba = _mm_or_si128(b, alpha);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_ptr), _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_ptr + 16), _mm_unpackhi_epi16(rg, ba));
+    src_ptr += 8 * sizeof(u16);
+    dst_ptr += 8 * sizeof(u32);
+  }
+
+  DecodePacked_Scalar<F>(dst_ptr, src_ptr, width - i);
+}
+
+template<typename F>
+static inline __m128i EncodePackedPixels_SSE2(__m128i pix)
+{
+  const __m128i mask5 = _mm_set1_epi32(0x1F);
+  const __m128i r = _mm_and_si128(_mm_srli_epi32(pix, 3), mask5);
+  const __m128i g = _mm_and_si128(_mm_srli_epi32(pix, 16 - F::G_BITS), _mm_set1_epi32(F::G_MASK));
+  const __m128i b = _mm_and_si128(_mm_srli_epi32(pix, 19), mask5);
+  const __m128i out = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, F::R_SHIFT), _mm_slli_epi32(g, F::G_SHIFT)),
+                                   _mm_slli_epi32(b, F::B_SHIFT));
+
+  // Sign extend from 16 bits, so that the signed saturating pack keeps the value intact.
+  return _mm_srai_epi32(_mm_slli_epi32(out, 16), 16);
+}
+
+template<typename F>
+static void EncodePacked_SSE2(void* dst, const void* src, u32 width)
+{
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+
+  u32 i = 0;
+  for (; (i + 8) <= width; i += 8)
+  {
+    const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_ptr));
+    const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_ptr + 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_ptr),
+                     _mm_packs_epi32(EncodePackedPixels_SSE2<F>(lo), EncodePackedPixels_SSE2<F>(hi)));
+    src_ptr += 8 * sizeof(u32);
+    dst_ptr += 8 * sizeof(u16);
+  }
+
+  EncodePacked_Scalar<F>(dst_ptr, src_ptr, width - i);
+}
+
+static void SwapRB_SSE2(void* dst, const void* src, u32 width)
+{
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+  const __m128i mask_ga = _mm_set1_epi32(static_cast<s32>(0xFF00FF00));
+  const __m128i mask_low = _mm_set1_epi32(0xFF);
+
+  u32 i = 0;
+  for (; (i + 4) <= width; i += 4)
+  {
+    const __m128i pix = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_ptr));
+    const __m128i rb = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(pix, mask_low), 16),
+                                    _mm_and_si128(_mm_srli_epi32(pix, 16), mask_low));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_ptr), _mm_or_si128(_mm_and_si128(pix, mask_ga), rb));
+    src_ptr += 4 * sizeof(u32);
+    dst_ptr += 4 * sizeof(u32);
+  }
+
+  SwapRB_Scalar(dst_ptr, src_ptr, width - i);
+}
+
+#endif
+
+#ifdef FRAMEBUFFER_CONVERT_X86
+
+// 24-bit formats need a byte shuffle, which SSE2 doesn't have.
+template<bool Swap>
+SSSE3_FUNCTION static void Decode24_SSSE3(void* dst, const void* src, u32 width)
+{
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+  const __m128i shuffle = Swap ? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+                                 _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m128i alpha = _mm_set1_epi32(static_cast<s32>(ALPHA_MASK));
+
+  // Each load covers 5 and a third pixels but only 4 are used, so stop early enough to not read past the row.
+  u32 i = 0;
+  for (; (i + 6) <= width; i += 4)
+  {
+    const __m128i pix = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_ptr));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_ptr), _mm_or_si128(_mm_shuffle_epi8(pix, shuffle), alpha));
+    src_ptr += 4 * 3;
+    dst_ptr += 4 * sizeof(u32);
+  }
+
+  Decode24_Scalar<Swap>(dst_ptr, src_ptr, width - i);
+}
+
+template<bool Swap>
+SSSE3_FUNCTION static void Encode24_SSSE3(void* dst, const void* src, u32 width)
+{
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+  const __m128i shuffle = Swap ? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1) :
+                                 _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+  // The store writes 4 bytes of padding past the pixels, which the next iteration overwrites.
+  u32 i = 0;
+  for (; (i + 6) <= width; i += 4)
+  {
+    const __m128i pix = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_ptr));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_ptr), _mm_shuffle_epi8(pix, shuffle));
+    src_ptr += 4 * sizeof(u32);
+    dst_ptr += 4 * 3;
+  }
+
+  Encode24_Scalar<Swap>(dst_ptr, src_ptr, width - i);
+}
+
+template<typename F>
+AVX2_FUNCTION static void DecodePacked_AVX2(void* dst, const void* src, u32 width)
+{
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+  const __m256i mask5 = _mm256_set1_epi16(0x1F);
+  const __m256i mask_g = _mm256_set1_epi16(F::G_MASK);
+  const __m256i alpha = _mm256_set1_epi16(static_cast<s16>(0xFF00));
+
+  u32 i = 0;
+  for (; (i + 16) <= width; i += 16)
+  {
+    const __m256i pix = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src_ptr));
+    __m256i r = _mm256_and_si256(_mm256_srli_epi16(pix, F::R_SHIFT), mask5);
+    __m256i g = _mm256_and_si256(_mm256_srli_epi16(pix, F::G_SHIFT), mask_g);
+    __m256i b = _mm256_and_si256(_mm256_srli_epi16(pix, F::B_SHIFT), mask5);
+    r = _mm256_or_si256(_mm256_slli_epi16(r, 3), _mm256_srli_epi16(r, 2));
+    g = (F::G_BITS == 6) ? _mm256_or_si256(_mm256_slli_epi16(g, 2), _mm256_srli_epi16(g, 4)) :
+                           _mm256_or_si256(_mm256_slli_epi16(g, 3), _mm256_srli_epi16(g, 2));
+    b = _mm256_or_si256(_mm256_slli_epi16(b, 3), _mm256_srli_epi16(b, 2));
+
+    // Unpacking works within each 128-bit lane, giving pixels 0-3/8-11 and 4-7/12-15.
+    const __m256i rg = _mm256_or_si256(r, _mm256_slli_epi16(g, 8));
+    const __m256i ba = _mm256_or_si256(b, alpha);
+    const __m256i lo = _mm256_unpacklo_epi16(rg, ba);
+    const __m256i hi = _mm256_unpackhi_epi16(rg, ba);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst_ptr), _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst_ptr + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    src_ptr += 16 * sizeof(u16);
+    dst_ptr += 16 * sizeof(u32);
+  }
+
+  DecodePacked_Scalar<F>(dst_ptr, src_ptr, width - i);
+}
+
+template<typename F>
+AVX2_FUNCTION static inline __m256i EncodePackedPixels_AVX2(__m256i pix)
+{
+  const __m256i mask5 = _mm256_set1_epi32(0x1F);
+  const __m256i r = _mm256_and_si256(_mm256_srli_epi32(pix, 3), mask5);
+  const __m256i g = _mm256_and_si256(_mm256_srli_epi32(pix, 16 - F::G_BITS), _mm256_set1_epi32(F::G_MASK));
+  const __m256i b = _mm256_and_si256(_mm256_srli_epi32(pix, 19), mask5);
+  const __m256i out =
+    _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(r, F::R_SHIFT), _mm256_slli_epi32(g, F::G_SHIFT)),
+                    _mm256_slli_epi32(b, F::B_SHIFT));
+  return _mm256_srai_epi32(_mm256_slli_epi32(out, 16), 16);
+}
+
+template<typename F>
+AVX2_FUNCTION static void EncodePacked_AVX2(void* dst, const void* src, u32 width)
+{
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+
+  u32 i = 0;
+  for (; (i + 16) <= width; i += 16)
+  {
+    const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src_ptr));
+    const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src_ptr + 32));
+
+    // Packing is also per-lane, so the qwords come out as 0-3, 8-11, 4-7, 12-15.
+    const __m256i packed = _mm256_packs_epi32(EncodePackedPixels_AVX2<F>(lo), EncodePackedPixels_AVX2<F>(hi));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst_ptr), _mm256_permute4x64_epi64(packed, 0xD8));
+    src_ptr += 16 * sizeof(u32);
+    dst_ptr += 16 * sizeof(u16);
+  }
+
+  EncodePacked_Scalar<F>(dst_ptr, src_ptr, width - i);
+}
+
+AVX2_FUNCTION static void SwapRB_AVX2(void* dst, const void* src, u32 width)
+{
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+  const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4,
+                                           7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+  u32 i = 0;
+  for (; (i + 8) <= width; i += 8)
+  {
+    const __m256i pix = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src_ptr));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst_ptr), _mm256_shuffle_epi8(pix, shuffle));
+    src_ptr += 8 * sizeof(u32);
+    dst_ptr += 8 * sizeof(u32);
+  }
+
+  SwapRB_Scalar(dst_ptr, src_ptr, width - i);
+}
+
+static bool HostSupportsSSSE3()
+{
+#ifdef Y_COMPILER_MSVC
+  int regs[4];
+  __cpuid(regs, 1);
+  return (regs[2] & (1 << 9)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+static bool HostSupportsAVX2()
+{
+#ifdef Y_COMPILER_MSVC
+  int regs[4];
+  __cpuid(regs, 0);
+  if (regs[0] < 7)
+    return false;
+
+  // OSXSAVE and AVX, and the OS has to be saving the YMM registers.
+  __cpuid(regs, 1);
+  if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+    return false;
+
+  __cpuidex(regs, 7, 0);
+  return (regs[1] & (1 << 5)) != 0;
+#else
+  // The dispatch table is built during static initialization, possibly before libgcc has run its own constructor.
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+struct DispatchTable
+{
+  // Indexed by format. Entries for RGBX8 are a plain copy.
+  std::array<RowFunction, NUM_FORMATS> decode;
+  std::array<RowFunction, NUM_FORMATS> encode;
+  const char* name;
+};
+
+static void SetEntry(std::array<RowFunction, NUM_FORMATS>& functions, Format format, RowFunction function)
+{
+  functions[static_cast<u32>(format)] = function;
+}
+
+static DispatchTable CreateDispatchTable()
+{
+  DispatchTable table = {};
+  table.name = "Scalar";
+  SetEntry(table.decode, Format::RGB8, Decode24_Scalar<false>);
+  SetEntry(table.decode, Format::RGBX8, CopyRGBX8);
+  SetEntry(table.decode, Format::BGR8, Decode24_Scalar<true>);
+  SetEntry(table.decode, Format::BGRX8, SwapRB_Scalar);
+  SetEntry(table.decode, Format::RGB565, DecodePacked_Scalar<RGB565>);
+  SetEntry(table.decode, Format::BGR565, DecodePacked_Scalar<BGR565>);
+  SetEntry(table.decode, Format::BGR555, DecodePacked_Scalar<BGR555>);
+  SetEntry(table.encode, Format::RGB8, Encode24_Scalar<false>);
+  SetEntry(table.encode, Format::RGBX8, CopyRGBX8);
+  SetEntry(table.encode, Format::BGR8, Encode24_Scalar<true>);
+  SetEntry(table.encode, Format::BGRX8, SwapRB_Scalar);
+  SetEntry(table.encode, Format::RGB565, EncodePacked_Scalar<RGB565>);
+  SetEntry(table.encode, Format::BGR565, EncodePacked_Scalar<BGR565>);
+  SetEntry(table.encode, Format::BGR555, EncodePacked_Scalar<BGR555>);
+
+#ifdef FRAMEBUFFER_CONVERT_SSE2
+  table.name = "SSE2";
+  SetEntry(table.decode, Format::BGRX8, SwapRB_SSE2);
+  SetEntry(table.decode, Format::RGB565, DecodePacked_SSE2<RGB565>);
+  SetEntry(table.decode, Format::BGR565, DecodePacked_SSE2<BGR565>);
+  SetEntry(table.decode, Format::BGR555, DecodePacked_SSE2<BGR555>);
+  SetEntry(table.encode, Format::BGRX8, SwapRB_SSE2);
+  SetEntry(table.encode, Format::RGB565, EncodePacked_SSE2<RGB565>);
+  SetEntry(table.encode, Format::BGR565, EncodePacked_SSE2<BGR565>);
+  SetEntry(table.encode, Format::BGR555, EncodePacked_SSE2<BGR555>);
+#endif
+
+#ifdef FRAMEBUFFER_CONVERT_X86
+  if (HostSupportsSSSE3())
+  {
+    table.name = "SSSE3";
+    SetEntry(table.decode, Format::RGB8, Decode24_SSSE3<false>);
+    SetEntry(table.decode, Format::BGR8, Decode24_SSSE3<true>);
+    SetEntry(table.encode, Format::RGB8, Encode24_SSSE3<false>);
+    SetEntry(table.encode, Format::BGR8, Encode24_SSSE3<true>);
+  }
+
+  if (HostSupportsAVX2())
+  {
+    table.name = "AVX2";
+    SetEntry(table.decode, Format::BGRX8, SwapRB_AVX2);
+    SetEntry(table.decode, Format::RGB565, DecodePacked_AVX2<RGB565>);
+    SetEntry(table.decode, Format::BGR565, DecodePacked_AVX2<BGR565>);
+    SetEntry(table.decode, Format::BGR555, DecodePacked_AVX2<BGR555>);
+    SetEntry(table.encode, Format::BGRX8, SwapRB_AVX2);
+    SetEntry(table.encode, Format::RGB565, EncodePacked_AVX2<RGB565>);
+    SetEntry(table.encode, Format::BGR565, EncodePacked_AVX2<BGR565>);
+    SetEntry(table.encode, Format::BGR555, EncodePacked_AVX2<BGR555>);
+  }
+#endif
+
+  return table;
+}
+
+static const DispatchTable s_dispatch_table = CreateDispatchTable();
+
+u32 GetBytesPerPixel(Format format)
+{
+  switch (format)
+  {
+    case Format::RGB8:
+    case Format::BGR8:
+      return 3;
+
+    case Format::RGBX8:
+    case Format::BGRX8:
+      return 4;
+
+    case Format::RGB565:
+    case Format::BGR565:
+    case Format::BGR555:
+      return 2;
+
+    default:
+      UnreachableCode();
+      return 0;
+  }
+}
+
+void ConvertRow(void* dst, Format dst_format, const void* src, Format src_format, u32 width)
+{
+  if (src_format == dst_format)
+  {
+    std::memcpy(dst, src, width * GetBytesPerPixel(src_format));
+    return;
+  }
+
+  if (dst_format == Format::RGBX8)
+  {
+    s_dispatch_table.decode[static_cast<u32>(src_format)](dst, src, width);
+    return;
+  }
+
+  if (src_format == Format::RGBX8)
+  {
+    s_dispatch_table.encode[static_cast<u32>(dst_format)](dst, src, width);
+    return;
+  }
+
+  // Neither side is RGBX8, so go through it a chunk at a time to stay in L1.
+  const RowFunction decode = s_dispatch_table.decode[static_cast<u32>(src_format)];
+  const RowFunction encode = s_dispatch_table.encode[static_cast<u32>(dst_format)];
+  const u32 src_bpp = GetBytesPerPixel(src_format);
+  const u32 dst_bpp = GetBytesPerPixel(dst_format);
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+  alignas(32) u32 temp[CHUNK_SIZE];
+  for (u32 i = 0; i < width; i += CHUNK_SIZE)
+  {
+    const u32 count = std::min(width - i, CHUNK_SIZE);
+    decode(temp, src_ptr, count);
+    encode(dst_ptr, temp, count);
+    src_ptr += count * src_bpp;
+    dst_ptr += count * dst_bpp;
+  }
+}
+
+void Convert(void* dst, u32 dst_stride, Format dst_format, const void* src, u32 src_stride, Format src_format,
+             u32 width, u32 height)
+{
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+
+  // Unpadded buffers of the same format can be copied in one go.
+  if (src_format == dst_format && src_stride == dst_stride && src_stride == (width * GetBytesPerPixel(src_format)))
+  {
+    std::memcpy(dst_ptr, src_ptr, size_t(src_stride) * height);
+    return;
+  }
+
+  for (u32 row = 0; row < height; row++)
+  {
+    ConvertRow(dst_ptr, dst_format, src_ptr, src_format, width);
+    src_ptr += src_stride;
+    dst_ptr += dst_stride;
+  }
+}
+
+static void ScaleRowInteger(u32* dst, const u32* src, u32 src_width, u32 factor)
+{
+  switch (factor)
+  {
+    case 2:
+    {
+      for (u32 i = 0; i < src_width; i++)
+      {
+        dst[0] = dst[1] = src[i];
+        dst += 2;
+      }
+    }
+    break;
+
+    default:
+    {
+      for (u32 i = 0; i < src_width; i++)
+      {
+        std::fill_n(dst, factor, src[i]);
+        dst += factor;
+      }
+    }
+    break;
+  }
+}
+
+static void ScaleRowNearest(u32* dst, u32 dst_width, const u32* src, u32 src_width)
+{
+  // Steps through the source as floor(i * src_width / dst_width) without dividing per pixel.
+  u32 src_x = 0;
+  u32 remainder = 0;
+  for (u32 i = 0; i < dst_width; i++)
+  {
+    dst[i] = src[src_x];
+    remainder += src_width;
+    while (remainder >= dst_width)
+    {
+      remainder -= dst_width;
+      src_x++;
+    }
+  }
+}
+
+void ConvertScaled(void* dst, u32 dst_stride, Format dst_format, u32 dst_width, u32 dst_height, const void* src,
+                   u32 src_stride, Format src_format, u32 src_width, u32 src_height)
+{
+  if (dst_width == src_width && dst_height == src_height)
+  {
+    Convert(dst, dst_stride, dst_format, src, src_stride, src_format, src_width, src_height);
+    return;
+  }
+
+  if (src_width == 0 || src_height == 0 || dst_width == 0 || dst_height == 0)
+    return;
+
+  const byte* src_ptr = static_cast<const byte*>(src);
+  byte* dst_ptr = static_cast<byte*>(dst);
+  const u32 dst_row_size = dst_width * GetBytesPerPixel(dst_format);
+  const bool integer_scale = (dst_width % src_width) == 0;
+  const u32 scale_factor = dst_width / src_width;
+
+  std::vector<u32> src_row(src_width);
+  std::vector<u32> scaled_row(dst_width);
+  const byte* last_dst_row = nullptr;
+  u32 last_src_y = src_height;
+  for (u32 y = 0; y < dst_height; y++)
+  {
+    const u32 src_y = static_cast<u32>((u64(y) * src_height) / dst_height);
+    byte* dst_row = dst_ptr + size_t(y) * dst_stride;
+
+    // Repeated rows are a copy of the output we already produced.
+    if (src_y == last_src_y)
+    {
+      std::memcpy(dst_row, last_dst_row, dst_row_size);
+      continue;
+    }
+
+    ConvertRow(src_row.data(), Format::RGBX8, src_ptr + size_t(src_y) * src_stride, src_format, src_width);
+    if (integer_scale)
+      ScaleRowInteger(scaled_row.data(), src_row.data(), src_width, scale_factor);
+    else
+      ScaleRowNearest(scaled_row.data(), dst_width, src_row.data(), src_width);
+    ConvertRow(dst_row, dst_format, scaled_row.data(), Format::RGBX8, dst_width);
+
+    last_src_y = src_y;
+    last_dst_row = dst_row;
+  }
+}
+
+const char* GetImplementationName()
+{
+  return s_dispatch_table.name;
+}
+
+} // namespace FramebufferConvert
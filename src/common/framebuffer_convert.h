@@ -0,0 +1,28 @@
+#pragma once
+#include "display.h"
+
+// Conversion between the framebuffer formats a Display can hold.
+// Every format is converted through RGBX8, which is what the renderers upload, so conversions to or from RGBX8 are a
+// single pass and any other pair is done in two passes over small chunks. SSE2 is used where it is available at
+// compile time, SSSE3 and AVX2 are selected at runtime.
+namespace FramebufferConvert {
+
+using Format = Display::FramebufferFormat;
+
+u32 GetBytesPerPixel(Format format);
+
+// Converts a single row of pixels. The source and destination must not overlap.
+void ConvertRow(void* dst, Format dst_format, const void* src, Format src_format, u32 width);
+
+void Convert(void* dst, u32 dst_stride, Format dst_format, const void* src, u32 src_stride, Format src_format,
+             u32 width, u32 height);
+
+// Nearest-neighbour resize while converting. When the destination size is an exact multiple of the source, which is
+// the case for Display::SetDisplayScale, each source row is converted once and its pixels and rows are replicated.
+void ConvertScaled(void* dst, u32 dst_stride, Format dst_format, u32 dst_width, u32 dst_height, const void* src,
+                   u32 src_stride, Format src_format, u32 src_width, u32 src_height);
+
+// Which instruction set the runtime dispatch picked, for logging and benchmarks.
+const char* GetImplementationName();
+
+} // namespace FramebufferConvert
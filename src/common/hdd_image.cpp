@@ -1,6 +1,12 @@
 #include "hdd_image.h"
 #include "YBaseLib/FileSystem.h"
 #include "YBaseLib/Log.h"
+#include "xxhash.h"
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <random>
 Log_SetChannel(HDDImage);
 
 #pragma pack(push, 1)
@@ -12,7 +18,22 @@ struct LOG_FILE_HEADER
   u64 image_size;
   u32 sector_count;
   u32 version_number;
-  u8 padding[12];
+  u64 log_id;
+  u32 checkpoint_count;
+};
+static constexpr u32 CHECKPOINT_RECORD_MAGIC = 0x43504B43;
+struct CHECKPOINT_RECORD_HEADER
+{
+  u32 magic;
+  u32 parent_record_sector;
+  u32 num_entries;
+  u32 padding;
+  u64 log_id;
+};
+struct CHECKPOINT_ENTRY
+{
+  u32 sector_index;
+  u32 log_sector_index;
 };
 static constexpr u32 STATE_MAGIC = 0x92087348;
 struct STATE_HEADER
@@ -25,8 +46,29 @@ struct STATE_HEADER
   u32 num_sectors_in_state;
   u8 padding[8];
 };
+static constexpr u32 CHECKPOINT_STATE_MAGIC = 0x92087349;
+struct CHECKPOINT_STATE_HEADER
+{
+  u32 magic;
+  u32 sector_size;
+  u64 image_size;
+  u32 sector_count;
+  u32 version_number;
+  u32 record_sector;
+  u32 log_filename_length;
+  u64 log_id;
+};
 #pragma pack(pop)
 
+// Identifies a log file, so that checkpoint states can tell whether they refer to the log they are loaded into.
+static u64 GenerateLogID()
+{
+  std::random_device rd;
+  const u64 id = (static_cast<u64>(rd()) << 32) ^ static_cast<u64>(rd()) ^
+                 static_cast<u64>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+  return (id != 0) ? id : 1;
+}
+
 static String GetLogFileName(const char* base_filename)
 {
   return String::FromFormat("%s.log", base_filename);
@@ -43,13 +85,18 @@ HDDImage::HDDImage(const std::string filename, ByteStream* base_stream, ByteStre
     m_sector_size(sector_size), m_sector_count(sector_count), m_version_number(version_number),
     m_log_sector_map(std::move(log_sector_map))
 {
-  m_current_sector.data = std::make_unique<byte[]>(sector_size);
+  SetCacheSectorCount(DefaultCacheSectorCount);
+  ReadCheckpointInfo();
 }
 
 HDDImage::~HDDImage()
 {
   m_base_stream->Release();
   m_log_stream->Release();
+
+  // Nothing needs to be written back for a discarded log, the file is simply removed.
+  if (m_discard_log && !m_memory_log)
+    FileSystem::DeleteFile(m_log_filename.c_str());
 }
 
 ByteStream* HDDImage::CreateLogFile(const char* filename, bool truncate_existing, bool atomic_update, u64 image_size,
@@ -66,15 +113,23 @@ ByteStream* HDDImage::CreateLogFile(const char* filename, bool truncate_existing
   sector_map.resize(static_cast<size_t>(num_sectors));
   std::fill_n(sector_map.begin(), static_cast<size_t>(num_sectors), InvalidSectorNumber);
 
-  u32 open_flags = BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_SEEKABLE;
-  if (truncate_existing)
-    open_flags |= BYTESTREAM_OPEN_TRUNCATE;
-  if (atomic_update)
-    open_flags |= BYTESTREAM_OPEN_ATOMIC_UPDATE;
+  ByteStream* log_stream;
+  if (filename)
+  {
+    u32 open_flags = BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_SEEKABLE;
+    if (truncate_existing)
+      open_flags |= BYTESTREAM_OPEN_TRUNCATE;
+    if (atomic_update)
+      open_flags |= BYTESTREAM_OPEN_ATOMIC_UPDATE;
 
-  ByteStream* log_stream = FileSystem::OpenFile(filename, open_flags);
-  if (!log_stream)
-    return nullptr;
+    log_stream = FileSystem::OpenFile(filename, open_flags);
+    if (!log_stream)
+      return nullptr;
+  }
+  else
+  {
+    log_stream = ByteStream_CreateGrowableMemoryStream();
+  }
 
   LOG_FILE_HEADER header = {};
   header.magic = LOG_FILE_MAGIC;
@@ -82,13 +137,15 @@ ByteStream* HDDImage::CreateLogFile(const char* filename, bool truncate_existing
   header.image_size = image_size;
   header.sector_count = static_cast<u32>(num_sectors);
   header.version_number = version_number;
+  header.log_id = GenerateLogID();
 
   // Write header and sector map to the file.
   if (!log_stream->Write2(&header, sizeof(header)) ||
       !log_stream->Write2(sector_map.data(), static_cast<u32>(sizeof(SectorIndex) * sector_map.size())))
   {
     log_stream->Release();
-    FileSystem::DeleteFile(filename);
+    if (filename)
+      FileSystem::DeleteFile(filename);
     return nullptr;
   }
 
@@ -104,7 +161,8 @@ ByteStream* HDDImage::CreateLogFile(const char* filename, bool truncate_existing
       if (!log_stream->Write2(&data, static_cast<u32>(size)))
       {
         log_stream->Release();
-        FileSystem::DeleteFile(filename);
+        if (filename)
+          FileSystem::DeleteFile(filename);
         return nullptr;
       }
 
@@ -115,7 +173,8 @@ ByteStream* HDDImage::CreateLogFile(const char* filename, bool truncate_existing
   if (!log_stream->Flush())
   {
     log_stream->Release();
-    FileSystem::DeleteFile(filename);
+    if (filename)
+      FileSystem::DeleteFile(filename);
     return nullptr;
   }
 
@@ -162,24 +221,64 @@ ByteStream* HDDImage::OpenLogFile(const char* filename, u64 image_size, u32& sec
   return log_stream;
 }
 
+void HDDImage::SetCacheSectorCount(u32 count)
+{
+  ReleaseAllSectors();
+
+  m_cache.resize(std::max(count, 1u));
+  for (SectorBuffer& buf : m_cache)
+  {
+    if (!buf.data)
+      buf.data = std::make_unique<byte[]>(m_sector_size);
+  }
+  m_cache_map.reserve(m_cache.size());
+}
+
+HDDImage::SectorBuffer* HDDImage::FindCachedSector(SectorIndex sector_index)
+{
+  auto iter = m_cache_map.find(sector_index);
+  if (iter == m_cache_map.end())
+    return nullptr;
+
+  SectorBuffer& buf = m_cache[iter->second];
+  buf.last_used = ++m_cache_clock;
+  return &buf;
+}
+
 HDDImage::SectorBuffer& HDDImage::GetSector(SectorIndex sector_index)
 {
-  if (m_current_sector.sector_number == sector_index)
-    return m_current_sector;
+  SectorBuffer* cached = FindCachedSector(sector_index);
+  if (cached)
+    return *cached;
+
+  // Replace the least recently used entry. Unused entries have never been touched, so they are picked first.
+  u32 victim_index = 0;
+  for (u32 i = 1; i < static_cast<u32>(m_cache.size()); i++)
+  {
+    if (m_cache[i].last_used < m_cache[victim_index].last_used)
+      victim_index = i;
+  }
 
-  // Unload current sector and replace it.
-  ReleaseSector(m_current_sector);
-  LoadSector(m_current_sector, sector_index);
-  return m_current_sector;
+  SectorBuffer& buf = m_cache[victim_index];
+  if (buf.sector_number != InvalidSectorNumber)
+    ReleaseSector(buf);
+
+  LoadSector(buf, sector_index);
+  buf.last_used = ++m_cache_clock;
+  m_cache_map.emplace(sector_index, victim_index);
+  return buf;
 }
 
 void HDDImage::LoadSector(SectorBuffer& buf, SectorIndex sector_index)
 {
   Assert(sector_index != InvalidSectorNumber && sector_index < m_log_sector_map.size());
   if (m_log_sector_map[sector_index] == InvalidSectorNumber)
-    LoadSectorFromImage(buf, sector_index);
+    ReadSectorsFromImage(sector_index, 1, buf.data.get());
   else
-    LoadSectorFromLog(buf, sector_index);
+    ReadSectorFromLog(sector_index, buf.data.get());
+
+  buf.sector_number = sector_index;
+  buf.dirty = false;
 }
 
 std::unique_ptr<HDDImage> HDDImage::Create(const char* filename, u64 size_in_bytes,
@@ -221,30 +320,135 @@ std::unique_ptr<HDDImage> HDDImage::Create(const char* filename, u64 size_in_byt
     return nullptr;
   }
 
-  return std::unique_ptr<HDDImage>(
+  std::unique_ptr<HDDImage> image(
     new HDDImage(filename, base_stream, log_stream, image_size, sector_size, sector_count, 0, std::move(sector_map)));
+  image->m_log_filename = log_filename.GetCharArray();
+  return image;
+}
+
+ByteStream* HDDImage::OpenBaseImage(const char* filename, bool writable, std::unique_ptr<BlockImage>& block_image)
+{
+  // Block images are never written, so they can live on read-only storage.
+  ByteStream* base_stream = FileSystem::OpenFile(filename, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_SEEKABLE);
+  if (!base_stream)
+    return nullptr;
+
+  if (BlockImage::IsBlockImage(base_stream))
+  {
+    block_image = BlockImage::Open(base_stream);
+    if (!block_image)
+    {
+      Log_ErrorPrintf("Failed to open block image '%s'", filename);
+      base_stream->Release();
+      return nullptr;
+    }
+
+    return base_stream;
+  }
+
+  if (writable)
+  {
+    base_stream->Release();
+    base_stream =
+      FileSystem::OpenFile(filename, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_SEEKABLE);
+  }
+
+  return base_stream;
+}
+
+bool HDDImage::CreateBlockImage(const char* raw_filename, const char* filename,
+                                u32 block_size /* = BlockImage::DefaultBlockSize */)
+{
+  ByteStream* raw_stream = FileSystem::OpenFile(raw_filename, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_SEEKABLE);
+  if (!raw_stream)
+    return false;
+
+  ByteStream* stream = FileSystem::OpenFile(filename, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_WRITE |
+                                                        BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_TRUNCATE |
+                                                        BYTESTREAM_OPEN_SEEKABLE | BYTESTREAM_OPEN_ATOMIC_UPDATE);
+  if (!stream)
+  {
+    raw_stream->Release();
+    return false;
+  }
+
+  const bool result = BlockImage::Create(raw_stream, raw_stream->GetSize(), stream, block_size);
+  raw_stream->Release();
+  if (!result || !stream->Commit())
+  {
+    Log_ErrorPrintf("Failed to create block image '%s' from '%s'", filename, raw_filename);
+    stream->Discard();
+    stream->Release();
+    return false;
+  }
+
+  stream->Release();
+  return true;
 }
 
 std::unique_ptr<HDDImage> HDDImage::Open(const char* filename, u32 sector_size /* = DefaultReplaySectorSize */)
 {
-  ByteStream* base_stream =
-    FileSystem::OpenFile(filename, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_SEEKABLE);
+  return OpenImage(filename, GetLogFileName(filename), true, false, sector_size);
+}
+
+std::unique_ptr<HDDImage> HDDImage::OpenOverlay(const char* filename, const char* log_directory, bool discard_log,
+                                                u32 sector_size /* = DefaultSectorSize */)
+{
+  if (!log_directory)
+    return OpenImage(filename, nullptr, false, true, sector_size);
+
+  if (!FileSystem::DirectoryExists(log_directory) && !FileSystem::CreateDirectory(log_directory, true))
+  {
+    Log_ErrorPrintf("Failed to create overlay directory '%s'", log_directory);
+    return nullptr;
+  }
+
+  // Logs are named after the base image, so one directory can hold the overlays for several drives. The hash of the
+  // full path keeps images with the same name in different directories apart.
+  const char* base_name = filename;
+  for (const char* ch = filename; *ch != '\0'; ch++)
+  {
+    if (*ch == '/' || *ch == '\\')
+      base_name = ch + 1;
+  }
+
+  const u64 path_hash = XXH64(filename, std::strlen(filename), 0);
+  const String log_filename = String::FromFormat("%s/%s.%016" PRIX64 ".log", log_directory, base_name, path_hash);
+  return OpenImage(filename, log_filename, false, discard_log, sector_size);
+}
+
+std::unique_ptr<HDDImage> HDDImage::OpenImage(const char* filename, const char* log_filename, bool writable_base,
+                                              bool discard_log, u32 sector_size)
+{
+  std::unique_ptr<BlockImage> block_image;
+  ByteStream* base_stream = OpenBaseImage(filename, writable_base, block_image);
   if (!base_stream)
     return nullptr;
 
-  u64 image_size = base_stream->GetSize();
+  u64 image_size = block_image ? block_image->GetImageSize() : base_stream->GetSize();
   if (image_size == 0)
   {
     base_stream->Release();
     return nullptr;
   }
 
-  String log_filename = GetLogFileName(filename);
   u32 sector_count;
   u32 version_number = 0;
   LogSectorMap sector_map;
   ByteStream* log_stream;
-  if (FileSystem::FileExists(log_filename))
+  if (!log_filename || discard_log)
+  {
+    // Discarded logs always start empty, any left over from a previous run are overwritten.
+    log_stream =
+      CreateLogFile(log_filename, true, false, image_size, sector_size, sector_count, version_number, sector_map);
+    if (!log_stream)
+    {
+      Log_ErrorPrintf("Failed to create overlay for image '%s'.", filename);
+      base_stream->Release();
+      return nullptr;
+    }
+  }
+  else if (FileSystem::FileExists(log_filename))
   {
     log_stream = OpenLogFile(log_filename, image_size, sector_size, sector_count, version_number, sector_map);
     if (!log_stream)
@@ -267,94 +471,195 @@ std::unique_ptr<HDDImage> HDDImage::Open(const char* filename, u32 sector_size /
     }
   }
 
-  Log_DevPrintf("Opened image '%s' with log file '%s' (sector size %u)", filename, log_filename.GetCharArray(),
-                sector_size);
-  return std::unique_ptr<HDDImage>(new HDDImage(filename, base_stream, log_stream, image_size, sector_size,
-                                                sector_count, version_number, std::move(sector_map)));
+  Log_DevPrintf("Opened image '%s' with log file '%s' (sector size %u)", filename,
+                log_filename ? log_filename : "<memory>", sector_size);
+  std::unique_ptr<HDDImage> image(new HDDImage(filename, base_stream, log_stream, image_size, sector_size,
+                                               sector_count, version_number, std::move(sector_map)));
+  image->m_log_filename = log_filename ? log_filename : "";
+  image->m_read_only_base = !writable_base;
+  image->m_memory_log = (log_filename == nullptr);
+  image->m_discard_log = discard_log;
+
+  if (block_image)
+  {
+    image->m_block_image = std::move(block_image);
+    image->m_read_only_base = true;
+    return image;
+  }
+
+  // Sectors which aren't in the log are read from a mapping of the base image where possible.
+  image->m_base_mapping = MappedFile::Open(filename);
+  if (image->m_base_mapping && image->m_base_mapping->GetSize() < image_size)
+    image->m_base_mapping.reset();
+
+  return image;
 }
 
-void HDDImage::LoadSectorFromImage(SectorBuffer& buf, SectorIndex sector_index)
+std::unique_ptr<HDDImage> HDDImage::CreateMemoryOverlay()
 {
-  if (!m_base_stream->SeekAbsolute(GetFileOffset(sector_index)) || !m_base_stream->Read2(buf.data.get(), m_sector_size))
-    Panic("Failed to read from base image.");
+  // Flush pending sectors to the replay log, so the overlay sees every write. The log is not copied here, only the
+  // base image is shared. Its sectors reach the overlay when the parent's state is loaded into it.
+  Flush();
 
-  buf.sector_number = sector_index;
-  buf.dirty = false;
-  buf.in_log = false;
+  // Block images have their own decompression cache, so each overlay opens a separate one.
+  std::unique_ptr<BlockImage> block_image;
+  ByteStream* base_stream = OpenBaseImage(m_filename.c_str(), false, block_image);
+  if (!base_stream)
+  {
+    Log_ErrorPrintf("Failed to reopen base image '%s'", m_filename.c_str());
+    return nullptr;
+  }
+
+  u32 sector_count;
+  LogSectorMap sector_map;
+  ByteStream* log_stream =
+    CreateLogFile(nullptr, false, false, m_image_size, m_sector_size, sector_count, m_version_number, sector_map);
+  if (!log_stream)
+  {
+    base_stream->Release();
+    return nullptr;
+  }
+
+  std::unique_ptr<HDDImage> image(new HDDImage(m_filename, base_stream, log_stream, m_image_size, m_sector_size,
+                                               sector_count, m_version_number, std::move(sector_map)));
+  image->m_read_only_base = true;
+  image->m_memory_log = true;
+  image->m_base_mapping = m_base_mapping;
+  image->m_block_image = std::move(block_image);
+  image->SetCacheSectorCount(GetCacheSectorCount());
+  return image;
+}
+
+ByteStream* HDDImage::RecreateLog(bool atomic_update, LogSectorMap& sector_map)
+{
+  if (m_memory_log)
+  {
+    return CreateLogFile(nullptr, true, atomic_update, m_image_size, m_sector_size, m_sector_count, m_version_number,
+                         sector_map);
+  }
+
+  return CreateLogFile(m_log_filename.c_str(), true, atomic_update, m_image_size, m_sector_size, m_sector_count,
+                       m_version_number, sector_map);
+}
+
+void HDDImage::ReadSectorsFromImage(SectorIndex first_sector_index, u32 count, byte* data)
+{
+  DebugAssert((first_sector_index + count) <= m_sector_count);
+  if (m_block_image)
+  {
+    // The last sector can extend past the end of the image, the remainder reads as zeros.
+    const u64 offset = GetFileOffset(first_sector_index);
+    const u32 size = count * m_sector_size;
+    const u32 size_in_image = static_cast<u32>(std::min(m_image_size - offset, u64(size)));
+    if (!m_block_image->Read(data, offset, size_in_image))
+      Panic("Failed to read from block image.");
+    std::memset(data + size_in_image, 0, size - size_in_image);
+    return;
+  }
+
+  if (m_base_mapping)
+  {
+    std::memcpy(data, m_base_mapping->GetData() + GetFileOffset(first_sector_index), count * m_sector_size);
+    return;
+  }
+
+  if (!m_base_stream->SeekAbsolute(GetFileOffset(first_sector_index)) ||
+      !m_base_stream->Read2(data, count * m_sector_size))
+  {
+    Panic("Failed to read from base image.");
+  }
 }
 
-void HDDImage::LoadSectorFromLog(SectorBuffer& buf, SectorIndex sector_index)
+void HDDImage::ReadSectorFromLog(SectorIndex sector_index, byte* data)
 {
   DebugAssert(sector_index < m_sector_count);
 
   const SectorIndex log_sector_index = m_log_sector_map[sector_index];
   Assert(log_sector_index != InvalidSectorNumber);
-  if (!m_log_stream->SeekAbsolute(GetFileOffset(log_sector_index)) ||
-      !m_log_stream->Read2(buf.data.get(), m_sector_size))
-  {
+  if (!m_log_stream->SeekAbsolute(GetFileOffset(log_sector_index)) || !m_log_stream->Read2(data, m_sector_size))
     Panic("Failed to read from log file.");
-  }
-
-  buf.sector_number = sector_index;
-  buf.dirty = false;
-  buf.in_log = true;
 }
 
-void HDDImage::WriteSectorToLog(SectorBuffer& buf)
+void HDDImage::WriteSectorToLog(SectorIndex sector_index, const byte* data)
 {
-  DebugAssert(buf.dirty && buf.sector_number < m_sector_count);
+  DebugAssert(sector_index < m_sector_count);
 
-  // Is the sector currently in the log?
-  if (!buf.in_log)
+  // Is the sector currently in the log? Sectors which belong to a checkpoint are never overwritten, the new data
+  // goes to a fresh sector so the checkpoint can still be restored.
+  if (!IsSectorInLog(sector_index) || m_log_sector_map[sector_index] < m_frozen_log_sector_count)
   {
-    Assert(m_log_sector_map[buf.sector_number] == InvalidSectorNumber);
-
     // Need to allocate it in the log file.
     if (!m_log_stream->SeekToEnd())
       Panic("Failed to seek to end of log.");
 
     const u64 sector_offset = m_log_stream->GetPosition();
     const SectorIndex log_sector_number = static_cast<SectorIndex>(sector_offset / m_sector_size);
-    Log_DevPrintf("Allocating log sector %u to sector %u", buf.sector_number, log_sector_number);
-    m_log_sector_map[buf.sector_number] = log_sector_number;
+    Log_DevPrintf("Allocating log sector %u to sector %u", sector_index, log_sector_number);
+    m_log_sector_map[sector_index] = log_sector_number;
 
     // Update log sector map in file.
-    if (!m_log_stream->SeekAbsolute(GetSectorMapOffset(buf.sector_number)) ||
+    if (!m_log_stream->SeekAbsolute(GetSectorMapOffset(sector_index)) ||
         !m_log_stream->Write2(&log_sector_number, sizeof(SectorIndex)))
     {
       Panic("Failed to update sector map in log file.");
     }
 
-    buf.in_log = true;
+    if (m_checkpoint_record != 0)
+      m_checkpoint_delta.push_back(sector_index);
   }
 
   // Write to the log.
-  const SectorIndex log_sector_index = m_log_sector_map[buf.sector_number];
-  Assert(log_sector_index != InvalidSectorNumber);
-  if (!m_log_stream->SeekAbsolute(GetFileOffset(log_sector_index)) ||
-      !m_log_stream->Write2(buf.data.get(), m_sector_size))
-  {
+  const SectorIndex log_sector_index = m_log_sector_map[sector_index];
+  if (!m_log_stream->SeekAbsolute(GetFileOffset(log_sector_index)) || !m_log_stream->Write2(data, m_sector_size))
     Panic("Failed to write sector to log file.");
-  }
-
-  buf.dirty = false;
 }
 
 void HDDImage::ReleaseSector(SectorBuffer& buf)
 {
   // Write it to the log file if it's changed.
-  if (m_current_sector.dirty)
-    WriteSectorToLog(m_current_sector);
+  if (buf.dirty)
+  {
+    WriteSectorToLog(buf.sector_number, buf.data.get());
+    buf.dirty = false;
+  }
 
-  m_current_sector.sector_number = InvalidSectorNumber;
+  m_cache_map.erase(buf.sector_number);
+  buf.sector_number = InvalidSectorNumber;
+  buf.last_used = 0;
 }
 
-void HDDImage::ReleaseAllSectors()
+bool HDDImage::WriteBackDirtySectors()
 {
-  if (m_current_sector.sector_number == InvalidSectorNumber)
-    return;
+  // Write in sector order, so that new log sectors are allocated sequentially.
+  std::vector<SectorBuffer*> dirty_sectors;
+  for (SectorBuffer& buf : m_cache)
+  {
+    if (buf.dirty)
+      dirty_sectors.push_back(&buf);
+  }
+  if (dirty_sectors.empty())
+    return false;
+
+  std::sort(dirty_sectors.begin(), dirty_sectors.end(),
+            [](const SectorBuffer* lhs, const SectorBuffer* rhs) { return lhs->sector_number < rhs->sector_number; });
+  for (SectorBuffer* buf : dirty_sectors)
+  {
+    WriteSectorToLog(buf->sector_number, buf->data.get());
+    buf->dirty = false;
+  }
 
-  ReleaseSector(m_current_sector);
+  return true;
+}
+
+void HDDImage::ReleaseAllSectors()
+{
+  WriteBackDirtySectors();
+  for (SectorBuffer& buf : m_cache)
+  {
+    buf.sector_number = InvalidSectorNumber;
+    buf.last_used = 0;
+  }
+  m_cache_map.clear();
 }
 
 void HDDImage::Read(void* buffer, u64 offset, u32 size)
@@ -369,6 +674,30 @@ void HDDImage::Read(void* buffer, u64 offset, u32 size)
     const u32 offset_in_sector = static_cast<u32>(offset % m_sector_size);
     const u32 size_to_read = std::min(size, m_sector_size - offset_in_sector);
 
+    // Whole sectors which aren't cached bypass the cache. Runs of sectors which are still in the base image are
+    // contiguous there, so they're read in a single request.
+    if (size_to_read == m_sector_size && !FindCachedSector(sector_index))
+    {
+      u32 count = 1;
+      if (IsSectorInLog(sector_index))
+      {
+        ReadSectorFromLog(sector_index, buf);
+      }
+      else
+      {
+        const u32 max_count = size / m_sector_size;
+        while (count < max_count && !IsSectorInLog(sector_index + count) && !FindCachedSector(sector_index + count))
+          count++;
+
+        ReadSectorsFromImage(sector_index, count, buf);
+      }
+
+      buf += count * m_sector_size;
+      offset += count * m_sector_size;
+      size -= count * m_sector_size;
+      continue;
+    }
+
     // Load the sector, and read the sub-sector.
     const SectorBuffer& sec = GetSector(sector_index);
     std::memcpy(buf, &sec.data[offset_in_sector], size_to_read);
@@ -390,6 +719,16 @@ void HDDImage::Write(const void* buffer, u64 offset, u32 size)
     const u32 offset_in_sector = static_cast<u32>(offset % m_sector_size);
     const u32 size_to_write = std::min(size, m_sector_size - offset_in_sector);
 
+    // Whole sectors which aren't cached are written straight to the log.
+    if (size_to_write == m_sector_size && !FindCachedSector(sector_index))
+    {
+      WriteSectorToLog(sector_index, buf);
+      buf += size_to_write;
+      offset += size_to_write;
+      size -= size_to_write;
+      continue;
+    }
+
     // Load the sector, and update it.
     SectorBuffer& sec = GetSector(sector_index);
     std::memcpy(&sec.data[offset_in_sector], buf, size_to_write);
@@ -404,6 +743,24 @@ bool HDDImage::LoadState(ByteStream* stream)
 {
   ReleaseAllSectors();
 
+  const u64 start_position = stream->GetPosition();
+  u32 magic;
+  if (!stream->Read2(&magic, sizeof(magic)) || !stream->SeekAbsolute(start_position))
+    return false;
+
+  return (magic == CHECKPOINT_STATE_MAGIC) ? LoadCheckpointState(stream) : LoadFullState(stream);
+}
+
+bool HDDImage::SaveState(ByteStream* stream)
+{
+  ReleaseAllSectors();
+
+  // Memory logs and discarded logs don't outlive the image, so their contents have to go in the state.
+  return (m_memory_log || m_discard_log) ? SaveFullState(stream) : SaveCheckpointState(stream);
+}
+
+bool HDDImage::LoadFullState(ByteStream* stream)
+{
   // Read header in from stream. It may not be valid.
   STATE_HEADER header;
   if (!stream->Read2(&header, sizeof(header)) || header.magic != STATE_MAGIC || header.image_size != m_image_size ||
@@ -423,8 +780,7 @@ bool HDDImage::LoadState(ByteStream* stream)
 
   // Okay, everything seems fine. We can now throw away the current log file, and re-write it.
   LogSectorMap new_sector_map;
-  ByteStream* new_log_stream = CreateLogFile(GetLogFileName(m_filename.c_str()), true, true, m_image_size,
-                                             m_sector_size, m_sector_count, m_version_number, new_sector_map);
+  ByteStream* new_log_stream = RecreateLog(true, new_sector_map);
   if (!new_log_stream)
     return false;
 
@@ -462,13 +818,12 @@ bool HDDImage::LoadState(ByteStream* stream)
   new_log_stream->Commit();
   m_log_stream = new_log_stream;
   m_log_sector_map = std::move(new_sector_map);
+  ReadCheckpointInfo();
   return true;
 }
 
-bool HDDImage::SaveState(ByteStream* stream)
+bool HDDImage::SaveFullState(ByteStream* stream)
 {
-  ReleaseAllSectors();
-
   // Precompute how many sectors are committed to the log.
   u32 log_sector_count = 0;
   for (SectorIndex sector_index = 0; sector_index < m_sector_count; sector_index++)
@@ -509,13 +864,275 @@ bool HDDImage::SaveState(ByteStream* stream)
   return true;
 }
 
+HDDImage::SectorIndex HDDImage::GetLogSectorCount() const
+{
+  return static_cast<SectorIndex>((m_log_stream->GetSize() + (m_sector_size - 1)) / m_sector_size);
+}
+
+void HDDImage::ReadCheckpointInfo()
+{
+  m_checkpoint_record = 0;
+  m_checkpoint_delta.clear();
+
+  LOG_FILE_HEADER header;
+  if (!m_log_stream->SeekAbsolute(0) || !m_log_stream->Read2(&header, sizeof(header)))
+    Panic("Failed to read log header.");
+
+  // Logs written before checkpoints existed have no identifier.
+  if (header.log_id == 0)
+  {
+    header.log_id = GenerateLogID();
+    header.checkpoint_count = 0;
+    if (!m_log_stream->SeekAbsolute(0) || !m_log_stream->Write2(&header, sizeof(header)))
+      Panic("Failed to update log header.");
+  }
+
+  // States saved in earlier runs may reference any sector already in the log.
+  m_log_id = header.log_id;
+  m_frozen_log_sector_count = (header.checkpoint_count > 0) ? GetLogSectorCount() : 0;
+}
+
+bool HDDImage::ReadCheckpointChain(ByteStream* log_stream, u64 log_id, SectorIndex record_sector,
+                                   LogSectorMap& sector_map) const
+{
+  // Walk back to the root, then apply the records oldest first.
+  const u64 log_size = log_stream->GetSize();
+  std::vector<SectorIndex> records;
+  for (SectorIndex current = record_sector; current != 0;)
+  {
+    CHECKPOINT_RECORD_HEADER header;
+    if (records.size() >= (log_size / m_sector_size) || !log_stream->SeekAbsolute(GetFileOffset(current)) ||
+        !log_stream->Read2(&header, sizeof(header)) || header.magic != CHECKPOINT_RECORD_MAGIC ||
+        header.log_id != log_id)
+    {
+      Log_ErrorPrintf("Corrupted checkpoint record at log sector %u", current);
+      return false;
+    }
+
+    records.push_back(current);
+    current = header.parent_record_sector;
+  }
+
+  sector_map.assign(m_sector_count, InvalidSectorNumber);
+  std::vector<CHECKPOINT_ENTRY> entries;
+  for (auto iter = records.rbegin(); iter != records.rend(); ++iter)
+  {
+    CHECKPOINT_RECORD_HEADER header;
+    if (!log_stream->SeekAbsolute(GetFileOffset(*iter)) || !log_stream->Read2(&header, sizeof(header)) ||
+        header.num_entries > m_sector_count)
+    {
+      return false;
+    }
+
+    entries.resize(header.num_entries);
+    if (header.num_entries > 0 &&
+        !log_stream->Read2(entries.data(), static_cast<u32>(sizeof(CHECKPOINT_ENTRY) * entries.size())))
+    {
+      return false;
+    }
+
+    for (const CHECKPOINT_ENTRY& entry : entries)
+    {
+      if (entry.sector_index >= m_sector_count || GetFileOffset(entry.log_sector_index) >= log_size)
+        return false;
+
+      sector_map[entry.sector_index] = entry.log_sector_index;
+    }
+  }
+
+  return true;
+}
+
+bool HDDImage::SaveCheckpointState(ByteStream* stream)
+{
+  // A checkpoint lists the sectors whose location in the log changed since the previous one. The first checkpoint
+  // made by this instance has no parent, so it lists every sector in the log.
+  std::vector<CHECKPOINT_ENTRY> entries;
+  if (m_checkpoint_record == 0)
+  {
+    for (SectorIndex sector_index = 0; sector_index < m_sector_count; sector_index++)
+    {
+      if (IsSectorInLog(sector_index))
+        entries.push_back({sector_index, m_log_sector_map[sector_index]});
+    }
+  }
+  else
+  {
+    entries.reserve(m_checkpoint_delta.size());
+    for (SectorIndex sector_index : m_checkpoint_delta)
+      entries.push_back({sector_index, m_log_sector_map[sector_index]});
+  }
+
+  // Records are appended to the log, padded to a whole sector so that data sectors stay aligned.
+  CHECKPOINT_RECORD_HEADER record_header = {};
+  record_header.magic = CHECKPOINT_RECORD_MAGIC;
+  record_header.parent_record_sector = m_checkpoint_record;
+  record_header.num_entries = static_cast<u32>(entries.size());
+  record_header.log_id = m_log_id;
+
+  const u32 record_size = static_cast<u32>(sizeof(record_header) + sizeof(CHECKPOINT_ENTRY) * entries.size());
+  const u32 padding_size = static_cast<u32>(Common::AlignUpPow2(record_size, m_sector_size) - record_size);
+  const std::vector<byte> padding(padding_size, 0);
+  if (!m_log_stream->SeekToEnd())
+    return false;
+
+  const SectorIndex record_sector = static_cast<SectorIndex>(m_log_stream->GetPosition() / m_sector_size);
+  if (!m_log_stream->Write2(&record_header, sizeof(record_header)) ||
+      (!entries.empty() &&
+       !m_log_stream->Write2(entries.data(), static_cast<u32>(sizeof(CHECKPOINT_ENTRY) * entries.size()))) ||
+      (padding_size > 0 && !m_log_stream->Write2(padding.data(), padding_size)))
+  {
+    Log_ErrorPrintf("Failed to write checkpoint record to log.");
+    return false;
+  }
+
+  LOG_FILE_HEADER log_header;
+  if (!m_log_stream->SeekAbsolute(0) || !m_log_stream->Read2(&log_header, sizeof(log_header)))
+    return false;
+  log_header.checkpoint_count++;
+  if (!m_log_stream->SeekAbsolute(0) || !m_log_stream->Write2(&log_header, sizeof(log_header)) ||
+      !m_log_stream->Flush())
+  {
+    Log_ErrorPrintf("Failed to update log header.");
+    return false;
+  }
+
+  Log_DevPrintf("Checkpoint at log sector %u: %u sectors changed", record_sector, static_cast<u32>(entries.size()));
+  m_checkpoint_record = record_sector;
+  m_checkpoint_delta.clear();
+  m_frozen_log_sector_count = GetLogSectorCount();
+
+  // The state only references the log, none of the sector data is copied.
+  CHECKPOINT_STATE_HEADER header = {};
+  header.magic = CHECKPOINT_STATE_MAGIC;
+  header.sector_size = m_sector_size;
+  header.image_size = m_image_size;
+  header.sector_count = m_sector_count;
+  header.version_number = m_version_number;
+  header.record_sector = record_sector;
+  header.log_filename_length = static_cast<u32>(m_log_filename.length());
+  header.log_id = m_log_id;
+  if (!stream->Write2(&header, sizeof(header)) ||
+      !stream->Write2(m_log_filename.c_str(), header.log_filename_length))
+  {
+    Log_ErrorPrintf("Failed to write checkpoint to save state.");
+    return false;
+  }
+
+  return true;
+}
+
+bool HDDImage::LoadCheckpointState(ByteStream* stream)
+{
+  CHECKPOINT_STATE_HEADER header;
+  if (!stream->Read2(&header, sizeof(header)) || header.magic != CHECKPOINT_STATE_MAGIC ||
+      header.image_size != m_image_size || header.sector_size != m_sector_size ||
+      header.sector_count != m_sector_count)
+  {
+    Log_ErrorPrintf("Corrupted save state.");
+    return false;
+  }
+
+  std::string log_filename(header.log_filename_length, '\0');
+  if (header.log_filename_length > 0 && !stream->Read2(&log_filename[0], header.log_filename_length))
+    return false;
+
+  if (header.version_number != m_version_number)
+  {
+    Log_ErrorPrintf("Incorrect version number in save state (%u, should be %u), it is a stale state",
+                    header.version_number, m_version_number);
+    return false;
+  }
+
+  // For the log the state was saved from, rewinding the sector map is enough, the data is still in place.
+  if (!m_memory_log && header.log_id == m_log_id)
+  {
+    LogSectorMap new_sector_map;
+    if (!ReadCheckpointChain(m_log_stream, m_log_id, header.record_sector, new_sector_map))
+      return false;
+
+    for (SectorIndex sector_index = 0; sector_index < m_sector_count; sector_index++)
+    {
+      if (new_sector_map[sector_index] == m_log_sector_map[sector_index])
+        continue;
+
+      if (!m_log_stream->SeekAbsolute(GetSectorMapOffset(sector_index)) ||
+          !m_log_stream->Write2(&new_sector_map[sector_index], sizeof(SectorIndex)))
+      {
+        Panic("Failed to update sector map in log file.");
+      }
+    }
+
+    m_log_stream->Flush();
+    m_log_sector_map = std::move(new_sector_map);
+    m_checkpoint_record = header.record_sector;
+    m_checkpoint_delta.clear();
+    m_frozen_log_sector_count = GetLogSectorCount();
+    return true;
+  }
+
+  // Otherwise, e.g. for a forked system, the checkpoint's sectors are copied from the other log.
+  ByteStream* source_stream =
+    FileSystem::OpenFile(log_filename.c_str(), BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_SEEKABLE);
+  if (!source_stream)
+  {
+    Log_ErrorPrintf("Failed to open log file '%s' referenced by save state.", log_filename.c_str());
+    return false;
+  }
+
+  LOG_FILE_HEADER source_header;
+  LogSectorMap source_sector_map;
+  if (!source_stream->Read2(&source_header, sizeof(source_header)) || source_header.log_id != header.log_id ||
+      !ReadCheckpointChain(source_stream, header.log_id, header.record_sector, source_sector_map))
+  {
+    Log_ErrorPrintf("Log file '%s' no longer matches the save state.", log_filename.c_str());
+    source_stream->Release();
+    return false;
+  }
+
+  LogSectorMap new_sector_map;
+  ByteStream* new_log_stream = RecreateLog(true, new_sector_map);
+  if (!new_log_stream)
+  {
+    source_stream->Release();
+    return false;
+  }
+
+  bool result = true;
+  for (SectorIndex sector_index = 0; sector_index < m_sector_count && result; sector_index++)
+  {
+    if (source_sector_map[sector_index] == InvalidSectorNumber)
+      continue;
+
+    new_sector_map[sector_index] = static_cast<SectorIndex>(new_log_stream->GetPosition() / m_sector_size);
+    result = (source_stream->SeekAbsolute(GetFileOffset(source_sector_map[sector_index])) &&
+              ByteStream_CopyBytes(source_stream, m_sector_size, new_log_stream) == m_sector_size);
+  }
+  source_stream->Release();
+
+  if (!result || !new_log_stream->SeekAbsolute(GetSectorMapOffset(0)) ||
+      !new_log_stream->Write2(new_sector_map.data(), sizeof(SectorIndex) * m_sector_count))
+  {
+    Log_ErrorPrintf("Failed to copy sectors from log file '%s'.", log_filename.c_str());
+    new_log_stream->Discard();
+    new_log_stream->Release();
+    return false;
+  }
+
+  m_log_stream->Release();
+  new_log_stream->Flush();
+  new_log_stream->Commit();
+  m_log_stream = new_log_stream;
+  m_log_sector_map = std::move(new_sector_map);
+  ReadCheckpointInfo();
+  return true;
+}
+
 void HDDImage::Flush()
 {
-  if (!m_current_sector.dirty)
+  if (!WriteBackDirtySectors())
     return;
 
-  WriteSectorToLog(m_current_sector);
-
   // Ensure the stream isn't buffering.
   if (!m_log_stream->Flush())
     Panic("Failed to flush log stream.");
@@ -523,6 +1140,12 @@ void HDDImage::Flush()
 
 void HDDImage::CommitLog()
 {
+  if (m_read_only_base)
+  {
+    Log_ErrorPrintf("Cannot commit log for '%s', base image is read-only.", m_filename.c_str());
+    return;
+  }
+
   Log_InfoPrintf("Committing log for '%s'.", m_filename.c_str());
   ReleaseAllSectors();
 
@@ -541,13 +1164,20 @@ void HDDImage::CommitLog()
     }
   }
 
+  // The base image mapping only sees the new data once it has reached the file.
+  if (!m_base_stream->Flush())
+    Panic("Failed to flush base image.");
+
   // Increment the version number, to invalidate old save states.
   m_version_number++;
 
   // Truncate the log, and re-create it.
   m_log_stream->Release();
-  m_log_stream = CreateLogFile(GetLogFileName(m_filename.c_str()), true, false, m_image_size, m_sector_size,
-                               m_sector_count, m_version_number, m_log_sector_map);
+  m_log_stream = RecreateLog(false, m_log_sector_map);
+  if (!m_log_stream)
+    Panic("Failed to recreate log file.");
+
+  ReadCheckpointInfo();
 }
 
 void HDDImage::RevertLog()
@@ -556,11 +1186,12 @@ void HDDImage::RevertLog()
   ReleaseAllSectors();
 
   m_log_stream->Release();
-  m_log_stream = CreateLogFile(GetLogFileName(m_filename.c_str()), true, false, m_image_size, m_sector_size,
-                               m_sector_count, m_version_number, m_log_sector_map);
+  m_log_stream = RecreateLog(false, m_log_sector_map);
   if (!m_log_stream)
   {
     Log_ErrorPrintf("Failed to recreate log file for image '%s'", m_filename.c_str());
     Panic("Failed to recreate log file.");
   }
+
+  ReadCheckpointInfo();
 }
@@ -1,7 +1,10 @@
 #pragma once
 #include "YBaseLib/ByteStream.h"
+#include "common/block_image.h"
+#include "common/mapped_file.h"
 #include "pce/types.h"
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 class HDDImage
@@ -11,23 +14,48 @@ public:
 
   static constexpr u32 InvalidSectorNumber = UINT32_C(0xFFFFFFFF);
   static constexpr u32 DefaultSectorSize = 4096;
+  static constexpr u32 DefaultCacheSectorCount = 16;
 
   static std::unique_ptr<HDDImage> Create(const char* filename, u64 size_in_bytes, u32 sector_size = DefaultSectorSize);
   static std::unique_ptr<HDDImage> Open(const char* filename, u32 sector_size = DefaultSectorSize);
 
+  /// Opens the base image read-only, with the replay log kept in log_directory, or in memory if it is null. The base
+  /// image is never written, so any number of instances can use it at once and share it in the host's page cache.
+  /// A discarded log starts out empty and is deleted when the image is closed, rather than persisting across runs.
+  static std::unique_ptr<HDDImage> OpenOverlay(const char* filename, const char* log_directory, bool discard_log,
+                                               u32 sector_size = DefaultSectorSize);
+
+  /// Converts a raw image to a compressed block image, which can be opened in its place. Block images are read-only,
+  /// changes are kept in the replay log and cannot be committed.
+  static bool CreateBlockImage(const char* raw_filename, const char* filename,
+                               u32 block_size = BlockImage::DefaultBlockSize);
+
+  /// Opens the same base image read-only, with an empty replay log held in memory. Used for forked systems, which
+  /// restore the log contents through LoadState(). Changes are never written back to disk.
+  std::unique_ptr<HDDImage> CreateMemoryOverlay();
+
   ~HDDImage();
 
   const u64 GetImageSize() const { return m_image_size; }
   const u32 GetSectorSize() const { return m_sector_size; }
   const u32 GetSectorCount() const { return m_sector_count; }
 
+  /// Number of sectors kept in memory. The least recently used sector is evicted when a new one is needed, and dirty
+  /// sectors are written back to the log on eviction or Flush(). Changing the size flushes the cache.
+  u32 GetCacheSectorCount() const { return static_cast<u32>(m_cache.size()); }
+  void SetCacheSectorCount(u32 count);
+
+  /// Whole sectors which are not cached are transferred directly between the caller's buffer and the image/log.
   void Read(void* buffer, u64 offset, u32 size);
   void Write(const void* buffer, u64 offset, u32 size);
 
   /// Erases the current replay log, and replaces it with the log from the specified stream.
   bool LoadState(ByteStream* stream);
 
-  /// Copies the current state of the replay log to the specified stream, so it can be restored later.
+  /// Saves the current state of the replay log to the specified stream, so it can be restored later. For logs on
+  /// disk this records a checkpoint in the log, and the state only references it. Sectors in checkpoints are never
+  /// overwritten, so saving and loading cost is proportional to the sectors written since the previous checkpoint.
+  /// Memory logs and discarded overlay logs copy their contents into the state, since they are gone once closed.
   bool SaveState(ByteStream* stream);
 
   /// Flushes any buffered sectors to the backing file/log.
@@ -45,18 +73,26 @@ private:
   {
     std::unique_ptr<byte[]> data;
     SectorIndex sector_number = InvalidSectorNumber;
-    bool in_log = false;
+    u64 last_used = 0;
     bool dirty = false;
   };
 
   HDDImage(const std::string filename, ByteStream* base_stream, ByteStream* log_stream, u64 size, u32 sector_size,
            u32 sector_count, u32 version_number, LogSectorMap log_sector_map);
 
+  // A null filename creates the log in memory.
   static ByteStream* CreateLogFile(const char* filename, bool truncate_existing, bool atomic_update, u64 image_size,
                                    u32 sector_size, u32& num_sectors, u32 version_number, LogSectorMap& sector_map);
   static ByteStream* OpenLogFile(const char* filename, u64 image_size, u32& sector_size, u32& num_sectors,
                                  u32& version_number, LogSectorMap& sector_map);
 
+  // A null log filename keeps the log in memory.
+  static std::unique_ptr<HDDImage> OpenImage(const char* filename, const char* log_filename, bool writable_base,
+                                             bool discard_log, u32 sector_size);
+
+  // Opens the base image, detecting the format. Block images are always opened read-only.
+  static ByteStream* OpenBaseImage(const char* filename, bool writable, std::unique_ptr<BlockImage>& block_image);
+
   // Returns the offset in the image (either log or base) for the specified sector.
   u64 GetFileOffset(SectorIndex sector_index) const
   {
@@ -66,21 +102,50 @@ private:
   // Returns whether the specified sector is in the log (true), or in the base image (false).
   bool IsSectorInLog(SectorIndex sector_index) const { return (m_log_sector_map[sector_index] != InvalidSectorNumber); }
 
-  // Currently, we only have one sector open. But we could change this in the future.
+  // Returns the cached copy of a sector, or null if it is not in the cache.
+  SectorBuffer* FindCachedSector(SectorIndex sector_index);
+
+  // Returns the cached copy of a sector, loading it over the least recently used entry if needed.
   SectorBuffer& GetSector(SectorIndex sector_index);
 
   void LoadSector(SectorBuffer& buf, SectorIndex sector_index);
-  void LoadSectorFromImage(SectorBuffer& buf, SectorIndex sector_index);
-  void LoadSectorFromLog(SectorBuffer& buf, SectorIndex sector_index);
-  void WriteSectorToLog(SectorBuffer& buf);
+  void ReadSectorsFromImage(SectorIndex first_sector_index, u32 count, byte* data);
+  void ReadSectorFromLog(SectorIndex sector_index, byte* data);
+  void WriteSectorToLog(SectorIndex sector_index, const byte* data);
   void ReleaseSector(SectorBuffer& buf);
+  bool WriteBackDirtySectors();
   void ReleaseAllSectors();
 
+  // Replaces the log with an empty one, either on disk or in memory.
+  ByteStream* RecreateLog(bool atomic_update, LogSectorMap& sector_map);
+
+  // Save states either hold a copy of every sector in the log, or reference a checkpoint within it.
+  bool LoadFullState(ByteStream* stream);
+  bool SaveFullState(ByteStream* stream);
+  bool LoadCheckpointState(ByteStream* stream);
+  bool SaveCheckpointState(ByteStream* stream);
+
+  // Reads the log identifier and checkpoint count from the log header, after the log is opened or replaced.
+  void ReadCheckpointInfo();
+
+  // Builds the sector map as of a checkpoint, by applying each record in its chain from the root.
+  bool ReadCheckpointChain(ByteStream* log_stream, u64 log_id, SectorIndex record_sector,
+                           LogSectorMap& sector_map) const;
+
+  SectorIndex GetLogSectorCount() const;
+
   std::string m_filename;
+  std::string m_log_filename;
 
   ByteStream* m_base_stream;
   ByteStream* m_log_stream;
 
+  // Read-only mapping of the base image, shared with memory overlays. Null if mapping is not supported.
+  std::shared_ptr<MappedFile> m_base_mapping;
+
+  // Set when the base image is a compressed block image, which is read through it instead of the stream.
+  std::unique_ptr<BlockImage> m_block_image;
+
   u64 m_image_size;
   u32 m_sector_size;
   u32 m_sector_count;
@@ -88,5 +153,19 @@ private:
 
   LogSectorMap m_log_sector_map;
 
-  SectorBuffer m_current_sector;
+  bool m_read_only_base = false;
+  bool m_memory_log = false;
+  bool m_discard_log = false;
+
+  // Log sector of the current checkpoint record, or 0 if no checkpoint has been made since the log was opened.
+  // Sectors whose location has changed since then are listed in the delta. Log sectors below the frozen count may be
+  // referenced by a checkpoint.
+  u64 m_log_id = 0;
+  SectorIndex m_checkpoint_record = 0;
+  SectorIndex m_frozen_log_sector_count = 0;
+  std::vector<SectorIndex> m_checkpoint_delta;
+
+  std::vector<SectorBuffer> m_cache;
+  std::unordered_map<SectorIndex, u32> m_cache_map;
+  u64 m_cache_clock = 0;
 };
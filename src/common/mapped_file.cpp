@@ -0,0 +1,49 @@
+#include "common/mapped_file.h"
+#include "YBaseLib/Log.h"
+#include <cinttypes>
+#if defined(Y_PLATFORM_LINUX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+Log_SetChannel(MappedFile);
+
+MappedFile::MappedFile(const byte* data, u64 size) : m_data(data), m_size(size) {}
+
+MappedFile::~MappedFile()
+{
+#if defined(Y_PLATFORM_LINUX)
+  munmap(const_cast<byte*>(m_data), static_cast<size_t>(m_size));
+#endif
+}
+
+std::unique_ptr<MappedFile> MappedFile::Open(const char* filename)
+{
+#if defined(Y_PLATFORM_LINUX)
+  const int fd = open(filename, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return nullptr;
+
+  // Empty files can't be mapped.
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0)
+  {
+    close(fd);
+    return nullptr;
+  }
+
+  // The mapping holds its own reference to the file, so the descriptor isn't needed afterwards.
+  const u64 size = static_cast<u64>(st.st_size);
+  void* ptr = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED)
+  {
+    Log_WarningPrintf("Failed to map '%s' (%" PRIu64 " bytes)", filename, size);
+    return nullptr;
+  }
+  return std::unique_ptr<MappedFile>(new MappedFile(static_cast<const byte*>(ptr), size));
+#else
+  return nullptr;
+#endif
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "common/types.h"
+#include <memory>
+
+// Read-only view of a whole file, mapped into the address space. Reads from the mapping are served from the host's
+// page cache without a system call or an intermediate copy. Only supported on Linux, Open() returns null elsewhere,
+// and callers are expected to fall back to reading through a ByteStream.
+// The mapping is shared, so writes made to the file through other handles are visible once they reach the OS.
+class MappedFile
+{
+public:
+  ~MappedFile();
+
+  static std::unique_ptr<MappedFile> Open(const char* filename);
+
+  const byte* GetData() const { return m_data; }
+  u64 GetSize() const { return m_size; }
+
+  // Returns a pointer to the specified range, or null if it lies outside the file.
+  const byte* GetPointer(u64 offset, u64 size) const
+  {
+    return (offset <= m_size && size <= (m_size - offset)) ? (m_data + offset) : nullptr;
+  }
+
+private:
+  MappedFile(const byte* data, u64 size);
+
+  const byte* m_data;
+  u64 m_size;
+};
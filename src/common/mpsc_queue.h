@@ -0,0 +1,83 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "common/types.h"
+#include <array>
+#include <atomic>
+#include <utility>
+
+// Bounded lock-free multiple producer, single consumer queue.
+// Slots are allocated up front, each carries a sequence number which tells producers and the consumer whether the
+// slot is free or filled for the current lap around the ring. Producers only contend on the enqueue position.
+template<typename T, u32 CAPACITY>
+class MPSCQueue
+{
+  static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "capacity is a power of two");
+
+public:
+  MPSCQueue()
+  {
+    for (u32 i = 0; i < CAPACITY; i++)
+      m_slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  // Returns false if the queue is full. Can be called from any thread.
+  template<typename U>
+  bool TryPush(U&& value)
+  {
+    u32 position = m_enqueue_position.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      Slot& slot = m_slots[position & (CAPACITY - 1)];
+      const u32 sequence = slot.sequence.load(std::memory_order_acquire);
+      const s32 diff = static_cast<s32>(sequence - position);
+      if (diff == 0)
+      {
+        // Slot is free for this lap, try to claim it.
+        if (m_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        {
+          slot.value = std::forward<U>(value);
+          slot.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (diff < 0)
+      {
+        // Consumer hasn't caught up.
+        return false;
+      }
+      else
+      {
+        // Another producer claimed this slot.
+        position = m_enqueue_position.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Returns false if the queue is empty. Must only be called from the consumer thread.
+  bool TryPop(T* value)
+  {
+    Slot& slot = m_slots[m_dequeue_position & (CAPACITY - 1)];
+    const u32 sequence = slot.sequence.load(std::memory_order_acquire);
+    if (static_cast<s32>(sequence - (m_dequeue_position + 1)) < 0)
+      return false;
+
+    *value = std::move(slot.value);
+    slot.value = T();
+    slot.sequence.store(m_dequeue_position + CAPACITY, std::memory_order_release);
+    m_dequeue_position++;
+    return true;
+  }
+
+private:
+  struct Slot
+  {
+    std::atomic<u32> sequence;
+    T value;
+  };
+
+  std::array<Slot, CAPACITY> m_slots;
+
+  // Kept on separate cache lines, as producers and the consumer run on different threads.
+  alignas(64) std::atomic<u32> m_enqueue_position{0};
+  alignas(64) u32 m_dequeue_position = 0;
+};
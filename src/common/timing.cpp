@@ -36,7 +36,9 @@ void TimingManager::AddPendingTime(SimulationTime time)
   // TODO: Accuracy of total while running events..
   m_pending_time += time;
   m_total_emulated_time += time;
-  if (m_pending_time >= m_next_event_time)
+
+  // Time added by an event callback, e.g. a bus stall, is run by RunEvents() once the current events complete.
+  if (m_pending_time >= m_next_event_time && !m_running_events)
     RunEvents();
 }
 
@@ -149,66 +151,71 @@ void TimingManager::RunEvents()
 {
   Assert(!m_running_events);
 
-  SimulationTime remaining_time = m_pending_time;
-  m_pending_time = 0;
   m_running_events = true;
 
-  while (remaining_time > 0)
+  // Time added by the callbacks, e.g. bus stalls, is run before returning if it reaches the next event.
+  do
   {
-    // To avoid issues where two events are related to each other from becoming desynced,
-    // we run at a slice that is the length of the lowest next event time.
-    SimulationTime time = std::min(remaining_time, m_next_event_time);
-    remaining_time -= time;
-
-    // Apply downcount to all events.
-    // This will result in a negative downcount for those events which are late.
-    for (TimingEvent* evt : m_events)
-    {
-      evt->m_downcount = evt->m_downcount - time;
-      evt->m_time_since_last_run += time;
-    }
+    SimulationTime remaining_time = m_pending_time;
+    m_pending_time = 0;
 
-    // Now we can actually run the callbacks.
-    while (!m_events.empty() && m_events.front()->GetDownCount() <= 0)
+    while (remaining_time > 0)
     {
-      TimingEvent* evt = m_events.front();
-      SimulationTime time_late = -evt->m_downcount;
-      std::pop_heap(m_events.begin(), m_events.end(), CompareEvents);
-
-      // Don't include overrun cycles in the execution.
-      // If the late time is greater than (period * interval), we'll re-place us at the front (or near)
-      // the front of the queue again, and submit the next iteration then. This should reduce issues where
-      // multiple events are dependent on one another, that may be caused if all cycles were executed at once.
-      CycleCount cycles_to_execute = (evt->m_time_since_last_run - time_late) / evt->m_cycle_period;
-
-      // Calculate and set the new downcount for periodic events, taking into account late time.
-      CycleCount cycles_late = time_late / evt->m_cycle_period;
-
-      // Factor late time into the time for the next invocation.
-      evt->m_downcount += (evt->m_cycle_period * evt->m_interval);
-      evt->m_time_since_last_run -= cycles_to_execute * evt->m_cycle_period;
-
-      // The cycles_late is only an indicator, it doesn't modify the cycles to execute.
-      evt->m_callback(evt, cycles_to_execute, cycles_late);
-
-      // Place it in the appropriate position in the queue.
-      if (m_needs_sort)
+      // To avoid issues where two events are related to each other from becoming desynced,
+      // we run at a slice that is the length of the lowest next event time.
+      SimulationTime time = std::min(remaining_time, m_next_event_time);
+      remaining_time -= time;
+
+      // Apply downcount to all events.
+      // This will result in a negative downcount for those events which are late.
+      for (TimingEvent* evt : m_events)
       {
-        // Another event may have been changed by this event, or the interval/downcount changed.
-        std::make_heap(m_events.begin(), m_events.end(), CompareEvents);
-        m_needs_sort = false;
+        evt->m_downcount = evt->m_downcount - time;
+        evt->m_time_since_last_run += time;
       }
-      else
+
+      // Now we can actually run the callbacks.
+      while (!m_events.empty() && m_events.front()->GetDownCount() <= 0)
       {
-        // Keep the event list in a heap. The event we just serviced will be in the last place,
-        // so we can use push_here instead of make_heap, which should be faster.
-        std::push_heap(m_events.begin(), m_events.end(), CompareEvents);
+        TimingEvent* evt = m_events.front();
+        SimulationTime time_late = -evt->m_downcount;
+        std::pop_heap(m_events.begin(), m_events.end(), CompareEvents);
+
+        // Don't include overrun cycles in the execution.
+        // If the late time is greater than (period * interval), we'll re-place us at the front (or near)
+        // the front of the queue again, and submit the next iteration then. This should reduce issues where
+        // multiple events are dependent on one another, that may be caused if all cycles were executed at once.
+        CycleCount cycles_to_execute = (evt->m_time_since_last_run - time_late) / evt->m_cycle_period;
+
+        // Calculate and set the new downcount for periodic events, taking into account late time.
+        CycleCount cycles_late = time_late / evt->m_cycle_period;
+
+        // Factor late time into the time for the next invocation.
+        evt->m_downcount += (evt->m_cycle_period * evt->m_interval);
+        evt->m_time_since_last_run -= cycles_to_execute * evt->m_cycle_period;
+
+        // The cycles_late is only an indicator, it doesn't modify the cycles to execute.
+        evt->m_callback(evt, cycles_to_execute, cycles_late);
+
+        // Place it in the appropriate position in the queue.
+        if (m_needs_sort)
+        {
+          // Another event may have been changed by this event, or the interval/downcount changed.
+          std::make_heap(m_events.begin(), m_events.end(), CompareEvents);
+          m_needs_sort = false;
+        }
+        else
+        {
+          // Keep the event list in a heap. The event we just serviced will be in the last place,
+          // so we can use push_here instead of make_heap, which should be faster.
+          std::push_heap(m_events.begin(), m_events.end(), CompareEvents);
+        }
       }
-    }
 
-    // Run until next event, or 100ms.
-    UpdateNextEventTime();
-  }
+      // Run until next event, or 100ms.
+      UpdateNextEventTime();
+    }
+  } while (m_pending_time > 0 && m_pending_time >= m_next_event_time);
 
   m_running_events = false;
 }
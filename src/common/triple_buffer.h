@@ -0,0 +1,54 @@
+#pragma once
+#include "common/types.h"
+#include <array>
+#include <atomic>
+
+// Lock-free triple buffer, for handing the most recent value from one producer thread to one consumer thread.
+// The producer always owns a buffer to write to and the consumer always owns a buffer to read from, the third buffer
+// holds the last published value. Publishing and acquiring are a single atomic exchange, so neither side ever waits.
+// If the producer publishes faster than the consumer acquires, the older unread values are overwritten.
+template<typename T>
+class TripleBuffer
+{
+public:
+  // Producer side. The write buffer keeps whatever was last written to it, which may be an older value.
+  T& GetWriteBuffer() { return m_buffers[m_write_index]; }
+  const T& GetWriteBuffer() const { return m_buffers[m_write_index]; }
+  u32 GetWriteIndex() const { return m_write_index; }
+
+  // Makes the write buffer visible to the consumer. Returns false if the previously published value was never
+  // acquired, in which case its buffer becomes the new write buffer, still holding the dropped value.
+  bool Publish()
+  {
+    const u32 old_pending = m_pending.exchange(m_write_index | FRESH_BIT, std::memory_order_acq_rel);
+    m_write_index = old_pending & INDEX_MASK;
+    return (old_pending & FRESH_BIT) == 0;
+  }
+
+  // Consumer side. Returns false if nothing has been published since the last call.
+  bool Acquire()
+  {
+    if ((m_pending.load(std::memory_order_relaxed) & FRESH_BIT) == 0)
+      return false;
+
+    m_read_index = m_pending.exchange(m_read_index, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+  }
+  const T& GetReadBuffer() const { return m_buffers[m_read_index]; }
+
+  // Direct access by index. Only safe for buffers the caller knows the other side is not writing, e.g. the buffer the
+  // producer just published (the consumer only reads), or any buffer while neither side is running.
+  T& GetBuffer(u32 index) { return m_buffers[index]; }
+  const T& GetBuffer(u32 index) const { return m_buffers[index]; }
+
+private:
+  static constexpr u32 INDEX_MASK = 0x03;
+  static constexpr u32 FRESH_BIT = 0x04;
+
+  std::array<T, 3> m_buffers;
+
+  // Each side only touches its own index, the pending index is exchanged between them.
+  alignas(64) u32 m_write_index = 0;
+  alignas(64) std::atomic<u32> m_pending{2};
+  alignas(64) u32 m_read_index = 1;
+};
@@ -0,0 +1,189 @@
+#include "common/audio.h"
+#include <cstring>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using Audio::AudioBuffer;
+using Audio::Channel;
+using Audio::SampleFormat;
+
+TEST(AudioBuffer, ReadWriteAcrossWrap)
+{
+  AudioBuffer buffer(16);
+  byte data[32];
+  for (u32 i = 0; i < sizeof(data); i++)
+    data[i] = Truncate8(i);
+
+  ASSERT_TRUE(buffer.Write(data, 10));
+  EXPECT_EQ(buffer.GetBufferUsed(), 10u);
+  EXPECT_EQ(buffer.GetBufferSpace(), 6u);
+
+  byte out[16];
+  ASSERT_TRUE(buffer.Read(out, 8));
+  for (u32 i = 0; i < 8; i++)
+    EXPECT_EQ(out[i], i);
+
+  // 6 bytes up to the end of the buffer, then 6 more at the start.
+  EXPECT_EQ(buffer.GetContiguousBufferSpace(), 6u);
+  ASSERT_TRUE(buffer.Write(data + 10, 12));
+  EXPECT_EQ(buffer.GetBufferUsed(), 14u);
+  EXPECT_EQ(buffer.GetBufferSpace(), 2u);
+  EXPECT_FALSE(buffer.Write(data, 3));
+
+  // The read pointer stops at the end of the buffer.
+  const void* read_ptr;
+  size_t read_len;
+  ASSERT_TRUE(buffer.GetReadPointer(&read_ptr, &read_len));
+  EXPECT_EQ(read_len, 8u);
+  EXPECT_EQ(static_cast<const byte*>(read_ptr)[0], 8);
+  buffer.MoveReadPointer(read_len);
+  ASSERT_TRUE(buffer.GetReadPointer(&read_ptr, &read_len));
+  EXPECT_EQ(read_len, 6u);
+  EXPECT_EQ(static_cast<const byte*>(read_ptr)[0], 16);
+
+  // Read() copies both parts.
+  ASSERT_TRUE(buffer.Write(data + 22, 2));
+  EXPECT_FALSE(buffer.Read(out, 9));
+  ASSERT_TRUE(buffer.Read(out, 8));
+  for (u32 i = 0; i < 8; i++)
+    EXPECT_EQ(out[i], 16 + i);
+  EXPECT_EQ(buffer.GetBufferUsed(), 0u);
+  EXPECT_FALSE(buffer.GetReadPointer(&read_ptr, &read_len));
+}
+
+TEST(AudioBuffer, WritePointer)
+{
+  AudioBuffer buffer(16);
+  void* write_ptr;
+  size_t write_len = 4;
+  ASSERT_TRUE(buffer.GetWritePointer(&write_ptr, &write_len));
+  EXPECT_EQ(write_len, 16u);
+  std::memset(write_ptr, 0xAA, 12);
+  buffer.MoveWritePointer(12);
+  EXPECT_EQ(buffer.GetWritePosition(), 12u);
+
+  // Only 4 bytes are left before the end, even after the start has been read.
+  byte out[12];
+  ASSERT_TRUE(buffer.Read(out, 12));
+  write_len = 8;
+  EXPECT_FALSE(buffer.GetWritePointer(&write_ptr, &write_len));
+  write_len = 4;
+  ASSERT_TRUE(buffer.GetWritePointer(&write_ptr, &write_len));
+  EXPECT_EQ(write_len, 4u);
+
+  // Discarding drops everything written before the position, but not what follows.
+  ASSERT_TRUE(buffer.Write(out, 8));
+  const u64 position = buffer.GetWritePosition();
+  ASSERT_TRUE(buffer.Write(out, 3));
+  buffer.DiscardUntil(position);
+  EXPECT_EQ(buffer.GetBufferUsed(), 3u);
+  buffer.DiscardUntil(position - 4);
+  EXPECT_EQ(buffer.GetBufferUsed(), 3u);
+  buffer.Clear();
+  EXPECT_EQ(buffer.GetBufferUsed(), 0u);
+}
+
+TEST(AudioBuffer, ProducerConsumerThreads)
+{
+  // Values are written in chunks which don't divide the buffer size, so that both sides regularly wrap.
+  AudioBuffer buffer(sizeof(u32) * 1000);
+  constexpr u32 total = 1000000;
+  std::thread producer([&buffer]() {
+    u32 next = 0;
+    while (next < total)
+    {
+      u32 values[37];
+      u32 count = 0;
+      for (; count < 37 && (next + count) < total; count++)
+        values[count] = next + count;
+      if (buffer.Write(values, count * sizeof(u32)))
+        next += count;
+      else
+        std::this_thread::yield();
+    }
+  });
+
+  u32 expected = 0;
+  u32 mismatches = 0;
+  while (expected < total)
+  {
+    const void* read_ptr;
+    size_t read_len;
+    if (!buffer.GetReadPointer(&read_ptr, &read_len))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    read_len = std::min<size_t>(read_len, sizeof(u32) * 53);
+    for (size_t i = 0; i < read_len / sizeof(u32); i++)
+      mismatches += static_cast<u32>(static_cast<const u32*>(read_ptr)[i] != expected++);
+    buffer.MoveReadPointer(read_len);
+  }
+
+  producer.join();
+  EXPECT_EQ(mismatches, 0u);
+  EXPECT_EQ(buffer.GetBufferUsed(), 0u);
+}
+
+static void WriteChannelSamples(Channel* channel, size_t count, float value)
+{
+  float* samples = static_cast<float*>(channel->ReserveInputSamples(count));
+  for (size_t i = 0; i < count; i++)
+    samples[i] = value;
+  channel->CommitInputSamples(count);
+}
+
+TEST(AudioChannel, StagedInputAcrossWrap)
+{
+  // One second of input, so 1000 samples.
+  Channel channel("test", 1000.0f, 1000.0f, SampleFormat::Float32, 1);
+  EXPECT_EQ(channel.GetFreeInputSamples(), 1000u);
+  WriteChannelSamples(&channel, 900, 0.5f);
+  EXPECT_EQ(channel.GetFreeInputSamples(), 100u);
+
+  // Consume some input, then write more than fits before the end of the ring, which goes through the staging buffer.
+  std::vector<float> output(500);
+  channel.ReadSamples(output.data(), output.size());
+  const size_t free_samples = channel.GetFreeInputSamples();
+  ASSERT_GE(free_samples, 300u);
+  WriteChannelSamples(&channel, 300, 0.5f);
+  EXPECT_EQ(channel.GetFreeInputSamples(), free_samples - 300);
+
+  // The staged samples come out the same as the rest, now that the resampler has settled.
+  channel.ReadSamples(output.data(), output.size());
+  for (size_t i = 0; i < output.size(); i++)
+    EXPECT_NEAR(output[i], 0.5f, 0.01f) << i;
+}
+
+TEST(AudioChannel, InputTruncatedWhenFull)
+{
+  Channel channel("test", 1000.0f, 1000.0f, SampleFormat::Float32, 1);
+  WriteChannelSamples(&channel, 950, 0.0f);
+  EXPECT_EQ(channel.GetFreeInputSamples(), 50u);
+
+  // The newest samples are dropped, rather than overwriting those which have not been read yet.
+  WriteChannelSamples(&channel, 80, 0.0f);
+  EXPECT_EQ(channel.GetFreeInputSamples(), 0u);
+  WriteChannelSamples(&channel, 10, 0.0f);
+  EXPECT_EQ(channel.GetFreeInputSamples(), 0u);
+}
+
+TEST(AudioChannel, ClearKeepsLaterSamples)
+{
+  Channel channel("test", 1000.0f, 1000.0f, SampleFormat::Float32, 1);
+  WriteChannelSamples(&channel, 300, 1.0f);
+  channel.ClearBuffer();
+  WriteChannelSamples(&channel, 200, 0.0f);
+
+  // The clear is only applied by the reading side, and only drops what was written before it was requested.
+  EXPECT_EQ(channel.GetFreeInputSamples(), 500u);
+  channel.ReadSamples(nullptr, 0);
+  EXPECT_EQ(channel.GetFreeInputSamples(), 800u);
+
+  std::vector<float> output(400);
+  channel.ReadSamples(output.data(), output.size());
+  for (size_t i = 0; i < output.size(); i++)
+    EXPECT_EQ(output[i], 0.0f) << i;
+}
@@ -0,0 +1,126 @@
+#include "YBaseLib/ByteStream.h"
+#include "common/block_image.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+// Mostly-empty disk contents: zero blocks, runs, text-like data and incompressible noise.
+static std::vector<byte> GenerateDiskContents(u32 size, u32 block_size, u32 seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<byte> data(size, 0);
+  for (u32 block_start = 0; block_start < size; block_start += block_size)
+  {
+    const u32 block_end = std::min(block_start + block_size, size);
+    switch ((block_start / block_size) % 4)
+    {
+      case 0:
+        break;
+
+      case 1:
+        for (u32 i = block_start; i < block_end; i++)
+          data[i] = static_cast<byte>((i / 37) & 0xFF);
+        break;
+
+      case 2:
+        for (u32 i = block_start; i < block_end; i++)
+          data[i] = static_cast<byte>("The quick brown fox "[rng() % 20]);
+        break;
+
+      case 3:
+        for (u32 i = block_start; i < block_end; i++)
+          data[i] = static_cast<byte>(rng());
+        break;
+    }
+  }
+  return data;
+}
+
+TEST(BlockImage, LZ4RoundTrip)
+{
+  for (u32 size : {0u, 1u, 5u, 12u, 13u, 100u, 4096u, 65536u})
+  {
+    for (u32 seed = 0; seed < 4; seed++)
+    {
+      const std::vector<byte> src = GenerateDiskContents(size, 1024, seed);
+      std::vector<byte> compressed(size + size / 255 + 16);
+      const u32 compressed_size =
+        BlockImage::CompressLZ4(src.data(), size, compressed.data(), static_cast<u32>(compressed.size()));
+      ASSERT_GT(compressed_size, 0u) << "size " << size;
+
+      std::vector<byte> decompressed(size);
+      ASSERT_TRUE(BlockImage::DecompressLZ4(compressed.data(), compressed_size, decompressed.data(), size))
+        << "size " << size;
+      EXPECT_EQ(src, decompressed) << "size " << size;
+    }
+  }
+}
+
+TEST(BlockImage, LZ4RejectsCorruptInput)
+{
+  // A match offset pointing before the start of the output.
+  const byte bad_offset[] = {0x10, 'A', 0x05, 0x00, 0x00};
+  byte out[32];
+  EXPECT_FALSE(BlockImage::DecompressLZ4(bad_offset, sizeof(bad_offset), out, sizeof(out)));
+
+  // Literals running past the end of the input.
+  const byte truncated[] = {0x50, 'A', 'B'};
+  EXPECT_FALSE(BlockImage::DecompressLZ4(truncated, sizeof(truncated), out, 5));
+}
+
+TEST(BlockImage, CreateAndRead)
+{
+  constexpr u32 block_size = 4096;
+  constexpr u32 image_size = block_size * 13 + 512;
+  const std::vector<byte> contents = GenerateDiskContents(image_size, block_size, 1);
+
+  ByteStream* raw_stream = ByteStream_CreateGrowableMemoryStream();
+  ASSERT_TRUE(raw_stream->Write2(contents.data(), image_size));
+  ByteStream* image_stream = ByteStream_CreateGrowableMemoryStream();
+  ASSERT_TRUE(BlockImage::Create(raw_stream, image_size, image_stream, block_size));
+  raw_stream->Release();
+
+  // Zero blocks take no space, so the image is smaller than the raw data.
+  EXPECT_LT(image_stream->GetSize(), u64(image_size));
+  ASSERT_TRUE(BlockImage::IsBlockImage(image_stream));
+
+  std::unique_ptr<BlockImage> image = BlockImage::Open(image_stream);
+  image_stream->Release();
+  ASSERT_TRUE(image);
+  EXPECT_EQ(image->GetImageSize(), u64(image_size));
+  EXPECT_EQ(image->GetBlockCount(), 14u);
+
+  // Reads which straddle blocks, with a cache smaller than the number of blocks touched.
+  image->SetCacheBlockCount(2);
+  std::mt19937 rng(2);
+  std::vector<byte> buffer(block_size * 3);
+  for (u32 i = 0; i < 200; i++)
+  {
+    const u32 offset = rng() % image_size;
+    const u32 size = std::min(static_cast<u32>(rng() % buffer.size()), image_size - offset);
+    ASSERT_TRUE(image->Read(buffer.data(), offset, size));
+    ASSERT_TRUE(std::equal(buffer.begin(), buffer.begin() + size, contents.begin() + offset))
+      << "offset " << offset << " size " << size;
+  }
+
+  EXPECT_FALSE(image->Read(buffer.data(), image_size - 1, 2));
+}
+
+TEST(BlockImage, RejectsOversizedIndex)
+{
+  constexpr u32 block_size = 4096;
+  const std::vector<byte> contents = GenerateDiskContents(block_size * 4, block_size, 3);
+  ByteStream* raw_stream = ByteStream_CreateGrowableMemoryStream();
+  ASSERT_TRUE(raw_stream->Write2(contents.data(), static_cast<u32>(contents.size())));
+  ByteStream* image_stream = ByteStream_CreateGrowableMemoryStream();
+  ASSERT_TRUE(BlockImage::Create(raw_stream, contents.size(), image_stream, block_size));
+  raw_stream->Release();
+
+  // A consistent header whose index is far larger than the stream.
+  const u64 image_size = u64(0xFFFFFFFFu) * block_size;
+  const u32 block_count = 0xFFFFFFFFu;
+  ASSERT_TRUE(image_stream->SeekAbsolute(8) && image_stream->Write2(&image_size, sizeof(image_size)));
+  ASSERT_TRUE(image_stream->SeekAbsolute(20) && image_stream->Write2(&block_count, sizeof(block_count)));
+  EXPECT_FALSE(BlockImage::Open(image_stream));
+  image_stream->Release();
+}
@@ -0,0 +1,144 @@
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/FileSystem.h"
+#include "common/cd_image.h"
+#include <cstring>
+#include <gtest/gtest.h>
+#include <vector>
+
+static bool WriteTestFile(const char* filename, const void* data, size_t size)
+{
+  ByteStream* stream = FileSystem::OpenFile(filename, BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE |
+                                                        BYTESTREAM_OPEN_TRUNCATE | BYTESTREAM_OPEN_SEEKABLE);
+  if (!stream)
+    return false;
+
+  const bool result = stream->Write2(data, static_cast<u32>(size));
+  stream->Release();
+  return result;
+}
+
+TEST(CDImage, LBAToMSF)
+{
+  u8 minute, second, frame;
+  CDImage::LBAToMSF(0, &minute, &second, &frame);
+  EXPECT_EQ(minute, 0);
+  EXPECT_EQ(second, 2);
+  EXPECT_EQ(frame, 0);
+
+  CDImage::LBAToMSF(4500 - 150 + 74, &minute, &second, &frame);
+  EXPECT_EQ(minute, 1);
+  EXPECT_EQ(second, 0);
+  EXPECT_EQ(frame, 74);
+}
+
+TEST(CDImage, CueSheetWithAudioTrack)
+{
+  // A raw mode 1 track of 10 sectors, then an audio track with a stored 2-sector pregap and 5 sectors of audio.
+  constexpr u32 data_sectors = 10;
+  constexpr u32 audio_sectors = 7;
+  std::vector<byte> bin((data_sectors + audio_sectors) * CDImage::RAW_SECTOR_SIZE);
+  for (u32 i = 0; i < data_sectors; i++)
+  {
+    byte* sector = &bin[i * CDImage::RAW_SECTOR_SIZE];
+    std::memset(sector + 1, 0xFF, 10);
+    sector[15] = 1;
+    std::memset(sector + 16, static_cast<int>(i), CDImage::DATA_SECTOR_SIZE);
+  }
+  for (u32 i = 0; i < audio_sectors; i++)
+    std::memset(&bin[(data_sectors + i) * CDImage::RAW_SECTOR_SIZE], 0x80 + i, CDImage::RAW_SECTOR_SIZE);
+
+  static const char cue[] = "FILE \"cd_image_test.bin\" BINARY\r\n"
+                            "  TRACK 01 MODE1/2352\r\n"
+                            "    INDEX 01 00:00:00\r\n"
+                            "  TRACK 02 AUDIO\r\n"
+                            "    INDEX 00 00:00:10\r\n"
+                            "    INDEX 01 00:00:12\r\n";
+  ASSERT_TRUE(WriteTestFile("cd_image_test.bin", bin.data(), bin.size()));
+  ASSERT_TRUE(WriteTestFile("cd_image_test.cue", cue, sizeof(cue) - 1));
+
+  std::unique_ptr<CDImage> image = CDImage::Open("cd_image_test.cue");
+  ASSERT_TRUE(image);
+  EXPECT_EQ(image->GetSectorCount(), 17u);
+  ASSERT_EQ(image->GetTrackCount(), 2u);
+
+  const CDImage::Track& data_track = image->GetTrack(0);
+  EXPECT_EQ(data_track.mode, CDImage::TrackMode::Mode1Raw);
+  EXPECT_EQ(data_track.start_lba, 0u);
+  EXPECT_EQ(data_track.length, 10u);
+
+  const CDImage::Track& audio_track = image->GetTrack(1);
+  EXPECT_TRUE(audio_track.IsAudio());
+  EXPECT_EQ(audio_track.start_lba, 12u);
+  EXPECT_EQ(audio_track.pregap, 2u);
+  EXPECT_EQ(audio_track.length, 5u);
+  EXPECT_EQ(image->GetTrackForLBA(9), &data_track);
+  EXPECT_EQ(image->GetTrackForLBA(10), &audio_track);
+  EXPECT_EQ(image->GetTrackForLBA(17), nullptr);
+
+  // User data is extracted from the raw sectors.
+  std::vector<byte> buffer(3 * CDImage::DATA_SECTOR_SIZE);
+  ASSERT_TRUE(image->ReadDataSectors(7, 3, buffer.data()));
+  for (u32 i = 0; i < 3; i++)
+    EXPECT_EQ(buffer[i * CDImage::DATA_SECTOR_SIZE + 100], 7 + i);
+  EXPECT_FALSE(image->ReadDataSectors(9, 2, buffer.data()));
+  EXPECT_FALSE(image->ReadDataSectors(12, 1, buffer.data()));
+
+  // Raw reads return the sector as stored.
+  std::vector<byte> raw(CDImage::RAW_SECTOR_SIZE);
+  ASSERT_TRUE(image->ReadRawSector(3, raw.data()));
+  EXPECT_TRUE(std::equal(raw.begin(), raw.end(), bin.begin() + 3 * CDImage::RAW_SECTOR_SIZE));
+  ASSERT_TRUE(image->ReadRawSector(16, raw.data()));
+  EXPECT_EQ(raw[0], 0x80 + 6);
+  EXPECT_FALSE(image->ReadRawSector(17, raw.data()));
+
+  image.reset();
+  FileSystem::DeleteFile("cd_image_test.cue");
+  FileSystem::DeleteFile("cd_image_test.bin");
+}
+
+TEST(CDImage, FlatImageRawSector)
+{
+  std::vector<byte> iso(4 * CDImage::DATA_SECTOR_SIZE);
+  for (u32 i = 0; i < 4; i++)
+    std::memset(&iso[i * CDImage::DATA_SECTOR_SIZE], 0x10 + i, CDImage::DATA_SECTOR_SIZE);
+  ASSERT_TRUE(WriteTestFile("cd_image_test.iso", iso.data(), iso.size()));
+
+  std::unique_ptr<CDImage> image = CDImage::Open("cd_image_test.iso");
+  ASSERT_TRUE(image);
+  EXPECT_EQ(image->GetSectorCount(), 4u);
+  ASSERT_EQ(image->GetTrackCount(), 1u);
+  EXPECT_EQ(image->GetTrack(0).mode, CDImage::TrackMode::Mode1);
+
+  // The sync pattern and header are generated, with the address at 00:02:02 in BCD.
+  std::vector<byte> raw(CDImage::RAW_SECTOR_SIZE);
+  ASSERT_TRUE(image->ReadRawSector(2, raw.data()));
+  EXPECT_EQ(raw[0], 0x00);
+  EXPECT_EQ(raw[1], 0xFF);
+  EXPECT_EQ(raw[10], 0xFF);
+  EXPECT_EQ(raw[11], 0x00);
+  EXPECT_EQ(raw[12], 0x00);
+  EXPECT_EQ(raw[13], 0x02);
+  EXPECT_EQ(raw[14], 0x02);
+  EXPECT_EQ(raw[15], 0x01);
+  EXPECT_EQ(raw[16], 0x12);
+  EXPECT_EQ(raw[16 + CDImage::DATA_SECTOR_SIZE - 1], 0x12);
+  EXPECT_EQ(raw[16 + CDImage::DATA_SECTOR_SIZE], 0x00);
+
+  image.reset();
+  FileSystem::DeleteFile("cd_image_test.iso");
+}
+
+TEST(CDImage, CueSheetRejectsBigEndianFile)
+{
+  std::vector<byte> bin(CDImage::RAW_SECTOR_SIZE);
+  static const char cue[] = "FILE \"cd_image_test.bin\" MOTOROLA\r\n"
+                            "  TRACK 01 AUDIO\r\n"
+                            "    INDEX 01 00:00:00\r\n";
+  ASSERT_TRUE(WriteTestFile("cd_image_test.bin", bin.data(), bin.size()));
+  ASSERT_TRUE(WriteTestFile("cd_image_test.cue", cue, sizeof(cue) - 1));
+
+  EXPECT_FALSE(CDImage::Open("cd_image_test.cue"));
+
+  FileSystem::DeleteFile("cd_image_test.cue");
+  FileSystem::DeleteFile("cd_image_test.bin");
+}
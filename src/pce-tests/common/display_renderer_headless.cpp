@@ -0,0 +1,439 @@
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/FileSystem.h"
+#include "common/display_renderer_headless.h"
+#include <cstring>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+static std::unique_ptr<DisplayRendererHeadless> CreateRenderer()
+{
+  std::unique_ptr<DisplayRenderer> renderer =
+    DisplayRenderer::Create(DisplayRenderer::BackendType::Headless, nullptr, 640, 480);
+  return std::unique_ptr<DisplayRendererHeadless>(static_cast<DisplayRendererHeadless*>(renderer.release()));
+}
+
+static bool ReadTestFile(const char* filename, std::vector<byte>* data)
+{
+  ByteStream* stream = FileSystem::OpenFile(filename, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_SEEKABLE);
+  if (!stream)
+    return false;
+
+  data->resize(static_cast<size_t>(stream->GetSize()));
+  const bool result = data->empty() || stream->Read2(data->data(), static_cast<u32>(data->size()));
+  stream->Release();
+  return result;
+}
+
+// Fills the framebuffer with a pattern derived from seed.
+static void DrawFrame(Display* display, u32 seed)
+{
+  for (u32 y = 0; y < display->GetFramebufferHeight(); y++)
+  {
+    for (u32 x = 0; x < display->GetFramebufferWidth(); x++)
+      display->SetPixel(x, y, Truncate8(seed), Truncate8(x + seed), Truncate8(y * 3));
+  }
+}
+
+static void PresentFrame(Display* display, u32 seed)
+{
+  DrawFrame(display, seed);
+  display->SwapFramebuffer();
+}
+
+static u32 ReadBE32(const byte* p)
+{
+  return (ZeroExtend32(p[0]) << 24) | (ZeroExtend32(p[1]) << 16) | (ZeroExtend32(p[2]) << 8) | ZeroExtend32(p[3]);
+}
+
+static u32 CRC32(const byte* data, size_t size)
+{
+  u32 crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; i++)
+  {
+    crc ^= data[i];
+    for (u32 k = 0; k < 8; k++)
+      crc = (crc & 1) ? (0xEDB88320u ^ (crc >> 1)) : (crc >> 1);
+  }
+  return ~crc;
+}
+
+static u32 Adler32(const byte* data, size_t size)
+{
+  u32 a = 1, b = 0;
+  for (size_t i = 0; i < size; i++)
+  {
+    a = (a + data[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+  return (b << 16) | a;
+}
+
+// Decoder for the subset of deflate which does not use dynamic Huffman tables, i.e. stored and fixed blocks.
+class InflateReader
+{
+public:
+  InflateReader(const byte* data, size_t size) : m_data(data), m_size(size) {}
+
+  bool Inflate(std::vector<byte>* out)
+  {
+    static constexpr u16 length_base[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                            31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static constexpr u8 length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                            2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static constexpr u16 distance_base[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                              33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                              1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static constexpr u8 distance_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                              6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    bool final_block = false;
+    while (!final_block)
+    {
+      final_block = GetBits(1) != 0;
+      const u32 type = GetBits(2);
+      if (type == 0)
+      {
+        // Stored block, aligned to the next byte.
+        if (m_bit_count != 0)
+        {
+          m_bit_count = 0;
+          m_position++;
+        }
+        if ((m_position + 4) > m_size)
+          return false;
+        const u32 length = ZeroExtend32(m_data[m_position]) | (ZeroExtend32(m_data[m_position + 1]) << 8);
+        const u32 nlength = ZeroExtend32(m_data[m_position + 2]) | (ZeroExtend32(m_data[m_position + 3]) << 8);
+        m_position += 4;
+        if ((length ^ 0xFFFF) != nlength || (m_position + length) > m_size)
+          return false;
+        out->insert(out->end(), m_data + m_position, m_data + m_position + length);
+        m_position += length;
+        continue;
+      }
+      if (type != 1)
+        return false;
+
+      for (;;)
+      {
+        const u32 symbol = GetLiteral();
+        if (m_overrun || symbol > 285)
+          return false;
+        if (symbol < 256)
+        {
+          out->push_back(Truncate8(symbol));
+          continue;
+        }
+        if (symbol == 256)
+          break;
+
+        const u32 length = length_base[symbol - 257] + GetBits(length_extra[symbol - 257]);
+        const u32 distance_code = GetCode(5);
+        if (distance_code >= 30)
+          return false;
+        const u32 distance = distance_base[distance_code] + GetBits(distance_extra[distance_code]);
+        if (m_overrun || distance > out->size())
+          return false;
+        for (u32 i = 0; i < length; i++)
+          out->push_back((*out)[out->size() - distance]);
+      }
+    }
+
+    return !m_overrun;
+  }
+
+  // Position of the first byte after the deflate stream.
+  size_t GetEndPosition() const { return m_position + (m_bit_count != 0); }
+
+private:
+  u32 GetBits(u32 count)
+  {
+    u32 value = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+      if (m_position >= m_size)
+      {
+        m_overrun = true;
+        return 0;
+      }
+      value |= ((ZeroExtend32(m_data[m_position]) >> m_bit_count) & 1) << i;
+      if (++m_bit_count == 8)
+      {
+        m_bit_count = 0;
+        m_position++;
+      }
+    }
+    return value;
+  }
+
+  // Huffman codes are packed starting from the most significant bit.
+  u32 GetCode(u32 length)
+  {
+    u32 code = 0;
+    for (u32 i = 0; i < length; i++)
+      code = (code << 1) | GetBits(1);
+    return code;
+  }
+
+  u32 GetLiteral()
+  {
+    u32 code = GetCode(7);
+    if (code < 0x18)
+      return 256 + code;
+    code = (code << 1) | GetBits(1);
+    if (code < 0xC0)
+      return code - 0x30;
+    if (code < 0xC8)
+      return 280 + (code - 0xC0);
+    code = (code << 1) | GetBits(1);
+    return 144 + (code - 0x190);
+  }
+
+  const byte* m_data;
+  size_t m_size;
+  size_t m_position = 0;
+  u32 m_bit_count = 0;
+  bool m_overrun = false;
+};
+
+// Parses a PNG written by the capture path, checking every CRC and the zlib checksum, and returns its pixels as RGB8.
+static bool DecodePNG(const std::vector<byte>& png, u32* width, u32* height, std::vector<byte>* rgb)
+{
+  static const byte signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  if (png.size() < sizeof(signature) || std::memcmp(png.data(), signature, sizeof(signature)) != 0)
+    return false;
+
+  std::vector<byte> zlib_data;
+  bool seen_ihdr = false, seen_iend = false;
+  size_t position = sizeof(signature);
+  while (!seen_iend)
+  {
+    if ((position + 12) > png.size())
+      return false;
+    const u32 length = ReadBE32(&png[position]);
+    if ((position + 12 + length) > png.size())
+      return false;
+    const byte* type = &png[position + 4];
+    const byte* data = &png[position + 8];
+    if (CRC32(type, length + 4) != ReadBE32(data + length))
+      return false;
+
+    if (std::memcmp(type, "IHDR", 4) == 0)
+    {
+      // 8-bit RGB, deflate, no filtering, no interlace.
+      static const byte expected[5] = {8, 2, 0, 0, 0};
+      if (length != 13 || std::memcmp(data + 8, expected, sizeof(expected)) != 0)
+        return false;
+      *width = ReadBE32(data);
+      *height = ReadBE32(data + 4);
+      seen_ihdr = true;
+    }
+    else if (std::memcmp(type, "IDAT", 4) == 0)
+    {
+      zlib_data.insert(zlib_data.end(), data, data + length);
+    }
+    else if (std::memcmp(type, "IEND", 4) == 0)
+    {
+      seen_iend = true;
+    }
+
+    position += 12 + length;
+  }
+  if (!seen_ihdr || position != png.size())
+    return false;
+
+  // zlib header: deflate with a 32K window, no dictionary, and a valid check value.
+  if (zlib_data.size() < 6 || (zlib_data[0] & 0x0F) != 8 || (zlib_data[0] >> 4) > 7 || (zlib_data[1] & 0x20) != 0 ||
+      ((ZeroExtend32(zlib_data[0]) << 8) | zlib_data[1]) % 31 != 0)
+  {
+    return false;
+  }
+
+  std::vector<byte> raw;
+  InflateReader reader(zlib_data.data() + 2, zlib_data.size() - 2);
+  if (!reader.Inflate(&raw))
+    return false;
+  const size_t adler_position = 2 + reader.GetEndPosition();
+  if ((adler_position + 4) != zlib_data.size() ||
+      ReadBE32(&zlib_data[adler_position]) != Adler32(raw.data(), raw.size()))
+  {
+    return false;
+  }
+
+  // Every row is preceded by its filter type, which is always none.
+  const size_t row_size = size_t(*width) * 3;
+  if (raw.size() != (row_size + 1) * *height)
+    return false;
+  rgb->clear();
+  for (u32 row = 0; row < *height; row++)
+  {
+    const byte* src = &raw[row * (row_size + 1)];
+    if (src[0] != 0)
+      return false;
+    rgb->insert(rgb->end(), src + 1, src + 1 + row_size);
+  }
+
+  return true;
+}
+
+TEST(DisplayRendererHeadless, FrameHashTracksContents)
+{
+  std::unique_ptr<DisplayRendererHeadless> renderer = CreateRenderer();
+  ASSERT_TRUE(renderer);
+  std::unique_ptr<Display> display = renderer->CreateDisplay("hash_test", Display::Type::Primary);
+  display->ResizeFramebuffer(16, 8);
+
+  PresentFrame(display.get(), 1);
+  const u64 first_hash = renderer->GetPrimaryDisplayFrameHash();
+  EXPECT_EQ(renderer->GetPrimaryDisplayFrameCount(), 1u);
+
+  // The same image again, drawn into a different buffer.
+  PresentFrame(display.get(), 1);
+  EXPECT_EQ(renderer->GetPrimaryDisplayFrameHash(), first_hash);
+  EXPECT_EQ(renderer->GetPrimaryDisplayFrameCount(), 2u);
+
+  // A single changed pixel.
+  DrawFrame(display.get(), 1);
+  display->SetPixel(15, 7, 0, 0, 0);
+  display->SwapFramebuffer();
+  EXPECT_NE(renderer->GetPrimaryDisplayFrameHash(), first_hash);
+
+  // Same pixels, different dimensions.
+  std::vector<u32> blank(16 * 8);
+  display->CopyFrame(blank.data(), 16 * sizeof(u32));
+  display->SwapFramebuffer();
+  const u64 blank_hash = renderer->GetPrimaryDisplayFrameHash();
+  display->ResizeFramebuffer(8, 16);
+  display->CopyFrame(blank.data(), 8 * sizeof(u32));
+  display->SwapFramebuffer();
+  EXPECT_NE(renderer->GetPrimaryDisplayFrameHash(), blank_hash);
+  EXPECT_EQ(renderer->GetPrimaryDisplayFrameCount(), 5u);
+}
+
+TEST(DisplayRendererHeadless, CaptureDecimation)
+{
+  std::unique_ptr<DisplayRendererHeadless> renderer = CreateRenderer();
+  ASSERT_TRUE(renderer);
+  std::unique_ptr<Display> display = renderer->CreateDisplay("capture_test", Display::Type::Primary);
+  display->ResizeFramebuffer(5, 3);
+  renderer->SetCapture(DisplayRendererHeadless::CaptureFormat::Raw, ".", 3);
+
+  // Waiting for each frame to be written means every slot is free again, so none are dropped, and with more captures
+  // than slots each slot is reused.
+  for (u32 frame = 1; frame <= 12; frame++)
+  {
+    PresentFrame(display.get(), frame);
+    renderer->FlushCapture();
+  }
+  EXPECT_EQ(renderer->GetDroppedCaptureCount(), 0u);
+
+  for (u32 frame = 1; frame <= 12; frame++)
+  {
+    SmallString filename;
+    filename.Format("./capture_test_%06u_5x3.rgba", frame);
+    std::vector<byte> data;
+    if ((frame % 3) != 0)
+    {
+      EXPECT_FALSE(FileSystem::FileExists(filename)) << filename.GetCharArray();
+      continue;
+    }
+
+    ASSERT_TRUE(ReadTestFile(filename, &data)) << filename.GetCharArray();
+    ASSERT_EQ(data.size(), 5u * 3u * 4u);
+    for (u32 i = 0; i < 5 * 3; i++)
+    {
+      const u32 x = i % 5;
+      const u32 y = i / 5;
+      EXPECT_EQ(data[i * 4 + 0], Truncate8(frame));
+      EXPECT_EQ(data[i * 4 + 1], Truncate8(x + frame));
+      EXPECT_EQ(data[i * 4 + 2], Truncate8(y * 3));
+    }
+    FileSystem::DeleteFile(filename);
+  }
+}
+
+TEST(DisplayRendererHeadless, CaptureSlotsAreNotShared)
+{
+  std::unique_ptr<DisplayRendererHeadless> renderer = CreateRenderer();
+  ASSERT_TRUE(renderer);
+  std::unique_ptr<Display> display = renderer->CreateDisplay("burst_test", Display::Type::Primary);
+  display->ResizeFramebuffer(64, 48);
+  renderer->SetCapture(DisplayRendererHeadless::CaptureFormat::Raw, ".", 1);
+
+  // Without waiting, the writer can fall behind and frames are dropped, but those which are written must hold the
+  // pixels of their own frame rather than a later one which reused the slot.
+  constexpr u32 frame_count = 50;
+  for (u32 frame = 1; frame <= frame_count; frame++)
+    PresentFrame(display.get(), frame);
+  renderer->FlushCapture();
+
+  u32 written = 0;
+  for (u32 frame = 1; frame <= frame_count; frame++)
+  {
+    SmallString filename;
+    filename.Format("./burst_test_%06u_64x48.rgba", frame);
+    std::vector<byte> data;
+    if (!ReadTestFile(filename, &data))
+      continue;
+
+    written++;
+    ASSERT_EQ(data.size(), 64u * 48u * 4u);
+    EXPECT_EQ(data[0], Truncate8(frame));
+    EXPECT_EQ(data[data.size() - 4], Truncate8(frame));
+    FileSystem::DeleteFile(filename);
+  }
+  EXPECT_GT(written, 0u);
+  EXPECT_EQ(written + renderer->GetDroppedCaptureCount(), frame_count);
+}
+
+TEST(DisplayRendererHeadless, PNGRoundTrip)
+{
+  // Noise on the top rows so that most of it is stored as literals, then rows copied from far enough above to need
+  // long distances, and a flat area which gives maximum length matches.
+  constexpr u32 width = 300;
+  constexpr u32 height = 120;
+  std::vector<u32> pixels(width * height);
+  std::mt19937 rng(1234);
+  for (u32 y = 0; y < height; y++)
+  {
+    for (u32 x = 0; x < width; x++)
+    {
+      u32& pixel = pixels[y * width + x];
+      if (y < 40)
+        pixel = Display::PackRGBX(Truncate8(rng()), Truncate8(rng()), Truncate8(rng()));
+      else if (y < 80)
+        pixel = pixels[(y - 36) * width + x];
+      else
+        pixel = Display::PackRGBX(0x20, 0x40, Truncate8(x / 100));
+    }
+  }
+
+  std::unique_ptr<DisplayRendererHeadless> renderer = CreateRenderer();
+  ASSERT_TRUE(renderer);
+  std::unique_ptr<Display> display = renderer->CreateDisplay("png_test", Display::Type::Primary);
+  display->ResizeFramebuffer(width, height);
+  renderer->SetCapture(DisplayRendererHeadless::CaptureFormat::PNG, ".", 1);
+  display->CopyFrame(pixels.data(), width * sizeof(u32));
+  display->SwapFramebuffer();
+  renderer->FlushCapture();
+
+  std::vector<byte> png;
+  ASSERT_TRUE(ReadTestFile("./png_test_000001.png", &png));
+  FileSystem::DeleteFile("./png_test_000001.png");
+
+  u32 decoded_width, decoded_height;
+  std::vector<byte> rgb;
+  ASSERT_TRUE(DecodePNG(png, &decoded_width, &decoded_height, &rgb));
+  ASSERT_EQ(decoded_width, width);
+  ASSERT_EQ(decoded_height, height);
+  for (u32 i = 0; i < width * height; i++)
+  {
+    const u32 expected = pixels[i];
+    ASSERT_EQ(rgb[i * 3 + 0], Truncate8(expected)) << i;
+    ASSERT_EQ(rgb[i * 3 + 1], Truncate8(expected >> 8)) << i;
+    ASSERT_EQ(rgb[i * 3 + 2], Truncate8(expected >> 16)) << i;
+  }
+
+  // The repeated and flat regions should compress well.
+  EXPECT_LT(png.size(), rgb.size() / 2);
+}
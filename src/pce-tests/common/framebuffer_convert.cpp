@@ -0,0 +1,208 @@
+#include "YBaseLib/Log.h"
+#include "common/framebuffer_convert.h"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+Log_SetChannel(FramebufferConvertTest);
+
+using Format = FramebufferConvert::Format;
+
+static constexpr Format s_all_formats[] = {Format::RGB8,   Format::RGBX8,  Format::BGR8,  Format::BGRX8,
+                                           Format::RGB565, Format::BGR565, Format::BGR555};
+
+static const char* GetFormatName(Format format)
+{
+  static const char* names[] = {"RGB8", "RGBX8", "BGR8", "BGRX8", "RGB565", "BGR565", "BGR555"};
+  return names[static_cast<u32>(format)];
+}
+
+// What an RGBX8 pixel looks like after a round trip through the given format.
+static u32 QuantizePixel(u32 pix, Format format)
+{
+  const u32 r = pix & 0xFF;
+  const u32 g = (pix >> 8) & 0xFF;
+  const u32 b = (pix >> 16) & 0xFF;
+  switch (format)
+  {
+    case Format::RGB565:
+    case Format::BGR565:
+    case Format::BGR555:
+    {
+      const u32 g_bits = (format == Format::BGR555) ? 5 : 6;
+      const u32 r5 = r >> 3;
+      const u32 b5 = b >> 3;
+      const u32 gq = g >> (8 - g_bits);
+      const u32 r8 = (r5 << 3) | (r5 >> 2);
+      const u32 b8 = (b5 << 3) | (b5 >> 2);
+      const u32 g8 = (g_bits == 6) ? ((gq << 2) | (gq >> 4)) : ((gq << 3) | (gq >> 2));
+      return r8 | (g8 << 8) | (b8 << 16) | 0xFF000000u;
+    }
+
+    case Format::RGB8:
+    case Format::BGR8:
+      return r | (g << 8) | (b << 16) | 0xFF000000u;
+
+    default:
+      return pix;
+  }
+}
+
+static std::vector<u32> GenerateRandomPixels(u32 count, u32 seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<u32> pixels(count);
+  for (u32& pix : pixels)
+    pix = static_cast<u32>(rng());
+  return pixels;
+}
+
+TEST(FramebufferConvert, RoundTripThroughRGBX8)
+{
+  // Odd widths make sure the scalar tails after each vector loop are exercised.
+  for (Format format : s_all_formats)
+  {
+    const u32 bpp = FramebufferConvert::GetBytesPerPixel(format);
+    for (u32 width = 1; width <= 67; width++)
+    {
+      const std::vector<u32> src = GenerateRandomPixels(width, width);
+      std::vector<byte> encoded(width * bpp + 16);
+      std::vector<u32> decoded(width);
+      FramebufferConvert::ConvertRow(encoded.data(), format, src.data(), Format::RGBX8, width);
+      FramebufferConvert::ConvertRow(decoded.data(), Format::RGBX8, encoded.data(), format, width);
+      for (u32 i = 0; i < width; i++)
+      {
+        ASSERT_EQ(decoded[i], QuantizePixel(src[i], format))
+          << GetFormatName(format) << " width " << width << " pixel " << i;
+      }
+    }
+  }
+}
+
+TEST(FramebufferConvert, KnownPixels)
+{
+  // Pure red in each format should decode to 0xFF0000FF.
+  const u8 rgb8[3] = {0xFF, 0x00, 0x00};
+  const u8 bgr8[3] = {0x00, 0x00, 0xFF};
+  const u8 bgrx8[4] = {0x00, 0x00, 0xFF, 0x00};
+  const u16 rgb565 = 0x001F;
+  const u16 bgr565 = 0xF800;
+  const u16 bgr555 = 0x7C00;
+
+  u32 out = 0;
+  FramebufferConvert::ConvertRow(&out, Format::RGBX8, rgb8, Format::RGB8, 1);
+  EXPECT_EQ(out, 0xFF0000FFu);
+  FramebufferConvert::ConvertRow(&out, Format::RGBX8, bgr8, Format::BGR8, 1);
+  EXPECT_EQ(out, 0xFF0000FFu);
+  FramebufferConvert::ConvertRow(&out, Format::RGBX8, bgrx8, Format::BGRX8, 1);
+  EXPECT_EQ(out & 0x00FFFFFFu, 0x000000FFu);
+  FramebufferConvert::ConvertRow(&out, Format::RGBX8, &rgb565, Format::RGB565, 1);
+  EXPECT_EQ(out, 0xFF0000FFu);
+  FramebufferConvert::ConvertRow(&out, Format::RGBX8, &bgr565, Format::BGR565, 1);
+  EXPECT_EQ(out, 0xFF0000FFu);
+  FramebufferConvert::ConvertRow(&out, Format::RGBX8, &bgr555, Format::BGR555, 1);
+  EXPECT_EQ(out, 0xFF0000FFu);
+}
+
+TEST(FramebufferConvert, ConvertBetweenNonRGBXFormats)
+{
+  // Wider than one chunk, to cover the two-pass path.
+  const u32 width = 700;
+  std::vector<u16> src(width);
+  for (u32 i = 0; i < width; i++)
+    src[i] = static_cast<u16>(i * 97);
+
+  std::vector<u16> converted(width);
+  std::vector<u16> back(width);
+  FramebufferConvert::ConvertRow(converted.data(), Format::RGB565, src.data(), Format::BGR565, width);
+  FramebufferConvert::ConvertRow(back.data(), Format::BGR565, converted.data(), Format::RGB565, width);
+  EXPECT_EQ(src, back);
+}
+
+TEST(FramebufferConvert, IntegerScale)
+{
+  const u32 src_width = 5, src_height = 3, scale = 3;
+  const std::vector<u32> src = GenerateRandomPixels(src_width * src_height, 1);
+  std::vector<u32> dst(src_width * scale * src_height * scale);
+  FramebufferConvert::ConvertScaled(dst.data(), src_width * scale * sizeof(u32), Format::RGBX8, src_width * scale,
+                                    src_height * scale, src.data(), src_width * sizeof(u32), Format::RGBX8, src_width,
+                                    src_height);
+
+  for (u32 y = 0; y < src_height * scale; y++)
+  {
+    for (u32 x = 0; x < src_width * scale; x++)
+      ASSERT_EQ(dst[y * src_width * scale + x], src[(y / scale) * src_width + (x / scale)]) << x << "," << y;
+  }
+}
+
+TEST(FramebufferConvert, NearestScale)
+{
+  const u32 src_width = 4, src_height = 4, dst_width = 6, dst_height = 5;
+  const std::vector<u32> src = GenerateRandomPixels(src_width * src_height, 2);
+  std::vector<u32> dst(dst_width * dst_height);
+  FramebufferConvert::ConvertScaled(dst.data(), dst_width * sizeof(u32), Format::RGBX8, dst_width, dst_height,
+                                    src.data(), src_width * sizeof(u32), Format::RGBX8, src_width, src_height);
+
+  for (u32 y = 0; y < dst_height; y++)
+  {
+    for (u32 x = 0; x < dst_width; x++)
+    {
+      const u32 sx = (x * src_width) / dst_width;
+      const u32 sy = (y * src_height) / dst_height;
+      ASSERT_EQ(dst[y * dst_width + x], src[sy * src_width + sx]) << x << "," << y;
+    }
+  }
+}
+
+// Throughput of each conversion at 640x480. Not run by default, use --gtest_also_run_disabled_tests.
+TEST(FramebufferConvert, DISABLED_Benchmark)
+{
+  constexpr u32 width = 640;
+  constexpr u32 height = 480;
+  constexpr u32 iterations = 200;
+
+  const std::vector<u32> rgbx = GenerateRandomPixels(width * height, 3);
+  std::vector<byte> encoded(width * height * 4);
+  std::vector<u32> decoded(width * height);
+
+  Log_InfoPrintf("Implementation: %s", FramebufferConvert::GetImplementationName());
+  for (Format format : s_all_formats)
+  {
+    const u32 stride = width * FramebufferConvert::GetBytesPerPixel(format);
+    FramebufferConvert::Convert(encoded.data(), stride, format, rgbx.data(), width * sizeof(u32), Format::RGBX8,
+                                width, height);
+
+    const auto decode_start = std::chrono::high_resolution_clock::now();
+    for (u32 i = 0; i < iterations; i++)
+    {
+      FramebufferConvert::Convert(decoded.data(), width * sizeof(u32), Format::RGBX8, encoded.data(), stride, format,
+                                  width, height);
+    }
+    const auto decode_end = std::chrono::high_resolution_clock::now();
+
+    for (u32 i = 0; i < iterations; i++)
+    {
+      FramebufferConvert::Convert(encoded.data(), stride, format, decoded.data(), width * sizeof(u32), Format::RGBX8,
+                                  width, height);
+    }
+    const auto encode_end = std::chrono::high_resolution_clock::now();
+
+    const double pixels = double(width) * double(height) * double(iterations);
+    const double decode_seconds = std::chrono::duration<double>(decode_end - decode_start).count();
+    const double encode_seconds = std::chrono::duration<double>(encode_end - decode_end).count();
+    Log_InfoPrintf("%-7s to RGBX8: %8.1f Mpixels/s, from RGBX8: %8.1f Mpixels/s", GetFormatName(format),
+                   pixels / decode_seconds / 1000000.0, pixels / encode_seconds / 1000000.0);
+  }
+
+  const auto scale_start = std::chrono::high_resolution_clock::now();
+  std::vector<u32> scaled(width * 2 * height * 2);
+  for (u32 i = 0; i < iterations; i++)
+  {
+    FramebufferConvert::ConvertScaled(scaled.data(), width * 2 * sizeof(u32), Format::RGBX8, width * 2, height * 2,
+                                      rgbx.data(), width * sizeof(u32), Format::RGBX8, width, height);
+  }
+  const auto scale_end = std::chrono::high_resolution_clock::now();
+  Log_InfoPrintf("2x scale: %8.1f Mpixels/s",
+                 double(width) * double(height) * double(iterations) /
+                   std::chrono::duration<double>(scale_end - scale_start).count() / 1000000.0);
+}
@@ -4,6 +4,7 @@
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/BinaryReader.h"
 #include "YBaseLib/BinaryWriter.h"
+#include "YBaseLib/FileSystem.h"
 #include "YBaseLib/Log.h"
 #include "YBaseLib/Memory.h"
 #include "pce/cpu.h"
@@ -15,6 +16,12 @@
 #include <cstring>
 #include <functional>
 #include <limits>
+#if defined(Y_PLATFORM_LINUX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 Log_SetChannel(Bus);
 
 DEFINE_OBJECT_TYPE_INFO(Bus);
@@ -49,23 +56,29 @@ Bus::~Bus()
   }
 
   delete[] m_physical_memory_pages;
-  delete[] m_ram_ptr;
+  FreeRAM();
 }
 
 bool Bus::Initialize(System* system)
 {
   m_system = system;
+
+  // RAM allocated before initialization is not backed yet.
+  if (m_ram_ptr)
+    MapRAM();
+
   return true;
 }
 
 void Bus::Reset()
 {
-  // Reset RAM
-  if (m_ram_ptr)
-    std::memset(m_ram_ptr, 0, m_ram_size);
+  // Reset RAM. When nothing has run since it was mapped, it already holds the initial contents, and clearing it
+  // would only commit every page.
+  if (m_ram_ptr && !m_ram_pristine)
+    ResetRAM();
 }
 
-bool Bus::LoadState(BinaryReader& reader)
+bool Bus::LoadState(BinaryReader& reader, bool include_ram /* = true */)
 {
   if (reader.ReadUInt32() != SERIALIZATION_ID)
     return false;
@@ -86,18 +99,33 @@ bool Bus::LoadState(BinaryReader& reader)
     return false;
   }
 
-  reader.ReadBytes(m_ram_ptr, m_ram_size);
+  // RAM may be stored externally in an image, see System::SaveState().
+  if (reader.ReadBool() != include_ram)
+  {
+    Log_ErrorPrintf(include_ram ? "RAM is not included in state" : "RAM is unexpectedly included in state");
+    return false;
+  }
+
+  if (include_ram)
+  {
+    reader.ReadBytes(m_ram_ptr, m_ram_size);
+    InvalidateRAMSnapshot();
+  }
+
   return true;
 }
 
-bool Bus::SaveState(BinaryWriter& writer)
+bool Bus::SaveState(BinaryWriter& writer, bool include_ram /* = true */)
 {
   writer.WriteUInt32(SERIALIZATION_ID);
 
   writer.WriteUInt32(m_num_physical_memory_pages);
   writer.WriteUInt32(m_physical_memory_address_mask);
   writer.WriteUInt32(m_ram_size);
-  writer.WriteBytes(m_ram_ptr, m_ram_size);
+  writer.WriteBool(include_ram);
+  if (include_ram)
+    writer.WriteBytes(m_ram_ptr, m_ram_size);
+
   return true;
 }
 
@@ -431,6 +459,24 @@ void Bus::ConnectIOPortWriteToPointer(u16 port, const void* owner, u8* var)
   ConnectIOPortWrite(port, owner, std::move(write_handler));
 }
 
+uint32 Bus::GetMMIOBlockSize(MMIO* handler, PhysicalMemoryAddress address, uint32 length) const
+{
+  // Extend the transfer over following pages which are mapped to the same handler, so that devices can process the
+  // whole block in a single call instead of one call per page.
+  uint32 size = 0;
+  uint32 page_number = (address & m_physical_memory_address_mask) / MEMORY_PAGE_SIZE;
+  const uint32 max_size =
+    static_cast<uint32>(std::min<u64>(length, u64(handler->GetEndAddress()) - u64(address) + 1));
+  while (size < max_size && page_number < m_num_physical_memory_pages &&
+         m_physical_memory_pages[page_number].mmio_handler == handler)
+  {
+    size += MEMORY_PAGE_SIZE - ((address + size) & MEMORY_PAGE_OFFSET_MASK);
+    page_number++;
+  }
+
+  return std::min(size, max_size);
+}
+
 void Bus::ReadMemoryBlock(PhysicalMemoryAddress address, uint32 length, void* destination)
 {
   byte* destination_ptr = reinterpret_cast<byte*>(destination);
@@ -443,68 +489,30 @@ void Bus::ReadMemoryBlock(PhysicalMemoryAddress address, uint32 length, void* de
 
     // Fast path?
     const PhysicalMemoryPage& page = m_physical_memory_pages[page_number];
-    const uint32 size_in_page = std::min(length, MEMORY_PAGE_SIZE);
+    uint32 size_in_page = std::min(length, MEMORY_PAGE_SIZE - page_offset);
     if (page.type & PhysicalMemoryPage::kReadableRAM)
     {
       std::memcpy(destination_ptr, page.ram_ptr + page_offset, size_in_page);
-      destination_ptr += size_in_page;
-      address += size_in_page;
-      length -= size_in_page;
-      continue;
     }
-
-    if (page.mmio_handler)
+    else if (page.mmio_handler && address >= page.mmio_handler->GetStartAddress() &&
+             address <= page.mmio_handler->GetEndAddress())
     {
-      // Slow path for MMIO.
-      MMIO* const handler = page.mmio_handler;
-      const uint32 page_base_address = page_number * MEMORY_PAGE_SIZE;
-      const uint32 start_address = handler->GetStartAddress();
-      const uint32 end_address = handler->GetEndAddress();
-      if (address >= start_address && (address + size_in_page) <= end_address)
-      {
-        handler->ReadBlock(address, size_in_page, destination_ptr);
-        destination_ptr += size_in_page;
-        address += size_in_page;
-        length -= size_in_page;
-        continue;
-      }
-
-      // Super slow path - when the MMIO doesn't cover the entire page.
-      const uint32 mmio_size_in_page = end_address - page_base_address;
-      const uint32 mmio_usable_size = mmio_size_in_page - page_offset;
-      const uint32 padding_before = (start_address >= address) ? (start_address - address) : 0;
-      const uint32 padding_after = (mmio_usable_size < size_in_page) ? (size_in_page - mmio_usable_size) : 0;
-      const uint32 copy_size = std::min(mmio_usable_size, size_in_page);
-      if (padding_before > 0)
-      {
-        std::memset(destination_ptr, 0xFF, padding_before);
-        destination_ptr += padding_before;
-        address += padding_before;
-        length -= padding_before;
-      }
-      if (copy_size > 0)
-      {
-        handler->ReadBlock(address, copy_size, destination_ptr);
-        destination_ptr += copy_size;
-        address += copy_size;
-        length -= copy_size;
-      }
-      if (padding_after > 0)
-      {
-        std::memset(destination_ptr, 0xFF, padding_after);
-        destination_ptr += padding_after;
-        address += padding_after;
-        length -= padding_after;
-      }
+      // Slow path for MMIO, possibly spanning multiple pages.
+      size_in_page = GetMMIOBlockSize(page.mmio_handler, address, length);
+      page.mmio_handler->ReadBlock(address, size_in_page, destination_ptr);
     }
     else
     {
-      // Not valid memory.
+      // Not valid memory, or the part of the page not covered by the MMIO.
+      if (page.mmio_handler && address < page.mmio_handler->GetStartAddress())
+        size_in_page = std::min(size_in_page, page.mmio_handler->GetStartAddress() - address);
+
       std::memset(destination_ptr, 0xFF, size_in_page);
-      destination_ptr += size_in_page;
-      address += size_in_page;
-      length -= size_in_page;
     }
+
+    destination_ptr += size_in_page;
+    address += size_in_page;
+    length -= size_in_page;
   }
 }
 
@@ -520,65 +528,35 @@ void Bus::WriteMemoryBlock(PhysicalMemoryAddress address, uint32 length, const v
 
     // Fast path?
     const PhysicalMemoryPage& page = m_physical_memory_pages[page_number];
-    const uint32 size_in_page = std::min(length, MEMORY_PAGE_SIZE);
+    uint32 size_in_page = std::min(length, MEMORY_PAGE_SIZE - page_offset);
     if (page.type & PhysicalMemoryPage::kWritableRAM)
     {
-      std::memcpy(page.ram_ptr + page_offset, source_ptr, size_in_page);
-      source_ptr += size_in_page;
-      address += size_in_page;
-      length -= size_in_page;
-      continue;
-    }
-
-    if (page.mmio_handler)
-    {
-      // Slow path for MMIO.
-      MMIO* const handler = page.mmio_handler;
-      const uint32 page_base_address = page_number * MEMORY_PAGE_SIZE;
-      const uint32 start_address = handler->GetStartAddress();
-      const uint32 end_address = handler->GetEndAddress();
-      if (address >= start_address && (address + size_in_page) <= end_address)
-      {
-        handler->WriteBlock(address, size_in_page, source_ptr);
-        source_ptr += size_in_page;
-        address += size_in_page;
-        length -= size_in_page;
-        continue;
-      }
-
-      // Super slow path - when the MMIO doesn't cover the entire page.
-      const uint32 mmio_size_in_page = end_address - page_base_address;
-      const uint32 mmio_usable_size = mmio_size_in_page - page_offset;
-      const uint32 padding_before = (start_address >= address) ? (start_address - address) : 0;
-      const uint32 padding_after = (mmio_usable_size < size_in_page) ? (size_in_page - mmio_usable_size) : 0;
-      const uint32 copy_size = std::min(mmio_usable_size, size_in_page);
-      if (padding_before > 0)
-      {
-        source_ptr += padding_before;
-        address += padding_before;
-        length -= padding_before;
-      }
-      if (copy_size > 0)
+      if (!(page.type & PhysicalMemoryPage::kCachedCode))
       {
-        handler->WriteBlock(address, copy_size, source_ptr);
-        source_ptr += copy_size;
-        address += copy_size;
-        length -= copy_size;
+        std::memcpy(page.ram_ptr + page_offset, source_ptr, size_in_page);
       }
-      if (padding_after > 0)
+      else if (std::memcmp(page.ram_ptr + page_offset, source_ptr, size_in_page) != 0)
       {
-        source_ptr += padding_after;
-        address += padding_after;
-        length -= padding_after;
+        std::memcpy(page.ram_ptr + page_offset, source_ptr, size_in_page);
+        m_code_invalidate_callback(address & MEMORY_PAGE_MASK);
       }
     }
-    else
+    else if (page.mmio_handler && address >= page.mmio_handler->GetStartAddress() &&
+             address <= page.mmio_handler->GetEndAddress())
     {
-      // Not valid memory.
-      source_ptr += size_in_page;
-      address += size_in_page;
-      length -= size_in_page;
+      // Slow path for MMIO, possibly spanning multiple pages.
+      size_in_page = GetMMIOBlockSize(page.mmio_handler, address, length);
+      page.mmio_handler->WriteBlock(address, size_in_page, source_ptr);
     }
+    else if (page.mmio_handler && address < page.mmio_handler->GetStartAddress())
+    {
+      // Skip up to the start of the MMIO.
+      size_in_page = std::min(size_in_page, page.mmio_handler->GetStartAddress() - address);
+    }
+
+    source_ptr += size_in_page;
+    address += size_in_page;
+    length -= size_in_page;
   }
 }
 
@@ -590,6 +568,44 @@ byte* Bus::GetRAMPointer(PhysicalMemoryAddress address)
                                                           nullptr;
 }
 
+byte* Bus::GetDMARAMPointer(PhysicalMemoryAddress address, uint32 length, bool write, uint32* span_length)
+{
+  const uint8 required_type = write ? PhysicalMemoryPage::kWritableRAM : PhysicalMemoryPage::kReadableRAM;
+  uint32 page_number = (address & m_physical_memory_address_mask) / MEMORY_PAGE_SIZE;
+  const uint32 page_offset = address & MEMORY_PAGE_OFFSET_MASK;
+  DebugAssert(page_number < m_num_physical_memory_pages);
+
+  const PhysicalMemoryPage& first_page = m_physical_memory_pages[page_number];
+  uint32 size = std::min(length, MEMORY_PAGE_SIZE - page_offset);
+  if (!(first_page.type & required_type))
+  {
+    *span_length = size;
+    return nullptr;
+  }
+
+  // Extend the span while the following pages are RAM which directly follows in host memory.
+  PhysicalMemoryAddress page_address = address & MEMORY_PAGE_MASK;
+  const byte* next_ram_ptr = first_page.ram_ptr + MEMORY_PAGE_SIZE;
+  if (write && (first_page.type & PhysicalMemoryPage::kCachedCode))
+    m_code_invalidate_callback(page_address);
+  while (size < length && ++page_number < m_num_physical_memory_pages)
+  {
+    const PhysicalMemoryPage& page = m_physical_memory_pages[page_number];
+    if (!(page.type & required_type) || page.ram_ptr != next_ram_ptr)
+      break;
+
+    page_address += MEMORY_PAGE_SIZE;
+    if (write && (page.type & PhysicalMemoryPage::kCachedCode))
+      m_code_invalidate_callback(page_address);
+
+    size += std::min(length - size, MEMORY_PAGE_SIZE);
+    next_ram_ptr += MEMORY_PAGE_SIZE;
+  }
+
+  *span_length = size;
+  return first_page.ram_ptr + page_offset;
+}
+
 void Bus::AllocateMemoryPages(uint32 memory_address_bits)
 {
   uint32 num_pages = uint32((uint64(1) << memory_address_bits) / uint64(MEMORY_PAGE_SIZE));
@@ -615,14 +631,321 @@ PhysicalMemoryAddress Bus::GetTotalRAMInPageRange(uint32 start_page, uint32 end_
   return size;
 }
 
+void Bus::SetRAMBackingOptions(bool huge_pages, const char* image_filename)
+{
+  DebugAssert(!m_system);
+  m_ram_huge_pages = huge_pages;
+  m_ram_image_filename = image_filename ? image_filename : "";
+}
+
 void Bus::AllocateRAM(uint32 size)
 {
   DebugAssert(size > 0 && !m_ram_ptr);
   Assert((size % MEMORY_PAGE_SIZE) == 0);
-  m_ram_ptr = new byte[size];
   m_ram_size = size;
   m_ram_assigned = 0;
+
+#if defined(Y_PLATFORM_LINUX)
+  // Reserve address space aligned to the huge page size, so the pointers can be handed out to RAM regions now.
+  // The memory is attached in MapRAM() once the backing options are known, which happens when the bus is initialized.
+  m_ram_mapping_size = (size + (HUGE_PAGE_SIZE - 1)) & ~(HUGE_PAGE_SIZE - 1);
+  const size_t reserve_size = size_t(m_ram_mapping_size) + HUGE_PAGE_SIZE;
+  void* reserve_ptr = mmap(nullptr, reserve_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (reserve_ptr != MAP_FAILED)
+  {
+    byte* reserve_start = static_cast<byte*>(reserve_ptr);
+    byte* reserve_end = reserve_start + reserve_size;
+    m_ram_ptr = reinterpret_cast<byte*>((reinterpret_cast<uintptr_t>(reserve_start) + (HUGE_PAGE_SIZE - 1)) &
+                                        ~uintptr_t(HUGE_PAGE_SIZE - 1));
+    if (m_ram_ptr != reserve_start)
+      munmap(reserve_start, m_ram_ptr - reserve_start);
+    if ((m_ram_ptr + m_ram_mapping_size) != reserve_end)
+      munmap(m_ram_ptr + m_ram_mapping_size, reserve_end - (m_ram_ptr + m_ram_mapping_size));
+
+    m_ram_mapping = RAMMapping::Reserved;
+    if (m_system)
+      MapRAM();
+
+    return;
+  }
+
+  Log_WarningPrintf("Failed to reserve address space for RAM, falling back to heap allocation");
+#endif
+
+  m_ram_ptr = new byte[size];
+  m_ram_mapping_size = size;
+  m_ram_mapping = RAMMapping::Heap;
   std::memset(m_ram_ptr, 0x00, m_ram_size);
+  if (m_system)
+    MapRAM();
+}
+
+void Bus::MapRAM()
+{
+#if defined(Y_PLATFORM_LINUX)
+  if (m_ram_mapping == RAMMapping::Reserved)
+  {
+    if (!m_ram_image_filename.IsEmpty())
+    {
+      if (MapRAMImage(m_ram_image_filename))
+      {
+        m_ram_pristine = true;
+        return;
+      }
+
+      Panic("Failed to map RAM image");
+    }
+
+    // Back RAM with an anonymous file, so that it can later be shared copy-on-write with forked systems.
+    // The pages are zero-filled on demand, so there's no need to clear it either.
+    if (m_ram_huge_pages)
+    {
+      // Explicit huge pages are reserved at mmap() time, so this fails cleanly if the pool is too small.
+      const int fd = memfd_create("pce-ram", MFD_CLOEXEC | MFD_HUGETLB);
+      if (fd >= 0 && AttachRAMFile(fd, m_ram_mapping_size, true))
+      {
+        Log_InfoPrintf("Mapped %u bytes of RAM with explicit huge pages", m_ram_size);
+        m_ram_hugetlb = true;
+        m_ram_pristine = true;
+        return;
+      }
+
+      Log_WarningPrintf("Explicit huge pages are not available, requesting transparent huge pages instead");
+      if (fd >= 0)
+        close(fd);
+    }
+
+    const int fd = memfd_create("pce-ram", MFD_CLOEXEC);
+    if (fd < 0 || !AttachRAMFile(fd, m_ram_mapping_size, true))
+      Panic("Failed to map RAM");
+
+    if (m_ram_huge_pages && madvise(m_ram_ptr, m_ram_mapping_size, MADV_HUGEPAGE) != 0)
+      Log_WarningPrintf("Transparent huge pages are not available for RAM");
+
+    m_ram_pristine = true;
+    return;
+  }
+#endif
+
+  // Heap allocation, load the image by copying.
+  if (m_ram_huge_pages)
+    Log_WarningPrintf("Huge pages are not supported on this platform, ignoring");
+  if (!m_ram_image_filename.IsEmpty() && !LoadRAMImage(m_ram_image_filename))
+    Panic("Failed to load RAM image");
+
+  m_ram_pristine = true;
+}
+
+void Bus::ResetRAM()
+{
+  InvalidateRAMSnapshot();
+
+#if defined(Y_PLATFORM_LINUX)
+  if (m_ram_mapping != RAMMapping::Heap)
+  {
+    // Map fresh backing over the old pages instead of writing to them. The image is mapped again, or new
+    // zero-filled-on-demand memory is attached, which also releases the pages the guest dirtied.
+    m_ram_mapping = RAMMapping::Reserved;
+    m_ram_hugetlb = false;
+    MapRAM();
+    return;
+  }
+#endif
+
+  if (m_ram_image_filename.IsEmpty())
+    std::memset(m_ram_ptr, 0, m_ram_size);
+  MapRAM();
+}
+
+bool Bus::AttachRAMFile(int fd, uint32 file_size, bool shared)
+{
+#if defined(Y_PLATFORM_LINUX)
+  if (shared && ftruncate(fd, static_cast<off_t>(file_size)) != 0)
+    return false;
+
+  const int flags = (shared ? MAP_SHARED : MAP_PRIVATE) | MAP_FIXED;
+  if (mmap(m_ram_ptr, file_size, PROT_READ | PROT_WRITE, flags, fd, 0) == MAP_FAILED)
+    return false;
+
+  if (m_ram_fd >= 0)
+    close(m_ram_fd);
+
+  m_ram_fd = fd;
+  m_ram_fd_size = file_size;
+  m_ram_mapping = shared ? RAMMapping::Shared : RAMMapping::Private;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool Bus::MapRAMImage(const char* filename)
+{
+#if defined(Y_PLATFORM_LINUX)
+  const int fd = open(filename, O_RDONLY | O_CLOEXEC);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0 || static_cast<u64>(st.st_size) != m_ram_size)
+  {
+    Log_ErrorPrintf("RAM image '%s' is missing or is not %u bytes", filename, m_ram_size);
+    if (fd >= 0)
+      close(fd);
+    return false;
+  }
+
+  // Private mappings of a read-only file are still writable, the writes never reach the file. The image is
+  // therefore also a valid snapshot for forking.
+  if (!AttachRAMFile(fd, m_ram_size, false))
+  {
+    Log_ErrorPrintf("Failed to map RAM image '%s'", filename);
+    close(fd);
+    return false;
+  }
+
+  m_ram_hugetlb = false;
+  m_ram_snapshot_valid = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool Bus::LoadRAMImage(const char* filename)
+{
+#if defined(Y_PLATFORM_LINUX)
+  if (m_ram_mapping != RAMMapping::Heap)
+    return MapRAMImage(filename);
+#endif
+
+  ByteStream* stream = FileSystem::OpenFile(filename, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_STREAMED);
+  if (!stream || stream->GetSize() != m_ram_size || !stream->Read2(m_ram_ptr, m_ram_size))
+  {
+    Log_ErrorPrintf("Failed to read RAM image '%s'", filename);
+    if (stream)
+      stream->Release();
+    return false;
+  }
+
+  stream->Release();
+  InvalidateRAMSnapshot();
+  return true;
+}
+
+bool Bus::SaveRAMImage(const char* filename)
+{
+  ByteStream* stream = FileSystem::OpenFile(filename, BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE |
+                                                        BYTESTREAM_OPEN_TRUNCATE | BYTESTREAM_OPEN_ATOMIC_UPDATE |
+                                                        BYTESTREAM_OPEN_STREAMED);
+  if (!stream || !stream->Write2(m_ram_ptr, m_ram_size) || !stream->Commit())
+  {
+    Log_ErrorPrintf("Failed to write RAM image '%s'", filename);
+    if (stream)
+    {
+      stream->Discard();
+      stream->Release();
+    }
+    return false;
+  }
+
+  stream->Release();
+  return true;
+}
+
+void Bus::FreeRAM()
+{
+  if (!m_ram_ptr)
+    return;
+
+#if defined(Y_PLATFORM_LINUX)
+  if (m_ram_mapping != RAMMapping::Heap)
+  {
+    munmap(m_ram_ptr, m_ram_mapping_size);
+    if (m_ram_fd >= 0)
+      close(m_ram_fd);
+    m_ram_fd = -1;
+    m_ram_ptr = nullptr;
+    return;
+  }
+#endif
+
+  delete[] m_ram_ptr;
+  m_ram_ptr = nullptr;
+}
+
+bool Bus::CreateRAMSnapshot()
+{
+#if defined(Y_PLATFORM_LINUX)
+  if (m_ram_mapping == RAMMapping::Heap || m_ram_mapping == RAMMapping::Reserved)
+    return false;
+  if (m_ram_mapping == RAMMapping::Private && m_ram_snapshot_valid)
+    return true;
+
+  if (m_ram_mapping == RAMMapping::Private)
+  {
+    // Our private pages have diverged from the file (or we never had one), so copy the current contents out.
+    // This goes through a temporary mapping rather than write(), which hugetlbfs does not support.
+    const int new_fd = memfd_create("pce-ram", MFD_CLOEXEC | (m_ram_hugetlb ? MFD_HUGETLB : 0));
+    void* temp_ptr = MAP_FAILED;
+    if (new_fd >= 0 && ftruncate(new_fd, static_cast<off_t>(m_ram_mapping_size)) == 0)
+      temp_ptr = mmap(nullptr, m_ram_mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, new_fd, 0);
+    if (temp_ptr == MAP_FAILED)
+    {
+      Log_ErrorPrintf("Failed to create RAM snapshot");
+      if (new_fd >= 0)
+        close(new_fd);
+      return false;
+    }
+
+    std::memcpy(temp_ptr, m_ram_ptr, m_ram_size);
+    munmap(temp_ptr, m_ram_mapping_size);
+
+    if (m_ram_fd >= 0)
+      close(m_ram_fd);
+    m_ram_fd = new_fd;
+    m_ram_fd_size = m_ram_mapping_size;
+  }
+
+  // Replace our mapping with a private one of the same file. The contents do not change, but from now on our
+  // writes no longer reach the file, so it stays as an immutable snapshot which children can map.
+  if (mmap(m_ram_ptr, m_ram_fd_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, m_ram_fd, 0) == MAP_FAILED)
+    Panic("Failed to remap RAM as private");
+
+  m_ram_mapping = RAMMapping::Private;
+  m_ram_snapshot_valid = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void Bus::ForkRAM(Bus* parent)
+{
+  Assert(m_ram_ptr && m_ram_size == parent->m_ram_size);
+
+#if defined(Y_PLATFORM_LINUX)
+  if (m_ram_mapping != RAMMapping::Heap && parent->CreateRAMSnapshot())
+  {
+    if (mmap(m_ram_ptr, parent->m_ram_fd_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, parent->m_ram_fd,
+             0) == MAP_FAILED)
+    {
+      Panic("Failed to map parent RAM snapshot");
+    }
+
+    // Our own file is no longer referenced. If we are forked in turn, a new snapshot will be written.
+    if (m_ram_fd >= 0)
+      close(m_ram_fd);
+    m_ram_fd = -1;
+    m_ram_fd_size = 0;
+    m_ram_hugetlb = parent->m_ram_hugetlb;
+    m_ram_mapping = RAMMapping::Private;
+    m_ram_snapshot_valid = false;
+    m_ram_pristine = false;
+    return;
+  }
+#endif
+
+  Log_WarningPrintf("Copy-on-write RAM is not available, copying %u bytes from parent", m_ram_size);
+  std::memcpy(m_ram_ptr, parent->m_ram_ptr, m_ram_size);
+  InvalidateRAMSnapshot();
 }
 
 uint32 Bus::CreateRAMRegion(PhysicalMemoryAddress start, PhysicalMemoryAddress end)
@@ -805,6 +1128,13 @@ bool Bus::IsWritablePage(const PhysicalMemoryPage& page)
   return false;
 }
 
+bool Bus::IsMMIOPage(PhysicalMemoryAddress address) const
+{
+  uint32 page_number = (address & m_physical_memory_address_mask) / MEMORY_PAGE_SIZE;
+  DebugAssert(page_number < m_num_physical_memory_pages);
+  return m_physical_memory_pages[page_number].IsMMIO();
+}
+
 bool Bus::IsWritablePage(PhysicalMemoryAddress address) const
 {
   uint32 page_number = address / MEMORY_PAGE_SIZE;
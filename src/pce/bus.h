@@ -9,6 +9,7 @@
 #include "YBaseLib/Common.h"
 #include "YBaseLib/Event.h"
 #include "YBaseLib/PODArray.h"
+#include "YBaseLib/String.h"
 #include "YBaseLib/TaskQueue.h"
 #include "YBaseLib/Timer.h"
 
@@ -34,6 +35,7 @@ public:
   static constexpr u32 SERIALIZATION_ID = Component::MakeSerializationID('B', 'U', 'S');
   static constexpr u32 MEMORY_PAGE_SIZE = 0x1000; // 4KiB
   static constexpr u32 MEMORY_PAGE_OFFSET_MASK = PhysicalMemoryAddress(MEMORY_PAGE_SIZE - 1);
+  static constexpr u32 HUGE_PAGE_SIZE = 0x200000; // 2MiB, RAM mappings are aligned to this
   static constexpr u32 MEMORY_PAGE_MASK = ~MEMORY_PAGE_OFFSET_MASK;
   static constexpr u32 NUM_IOPORTS = 0x10000;
 
@@ -43,8 +45,9 @@ public:
   virtual bool Initialize(System* system);
   virtual void Reset();
 
-  virtual bool LoadState(BinaryReader& reader);
-  virtual bool SaveState(BinaryWriter& writer);
+  // When include_ram is false, the RAM contents are left out, e.g. when they are shared with ForkRAM().
+  virtual bool LoadState(BinaryReader& reader, bool include_ram = true);
+  virtual bool SaveState(BinaryWriter& writer, bool include_ram = true);
 
   PhysicalMemoryAddress GetMemoryAddressMask() const { return m_physical_memory_address_mask; }
   void SetMemoryAddressMask(PhysicalMemoryAddress mask) { m_physical_memory_address_mask = mask; }
@@ -56,6 +59,30 @@ public:
 
   void AllocateRAM(uint32 size);
 
+  // Shares the parent's RAM with this bus copy-on-write, for forked systems. Both buses must have the same
+  // amount of RAM allocated. Pages are only duplicated when either side writes to them. Where the platform
+  // does not support this, the parent's RAM is copied instead.
+  void ForkRAM(Bus* parent);
+
+  // Marks the RAM snapshot used for forking as out of date. Called whenever RAM may have been modified.
+  void InvalidateRAMSnapshot()
+  {
+    m_ram_snapshot_valid = false;
+    m_ram_pristine = false;
+  }
+
+  // Selects how RAM is backed. Must be called before the bus is initialized. With huge_pages, RAM is mapped with
+  // explicit huge pages where available, otherwise transparent huge pages are requested. With image_filename, the
+  // initial RAM contents are mapped copy-on-write from a file previously written with SaveRAMImage().
+  void SetRAMBackingOptions(bool huge_pages, const char* image_filename);
+
+  // Writes the RAM contents to a raw image file.
+  bool SaveRAMImage(const char* filename);
+
+  // Replaces the RAM contents with an image written by SaveRAMImage(). Where supported, the file is mapped
+  // copy-on-write rather than read, so only pages which are touched are loaded from disk.
+  bool LoadRAMImage(const char* filename);
+
   // Returns the amount of RAM allocated to this region.
   // Start and end have to be page-aligned.
   uint32 CreateRAMRegion(PhysicalMemoryAddress start, PhysicalMemoryAddress end);
@@ -142,13 +169,18 @@ public:
   bool CheckedReadMemoryQWord(PhysicalMemoryAddress address, uint64* value);
   bool CheckedWriteMemoryQWord(PhysicalMemoryAddress address, uint64 value);
 
-  // Read/write block of memory.
+  // Read/write block of memory. Ranges covered by MMIO are passed to the handler's block functions in one call.
   void ReadMemoryBlock(PhysicalMemoryAddress address, uint32 length, void* destination);
   void WriteMemoryBlock(PhysicalMemoryAddress address, uint32 length, const void* source);
 
   // Get pointer to memory. Must lie within the same 64KiB page and be RAM not MMIO.
   byte* GetRAMPointer(PhysicalMemoryAddress address);
 
+  // Get pointer to RAM for a bus master transfer. span_length is set to the number of bytes from address, up to length,
+  // which are contiguous in host memory. Returns nullptr if the first page is not RAM, span_length then covers the rest
+  // of that page. When writing, code in each page of the span is invalidated up front.
+  byte* GetDMARAMPointer(PhysicalMemoryAddress address, uint32 length, bool write, uint32* span_length);
+
   // MMIO handlers
   void ConnectMMIO(MMIO* mmio);
   void DisconnectMMIO(MMIO* mmio);
@@ -158,6 +190,9 @@ public:
   bool IsCachablePage(PhysicalMemoryAddress address) const;
   bool IsWritablePage(PhysicalMemoryAddress address) const;
 
+  // Checks if a page is (at least partially) handled by MMIO.
+  bool IsMMIOPage(PhysicalMemoryAddress address) const;
+
   // Hashes a block of code for use in backend code caches.
   CodeHashType GetCodeHash(PhysicalMemoryAddress address, uint32 length);
   void MarkPageAsCode(PhysicalMemoryAddress address);
@@ -211,13 +246,40 @@ protected:
     IOPortWriteDWordHandler write_dword_handler;
   };
 
+  enum class RAMMapping : uint8
+  {
+    Heap,     // allocated with new[], cannot be shared
+    Reserved, // address space only, backed in MapRAM()
+    Shared,   // mapped shared from m_ram_fd, writes go to the file
+    Private,  // mapped private from m_ram_fd (or a parent's file), writes are copy-on-write
+  };
+
   void AllocateMemoryPages(uint32 memory_address_bits);
+  void FreeRAM();
+
+  // Attaches backing memory to RAM reserved by AllocateRAM(), once the bus is initialized.
+  void MapRAM();
+
+  // Returns RAM to its initial contents, either zero or the RAM image.
+  void ResetRAM();
+
+  // Maps fd over RAM, replacing m_ram_fd. Shared files are resized to file_size first.
+  bool AttachRAMFile(int fd, uint32 file_size, bool shared);
+
+  // Maps a RAM image file copy-on-write over RAM.
+  bool MapRAMImage(const char* filename);
+
+  // Freezes the current RAM contents into m_ram_fd, so it can be mapped by forked systems.
+  bool CreateRAMSnapshot();
 
   template<typename T>
   void EnumeratePagesForRange(PhysicalMemoryAddress start_address, PhysicalMemoryAddress end_address, T callback);
   static bool IsCachablePage(const PhysicalMemoryPage& page);
   static bool IsWritablePage(const PhysicalMemoryPage& page);
 
+  // Returns the number of bytes from address which can be passed to handler in one block transfer.
+  uint32 GetMMIOBlockSize(MMIO* handler, PhysicalMemoryAddress address, uint32 length) const;
+
   // Generic memory read/write handler
   template<typename T, bool aligned>
   bool ReadMemoryT(PhysicalMemoryAddress address, T* value);
@@ -254,6 +316,19 @@ protected:
   uint32 m_ram_size = 0;
   uint32 m_ram_assigned = 0;
 
+  // Backing file for RAM, used for copy-on-write sharing with forked systems.
+  int m_ram_fd = -1;
+  RAMMapping m_ram_mapping = RAMMapping::Heap;
+  bool m_ram_snapshot_valid = false;
+  bool m_ram_hugetlb = false;
+  bool m_ram_pristine = false; // contents are as just mapped, nothing has run since
+  uint32 m_ram_fd_size = 0;
+  uint32 m_ram_mapping_size = 0;
+
+  // Backing options, see SetRAMBackingOptions().
+  bool m_ram_huge_pages = false;
+  String m_ram_image_filename;
+
   // List of ROM regions allocated.
   // This does not include mirrors.
   struct ROMRegion
@@ -191,6 +191,9 @@ private:
   // String operations
   template<Operation operation, bool check_equal, typename callback>
   static inline void Execute_REP(CPU* cpu, callback cb);
+  // Moves all but the last remaining element of a REP MOVS between RAM and MMIO in one block transfer.
+  // Returns the number of elements moved, which can be zero if the fast path does not apply.
+  static inline uint32 FastREPMOVS(CPU* cpu, uint32 element_size);
   template<OperandSize dst_size, OperandMode dst_mode, uint32 dst_constant, OperandSize src_size, OperandMode src_mode,
            uint32 src_constant>
   static inline void Execute_Operation_MOVS(CPU* cpu);
@@ -5488,20 +5488,95 @@ void Interpreter::Execute_Operation_CMPS(CPU* cpu)
   });
 }
 
+inline uint32 Interpreter::FastREPMOVS(CPU* cpu, uint32 element_size)
+{
+  // Only forward copies between RAM and MMIO are handled here, e.g. blits to VRAM. MMIO to MMIO copies rely on
+  // each read being followed by a write (VGA latches), and RAM to RAM copies are already fast.
+  const bool address_size_16 = (cpu->idata.address_size == AddressSize_16);
+  const uint32 count = address_size_16 ? ZeroExtend32(cpu->m_registers.CX) : cpu->m_registers.ECX;
+  if (cpu->m_registers.EFLAGS.DF || cpu->m_alignment_check_enabled || count < 2)
+    return 0;
+
+  // Leave the last element to the caller, which also updates the count register.
+  const Segment src_segment = cpu->idata.segment;
+  const VirtualMemoryAddress src_offset = address_size_16 ? ZeroExtend32(cpu->m_registers.SI) : cpu->m_registers.ESI;
+  const VirtualMemoryAddress dst_offset = address_size_16 ? ZeroExtend32(cpu->m_registers.DI) : cpu->m_registers.EDI;
+  const LinearMemoryAddress src_linear = cpu->CalculateLinearAddress(src_segment, src_offset);
+  const LinearMemoryAddress dst_linear = cpu->CalculateLinearAddress(Segment_ES, dst_offset);
+
+  // Stay within one page on both sides, so a single translation covers the transfer. The offsets must not wrap.
+  uint32 length = std::min(count - 1, CPU::PAGE_SIZE) * element_size;
+  length = std::min(length, CPU::PAGE_SIZE - (src_linear & CPU::PAGE_OFFSET_MASK));
+  length = std::min(length, CPU::PAGE_SIZE - (dst_linear & CPU::PAGE_OFFSET_MASK));
+  if (address_size_16)
+  {
+    length = std::min(length, 0x10000 - src_offset);
+    length = std::min(length, 0x10000 - dst_offset);
+  }
+
+  const uint32 elements = length / element_size;
+  length = elements * element_size;
+  if (elements == 0 ||
+      !cpu->CheckSegmentAccess<sizeof(uint8), AccessType::Read>(src_segment, src_offset, false) ||
+      !cpu->CheckSegmentAccess<sizeof(uint8), AccessType::Read>(src_segment, src_offset + length - 1, false) ||
+      !cpu->CheckSegmentAccess<sizeof(uint8), AccessType::Write>(Segment_ES, dst_offset, false) ||
+      !cpu->CheckSegmentAccess<sizeof(uint8), AccessType::Write>(Segment_ES, dst_offset + length - 1, false))
+  {
+    return 0;
+  }
+
+  // Faults are left to the slow path.
+  PhysicalMemoryAddress src_physical, dst_physical;
+  if (!cpu->TranslateLinearAddress(&src_physical, src_linear,
+                                   AddAccessTypeToFlags(AccessType::Read, AccessFlags::NoPageFaults)) ||
+      !cpu->TranslateLinearAddress(&dst_physical, dst_linear,
+                                   AddAccessTypeToFlags(AccessType::Write, AccessFlags::NoPageFaults)) ||
+      cpu->m_bus->IsMMIOPage(src_physical) == cpu->m_bus->IsMMIOPage(dst_physical))
+  {
+    return 0;
+  }
+
+  byte buffer[CPU::PAGE_SIZE];
+  cpu->m_bus->ReadMemoryBlock(src_physical, length, buffer);
+  cpu->m_bus->WriteMemoryBlock(dst_physical, length, buffer);
+
+  if (address_size_16)
+  {
+    cpu->m_registers.SI += Truncate16(length);
+    cpu->m_registers.DI += Truncate16(length);
+    cpu->m_registers.CX -= Truncate16(elements);
+  }
+  else
+  {
+    cpu->m_registers.ESI += length;
+    cpu->m_registers.EDI += length;
+    cpu->m_registers.ECX -= elements;
+  }
+
+  // Same cycles as the iterations of Execute_REP we skipped.
+  cpu->m_pending_cycles += ZeroExtend64(cpu->m_cycle_group_timings[CYCLES_REP_MOVS_N] + 1) * elements;
+  return elements;
+}
+
 template<OperandSize dst_size, OperandMode dst_mode, uint32 dst_constant, OperandSize src_size, OperandMode src_mode,
          uint32 src_constant>
 void Interpreter::Execute_Operation_MOVS(CPU* cpu)
 {
   static_assert(src_size == dst_size, "operand sizes are the same");
   Execute_REP<Operation_MOVS, false>(cpu, [](CPU* cpu) {
+    const OperandSize actual_size = (dst_size == OperandSize_Count) ? cpu->idata.operand_size : dst_size;
+    uint8 data_size;
+
+    // Copy as many of the remaining elements as possible in one block, before moving this one.
+    if (cpu->idata.has_rep)
+      FastREPMOVS(cpu, (actual_size == OperandSize_8) ? 1 : ((actual_size == OperandSize_16) ? 2 : 4));
+
     // The DS segment may be over-ridden with a segment override prefix, but the ES segment cannot be overridden.
     const Segment src_segment = cpu->idata.segment;
     const VirtualMemoryAddress src_address =
       (cpu->idata.address_size == AddressSize_16) ? ZeroExtend32(cpu->m_registers.SI) : cpu->m_registers.ESI;
     const VirtualMemoryAddress dst_address =
       (cpu->idata.address_size == AddressSize_16) ? ZeroExtend32(cpu->m_registers.DI) : cpu->m_registers.EDI;
-    const OperandSize actual_size = (dst_size == OperandSize_Count) ? cpu->idata.operand_size : dst_size;
-    uint8 data_size;
 
     if (actual_size == OperandSize_8)
     {
@@ -22,9 +22,17 @@ public:
   using DMAReadCallback = std::function<void(IOPortDataSize size, uint32* value, uint32 remaining_bytes)>;
   using DMAWriteCallback = std::function<void(IOPortDataSize size, uint32 value, uint32 remaining_bytes)>;
 
-  // Connect DMA channel to a device
+  // Block callbacks move a run of units at once, which ends at the page boundary or terminal count. terminal_count is
+  // set if the last unit of the block is the final one of the transfer. The device returns the number of bytes it
+  // produced or consumed, which can be fewer than size, e.g. when it drops the request.
+  using DMABlockReadCallback = std::function<uint32(void* data, uint32 size, bool terminal_count)>;
+  using DMABlockWriteCallback = std::function<uint32(const void* data, uint32 size, bool terminal_count)>;
+
+  // Connect DMA channel to a device. The block callbacks are optional, and used in place of the per-unit callbacks
+  // when present.
   virtual bool ConnectDMAChannel(uint32 channel_index, DMAReadCallback&& read_callback,
-                                 DMAWriteCallback&& write_callback) = 0;
+                                 DMAWriteCallback&& write_callback, DMABlockReadCallback&& block_read_callback = {},
+                                 DMABlockWriteCallback&& block_write_callback = {}) = 0;
 
   // Sends DREQ signal from device
   virtual bool GetDMAState(uint32 channel_index) = 0;
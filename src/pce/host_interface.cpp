@@ -51,6 +51,29 @@ bool HostInterface::CreateSystem(const char* inifile, Error* error)
   return initialization_result;
 }
 
+bool HostInterface::CreateSystemFromFork(HostInterface* parent, Error* error)
+{
+  Assert(!m_system && parent->m_system);
+
+  // The fork happens on the parent's simulation thread, between slices, so its state is consistent.
+  bool initialization_result = false;
+  QueueExternalEvent(
+    [this, parent, error, &initialization_result]() {
+      parent->QueueExternalEvent([this, parent, error]() { m_system = parent->m_system->Fork(this, error); }, true);
+      if (!m_system)
+        return;
+
+      OnSystemInitialized();
+      Log_InfoPrintf("Forked system initialized successfully.");
+      m_system->SetState(System::State::Paused);
+      m_last_system_state = System::State::Paused;
+      initialization_result = true;
+    },
+    true);
+
+  return initialization_result;
+}
+
 void HostInterface::ResetSystem()
 {
   // Always run after exiting the current simulation slice.
@@ -65,7 +88,7 @@ void HostInterface::ResetSystem()
     false);
 }
 
-bool HostInterface::LoadSystemState(const char* filename, Error* error)
+bool HostInterface::LoadSystemState(const char* filename, Error* error, const char* ram_image_filename /* = nullptr */)
 {
   ByteStream* stream = FileSystem::OpenFile(filename, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_STREAMED);
   if (!stream)
@@ -76,9 +99,9 @@ bool HostInterface::LoadSystemState(const char* filename, Error* error)
 
   bool result = false;
   QueueExternalEvent(
-    [this, stream, error, &result]() {
+    [this, stream, error, ram_image_filename, &result]() {
       BinaryReader reader(stream);
-      if (!m_system->LoadState(reader))
+      if (ram_image_filename ? !m_system->LoadState(reader, ram_image_filename) : !m_system->LoadState(reader))
       {
         // Stream load failed, reset system, as it is now in an unknown state.
         error->SetErrorUserFormatted(0, "Loading state failed.");
@@ -97,7 +120,7 @@ bool HostInterface::LoadSystemState(const char* filename, Error* error)
   return result;
 }
 
-void HostInterface::SaveSystemState(const char* filename)
+void HostInterface::SaveSystemState(const char* filename, const char* ram_image_filename /* = nullptr */)
 {
   ByteStream* stream =
     FileSystem::OpenFile(filename, BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_WRITE |
@@ -109,9 +132,10 @@ void HostInterface::SaveSystemState(const char* filename)
   }
 
   QueueExternalEvent(
-    [this, stream]() {
+    [this, stream, ram_image_filename = String(ram_image_filename ? ram_image_filename : "")]() {
       BinaryWriter writer(stream);
-      if (!m_system->SaveState(writer))
+      if (!ram_image_filename.IsEmpty() ? !m_system->SaveState(writer, ram_image_filename) :
+                                          !m_system->SaveState(writer))
       {
         // Stream load failed, reset system, as it is now in an unknown state.
         stream->Discard();
@@ -129,14 +153,29 @@ void HostInterface::SaveSystemState(const char* filename)
 
 void HostInterface::QueueExternalEvent(ExternalEventCallback callback, bool wait)
 {
-  m_external_events_lock.lock();
-  m_external_events.emplace(std::make_pair(std::move(callback), wait));
-  m_simulation_thread_semaphore.Post();
-  m_external_events_lock.unlock();
+  ExternalEvent event;
+  event.type = ExternalEvent::Type::Callback;
+  event.wait = wait;
+  event.callback = std::move(callback);
+  PushExternalEvent(std::move(event));
   if (wait)
     WaitForSimulationThread();
 }
 
+void HostInterface::PushExternalEvent(ExternalEvent&& event)
+{
+  while (!m_external_events.TryPush(std::move(event)))
+  {
+    // Queue is full. The simulation thread can drain it itself, other threads have to wait for it to catch up.
+    if (IsOnSimulationThread())
+      ExecuteExternalEvents();
+    else
+      std::this_thread::yield();
+  }
+
+  m_simulation_thread_semaphore.Post();
+}
+
 CPU::BackendType HostInterface::GetCPUBackend() const
 {
   return m_system ? m_system->GetCPU()->GetBackend() : CPU::BackendType::Interpreter;
@@ -245,7 +284,7 @@ void HostInterface::AddKeyboardCallback(const void* owner, KeyboardCallback call
 
 void HostInterface::InjectKeyEvent(GenScanCode sc, bool down)
 {
-  QueueExternalEvent([this, sc, down]() { ExecuteKeyboardCallbacks(sc, down); }, false);
+  ExecuteKeyboardCallbacks(sc, down);
 }
 
 void HostInterface::AddMousePositionChangeCallback(const void* owner, MousePositionChangeCallback callback)
@@ -384,34 +423,34 @@ void HostInterface::AddUIFileCallback(const Component* component, const String&
 void HostInterface::ExecuteKeyboardCallbacks(GenScanCode scancode, bool key_down)
 {
   Log_DevPrintf("Key scancode %u %s", uint32(scancode), key_down ? "down" : "up");
-  QueueExternalEvent(
-    [this, scancode, key_down]() {
-      for (const auto& it : m_keyboard_callbacks)
-        it.second(scancode, key_down);
-    },
-    false);
+
+  ExternalEvent event;
+  event.type = ExternalEvent::Type::Keyboard;
+  event.keyboard.scancode = scancode;
+  event.keyboard.key_down = key_down;
+  PushExternalEvent(std::move(event));
 }
 
 void HostInterface::ExecuteMousePositionChangeCallbacks(int32 dx, int32 dy)
 {
   Log_DevPrintf("Mouse position change: %d %d", dx, dy);
-  QueueExternalEvent(
-    [this, dx, dy]() {
-      for (const auto& it : m_mouse_position_change_callbacks)
-        it.second(dx, dy);
-    },
-    false);
+
+  ExternalEvent event;
+  event.type = ExternalEvent::Type::MousePositionChange;
+  event.mouse_position_change.dx = dx;
+  event.mouse_position_change.dy = dy;
+  PushExternalEvent(std::move(event));
 }
 
 void HostInterface::ExecuteMouseButtonChangeCallbacks(uint32 button, bool state)
 {
   Log_DevPrintf("Mouse button change: %u %s", button, state ? "down" : "up");
-  QueueExternalEvent(
-    [this, button, state]() {
-      for (const auto& it : m_mouse_button_change_callbacks)
-        it.second(button, state);
-    },
-    false);
+
+  ExternalEvent event;
+  event.type = ExternalEvent::Type::MouseButtonChange;
+  event.mouse_button_change.button = button;
+  event.mouse_button_change.state = state;
+  PushExternalEvent(std::move(event));
 }
 
 HostInterface::ComponentUIElement* HostInterface::CreateComponentUIElement(const Component* component)
@@ -507,22 +546,38 @@ bool HostInterface::ExecuteExternalEvents()
 {
   bool did_any_work = false;
 
-  m_external_events_lock.lock();
-  while (!m_external_events.empty())
+  ExternalEvent event;
+  while (m_external_events.TryPop(&event))
   {
-    auto elem = std::move(m_external_events.front());
-    m_external_events.pop();
-    m_external_events_lock.unlock();
+    switch (event.type)
+    {
+      case ExternalEvent::Type::Callback:
+        event.callback();
+        event.callback = nullptr;
+        break;
+
+      case ExternalEvent::Type::Keyboard:
+        for (const auto& it : m_keyboard_callbacks)
+          it.second(event.keyboard.scancode, event.keyboard.key_down);
+        break;
+
+      case ExternalEvent::Type::MousePositionChange:
+        for (const auto& it : m_mouse_position_change_callbacks)
+          it.second(event.mouse_position_change.dx, event.mouse_position_change.dy);
+        break;
+
+      case ExternalEvent::Type::MouseButtonChange:
+        for (const auto& it : m_mouse_button_change_callbacks)
+          it.second(event.mouse_button_change.button, event.mouse_button_change.state);
+        break;
+    }
 
-    elem.first();
-    if (elem.second)
+    if (event.wait)
       WaitForCallingThread();
 
     did_any_work = true;
-    m_external_events_lock.lock();
   }
 
-  m_external_events_lock.unlock();
   return did_any_work;
 }
 
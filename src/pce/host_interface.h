@@ -6,6 +6,7 @@
 #include "YBaseLib/TaskQueue.h"
 #include "YBaseLib/Timer.h"
 #include "common/display.h"
+#include "common/mpsc_queue.h"
 #include "cpu.h"
 #include "scancodes.h"
 #include "system.h"
@@ -13,8 +14,6 @@
 #include <atomic>
 #include <functional>
 #include <memory>
-#include <mutex>
-#include <queue>
 #include <thread>
 #include <utility>
 #include <vector>
@@ -56,14 +55,19 @@ public:
   // Loads/creates a system.
   bool CreateSystem(const char* inifile, Error* error);
 
+  // Creates a system by forking the system currently running in another host interface, see System::Fork().
+  // Each host interface runs its system on its own simulation thread.
+  bool CreateSystemFromFork(HostInterface* parent, Error* error);
+
   // Resets the system.
   void ResetSystem();
 
   // Load/save state. If load fails, system is in an undefined state, Reset it.
   // This occurs asynchronously, the event maintains a reference to the stream.
   // The stream is committed upon success, or discarded upon fail.
-  bool LoadSystemState(const char* filename, Error* error);
-  void SaveSystemState(const char* filename);
+  // If ram_image_filename is set, RAM is stored in that file instead of the state stream.
+  bool LoadSystemState(const char* filename, Error* error, const char* ram_image_filename = nullptr);
+  void SaveSystemState(const char* filename, const char* ram_image_filename = nullptr);
 
   // External events, will interrupt the CPU and execute.
   // Use care when calling this variant, deadlocks can occur.
@@ -165,10 +169,49 @@ protected:
   ComponentUIElement* GetComponentUIElement(const Component* component);
 
 private:
+  // Input events are typed, so they can be queued without allocating.
+  struct ExternalEvent
+  {
+    enum class Type : u8
+    {
+      Callback,
+      Keyboard,
+      MousePositionChange,
+      MouseButtonChange
+    };
+    struct KeyboardEvent
+    {
+      GenScanCode scancode;
+      bool key_down;
+    };
+    struct MousePositionChangeEvent
+    {
+      int32 dx;
+      int32 dy;
+    };
+    struct MouseButtonChangeEvent
+    {
+      uint32 button;
+      bool state;
+    };
+
+    Type type = Type::Callback;
+    bool wait = false;
+    union
+    {
+      KeyboardEvent keyboard;
+      MousePositionChangeEvent mouse_position_change;
+      MouseButtonChangeEvent mouse_button_change;
+    };
+    ExternalEventCallback callback;
+  };
+  static constexpr u32 EXTERNAL_EVENT_QUEUE_SIZE = 1024;
+
   SimulationTime GetSimulationSliceTime() const;
   SimulationTime GetMaxSimulationSliceTime() const;
   SimulationTime GetMaxSimulationVarianceTime() const;
   void HandleStateChange();
+  void PushExternalEvent(ExternalEvent&& event);
   bool ExecuteExternalEvents();
   void ExecuteSlice();
   void UpdateExecutionSpeed();
@@ -202,7 +245,6 @@ private:
   std::atomic_bool m_simulation_thread_running{true};
   System::State m_last_system_state = System::State::Stopped;
 
-  // External event queue
-  std::queue<std::pair<ExternalEventCallback, bool>> m_external_events;
-  std::mutex m_external_events_lock;
+  // External event queue, written by any thread and read by the simulation thread.
+  MPSCQueue<ExternalEvent, EXTERNAL_EVENT_QUEUE_SIZE> m_external_events;
 };
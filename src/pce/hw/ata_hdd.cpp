@@ -7,6 +7,7 @@
 #include "common/hdd_image.h"
 #include "hdc.h"
 #include <cinttypes>
+#include <cstring>
 Log_SetChannel(HW::ATAHDD);
 
 // http://margo.student.utwente.nl/el/pc/hd-info/ide-tech.htm
@@ -20,6 +21,11 @@ PROPERTY_TABLE_MEMBER_STRING("ImageFile", 0, offsetof(ATAHDD, m_image_filename),
 PROPERTY_TABLE_MEMBER_UINT("Cylinders", 0, offsetof(ATAHDD, m_cylinders), nullptr, 0)
 PROPERTY_TABLE_MEMBER_UINT("Heads", 0, offsetof(ATAHDD, m_heads), nullptr, 0)
 PROPERTY_TABLE_MEMBER_UINT("Sectors", 0, offsetof(ATAHDD, m_sectors_per_track), nullptr, 0)
+PROPERTY_TABLE_MEMBER_UINT("CacheSectors", 0, offsetof(ATAHDD, m_cache_sectors), nullptr, 0)
+PROPERTY_TABLE_MEMBER_BOOL("Overlay", 0, offsetof(ATAHDD, m_overlay), nullptr, 0)
+PROPERTY_TABLE_MEMBER_STRING("OverlayDirectory", 0, offsetof(ATAHDD, m_overlay_directory), nullptr, 0)
+PROPERTY_TABLE_MEMBER_BOOL("DiscardOverlay", 0, offsetof(ATAHDD, m_discard_overlay), nullptr, 0)
+PROPERTY_TABLE_MEMBER_BOOL("AsyncIO", 0, offsetof(ATAHDD, m_async_io), nullptr, 0)
 END_OBJECT_PROPERTY_MAP()
 
 ATAHDD::ATAHDD(const String& identifier, const char* image_filename /* = "" */, u32 cylinders /* = 0 */,
@@ -30,12 +36,35 @@ ATAHDD::ATAHDD(const String& identifier, const char* image_filename /* = "" */,
 {
 }
 
+ATAHDD::~ATAHDD()
+{
+  if (m_async_io)
+    m_io_thread.ExitWorkers();
+}
+
 bool ATAHDD::Initialize(System* system, Bus* bus)
 {
   if (!BaseClass::Initialize(system, bus))
     return false;
 
-  m_image = HDDImage::Open(m_image_filename);
+  // Forked systems share the parent's base image, with the replay log kept in memory.
+  ATAHDD* fork_parent_drive =
+    system->GetForkParent() ? system->GetForkParent()->GetComponentByIdentifier<ATAHDD>(m_identifier) : nullptr;
+  if (fork_parent_drive)
+  {
+    // The parent's worker may still be using the image, and creating the overlay flushes it.
+    fork_parent_drive->WaitForPendingIO();
+    m_image = fork_parent_drive->GetImage()->CreateMemoryOverlay();
+  }
+  else if (m_overlay)
+  {
+    const char* overlay_directory = m_overlay_directory.IsEmpty() ? nullptr : m_overlay_directory.GetCharArray();
+    m_image = HDDImage::OpenOverlay(m_image_filename, overlay_directory, m_discard_overlay);
+  }
+  else
+  {
+    m_image = HDDImage::Open(m_image_filename);
+  }
   if (!m_image)
   {
     Log_ErrorPrintf("Failed to open image for drive %u/%u (%s)", m_ata_channel_number, m_ata_drive_number,
@@ -43,6 +72,13 @@ bool ATAHDD::Initialize(System* system, Bus* bus)
     return false;
   }
 
+  m_image->SetCacheSectorCount(m_cache_sectors);
+  if (m_async_io && !m_io_thread.Initialize(TaskQueue::DefaultQueueSize, 1))
+  {
+    Log_WarningPrintf("Failed to create I/O thread for drive %u/%u, falling back to synchronous I/O",
+                      m_ata_channel_number, m_ata_drive_number);
+    m_async_io = false;
+  }
   m_lbas = m_image->GetImageSize() / SECTOR_SIZE;
   if (m_cylinders == 0 || m_heads == 0 || m_sectors_per_track == 0)
   {
@@ -84,8 +120,12 @@ bool ATAHDD::Initialize(System* system, Bus* bus)
 
   // Create indicator and menu options.
   system->GetHostInterface()->AddUIIndicator(this, HostInterface::IndicatorType::HDD);
-  system->GetHostInterface()->AddUICallback(this, "Commit Log to Image", [this]() { m_image->CommitLog(); });
+  system->GetHostInterface()->AddUICallback(this, "Commit Log to Image", [this]() {
+    WaitForPendingIO();
+    m_image->CommitLog();
+  });
   system->GetHostInterface()->AddUICallback(this, "Revert Log and Reset", [this]() {
+    WaitForPendingIO();
     m_image->RevertLog();
     m_system->Reset();
   });
@@ -133,6 +173,7 @@ bool ATAHDD::LoadState(BinaryReader& reader)
   if (reader.GetErrorState())
     return false;
 
+  WaitForPendingIO();
   return m_image->LoadState(reader.GetStream());
 }
 
@@ -164,6 +205,7 @@ bool ATAHDD::SaveState(BinaryWriter& writer)
   if (writer.InErrorState())
     return false;
 
+  WaitForPendingIO();
   return m_image->SaveState(writer.GetStream());
 }
 
@@ -211,7 +253,15 @@ void ATAHDD::ClearActivity()
 
 void ATAHDD::FlushImage()
 {
-  m_image->Flush();
+  if (!m_async_io)
+  {
+    m_image->Flush();
+    return;
+  }
+
+  // Runs after any outstanding read or write, there's no need to wait for it.
+  m_io_pending = true;
+  m_io_thread.QueueLambdaTask([this]() { m_image->Flush(); });
 }
 
 bool ATAHDD::ComputeCHSGeometry(const u64 size, u32& cylinders, u32& heads, u32& sectors_per_track)
@@ -393,6 +443,25 @@ void ATAHDD::SetupReadWriteEvent(CycleCount seek_time, u32 num_sectors)
 
   DebugAssert(!m_read_write_event->IsActive());
   m_read_write_event->Queue(seek_time + rw_time);
+
+  // Start reading from the image now, the data is collected when the event fires.
+  if (m_async_io && !m_buffer.is_write)
+    QueueRead(num_sectors);
+}
+
+void ATAHDD::QueueRead(u32 sector_count)
+{
+  // The staging buffer may still be in use by the previous request.
+  WaitForPendingIO();
+
+  const u64 offset = m_current_lba * SECTOR_SIZE;
+  const u32 size = sector_count * SECTOR_SIZE;
+  DebugAssert((offset + size) <= m_image->GetImageSize());
+  if (m_io_buffer.size() < size)
+    m_io_buffer.resize(size);
+
+  m_io_pending = true;
+  m_io_thread.QueueLambdaTask([this, offset, size]() { m_image->Read(m_io_buffer.data(), offset, size); });
 }
 
 void ATAHDD::FillReadBuffer()
@@ -400,7 +469,17 @@ void ATAHDD::FillReadBuffer()
   const u32 sector_count = std::min(m_transfer_remaining_sectors, m_transfer_block_size);
   DebugAssert(m_buffer.size >= (sector_count * SECTOR_SIZE));
   DebugAssert((m_current_lba + sector_count) * SECTOR_SIZE <= m_image->GetImageSize());
-  m_image->Read(m_buffer.data.data(), m_current_lba * SECTOR_SIZE, sector_count * SECTOR_SIZE);
+  if (m_async_io)
+  {
+    // The read was queued along with the event, and has usually finished by now. Both buffers are at least the block
+    // size, so they can be exchanged instead of copied.
+    WaitForPendingIO();
+    m_buffer.data.swap(m_io_buffer);
+  }
+  else
+  {
+    m_image->Read(m_buffer.data.data(), m_current_lba * SECTOR_SIZE, sector_count * SECTOR_SIZE);
+  }
   m_current_lba += sector_count;
 }
 
@@ -409,10 +488,37 @@ void ATAHDD::FlushWriteBuffer()
   const u32 sector_count = std::min(m_transfer_remaining_sectors, m_transfer_block_size);
   DebugAssert(m_buffer.size >= (sector_count * SECTOR_SIZE));
   DebugAssert((m_current_lba + sector_count) * SECTOR_SIZE <= m_image->GetImageSize());
-  m_image->Write(m_buffer.data.data(), m_current_lba * SECTOR_SIZE, sector_count * SECTOR_SIZE);
+  if (m_async_io)
+  {
+    // Writes are completed in the background. The data is copied, as the buffer can be reused for the next block
+    // before the write reaches the image.
+    WaitForPendingIO();
+
+    const u64 offset = m_current_lba * SECTOR_SIZE;
+    const u32 size = sector_count * SECTOR_SIZE;
+    if (m_io_buffer.size() < size)
+      m_io_buffer.resize(size);
+    std::memcpy(m_io_buffer.data(), m_buffer.data.data(), size);
+
+    m_io_pending = true;
+    m_io_thread.QueueLambdaTask([this, offset, size]() { m_image->Write(m_io_buffer.data(), offset, size); });
+  }
+  else
+  {
+    m_image->Write(m_buffer.data.data(), m_current_lba * SECTOR_SIZE, sector_count * SECTOR_SIZE);
+  }
   m_current_lba += sector_count;
 }
 
+void ATAHDD::WaitForPendingIO()
+{
+  if (!m_io_pending)
+    return;
+
+  m_io_thread.QueueBlockingLambdaTask([]() {});
+  m_io_pending = false;
+}
+
 void ATAHDD::OnBufferEnd()
 {
   if (m_buffer.is_write)
@@ -788,7 +894,7 @@ void ATAHDD::HandleATATransfer(bool dma, bool write, bool extended, bool multipl
   }
 
   // Setup transfer and fire irq
-  SetupTransfer(count, multiple ? m_multiple_sectors : 1, write, dma);
+  SetupTransfer(count, dma ? MAX_DMA_BLOCK_SECTORS : (multiple ? m_multiple_sectors : 1), write, dma);
   if (!write)
   {
     // Reads are delayed.
@@ -1,6 +1,8 @@
 #pragma once
+#include "YBaseLib/TaskQueue.h"
 #include "ata_device.h"
 #include "common/timing.h"
+#include <vector>
 
 class HDDImage;
 
@@ -17,6 +19,7 @@ class ATAHDD final : public ATADevice
 public:
   ATAHDD(const String& identifier, const char* image_filename = "", u32 cylinders = 0, u32 heads = 0, u32 sectors = 0,
          u32 ide_channel = 0, u32 ide_device = 0, const ObjectTypeInfo* type_info = &s_type_info);
+  ~ATAHDD();
 
   // Pass in 0/0/0 for complete autodetection, otherwise heads/sectors are used to compute cylinders.
   static bool ComputeCHSGeometry(const u64 size, u32& cylinders, u32& heads, u32& sectors_per_track);
@@ -43,6 +46,8 @@ protected:
 private:
   static constexpr u32 SERIALIZATION_ID = MakeSerializationID('A', 'T', 'A', 'H');
   static constexpr u32 SECTOR_SIZE = 512;
+  // DMA commands don't interrupt between blocks, so they are moved in large blocks rather than sector by sector.
+  static constexpr u32 MAX_DMA_BLOCK_SECTORS = 256;
   static constexpr u16 INVALID_COMMAND = 0x100;
 
   void SetSignature();
@@ -62,8 +67,10 @@ private:
 
   void SetupTransfer(u32 num_sectors, u32 block_size, bool is_write, bool dma);
   void SetupReadWriteEvent(CycleCount seek_time, u32 num_sectors);
+  void QueueRead(u32 sector_count);
   void FillReadBuffer();
   void FlushWriteBuffer();
+  void WaitForPendingIO();
   void OnBufferEnd() override;
   void ExecutePendingReadWrite();
   void OnReadWriteEnd();
@@ -89,6 +96,12 @@ private:
   String m_image_filename;
   std::unique_ptr<HDDImage> m_image;
 
+  // Overlay mode leaves the image untouched, keeping changes in a log in the overlay directory, or in memory if no
+  // directory is given. This lets many instances share a single image.
+  String m_overlay_directory;
+  bool m_overlay = false;
+  bool m_discard_overlay = false;
+
   TimingEvent::Pointer m_flush_event;
   TimingEvent::Pointer m_command_event;
   TimingEvent::Pointer m_read_write_event;
@@ -98,6 +111,18 @@ private:
   u32 m_heads;
   u32 m_sectors_per_track;
 
+  // Number of sectors kept in the image's write-back cache.
+  u32 m_cache_sectors = 16;
+
+  // When enabled, image reads and writes run on a worker thread. Reads are started when the read/write event is
+  // queued and collected when it fires, so host latency is hidden behind the emulated seek/transfer time.
+  // The image is only accessed from the worker while it is running, so WaitForPendingIO() must be called before
+  // touching it from the emulation thread.
+  bool m_async_io = true;
+  bool m_io_pending = false;
+  std::vector<byte> m_io_buffer;
+  TaskQueue m_io_thread;
+
   // parameters in current translation mode
   u32 m_current_num_cylinders = 0;
   u32 m_current_num_heads = 0;
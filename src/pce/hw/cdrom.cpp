@@ -6,6 +6,7 @@
 #include "pce/host_interface.h"
 #include "pce/system.h"
 #include <cinttypes>
+#include <cstring>
 #include <functional>
 Log_SetChannel(HW::CDROM);
 
@@ -16,6 +17,7 @@ BEGIN_OBJECT_PROPERTY_MAP(CDROM)
 PROPERTY_TABLE_MEMBER_STRING("VendorID", 0, offsetof(CDROM, m_vendor_id_string), nullptr, 0)
 PROPERTY_TABLE_MEMBER_STRING("ModelID", 0, offsetof(CDROM, m_model_id_string), nullptr, 0)
 PROPERTY_TABLE_MEMBER_STRING("FirmwareVersion", 0, offsetof(CDROM, m_firmware_version_string), nullptr, 0)
+PROPERTY_TABLE_MEMBER_UINT("ReadAheadSectors", 0, offsetof(CDROM, m_read_ahead_sectors), nullptr, 0)
 END_OBJECT_PROPERTY_MAP()
 
 CDROM::CDROM(const String& identifier, const ObjectTypeInfo* type_info /* = &s_type_info */)
@@ -24,7 +26,11 @@ CDROM::CDROM(const String& identifier, const ObjectTypeInfo* type_info /* = &s_t
 {
 }
 
-CDROM::~CDROM() {}
+CDROM::~CDROM()
+{
+  if (m_read_ahead_sectors > 0)
+    m_read_ahead_thread.ExitWorkers();
+}
 
 bool CDROM::Initialize(System* system, Bus* bus)
 {
@@ -34,6 +40,12 @@ bool CDROM::Initialize(System* system, Bus* bus)
   m_clock.SetManager(system->GetTimingManager());
   m_command_event = m_clock.NewEvent("CDROM Command Event", 1, std::bind(&CDROM::ExecuteCommand, this), false);
 
+  if (m_read_ahead_sectors > 0 && !m_read_ahead_thread.Initialize(TaskQueue::DefaultQueueSize, 1))
+  {
+    Log_WarningPrintf("Failed to create read-ahead thread, disabling read-ahead");
+    m_read_ahead_sectors = 0;
+  }
+
   // Create indicator and menu options.
   system->GetHostInterface()->AddUIIndicator(this, HostInterface::IndicatorType::CDROM);
   system->GetHostInterface()->AddUIFileCallback(this, "Insert Media...", [this](const String& filename) {
@@ -56,13 +68,15 @@ void CDROM::Reset()
 
   m_current_lba = 0;
   m_tray_locked = false;
+  InvalidateReadAhead();
 
   m_command_event->SetActive(false);
 }
 
 bool CDROM::LoadState(BinaryReader& reader)
 {
-  SAFE_RELEASE(m_media.stream);
+  InvalidateReadAhead();
+  m_media.image.reset();
 
   uint32 magic;
   if (!reader.SafeReadUInt32(&magic) || magic != SERIALIZATION_ID)
@@ -112,9 +126,8 @@ bool CDROM::LoadState(BinaryReader& reader)
   // Load up the media, and make sure it matches in size.
   if (!m_media.filename.IsEmpty())
   {
-    if (!ByteStream_OpenFileStream(m_media.filename, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_SEEKABLE,
-                                   &m_media.stream) ||
-        m_media.stream->GetSize() != (m_media.total_sectors * SECTOR_SIZE))
+    m_media.image = CDImage::Open(m_media.filename);
+    if (!m_media.image || m_media.image->GetSectorCount() != m_media.total_sectors)
     {
       Log_ErrorPrintf("Failed to re-insert CD media from save state: '%s'. Ejecting.", m_media.filename.GetCharArray());
       EjectMedia();
@@ -159,26 +172,18 @@ bool CDROM::InsertMedia(const char* filename)
   if (HasMedia())
     EjectMedia();
 
-  if (!ByteStream_OpenFileStream(filename, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_SEEKABLE, &m_media.stream))
+  m_media.image = CDImage::Open(filename);
+  if (!m_media.image)
   {
     Log_ErrorPrintf("Failed to open CD media: %s", filename);
     return false;
   }
 
-  uint64 file_size = m_media.stream->GetSize();
-  if (file_size < SECTOR_SIZE)
-  {
-    Log_ErrorPrintf("File '%s' does not contain at least one sector", unsigned(file_size));
-    return false;
-  }
-
-  if ((file_size % SECTOR_SIZE) != 0)
-    Log_WarningPrintf("File '%s' is not aligned to sector size. (%u vs %u bytes)", unsigned(file_size), SECTOR_SIZE);
-
   m_media.filename = filename;
-  m_media.total_sectors = file_size / SECTOR_SIZE;
+  m_media.total_sectors = m_media.image->GetSectorCount();
   m_current_lba = 0;
-  Log_InfoPrintf("Inserted CD media '%s': %u sectors", filename, uint32(m_media.total_sectors));
+  Log_InfoPrintf("Inserted CD media '%s': %u sectors, %u tracks", filename, uint32(m_media.total_sectors),
+                 m_media.image->GetTrackCount());
 
   // Notify the host that the media has changed.
   UpdateSenseInfo(SENSE_UNIT_ATTENTION, ASC_MEDIUM_MAY_HAVE_CHANGED);
@@ -192,7 +197,8 @@ void CDROM::EjectMedia()
   if (IsBusy())
     AbortCommand(SENSE_NOT_READY, ASC_MEDIUM_NOT_PRESENT);
 
-  SAFE_RELEASE(m_media.stream);
+  InvalidateReadAhead();
+  m_media.image.reset();
   m_media.filename.Clear();
   m_media.total_sectors = 0;
   m_current_lba = 0;
@@ -654,7 +660,7 @@ void CDROM::HandleInquiryCommand()
 
 void CDROM::HandleReadCapacityCommand()
 {
-  Log_DevPrintf("CDROM read capacity - %u blocks", m_media.stream ? Truncate32(m_media.total_sectors) : 0);
+  Log_DevPrintf("CDROM read capacity - %u blocks", m_media.image ? Truncate32(m_media.total_sectors) : 0);
 
   if (!HasMedia())
   {
@@ -685,69 +691,71 @@ void CDROM::HandleReadTOCCommand()
     return;
   }
 
-  // from bochs
+  const CDImage& image = *m_media.image;
+  const uint32 track_count = image.GetTrackCount();
+  const uint8 first_track = Truncate8(image.GetTrack(0).number);
+  const uint8 last_track = Truncate8(image.GetTrack(track_count - 1).number);
+  const uint64 lead_out_lba = image.GetSectorCount();
+  auto GetTrackControl = [](const CDImage::Track& track) -> uint8 { return track.IsAudio() ? 0x10 : 0x14; };
+  const uint8 lead_out_control = GetTrackControl(image.GetTrack(track_count - 1)) | 0x02;
+
+  // Addresses are either a reserved byte followed by minute/second/frame, or a big-endian LBA.
+  uint32 len = 4;
+  auto WriteAddress = [this, msf, &len](uint64 lba) {
+    if (msf)
+    {
+      m_data_buffer[len++] = 0;
+      CDImage::LBAToMSF(lba, &m_data_buffer[len], &m_data_buffer[len + 1], &m_data_buffer[len + 2]);
+      len += 3;
+    }
+    else
+    {
+      const uint32 blocks = Truncate32(lba);
+      m_data_buffer[len++] = uint8((blocks >> 24) & 0xff);
+      m_data_buffer[len++] = uint8((blocks >> 16) & 0xff);
+      m_data_buffer[len++] = uint8((blocks >> 8) & 0xff);
+      m_data_buffer[len++] = uint8((blocks >> 0) & 0xff);
+    }
+  };
+
   switch (format)
   {
     case 0:
     {
-      if (start_track > 1 && start_track != 0xAA)
+      if (start_track > last_track && start_track != 0xAA)
       {
         AbortCommand(SENSE_ILLEGAL_REQUEST, ASC_INVALID_FIELD_IN_CMD_PACKET);
         return;
       }
 
-      uint32 len = 4;
-      AllocateData((start_track <= 1) ? 20 : 8, max_length);
-      m_data_buffer[2] = 1;
-      m_data_buffer[3] = 1;
+      // Tracks from start_track onwards, then the lead out track.
+      uint32 descriptor_count = 1;
+      for (uint32 i = 0; i < track_count; i++)
+        descriptor_count += BoolToUInt32(image.GetTrack(i).number >= start_track);
 
-      if (start_track <= 1)
-      {
-        m_data_buffer[len++] = 0;    // Reserved
-        m_data_buffer[len++] = 0x14; // ADR, control
-        m_data_buffer[len++] = 1;    // Track number
-        m_data_buffer[len++] = 0;    // Reserved
+      AllocateData(4 + descriptor_count * 8, max_length);
+      m_data_buffer[2] = first_track;
+      m_data_buffer[3] = last_track;
 
-        // Start address
-        if (msf)
-        {
-          m_data_buffer[len++] = 0; // reserved
-          m_data_buffer[len++] = 0; // minute
-          m_data_buffer[len++] = 2; // second
-          m_data_buffer[len++] = 0; // frame
-        }
-        else
-        {
-          m_data_buffer[len++] = 0;
-          m_data_buffer[len++] = 0;
-          m_data_buffer[len++] = 0;
-          m_data_buffer[len++] = 0; // logical sector 0
-        }
-
-        // Lead out track
-        m_data_buffer[len++] = 0;    // Reserved
-        m_data_buffer[len++] = 0x16; // ADR, control
-        m_data_buffer[len++] = 0xaa; // Track number
-        m_data_buffer[len++] = 0;    // Reserved
+      for (uint32 i = 0; i < track_count; i++)
+      {
+        const CDImage::Track& track = image.GetTrack(i);
+        if (track.number < start_track)
+          continue;
+
+        m_data_buffer[len++] = 0;                       // Reserved
+        m_data_buffer[len++] = GetTrackControl(track);  // ADR, control
+        m_data_buffer[len++] = Truncate8(track.number); // Track number
+        m_data_buffer[len++] = 0;                       // Reserved
+        WriteAddress(track.start_lba);
       }
 
-      uint32 blocks = uint32(m_media.total_sectors);
+      m_data_buffer[len++] = 0;                // Reserved
+      m_data_buffer[len++] = lead_out_control; // ADR, control
+      m_data_buffer[len++] = 0xaa;             // Track number
+      m_data_buffer[len++] = 0;                // Reserved
+      WriteAddress(lead_out_lba);
 
-      // Start address
-      if (msf)
-      {
-        m_data_buffer[len++] = 0;                                 // reserved
-        m_data_buffer[len++] = uint8(((blocks + 150) / 75) / 60); // minute
-        m_data_buffer[len++] = uint8(((blocks + 150) / 75) % 60); // second
-        m_data_buffer[len++] = uint8((blocks + 150) % 75);        // frame;
-      }
-      else
-      {
-        m_data_buffer[len++] = uint8((blocks >> 24) & 0xff);
-        m_data_buffer[len++] = uint8((blocks >> 16) & 0xff);
-        m_data_buffer[len++] = uint8((blocks >> 8) & 0xff);
-        m_data_buffer[len++] = uint8((blocks >> 0) & 0xff);
-      }
       m_data_buffer[0] = uint8(((len - 2) >> 8) & 0xff);
       m_data_buffer[1] = uint8((len - 2) & 0xff);
 
@@ -758,14 +766,18 @@ void CDROM::HandleReadTOCCommand()
 
     case 1:
     {
-      // emulate a single session
+      // emulate a single session, whose first track is the first track on the disc
       AllocateData(12, max_length);
       m_data_buffer[0] = 0;
       m_data_buffer[1] = 0x0A;
       m_data_buffer[2] = 1;
       m_data_buffer[3] = 1;
-      for (uint32 i = 0; i < 8; i++)
-        m_data_buffer[4 + i] = 0;
+
+      m_data_buffer[len++] = 0;                                  // Reserved
+      m_data_buffer[len++] = GetTrackControl(image.GetTrack(0)); // ADR, control
+      m_data_buffer[len++] = first_track;                        // First track number in last session
+      m_data_buffer[len++] = 0;                                  // Reserved
+      WriteAddress(image.GetTrack(0).start_lba);
 
       UpdateSenseInfo(SENSE_NO_STATUS, 0);
       CompleteCommand();
@@ -774,59 +786,31 @@ void CDROM::HandleReadTOCCommand()
 
     case 2:
     {
-      // raw toc
-      uint32 len = 4;
+      // raw toc: first track, last track and lead out points, then each track
+      AllocateData(4 + (3 + track_count) * 11, max_length);
       m_data_buffer[2] = 1;
       m_data_buffer[3] = 1;
 
-      for (uint32 i = 0; i < 4; i++)
+      for (uint32 i = 0; i < (3 + track_count); i++)
       {
+        const CDImage::Track& track = image.GetTrack((i < 3) ? ((i == 0) ? 0 : (track_count - 1)) : (i - 3));
         m_data_buffer[len++] = 1;
-        m_data_buffer[len++] = 0x14;
+        m_data_buffer[len++] = (i == 2) ? lead_out_control : GetTrackControl(track);
         m_data_buffer[len++] = 0;
-        if (i < 3)
-        {
-          m_data_buffer[len++] = uint8(0xa0 + i);
-        }
-        else
-        {
-          m_data_buffer[len++] = 1;
-        }
+        m_data_buffer[len++] = (i < 3) ? uint8(0xa0 + i) : Truncate8(track.number);
         m_data_buffer[len++] = 0;
         m_data_buffer[len++] = 0;
         m_data_buffer[len++] = 0;
         if (i < 2)
         {
           m_data_buffer[len++] = 0;
-          m_data_buffer[len++] = 1;
+          m_data_buffer[len++] = (i == 0) ? first_track : last_track;
           m_data_buffer[len++] = 0;
           m_data_buffer[len++] = 0;
         }
-        else if (i == 2)
-        {
-          uint32 blocks = uint32(m_media.total_sectors);
-
-          if (msf)
-          {
-            m_data_buffer[len++] = 0;                                 // reserved
-            m_data_buffer[len++] = uint8(((blocks + 150) / 75) / 60); // minute
-            m_data_buffer[len++] = uint8(((blocks + 150) / 75) % 60); // second
-            m_data_buffer[len++] = uint8((blocks + 150) % 75);        // frame;
-          }
-          else
-          {
-            m_data_buffer[len++] = uint8((blocks >> 24) & 0xff);
-            m_data_buffer[len++] = uint8((blocks >> 16) & 0xff);
-            m_data_buffer[len++] = uint8((blocks >> 8) & 0xff);
-            m_data_buffer[len++] = uint8((blocks >> 0) & 0xff);
-          }
-        }
         else
         {
-          m_data_buffer[len++] = 0;
-          m_data_buffer[len++] = 0;
-          m_data_buffer[len++] = 0;
-          m_data_buffer[len++] = 0;
+          WriteAddress((i == 2) ? lead_out_lba : track.start_lba);
         }
       }
       m_data_buffer[0] = uint8(((len - 2) >> 8) & 0xff);
@@ -1008,8 +992,8 @@ void CDROM::HandleReadCommand()
         return;
       }
 
-      // Only support data reads for now.
-      if ((m_command_buffer[9] & 0xF8) != 0x10)
+      // Either the user data, or the whole sector.
+      if ((m_command_buffer[9] & 0xF8) != 0x10 && (m_command_buffer[9] & 0xF8) != 0xF8)
       {
         AbortCommand(SENSE_ILLEGAL_REQUEST, ASC_INVALID_FIELD_IN_CMD_PACKET);
         return;
@@ -1034,9 +1018,7 @@ void CDROM::HandleReadCommand()
   }
 
   // Read a single sector at a time.
-  AllocateData(SECTOR_SIZE, SECTOR_SIZE);
-  if (!m_media.stream->SeekAbsolute(lba * uint64(m_data_response_size)) ||
-      !m_media.stream->Read2(m_data_buffer.data(), m_data_response_size))
+  if (!ReadTransferSector(lba))
   {
     Log_ErrorPrintf("CDROM read error at LBA %u", uint32(lba));
     AbortCommand(SENSE_ILLEGAL_REQUEST, ASC_MEDIUM_NOT_PRESENT);
@@ -1064,8 +1046,7 @@ void CDROM::HandleReadCommand()
 bool CDROM::TransferNextSector()
 {
   // Read next sector.
-  AllocateData(SECTOR_SIZE, SECTOR_SIZE);
-  if (!m_media.stream->Read2(m_data_buffer.data(), m_data_response_size))
+  if (!ReadTransferSector(m_current_lba))
   {
     Log_ErrorPrintf("CDROM read error at LBA %u", uint32(m_current_lba));
     AbortCommand(SENSE_ILLEGAL_REQUEST, ASC_MEDIUM_NOT_PRESENT);
@@ -1087,6 +1068,122 @@ bool CDROM::TransferNextSector()
   return true;
 }
 
+bool CDROM::ReadMediaSector(uint64 lba)
+{
+  // Multiple-sector commands are sequential from the start, otherwise compare against the previous read.
+  const bool sequential =
+    (m_remaining_sectors > 1 || (m_last_read_lba != INVALID_LBA && lba == (m_last_read_lba + 1)));
+  m_last_read_lba = lba;
+
+  for (uint32 i = 0; i < countof(m_read_ahead_buffers); i++)
+  {
+    ReadAheadBuffer& rab = m_read_ahead_buffers[i];
+    if (!rab.Contains(lba))
+      continue;
+
+    // The sector may still be on its way, but it is needed now.
+    if (m_read_ahead_pending && m_read_ahead_pending_index == i)
+      WaitForReadAhead();
+    if (!rab.valid)
+      break;
+
+    std::memcpy(m_data_buffer.data(), &rab.data[(lba - rab.start_lba) * SECTOR_SIZE], SECTOR_SIZE);
+
+    // Fill the other buffer with what follows while this one is consumed.
+    const uint64 next_lba = rab.start_lba + rab.sector_count;
+    const ReadAheadBuffer& other_rab = m_read_ahead_buffers[i ^ 1];
+    if (!m_read_ahead_pending && !(other_rab.valid && other_rab.Contains(next_lba)))
+      QueueReadAhead(i ^ 1, next_lba);
+
+    return true;
+  }
+
+  // Not read ahead, so read it directly. The worker has to finish with the media first.
+  WaitForReadAhead();
+  if (!ReadMediaSectors(lba, 1, m_data_buffer.data()))
+    return false;
+
+  if (sequential)
+    QueueReadAhead(0, lba + 1);
+
+  return true;
+}
+
+bool CDROM::ReadMediaSectors(uint64 lba, uint32 sector_count, byte* buffer)
+{
+  return m_media.image->ReadDataSectors(lba, sector_count, buffer);
+}
+
+uint32 CDROM::GetTransferSectorSize(uint64 lba) const
+{
+  // READ CD can ask for the whole sector including the sync pattern, header and EDC/ECC. Audio sectors have no
+  // header, so all of the sector is user data.
+  if (m_command_buffer[0] != SCSI_CMD_READ_CD)
+    return SECTOR_SIZE;
+  if ((m_command_buffer[9] & 0xF8) == 0xF8)
+    return AUDIO_SECTOR_SIZE;
+
+  const CDImage::Track* track = m_media.image->GetTrackForLBA(lba);
+  return (track && track->IsAudio()) ? AUDIO_SECTOR_SIZE : SECTOR_SIZE;
+}
+
+bool CDROM::ReadTransferSector(uint64 lba)
+{
+  const uint32 sector_size = GetTransferSectorSize(lba);
+  AllocateData(sector_size, sector_size);
+  if (sector_size == SECTOR_SIZE)
+    return ReadMediaSector(lba);
+
+  // Whole sectors are not read ahead, but the worker has to finish with the media first.
+  WaitForReadAhead();
+  m_last_read_lba = lba;
+  return m_media.image->ReadRawSector(lba, m_data_buffer.data());
+}
+
+void CDROM::QueueReadAhead(uint32 buffer_index, uint64 lba)
+{
+  DebugAssert(!m_read_ahead_pending);
+  if (m_read_ahead_sectors == 0 || lba >= m_media.total_sectors)
+    return;
+
+  // Data reads fail on audio sectors, so stop at the end of the track.
+  const CDImage::Track* track = m_media.image->GetTrackForLBA(lba);
+  if (!track || track->IsAudio())
+    return;
+
+  ReadAheadBuffer& rab = m_read_ahead_buffers[buffer_index];
+  rab.start_lba = lba;
+  rab.sector_count = Truncate32(std::min(ZeroExtend64(m_read_ahead_sectors), track->GetEndLBA() - lba));
+  rab.valid = false;
+  if (rab.data.size() < (rab.sector_count * SECTOR_SIZE))
+    rab.data.resize(rab.sector_count * SECTOR_SIZE);
+
+  m_read_ahead_pending = true;
+  m_read_ahead_pending_index = buffer_index;
+  m_read_ahead_thread.QueueLambdaTask(
+    [this, &rab]() { rab.valid = ReadMediaSectors(rab.start_lba, rab.sector_count, rab.data.data()); });
+}
+
+void CDROM::WaitForReadAhead()
+{
+  if (!m_read_ahead_pending)
+    return;
+
+  m_read_ahead_thread.QueueBlockingLambdaTask([]() {});
+  m_read_ahead_pending = false;
+}
+
+void CDROM::InvalidateReadAhead()
+{
+  WaitForReadAhead();
+  for (ReadAheadBuffer& rab : m_read_ahead_buffers)
+  {
+    rab.sector_count = 0;
+    rab.valid = false;
+  }
+  m_last_read_lba = INVALID_LBA;
+}
+
 void CDROM::HandleMechanismStatusCommand()
 {
   Log_DevPrintf("CDROM read mechanism status");
@@ -1,7 +1,9 @@
 #pragma once
 #include "YBaseLib/String.h"
+#include "YBaseLib/TaskQueue.h"
 #include "common/bitfield.h"
 #include "common/clock.h"
+#include "common/cd_image.h"
 #include "pce/component.h"
 #include <vector>
 
@@ -33,7 +35,7 @@ public:
 
   bool IsBusy() const { return m_busy; }
   bool HasError() const { return m_error; }
-  bool HasMedia() const { return (m_media.stream != nullptr); }
+  bool HasMedia() const { return (m_media.image != nullptr); }
   uint8 GetSenseKey() const { return static_cast<uint8>(m_sense.key); }
 
   const byte* GetDataBuffer() const { return m_data_buffer.data(); }
@@ -62,6 +64,7 @@ public:
 private:
   static constexpr uint32 SECTOR_SIZE = 2048;
   static constexpr uint32 AUDIO_SECTOR_SIZE = 2352;
+  static constexpr uint64 INVALID_LBA = UINT64_C(0xFFFFFFFFFFFFFFFF);
   static constexpr uint32 SERIALIZATION_ID = MakeSerializationID('C', 'D', 'R');
 
   using CommandBuffer = std::vector<byte>;
@@ -141,6 +144,14 @@ private:
   };
 
   void EjectMedia();
+
+  bool ReadMediaSector(uint64 lba);
+  bool ReadMediaSectors(uint64 lba, uint32 sector_count, byte* buffer);
+  uint32 GetTransferSectorSize(uint64 lba) const;
+  bool ReadTransferSector(uint64 lba);
+  void QueueReadAhead(uint32 buffer_index, uint64 lba);
+  void WaitForReadAhead();
+  void InvalidateReadAhead();
   void UpdateSenseInfo(SENSE_KEY key, uint8 asc);
   void AllocateData(uint32 reserve_length, uint32 response_length);
 
@@ -212,7 +223,7 @@ private:
   struct
   {
     String filename;
-    ByteStream* stream = nullptr;
+    std::unique_ptr<CDImage> image;
     uint64 total_sectors = 0;
   } m_media;
 
@@ -220,6 +231,26 @@ private:
   uint64 m_current_lba = 0;
   uint32 m_remaining_sectors = 0;
   bool m_tray_locked = false;
+
+  // Read-ahead. Once reads are sequential, the following sectors are read on a worker thread into one buffer while
+  // the other is consumed, so host I/O stays off the emulation thread. Command timing is unaffected, it is still
+  // determined by CalculateSeekTime()/CalculateReadTime(). The media is only accessed from the worker while a read is
+  // pending, so WaitForReadAhead() must be called before touching it from the emulation thread.
+  struct ReadAheadBuffer
+  {
+    std::vector<byte> data;
+    uint64 start_lba = 0;
+    uint32 sector_count = 0;
+    bool valid = false;
+
+    bool Contains(uint64 lba) const { return (lba >= start_lba && (lba - start_lba) < sector_count); }
+  };
+  uint32 m_read_ahead_sectors = 32;
+  ReadAheadBuffer m_read_ahead_buffers[2];
+  uint32 m_read_ahead_pending_index = 0;
+  bool m_read_ahead_pending = false;
+  uint64 m_last_read_lba = INVALID_LBA;
+  TaskQueue m_read_ahead_thread;
 };
 
 } // namespace HW
@@ -13,6 +13,17 @@ namespace HW {
 #include "cga_font.inl"
 #include "cga_palette.inl"
 
+// Each byte value expanded to eight pixel masks, MSB first.
+static const std::array<std::array<uint32, 8>, 256> s_pixel_masks = []() {
+  std::array<std::array<uint32, 8>, 256> masks = {};
+  for (uint32 value = 0; value < 256; value++)
+  {
+    for (uint32 bit = 0; bit < 8; bit++)
+      masks[value][bit] = ((value >> (7 - bit)) & 1) ? 0xFFFFFFFFu : 0u;
+  }
+  return masks;
+}();
+
 DEFINE_OBJECT_TYPE_INFO(CGA);
 DEFINE_GENERIC_COMPONENT_FACTORY(CGA);
 BEGIN_OBJECT_PROPERTY_MAP(CGA)
@@ -57,6 +68,8 @@ void CGA::Reset()
   m_mode_control_register.enable_video_output = false;
   m_mode_control_register.high_resolution_graphics = false;
   m_mode_control_register.enable_blink = false;
+  UpdateAttributeColors();
+  UpdateGraphicsColors();
   RecalculateEventTiming();
   BeginFrame();
 
@@ -90,7 +103,11 @@ bool CGA::LoadState(BinaryReader& reader)
   }
 
   if (valid)
+  {
+    UpdateAttributeColors();
+    UpdateGraphicsColors();
     RecalculateEventTiming();
+  }
 
   return valid;
 }
@@ -244,6 +261,7 @@ void CGA::BeginFrame()
   {
     m_blink_frame_counter = BLINK_INTERVAL;
     m_blink_state ^= 1;
+    UpdateAttributeColors();
   }
 
   // Update cursor state.
@@ -284,6 +302,7 @@ void CGA::RenderLineText()
   uint32 cursor_address = GetCursorAddress();
   uint32 address_register = m_address_counter;
   uint32 character_start_y = m_character_row_counter & 0x7;
+  uint32* dest = &m_current_frame[m_current_frame_offset];
   for (uint32 j = 0; j < num_characters; j++)
   {
     uint32 vram_address = (address_register & ADDRESS_COUNTER_VRAM_MASK_TEXT) << CRTC_ADDRESS_SHIFT;
@@ -291,22 +310,18 @@ void CGA::RenderLineText()
     uint8 character_attributes = m_vram[vram_address + 1];
 
     uint8 source_bits = CGA_FONT[character_code][character_start_y];
-    uint32 foreground_color = CGA_PALETTE[character_attributes & 0xF];
-    uint32 background_color = CGA_PALETTE[(character_attributes >> 4) & 0x7];
     if (address_register == cursor_address && InCursorBox())
       source_bits = 0xFF;
-    if ((character_attributes >> 7) & m_blink_state)
-      foreground_color = background_color;
 
-    for (uint32 k = 0; k < 8; k++)
-    {
-      // This goes MSB..LSB.
-      m_current_frame[m_current_frame_offset++] = (source_bits >> 7) ? foreground_color : background_color;
-      source_bits <<= 1;
-    }
+    const AttributeColors& colors = m_attribute_colors[character_attributes];
+    const uint32* masks = s_pixel_masks[source_bits].data();
+    for (uint32 k = 0; k < CHARACTER_WIDTH; k++)
+      dest[k] = colors.background ^ (colors.difference & masks[k]);
+    dest += CHARACTER_WIDTH;
 
     address_register = (address_register + 1) & ADDRESS_COUNTER_MASK;
   }
+  m_current_frame_offset += num_characters * CHARACTER_WIDTH;
 
   for (uint32 i = 0; i < m_timing.horizontal_right_border_pixels; i++)
     m_current_frame[m_current_frame_offset++] = border_color;
@@ -330,44 +345,35 @@ void CGA::RenderLineGraphics()
     m_current_frame[m_current_frame_offset++] = border_color;
 
   uint32 address_counter = m_address_counter;
+  uint32* dest = &m_current_frame[m_current_frame_offset];
   for (uint32 j = 0; j < num_characters; j++)
   {
     // TODO: Is this correct?
     uint32 vram_offset = ((address_counter++ & ADDRESS_COUNTER_VRAM_MASK_GRAPHICS) << CRTC_ADDRESS_SHIFT) |
                          ((m_character_row_counter & 1) << 13);
-    uint16 pixels = (ZeroExtend16(m_vram[vram_offset + 0]) << 8) | ZeroExtend16(m_vram[vram_offset + 1]);
 
-    if (high_resolution)
+    for (uint32 i = 0; i < 2; i++)
     {
-      uint32 foreground_color = CGA_PALETTE[m_color_control_register.background_color];
-      uint32 background_color = CGA_PALETTE[0];
-
-      // 1 bit per pixel, 8 pixels per byte
-      for (uint32 k = 0; k < 16; k++)
+      const uint8 pixels = m_vram[vram_offset + i];
+      if (high_resolution)
       {
-        m_current_frame[m_current_frame_offset++] = (pixels >> 15) ? foreground_color : background_color;
-        pixels <<= 1;
+        // 1 bit per pixel, 8 pixels per byte
+        const uint32* masks = s_pixel_masks[pixels].data();
+        for (uint32 k = 0; k < 8; k++)
+          dest[k] = m_high_resolution_colors.background ^ (m_high_resolution_colors.difference & masks[k]);
+        dest += 8;
       }
-    }
-    else
-    {
-      const uint32* foreground_palette =
-        (m_mode_control_register.monochrome ?
-           CGA_GRAPHICS_PALETTE_2 :
-           (m_color_control_register.palette_select ? CGA_GRAPHICS_PALETTE_1 : CGA_GRAPHICS_PALETTE_0));
-      uint8 foreground_intensity = m_color_control_register.foreground_intensity ? 1 : 0;
-      uint32 background_color = CGA_PALETTE[m_color_control_register.background_color];
-
-      // 2 bits per pixel, 4 pixels per byte
-      for (uint32 k = 0; k < 8; k++)
+      else
       {
-        uint8 index = (pixels >> 14);
-        m_current_frame[m_current_frame_offset++] =
-          (index == 0) ? background_color : foreground_palette[(index << 1) | foreground_intensity];
-        pixels <<= 2;
+        // 2 bits per pixel, 4 pixels per byte
+        const std::array<uint32, 4>& byte_pixels = m_graphics_byte_pixels[pixels];
+        for (uint32 k = 0; k < 4; k++)
+          dest[k] = byte_pixels[k];
+        dest += 4;
       }
     }
   }
+  m_current_frame_offset += num_characters * (high_resolution ? (CHARACTER_WIDTH * 2) : CHARACTER_WIDTH);
 
   for (uint32 i = 0; i < m_timing.horizontal_right_border_pixels; i++)
     m_current_frame[m_current_frame_offset++] = border_color;
@@ -412,10 +418,47 @@ void CGA::FlushFrame()
   m_current_frame_offset = 0;
 }
 
+void CGA::UpdateAttributeColors()
+{
+  for (uint32 attribute = 0; attribute < 256; attribute++)
+  {
+    uint32 foreground_color = CGA_PALETTE[attribute & 0xF];
+    uint32 background_color = CGA_PALETTE[(attribute >> 4) & 0x7];
+    if ((attribute >> 7) & m_blink_state)
+      foreground_color = background_color;
+
+    m_attribute_colors[attribute] = {background_color, foreground_color ^ background_color};
+  }
+}
+
+void CGA::UpdateGraphicsColors()
+{
+  const uint32 high_resolution_foreground = CGA_PALETTE[m_color_control_register.background_color];
+  const uint32 high_resolution_background = CGA_PALETTE[0];
+  m_high_resolution_colors = {high_resolution_background, high_resolution_foreground ^ high_resolution_background};
+
+  const uint32* foreground_palette =
+    (m_mode_control_register.monochrome ?
+       CGA_GRAPHICS_PALETTE_2 :
+       (m_color_control_register.palette_select ? CGA_GRAPHICS_PALETTE_1 : CGA_GRAPHICS_PALETTE_0));
+  const uint8 foreground_intensity = m_color_control_register.foreground_intensity ? 1 : 0;
+  const uint32 background_color = CGA_PALETTE[m_color_control_register.background_color];
+  for (uint32 value = 0; value < 256; value++)
+  {
+    for (uint32 k = 0; k < 4; k++)
+    {
+      const uint8 index = Truncate8((value >> (6 - (k * 2))) & 3);
+      m_graphics_byte_pixels[value][k] =
+        (index == 0) ? background_color : foreground_palette[(index << 1) | foreground_intensity];
+    }
+  }
+}
+
 void CGA::ModeControlRegisterWrite(uint8 value)
 {
   m_line_event->InvokeEarly();
   m_mode_control_register.raw = value;
+  UpdateGraphicsColors();
   RecalculateEventTiming();
 }
 
@@ -423,6 +466,7 @@ void CGA::ColorControlRegisterWrite(uint8 value)
 {
   m_line_event->InvokeEarly();
   m_color_control_register.raw = value;
+  UpdateGraphicsColors();
 }
 
 void CGA::StatusRegisterRead(uint8* value)
@@ -4,6 +4,7 @@
 #include "common/clock.h"
 #include "pce/component.h"
 #include "pce/system.h"
+#include <array>
 
 class Display;
 
@@ -54,6 +55,8 @@ private:
   void RenderLineGraphics();
   void RenderLineBorder();
   void FlushFrame();
+  void UpdateAttributeColors();
+  void UpdateGraphicsColors();
 
   std::unique_ptr<Display> m_display;
   uint8 m_vram[VRAM_SIZE];
@@ -164,5 +167,19 @@ private:
   uint8 m_cursor_frame_counter = BLINK_INTERVAL;
   uint8 m_blink_state = 0;
   uint8 m_cursor_state = 0;
+
+  // Colours for each text attribute with the current blink state applied, rebuilt when the blink state flips.
+  // Stored as the background and its XOR with the foreground, so a glyph row is expanded with a mask per pixel.
+  struct AttributeColors
+  {
+    uint32 background;
+    uint32 difference;
+  };
+  std::array<AttributeColors, 256> m_attribute_colors = {};
+
+  // Colours for 640x200 graphics, and the four pixels of each byte of 320x200 graphics, for the current palette.
+  // Rebuilt when the mode or colour control register is written.
+  AttributeColors m_high_resolution_colors = {};
+  std::array<std::array<uint32, 4>, 256> m_graphics_byte_pixels = {};
 };
 } // namespace HW
\ No newline at end of file
@@ -7,8 +7,10 @@
 #include "common/display.h"
 #include "pce/bus.h"
 #include "pce/host_interface.h"
+#include "pce/hw/vga_scanline.h"
 #include "pce/mmio.h"
 #include "pce/system.h"
+#include <algorithm>
 Log_SetChannel(HW::ET4000);
 
 namespace HW {
@@ -25,6 +27,9 @@ ET4000::ET4000(const String& identifier, const ObjectTypeInfo* type_info /* = &s
 
 ET4000::~ET4000()
 {
+#ifdef ET4000_USE_RENDER_THREAD
+  m_render_thread.ExitWorkers();
+#endif
   SAFE_RELEASE(m_bios_mmio);
   SAFE_RELEASE(m_vram_mmio);
 }
@@ -38,6 +43,8 @@ bool ET4000::Initialize(System* system, Bus* bus)
     SmallString::FromFormat("%s (ET4000)", m_identifier.GetCharArray()), Display::Type::Primary);
   if (!m_display)
     return false;
+
+  m_renderer.SetDisplay(m_display.get());
   m_display->SetDisplayAspectRatio(4, 3);
 
   m_clock.SetManager(system->GetTimingManager());
@@ -50,6 +57,15 @@ bool ET4000::Initialize(System* system, Bus* bus)
 
   // Retrace event will be scheduled after timing is calculated.
   m_retrace_event = m_clock.NewEvent("Retrace", 1, std::bind(&ET4000::Render, this), false);
+
+  // Every buffer's copy of VRAM starts out of date.
+  for (VRAMDirtyBits& bits : m_render_stale_vram_bits)
+    bits.fill(~UINT64_C(0));
+
+#ifdef ET4000_USE_RENDER_THREAD
+  m_render_thread.Initialize(TaskQueue::DefaultQueueSize, 1);
+#endif
+
   return true;
 }
 
@@ -100,6 +116,8 @@ void ET4000::Reset()
 
   m_cursor_counter = 0;
   m_cursor_state = false;
+  m_display_dirty = true;
+  m_frame_in_progress = false;
 
   RecalculateEventTiming();
   m_retrace_event->Reset();
@@ -138,6 +156,9 @@ bool ET4000::LoadState(BinaryReader& reader)
   reader.SafeReadBool(&m_cursor_state);
 
   // Force re-render after loading state
+  MarkVRAMDirtyRange(0, VRAM_SIZE);
+  m_display_dirty = true;
+  m_frame_in_progress = false;
   RecalculateEventTiming();
   Render();
 
@@ -251,15 +272,192 @@ void ET4000::Render()
   {
     m_cursor_counter = 0;
     m_cursor_state ^= true;
+
+    // The cursor and blinking attributes are only drawn in text modes.
+    if (!m_graphics_registers.misc.text_mode_disable)
+      m_display_dirty = true;
   }
 
   if (!m_display->IsActive())
+  {
+    // Redraw everything once the display is shown again.
+    m_frame_in_progress = false;
+    m_display_dirty = true;
+    return;
+  }
+
+  // Finish off the frame which has just been scanned out, and start the next one. If there is no frame in progress,
+  // because the display was off or state was just loaded, the whole frame is drawn from the current state.
+  if (!m_frame_in_progress)
+    BeginFrame();
+
+  FinishFrame();
+  BeginFrame();
+
+  // The renderer only reports the size of the frames it draws, messages are sent from the emulation thread.
+  const uint32 screen_size = m_renderer.GetScreenSize();
+  if (screen_size != 0 && (screen_size != m_last_reported_screen_size ||
+                           m_last_rendered_vertical_frequency != m_timing.vertical_frequency))
+  {
+    m_system->GetHostInterface()->ReportFormattedMessage("Screen format changed: %ux%u @ %.1f hz", screen_size >> 16,
+                                                         screen_size & 0xFFFF, m_timing.vertical_frequency);
+
+    m_last_reported_screen_size = screen_size;
+    m_last_rendered_vertical_frequency = m_timing.vertical_frequency;
+  }
+}
+
+void ET4000::BeginFrame()
+{
+  // The write buffer can still hold the dirty state of a dropped frame, which is merged in FinishFrame().
+  FrameSnapshot& frame = m_render_frames.GetWriteBuffer();
+  frame.num_spans = 0;
+  frame.graphics_mode = m_graphics_registers.misc.text_mode_disable;
+  m_frame_in_progress = true;
+}
+
+void ET4000::FinishFrame()
+{
+  FrameSnapshot& frame = m_render_frames.GetWriteBuffer();
+
+  // The last span runs to the end of the frame. Text modes are drawn whole, so they only have this span.
+  AddRenderSpan(FrameSnapshot::END_OF_FRAME);
+  frame.cursor_state = m_cursor_state;
+
+  if (m_render_merge_dropped_frame)
+  {
+    frame.display_dirty |= m_display_dirty;
+    frame.vram_dirty |= m_vram_dirty;
+    for (size_t i = 0; i < frame.vram_dirty_bits.size(); i++)
+      frame.vram_dirty_bits[i] |= m_vram_dirty_bits[i];
+  }
+  else
+  {
+    frame.display_dirty = m_display_dirty;
+    frame.vram_dirty = m_vram_dirty;
+    frame.vram_dirty_bits = m_vram_dirty_bits;
+  }
+
+  // Pages written this frame are out of date in every buffer's copy of VRAM. Bring this buffer's copy up to date.
+  if (m_vram_dirty)
+  {
+    for (VRAMDirtyBits& stale_bits : m_render_stale_vram_bits)
+    {
+      for (size_t i = 0; i < stale_bits.size(); i++)
+        stale_bits[i] |= m_vram_dirty_bits[i];
+    }
+  }
+
+  VRAMDirtyBits& stale_bits = m_render_stale_vram_bits[m_render_frames.GetWriteIndex()];
+  constexpr uint32 num_pages = VRAM_SIZE >> VRAM_DIRTY_SHIFT;
+  uint32 page = 0;
+  while (page < num_pages)
+  {
+    if (stale_bits[page / 64] == 0)
+    {
+      page = (page | 63) + 1;
+      continue;
+    }
+
+    if (((stale_bits[page / 64] >> (page % 64)) & 1) == 0)
+    {
+      page++;
+      continue;
+    }
+
+    // Copy runs of stale pages in one go.
+    uint32 end_page = page + 1;
+    while (end_page < num_pages && ((stale_bits[end_page / 64] >> (end_page % 64)) & 1) != 0)
+      end_page++;
+
+    const uint32 offset = page << VRAM_DIRTY_SHIFT;
+    std::memcpy(&frame.vram[offset], &m_vram[offset], (end_page - page) << VRAM_DIRTY_SHIFT);
+    page = end_page;
+  }
+  stale_bits.fill(0);
+
+  ClearDirtyState();
+  m_frame_in_progress = false;
+
+  // If the render thread never picked up the previous frame, its buffer comes back with that frame still in it.
+  m_render_merge_dropped_frame = !m_render_frames.Publish();
+  QueueRenderFrame();
+}
+
+void ET4000::CloseRenderSpan()
+{
+  // Text modes are drawn with the registers at the end of the frame.
+  if (!m_frame_in_progress || !m_render_frames.GetWriteBuffer().graphics_mode)
     return;
 
-  if (m_graphics_registers.misc.text_mode_disable)
-    RenderGraphicsMode();
+  // Scanlines above the beam have been displayed with the current register values. In horizontal blank, the current
+  // line is complete as well.
+  const ScanoutInfo si = GetScanoutInfo();
+  if (si.in_vertical_blank)
+    AddRenderSpan(FrameSnapshot::END_OF_FRAME);
   else
-    RenderTextMode();
+    AddRenderSpan(si.current_line + BoolToUInt32(si.in_horizontal_blank));
+}
+
+void ET4000::AddRenderSpan(uint32 end_line)
+{
+  FrameSnapshot& frame = m_render_frames.GetWriteBuffer();
+  const uint32 start_line = (frame.num_spans > 0) ? frame.spans[frame.num_spans - 1].end_line : 0;
+  if (end_line <= start_line)
+    return;
+
+  // With too many changes in one frame, the last span is extended and drawn with the most recent registers.
+  if (frame.num_spans == FrameSnapshot::MAX_SPANS)
+    frame.num_spans--;
+
+  FrameSnapshot::Span& span = frame.spans[frame.num_spans++];
+  span.end_line = end_line;
+  CaptureRenderRegisters(&span.registers);
+}
+
+void ET4000::MarkDisplayDirty()
+{
+  CloseRenderSpan();
+  m_display_dirty = true;
+}
+
+void ET4000::CaptureRenderRegisters(RenderRegisters* registers) const
+{
+  // BitField deletes copy assignment, so the register unions are copied through their index arrays.
+  std::memcpy(registers->crtc_registers.index, m_crtc_registers.index, sizeof(m_crtc_registers.index));
+  std::memcpy(registers->graphics_registers.index, m_graphics_registers.index, sizeof(m_graphics_registers.index));
+  std::memcpy(registers->attribute_registers.index, m_attribute_registers.index, sizeof(m_attribute_registers.index));
+  std::memcpy(registers->sequencer_registers.index, m_sequencer_registers.index, sizeof(m_sequencer_registers.index));
+  registers->dac_palette = m_dac_palette;
+  registers->dac_ctrl = m_dac_ctrl;
+}
+
+void ET4000::QueueRenderFrame()
+{
+#ifdef ET4000_USE_RENDER_THREAD
+  // A queued task draws every frame published before it runs, so there is never more than one in the queue.
+  if (!m_render_task_queued.exchange(true))
+    m_render_thread.QueueLambdaTask([this]() { RenderPendingFrames(); });
+#else
+  RenderPendingFrames();
+#endif
+}
+
+void ET4000::RenderPendingFrames()
+{
+#ifdef ET4000_USE_RENDER_THREAD
+  m_render_task_queued.store(false);
+#endif
+
+  while (m_render_frames.Acquire())
+    m_renderer.DrawFrame(m_render_frames.GetReadBuffer());
+}
+
+void ET4000::FlushRenderThread()
+{
+#ifdef ET4000_USE_RENDER_THREAD
+  m_render_thread.QueueBlockingLambdaTask([]() {});
+#endif
 }
 
 void ET4000::IOReadStatusRegister1(uint8* value)
@@ -302,6 +500,7 @@ void ET4000::IOCRTCDataRegisterRead(uint8* value)
 
 void ET4000::IOCRTCDataRegisterWrite(uint8 value)
 {
+  MarkDisplayDirty();
   if (m_crtc_index_register >= countof(m_crtc_registers.index))
   {
     Log_ErrorPrintf("Out-of-range CRTC register write: %u", uint32(m_crtc_index_register));
@@ -335,6 +534,7 @@ void ET4000::IOGraphicsDataRegisterRead(uint8* value)
 
 void ET4000::IOGraphicsDataRegisterWrite(uint8 value)
 {
+  MarkDisplayDirty();
   static const uint8_t gr_mask[16] = {
     0x0f, /* 0x00 */
     0x0f, /* 0x01 */
@@ -368,6 +568,7 @@ void ET4000::IOGraphicsDataRegisterWrite(uint8 value)
 
 void ET4000::IOMiscOutputRegisterWrite(uint8 value)
 {
+  MarkDisplayDirty();
   Log_TracePrintf("Misc output register write: 0x%02X", uint32(value));
   m_misc_output_register.bits = value;
   RecalculateEventTiming();
@@ -396,6 +597,7 @@ void ET4000::IOAttributeDataRead(uint8* value)
 
 void ET4000::IOAttributeAddressDataWrite(uint8 value)
 {
+  MarkDisplayDirty();
   if (!m_crtc_registers.attribute_register_flipflop)
   {
     // bit 5/0x20 - disable ATC palette ram access, replace palette with overscan register
@@ -449,6 +651,7 @@ void ET4000::IOSequencerDataRegisterRead(uint8* value)
 
 void ET4000::IOSequencerDataRegisterWrite(uint8 value)
 {
+  MarkDisplayDirty();
   /* force some bits to zero */
   const uint8_t sr_mask[8] = {
     0x03, 0x3d, 0x0f, 0x3f, 0x0e, 0x00, 0x00, 0xff,
@@ -482,6 +685,7 @@ void ET4000::IODACMaskRead(uint8* value) // 3c6
 
 void ET4000::IODACMaskWrite(uint8 value) // 3c6
 {
+  MarkDisplayDirty();
   if (m_dac_state_register == 4)
   {
     m_dac_state_register = 0;
@@ -541,6 +745,7 @@ void ET4000::IODACDataRegisterRead(uint8* value) // 3c9
 
 void ET4000::IODACDataRegisterWrite(uint8 value) // 3c9
 {
+  MarkDisplayDirty();
   Log_TracePrintf("DAC palette write %u/%u: %u", uint32(m_dac_write_address), uint32(m_dac_color_index), uint32(value));
 
   // Mask away higher bits
@@ -703,12 +908,14 @@ void ET4000::HandleVRAMWrite(uint32 offset, uint8 value)
     uint8 plane = Truncate8(offset & 3);
     if (m_sequencer_registers.memory_plane_write_enable & (1 << plane))
       m_vram[segment + offset] = value;
+      MarkVRAMDirty(segment + offset);
   }
   else if (!m_sequencer_registers.sequencer_memory_mode.odd_even_host_memory)
   {
     uint8 plane = Truncate8(offset & 1);
     if (m_sequencer_registers.memory_plane_write_enable & (1 << plane))
       m_vram[((segment + (offset & ~uint32(1))) * 4) | plane] = value;
+      MarkVRAMDirty(((segment + (offset & ~uint32(1))) * 4) | plane);
   }
   else
   {
@@ -793,7 +1000,114 @@ void ET4000::HandleVRAMWrite(uint32 offset, uint8 value)
     std::memcpy(&current_value, &m_vram[(segment + offset) * 4], sizeof(current_value));
     all_planes_value = (all_planes_value & write_mask) | (current_value & ~write_mask);
     std::memcpy(&m_vram[(segment + offset) * 4], &all_planes_value, sizeof(current_value));
+    MarkVRAMDirty((segment + offset) * 4);
+  }
+}
+
+bool ET4000::MapToVRAMOffsetRange(uint32* offset, uint32 length)
+{
+  // The windows are contiguous, so if both ends map with the same distance between them, the whole range does.
+  uint32 start = *offset;
+  uint32 end = *offset + length - 1;
+  if (!MapToVRAMOffset(&start) || !MapToVRAMOffset(&end) || (end - start) != (length - 1))
+    return false;
+
+  *offset = start;
+  return true;
+}
+
+void ET4000::HandleVRAMReadBlock(uint32 offset, uint32 length, void* destination)
+{
+  uint8* destination_ptr = static_cast<uint8*>(destination);
+  uint32 vram_offset = offset;
+  if (length == 0)
+    return;
+
+  const uint32 segment = ZeroExtend32(m_segment_select_register.read_segment.GetValue()) * 65536;
+  if (MapToVRAMOffsetRange(&vram_offset, length) && m_graphics_registers.mode.read_mode == 0)
+  {
+    if (m_sequencer_registers.sequencer_memory_mode.chain_4_enable && (segment + vram_offset + length) <= VRAM_SIZE)
+    {
+      // Chained addresses are linear in VRAM, so this is a straight copy.
+      std::memcpy(destination_ptr, &m_vram[segment + vram_offset], length);
+      std::memcpy(&m_latch, &m_vram[(segment + vram_offset + length - 1) & ~uint32(3)], sizeof(m_latch));
+      return;
+    }
+
+    if (!m_sequencer_registers.sequencer_memory_mode.chain_4_enable && !m_graphics_registers.mode.host_odd_even &&
+        (segment + vram_offset + length) <= VRAM_SIZE_PER_PLANE)
+    {
+      // Planar, a single plane is returned.
+      const uint32 read_plane = m_graphics_registers.read_map_select & 3;
+      for (uint32 i = 0; i < length; i++)
+        destination_ptr[i] = m_vram[((segment + vram_offset + i) * 4) | read_plane];
+
+      std::memcpy(&m_latch, &m_vram[(segment + vram_offset + length - 1) * 4], sizeof(m_latch));
+      return;
+    }
+  }
+
+  for (uint32 i = 0; i < length; i++)
+    HandleVRAMRead(offset + i, &destination_ptr[i]);
+}
+
+void ET4000::HandleVRAMWriteBlock(uint32 offset, uint32 length, const void* source)
+{
+  const uint8* source_ptr = static_cast<const uint8*>(source);
+  uint32 vram_offset = offset;
+  if (length == 0)
+    return;
+
+  const uint32 segment = ZeroExtend32(m_segment_select_register.write_segment.GetValue()) * 65536;
+  const uint8 plane_write_enable = m_sequencer_registers.memory_plane_write_enable & 0xF;
+  if (MapToVRAMOffsetRange(&vram_offset, length))
+  {
+    if (m_sequencer_registers.sequencer_memory_mode.chain_4_enable && (segment + vram_offset + length) <= VRAM_SIZE)
+    {
+      MarkVRAMDirtyRange(segment + vram_offset, length);
+
+      if (plane_write_enable == 0xF)
+      {
+        // Chained addresses are linear in VRAM, so with all planes enabled this is a straight copy.
+        std::memcpy(&m_vram[segment + vram_offset], source_ptr, length);
+        return;
+      }
+
+      for (uint32 i = 0; i < length; i++)
+      {
+        if (plane_write_enable & (1 << ((vram_offset + i) & 3)))
+          m_vram[segment + vram_offset + i] = source_ptr[i];
+      }
+      return;
+    }
+
+    // Planar - only handle the common cases of host data or latches being written through unmodified here.
+    const bool passthrough = (m_graphics_registers.mode.write_mode == 0 && m_graphics_registers.rotate_count == 0 &&
+                              (m_graphics_registers.enable_set_reset & 0xF) == 0 &&
+                              m_graphics_registers.logic_op == 0 && m_graphics_registers.bit_mask == 0xFF);
+    if (!m_sequencer_registers.sequencer_memory_mode.chain_4_enable &&
+        m_sequencer_registers.sequencer_memory_mode.odd_even_host_memory &&
+        (passthrough || m_graphics_registers.mode.write_mode == 1) &&
+        (segment + vram_offset + length) <= VRAM_SIZE_PER_PLANE)
+    {
+      MarkVRAMDirtyRange((segment + vram_offset) * 4, length * 4);
+
+      const uint32 write_mask = mask16[plane_write_enable];
+      for (uint32 i = 0; i < length; i++)
+      {
+        const uint32 all_planes_value = passthrough ? ET4000ExpandMask(source_ptr[i]) : m_latch;
+        uint8* vram_ptr = &m_vram[(segment + vram_offset + i) * 4];
+        uint32 current_value;
+        std::memcpy(&current_value, vram_ptr, sizeof(current_value));
+        current_value = (all_planes_value & write_mask) | (current_value & ~write_mask);
+        std::memcpy(vram_ptr, &current_value, sizeof(current_value));
+      }
+      return;
+    }
   }
+
+  for (uint32 i = 0; i < length; i++)
+    HandleVRAMWrite(offset + i, source_ptr[i]);
 }
 
 bool ET4000::IsBIOSAddressMapped(uint32 offset, uint32 size)
@@ -835,6 +1149,29 @@ bool ET4000::LoadBIOSROM()
   return true;
 }
 
+void ET4000::MarkVRAMDirtyRange(uint32 vram_offset, uint32 length)
+{
+  if (length == 0)
+    return;
+
+  const uint32 first_page = vram_offset >> VRAM_DIRTY_SHIFT;
+  const uint32 last_page = (vram_offset + length - 1) >> VRAM_DIRTY_SHIFT;
+  for (uint32 page = first_page; page <= last_page; page++)
+    MarkVRAMDirty(page << VRAM_DIRTY_SHIFT);
+}
+
+
+void ET4000::ClearDirtyState()
+{
+  if (m_vram_dirty)
+  {
+    m_vram_dirty_bits.fill(0);
+    m_vram_dirty = false;
+  }
+
+  m_display_dirty = false;
+}
+
 void ET4000::RegisterVRAMMMIO()
 {
   auto read_byte_handler = [this](uint32 base, uint32 offset, uint8* value) { HandleVRAMRead(base + offset, value); };
@@ -871,6 +1208,12 @@ void ET4000::RegisterVRAMMMIO()
   handlers.write_byte = std::bind(write_byte_handler, 0, std::placeholders::_1, std::placeholders::_2);
   handlers.write_word = std::bind(write_word_handler, 0, std::placeholders::_1, std::placeholders::_2);
   handlers.write_dword = std::bind(write_dword_handler, 0, std::placeholders::_1, std::placeholders::_2);
+  handlers.read_block = [this](uint32 offset, uint32 length, void* destination) {
+    HandleVRAMReadBlock(offset, length, destination);
+  };
+  handlers.write_block = [this](uint32 offset, uint32 length, const void* source) {
+    HandleVRAMWriteBlock(offset, length, source);
+  };
 
   // Map the entire range (0xA0000 - 0xCFFFF), then throw the writes out in the handler.
   m_vram_mmio = MMIO::CreateComplex(0xA0000, 0x20000, std::move(handlers));
@@ -909,38 +1252,11 @@ inline uint32 Convert6BitColorTo8Bit(uint32 color)
   g = (g << 2) | (g >> 4);
   b = (b << 2) | (b >> 4);
 
-  return (color & 0xFF000000) | ZeroExtend32(r) | (ZeroExtend32(g) << 8) | (ZeroExtend32(b) << 16);
-}
-
-inline uint32 ConvertBGR555ToRGB24(uint16 color)
-{
-  uint8 b = Truncate8(color & 31);
-  uint8 g = Truncate8((color >> 5) & 31);
-  uint8 r = Truncate8((color >> 10) & 31);
-
-  // 00012345 -> 1234545
-  b = (b << 3) | (b >> 3);
-  g = (g << 3) | (g >> 3);
-  r = (r << 3) | (r >> 3);
-
-  return (color & 0xFF000000) | ZeroExtend32(r) | (ZeroExtend32(g) << 8) | (ZeroExtend32(b) << 16);
-}
-
-inline uint32 ConvertBGR565ToRGB24(uint16 color)
-{
-  uint8 b = Truncate8(color & 31);
-  uint8 g = Truncate8((color >> 5) & 63);
-  uint8 r = Truncate8((color >> 11) & 31);
-
-  // 00012345 -> 1234545 / 00123456 -> 12345656
-  b = (b << 3) | (b >> 3);
-  g = (g << 2) | (g >> 4);
-  r = (r << 3) | (r >> 3);
-
-  return (color & 0xFF000000) | ZeroExtend32(r) | (ZeroExtend32(g) << 8) | (ZeroExtend32(b) << 16);
+  // The scanline converters write the palette straight to the framebuffer, so the alpha channel has to be set.
+  return UINT32_C(0xFF000000) | ZeroExtend32(r) | (ZeroExtend32(g) << 8) | (ZeroExtend32(b) << 16);
 }
 
-void ET4000::SetOutputPalette16()
+void ET4000::Renderer::SetOutputPalette16()
 {
   for (uint32 i = 0; i < 16; i++)
   {
@@ -956,7 +1272,7 @@ void ET4000::SetOutputPalette16()
   }
 }
 
-void ET4000::SetOutputPalette256()
+void ET4000::Renderer::SetOutputPalette256()
 {
   for (uint32 i = 0; i < 256; i++)
   {
@@ -1017,6 +1333,12 @@ void ET4000::RecalculateEventTiming()
     Log_ErrorPrintf("ET4000: Horizontal frequency: %.4f kHz, vertical frequency: %.4f hz out of range.",
                     horizontal_frequency / 1000.0, vertical_frequency);
 
+    // Clear the screen, once the render thread is done with the display.
+    FlushRenderThread();
+    m_display->ClearFramebuffer();
+    m_display_dirty = true;
+    m_frame_in_progress = false;
+
     // And prevent it from refreshing
     if (m_retrace_event->IsActive())
       m_retrace_event->Deactivate();
@@ -1024,7 +1346,7 @@ void ET4000::RecalculateEventTiming()
     return;
   }
 
-  // TODO: Per-scanline rendering
+  // Graphics modes are drawn in spans as registers change, the retrace event only finishes off each frame.
   if (m_timing.vertical_frequency != m_retrace_event->GetInterval())
     m_retrace_event->SetFrequency(m_timing.vertical_frequency);
   if (!m_retrace_event->IsActive())
@@ -1065,7 +1387,71 @@ ET4000::ScanoutInfo ET4000::GetScanoutInfo()
   return si;
 }
 
-uint32 ET4000::CRTCReadVRAMPlanes(uint32 address_counter, uint32 row_scan_counter) const
+void ET4000::Renderer::LoadRegisters(const RenderRegisters& registers)
+{
+  std::memcpy(m_crtc_registers.index, registers.crtc_registers.index, sizeof(m_crtc_registers.index));
+  std::memcpy(m_graphics_registers.index, registers.graphics_registers.index, sizeof(m_graphics_registers.index));
+  std::memcpy(m_attribute_registers.index, registers.attribute_registers.index, sizeof(m_attribute_registers.index));
+  std::memcpy(m_sequencer_registers.index, registers.sequencer_registers.index, sizeof(m_sequencer_registers.index));
+  m_dac_palette = registers.dac_palette;
+  m_dac_ctrl = registers.dac_ctrl;
+}
+
+void ET4000::Renderer::SetScreenSize(uint32 width, uint32 height)
+{
+  m_screen_size.store((width << 16) | height, std::memory_order_relaxed);
+}
+
+void ET4000::Renderer::DrawFrame(const FrameSnapshot& frame)
+{
+  DebugAssert(frame.num_spans > 0);
+  m_vram = frame.vram.data();
+  m_vram_dirty_bits = &frame.vram_dirty_bits;
+  m_vram_dirty = frame.vram_dirty;
+  m_display_dirty = frame.display_dirty;
+  m_cursor_state = frame.cursor_state;
+
+  // Text modes are drawn in one go, with the registers at the end of the frame.
+  if (!frame.graphics_mode)
+  {
+    if (m_display_dirty || m_vram_dirty)
+    {
+      LoadRegisters(frame.spans[frame.num_spans - 1].registers);
+      RenderTextMode();
+    }
+    else
+    {
+      m_display->RepeatFrame();
+    }
+
+    return;
+  }
+
+  // The first span holds the registers at the start of the frame, which latch the geometry and start address.
+  LoadRegisters(frame.spans[0].registers);
+  BeginGraphicsFrame();
+  if (m_frame.screen_height > 0)
+  {
+    for (uint32 i = 0; i < frame.num_spans; i++)
+    {
+      const FrameSnapshot::Span& span = frame.spans[i];
+      if (i > 0)
+        LoadRegisters(span.registers);
+
+      // Spans end at displayed lines, the framebuffer can have fewer lines than the CRTC displays.
+      const uint32 end_line = std::min(span.end_line, m_frame.display_lines);
+      RenderGraphicsLines((end_line * m_frame.screen_height) / m_frame.display_lines);
+    }
+  }
+
+  // If none of the scanlines changed, present the previous frame again.
+  if (m_frame.lines_rendered > 0)
+    m_display->SwapFramebuffer(true);
+  else
+    m_display->RepeatFrame();
+}
+
+uint32 ET4000::Renderer::CRTCReadVRAMPlanes(uint32 address_counter, uint32 row_scan_counter) const
 {
   uint32 address = CRTCWrapAddress(address_counter, row_scan_counter);
   uint32 vram_offset = (address * 4) & (VRAM_SIZE - 1);
@@ -1077,7 +1463,7 @@ uint32 ET4000::CRTCReadVRAMPlanes(uint32 address_counter, uint32 row_scan_counte
   return all_planes & plane_mask;
 }
 
-uint32 ET4000::CRTCWrapAddress(uint32 address_counter, uint32 row_scan_counter) const
+uint32 ET4000::Renderer::CRTCWrapAddress(uint32 address_counter, uint32 row_scan_counter) const
 {
   uint32 address;
   if (m_crtc_registers.underline_location & 0x40)
@@ -1113,7 +1499,19 @@ uint32 ET4000::CRTCWrapAddress(uint32 address_counter, uint32 row_scan_counter)
   return address;
 }
 
-void ET4000::RenderTextMode()
+bool ET4000::Renderer::IsScanlineDirty(uint32 address_counter, uint32 row_scan_counter, uint32 count) const
+{
+  // Addresses aren't necessarily linear in VRAM (byte/word modes, wrapping), so check each one the CRTC will fetch.
+  for (uint32 i = 0; i < count; i++)
+  {
+    if (IsVRAMDirty(CRTCWrapAddress(address_counter + i, row_scan_counter) * 4))
+      return true;
+  }
+
+  return false;
+}
+
+void ET4000::Renderer::RenderTextMode()
 {
   const uint32 character_height = m_crtc_registers.GetScanlinesPerRow();
   const uint32 character_width = m_sequencer_registers.GetCharacterWidth();
@@ -1132,16 +1530,12 @@ void ET4000::RenderTextMode()
   if (screen_width == 0 || screen_height == 0)
     return;
 
-  if (m_display->GetFramebufferWidth() != screen_width || m_display->GetFramebufferHeight() != screen_height ||
-      m_last_rendered_vertical_frequency != m_timing.vertical_frequency)
+  if (m_display->GetFramebufferWidth() != screen_width || m_display->GetFramebufferHeight() != screen_height)
   {
-    m_system->GetHostInterface()->ReportFormattedMessage("Screen format changed: %ux%u @ %.1f hz", screen_width,
-                                                         screen_height, m_timing.vertical_frequency);
-
-    m_last_rendered_vertical_frequency = m_timing.vertical_frequency;
     m_display->ResizeFramebuffer(screen_width, screen_height);
     m_display->ResizeDisplay();
   }
+  SetScreenSize(screen_width, screen_height);
 
   // preset_row_scan[4:0] contains the starting row scan number, cleared when it hits max.
   // uint32 row_counter = 0;
@@ -1204,6 +1598,10 @@ void ET4000::RenderTextMode()
   //                           (ZeroExtend32(m_crtc_registers.maximum_scan_lines & 0x40) << 3);
   uint32 row_pitch = ZeroExtend32(m_crtc_registers.offset) * 2;
 
+  // The glyphs and cursor are written directly to the framebuffer.
+  DebugAssert(m_display->GetFramebufferFormat() == Display::FramebufferFormat::RGBX8);
+  const uint32 framebuffer_stride = m_display->GetFramebufferStride();
+
   // Cursor setup
   uint32 cursor_address =
     (ZeroExtend32(m_crtc_registers.cursor_location_high) << 8) | (ZeroExtend32(m_crtc_registers.cursor_location_low));
@@ -1268,8 +1666,10 @@ void ET4000::RenderTextMode()
         cursor_end_line = std::min(cursor_end_line, character_height);
         for (uint32 cursor_line = cursor_start_line; cursor_line < cursor_end_line; cursor_line++)
         {
-          for (uint32 i = 0; i < character_width; i++)
-            m_display->SetPixel(col * character_width + i, row * character_height + cursor_line, foreground_color);
+          uint32* cursor_ptr = reinterpret_cast<uint32*>(m_display->GetFramebufferPointer() +
+                                                         (row * character_height + cursor_line) * framebuffer_stride) +
+                               (col * character_width);
+          std::fill_n(cursor_ptr, character_width, foreground_color);
         }
       }
     }
@@ -1278,65 +1678,89 @@ void ET4000::RenderTextMode()
   m_display->SwapFramebuffer();
 }
 
-void ET4000::DrawTextGlyph8(uint32 fb_x, uint32 fb_y, const uint8* glyph, uint32 rows, uint32 fg_color, uint32 bg_color,
-                            int32 dup9)
+void ET4000::Renderer::DrawTextGlyph8(uint32 fb_x, uint32 fb_y, const uint8* glyph, uint32 rows, uint32 fg_color,
+                                      uint32 bg_color, int32 dup9)
 {
-  const uint32 colors[2] = {bg_color, fg_color};
+  const uint32 stride = m_display->GetFramebufferStride();
+  byte* fb_ptr = m_display->GetFramebufferPointer() + (fb_y * stride) + (fb_x * sizeof(uint32));
 
   for (uint32 row = 0; row < rows; row++)
   {
     uint8 source_row = *glyph;
-    m_display->SetPixel(fb_x + 0, fb_y + row, colors[(source_row >> 7) & 1]);
-    m_display->SetPixel(fb_x + 1, fb_y + row, colors[(source_row >> 6) & 1]);
-    m_display->SetPixel(fb_x + 2, fb_y + row, colors[(source_row >> 5) & 1]);
-    m_display->SetPixel(fb_x + 3, fb_y + row, colors[(source_row >> 4) & 1]);
-    m_display->SetPixel(fb_x + 4, fb_y + row, colors[(source_row >> 3) & 1]);
-    m_display->SetPixel(fb_x + 5, fb_y + row, colors[(source_row >> 2) & 1]);
-    m_display->SetPixel(fb_x + 6, fb_y + row, colors[(source_row >> 1) & 1]);
-    m_display->SetPixel(fb_x + 7, fb_y + row, colors[(source_row >> 0) & 1]);
+    uint32* row_ptr = reinterpret_cast<uint32*>(fb_ptr);
+    VGAScanline::ExpandGlyphRow8(row_ptr, source_row, fg_color, bg_color);
 
     if (dup9 == 0)
-      m_display->SetPixel(fb_x + 8, fb_y + row, bg_color);
+      row_ptr[8] = bg_color;
     else if (dup9 > 0)
-      m_display->SetPixel(fb_x + 8, fb_y + row, colors[(source_row >> 0) & 1]);
+      row_ptr[8] = row_ptr[7];
 
     // Have to read the second plane, so offset by 4
     glyph += 4;
+    fb_ptr += stride;
   }
 }
 
-void ET4000::DrawTextGlyph16(uint32 fb_x, uint32 fb_y, const uint8* glyph, uint32 rows, uint32 fg_color,
-                             uint32 bg_color)
+void ET4000::Renderer::DrawTextGlyph16(uint32 fb_x, uint32 fb_y, const uint8* glyph, uint32 rows, uint32 fg_color,
+                                       uint32 bg_color)
 {
-  const uint32 colors[2] = {bg_color, fg_color};
+  const uint32 stride = m_display->GetFramebufferStride();
+  byte* fb_ptr = m_display->GetFramebufferPointer() + (fb_y * stride) + (fb_x * sizeof(uint32));
 
   for (uint32 row = 0; row < rows; row++)
   {
-    uint8 source_row = *glyph;
-    m_display->SetPixel(fb_x + 0, fb_y + row, colors[(source_row >> 7) & 1]);
-    m_display->SetPixel(fb_x + 1, fb_y + row, colors[(source_row >> 7) & 1]);
-    m_display->SetPixel(fb_x + 2, fb_y + row, colors[(source_row >> 6) & 1]);
-    m_display->SetPixel(fb_x + 3, fb_y + row, colors[(source_row >> 6) & 1]);
-    m_display->SetPixel(fb_x + 4, fb_y + row, colors[(source_row >> 5) & 1]);
-    m_display->SetPixel(fb_x + 5, fb_y + row, colors[(source_row >> 5) & 1]);
-    m_display->SetPixel(fb_x + 6, fb_y + row, colors[(source_row >> 4) & 1]);
-    m_display->SetPixel(fb_x + 7, fb_y + row, colors[(source_row >> 4) & 1]);
-    m_display->SetPixel(fb_x + 8, fb_y + row, colors[(source_row >> 3) & 1]);
-    m_display->SetPixel(fb_x + 9, fb_y + row, colors[(source_row >> 3) & 1]);
-    m_display->SetPixel(fb_x + 10, fb_y + row, colors[(source_row >> 2) & 1]);
-    m_display->SetPixel(fb_x + 11, fb_y + row, colors[(source_row >> 2) & 1]);
-    m_display->SetPixel(fb_x + 12, fb_y + row, colors[(source_row >> 1) & 1]);
-    m_display->SetPixel(fb_x + 13, fb_y + row, colors[(source_row >> 1) & 1]);
-    m_display->SetPixel(fb_x + 14, fb_y + row, colors[(source_row >> 0) & 1]);
-    m_display->SetPixel(fb_x + 15, fb_y + row, colors[(source_row >> 0) & 1]);
+    VGAScanline::ExpandGlyphRow16(reinterpret_cast<uint32*>(fb_ptr), *glyph, fg_color, bg_color);
 
     // Have to read the second plane, so offset by 4
     glyph += 4;
+    fb_ptr += stride;
   }
 }
 
-void ET4000::RenderGraphicsMode()
+template<typename Converter>
+void ET4000::Renderer::RenderScanline(uint32* dst, uint32 width, uint32 skip_pixels, uint32 pixel_repeat,
+                                      uint32 pixels_per_fetch, uint32 address_counter, uint32 row_scan_counter,
+                                      const Converter& convert)
 {
+  const uint32 source_pixels = skip_pixels + (width + pixel_repeat - 1) / pixel_repeat;
+  const uint32 fetch_count = (source_pixels + pixels_per_fetch - 1) / pixels_per_fetch;
+  if (m_scanline_fetches.size() < fetch_count)
+    m_scanline_fetches.resize(fetch_count);
+
+  for (uint32 i = 0; i < fetch_count; i++)
+    m_scanline_fetches[i] = CRTCReadVRAMPlanes(address_counter + i, row_scan_counter);
+
+  // Lines which aren't panned or doubled can be converted straight into the framebuffer.
+  if (skip_pixels == 0 && pixel_repeat == 1 && (width % pixels_per_fetch) == 0)
+  {
+    convert(dst, m_scanline_fetches.data(), fetch_count);
+    return;
+  }
+
+  if (m_scanline_pixels.size() < (fetch_count * pixels_per_fetch))
+    m_scanline_pixels.resize(fetch_count * pixels_per_fetch);
+
+  convert(m_scanline_pixels.data(), m_scanline_fetches.data(), fetch_count);
+  const uint32* src = m_scanline_pixels.data() + skip_pixels;
+  if (pixel_repeat == 1)
+  {
+    std::memcpy(dst, src, sizeof(uint32) * width);
+  }
+  else
+  {
+    VGAScanline::DoublePixels(dst, src, width / 2);
+    if (width & 1)
+      dst[width - 1] = src[width / 2];
+  }
+}
+
+void ET4000::Renderer::BeginGraphicsFrame()
+{
+  m_frame.screen_width = 0;
+  m_frame.screen_height = 0;
+  m_frame.next_line = 0;
+  m_frame.lines_rendered = 0;
+
   uint32 screen_width = m_crtc_registers.GetHorizontalDisplayed() * m_sequencer_registers.GetCharacterWidth();
   uint32 screen_height = m_crtc_registers.GetVerticalDisplayed();
   uint32 scanlines_per_row = m_crtc_registers.GetScanlinesPerRow();
@@ -1344,6 +1768,9 @@ void ET4000::RenderGraphicsMode()
   if (screen_width == 0 || screen_height == 0)
     return;
 
+  m_frame.display_lines = screen_height;
+  m_frame.halve_line_compare = false;
+
   // 200-line EGA/VGA modes set scanlines_per_row to 2, creating an effective 400 lines.
   // We can speed things up by only rendering one of these lines, if the only muxes which
   // use the scanline counter are enabled (alternative LA13/14).
@@ -1353,9 +1780,11 @@ void ET4000::RenderGraphicsMode()
   {
     scanlines_per_row = 1;
     screen_height /= 2;
-    line_compare /= 2;
+    m_frame.halve_line_compare = true;
   }
 
+  m_frame.scanlines_per_row = scanlines_per_row;
+
   // Scan doubling, used for CGA modes
   // This causes the row scan counter to increment at half the rate, so when scanlines_per_row = 1,
   // address counter is always divided by two as well (for CGA modes).
@@ -1371,17 +1800,49 @@ void ET4000::RenderGraphicsMode()
     screen_width /= 2;
 
   // Update framebuffer size before drawing to it
-  if (m_display->GetFramebufferWidth() != screen_width || m_display->GetFramebufferHeight() != screen_height ||
-      m_last_rendered_vertical_frequency != m_timing.vertical_frequency)
+  if (m_display->GetFramebufferWidth() != screen_width || m_display->GetFramebufferHeight() != screen_height)
   {
-    m_system->GetHostInterface()->ReportFormattedMessage("Screen format changed: %ux%u @ %.1f hz", screen_width,
-                                                         screen_height, m_timing.vertical_frequency);
-
-    m_last_rendered_vertical_frequency = m_timing.vertical_frequency;
     m_display->ResizeFramebuffer(screen_width, screen_height);
     m_display->ResizeDisplay();
+    m_display_dirty = true;
   }
+  SetScreenSize(screen_width, screen_height);
+
+  m_frame.screen_width = screen_width;
+  m_frame.screen_height = screen_height;
 
+  // Determine the starting address in VRAM of the data from the CRTC registers
+  // This should be multiplied by 4 when accessing because we store interleave all planes.
+  // The start address is latched at the start of the frame, so changing it mid-frame takes effect on the next frame.
+  m_frame.data_base_address = m_crtc_registers.GetStartAddress();
+  m_frame.data_base_address += m_crtc_registers.byte_panning;
+
+  // preset_row_scan[4:0] contains the starting row scan number, cleared when it hits max.
+  m_frame.row_counter = 0;
+  m_frame.row_scan_counter = m_crtc_registers.preset_row_scan;
+  m_frame.line_compare_reached = false;
+}
+
+void ET4000::Renderer::RenderGraphicsLines(uint32 end_line)
+{
+  end_line = std::min(end_line, m_frame.screen_height);
+  if (m_frame.next_line >= end_line)
+    return;
+
+  const uint32 screen_width = m_frame.screen_width;
+
+  // If only VRAM has changed, the backbuffer still holds the previous frame, and we only need to redraw the
+  // scanlines which fetch from dirty VRAM. Each fetch produces at least two pixels, plus some slack for panning.
+  const bool render_all = m_display_dirty;
+  const bool check_vram = m_vram_dirty;
+  const uint32 fetches_per_scanline = screen_width / 2 + 2;
+
+  // Scanlines are converted directly into the framebuffer.
+  DebugAssert(m_display->GetFramebufferFormat() == Display::FramebufferFormat::RGBX8);
+  byte* framebuffer = m_display->GetFramebufferPointer();
+  const uint32 framebuffer_stride = m_display->GetFramebufferStride();
+
+  // Everything below is read from the registers for each span, so that changes between spans are visible.
   // 4 or 16 color mode?
   if (!m_graphics_registers.mode.shift_256)
   {
@@ -1394,24 +1855,24 @@ void ET4000::RenderGraphicsMode()
     SetOutputPalette256();
   }
 
-  // Determine the starting address in VRAM of the data from the CRTC registers
-  // This should be multiplied by 4 when accessing because we store interleave all planes.
-  uint32 data_base_address = m_crtc_registers.GetStartAddress();
-  data_base_address += m_crtc_registers.byte_panning;
+  // Line compare, address resets to zero at this line
+  uint32 line_compare = m_crtc_registers.GetLineCompare();
+  if (m_frame.halve_line_compare)
+    line_compare /= 2;
 
   // Determine the pitch of each line
   uint32 row_pitch = ZeroExtend32(m_crtc_registers.offset) * 2;
 
   uint32 horizontal_pan = m_attribute_registers.horizontal_pixel_panning;
-  if (horizontal_pan >= 8)
+  if (horizontal_pan >= 8 || m_frame.line_compare_reached)
     horizontal_pan = 0;
 
-  // preset_row_scan[4:0] contains the starting row scan number, cleared when it hits max.
-  uint32 row_counter = 0;
-  uint32 row_scan_counter = m_crtc_registers.preset_row_scan;
+  uint32 data_base_address = m_frame.data_base_address;
+  uint32 row_counter = m_frame.row_counter;
+  uint32 row_scan_counter = m_frame.row_scan_counter;
 
   // Draw lines
-  for (uint32 scanline = 0; scanline < screen_height; scanline++)
+  for (uint32 scanline = m_frame.next_line; scanline < end_line; scanline++)
   {
     if (scanline == line_compare)
     {
@@ -1420,176 +1881,81 @@ void ET4000::RenderGraphicsMode()
       row_counter = 0;
       row_scan_counter = 0;
       horizontal_pan = 0;
+      m_frame.line_compare_reached = true;
     }
 
     uint32 address_counter = (data_base_address + (row_pitch * row_counter));
+    const bool scanline_dirty =
+      render_all || (check_vram && IsScanlineDirty(address_counter, row_scan_counter, fetches_per_scanline));
 
-    // High colour modes
-    // This is a hack. The palette should be disabled, and we should read like shift mode?
-    if ((m_dac_ctrl & 0xc0) != 0)
+    if (scanline_dirty)
     {
-      const bool is_16bpp = !!(m_dac_ctrl & 0x40);
-      for (uint32 col = 0; col < screen_width;)
+      uint32* dst = reinterpret_cast<uint32*>(framebuffer + scanline * framebuffer_stride);
+      m_frame.lines_rendered++;
+
+      // High colour modes
+      // This is a hack. The palette should be disabled, and we should read like shift mode?
+      if ((m_dac_ctrl & 0xc0) != 0)
       {
         // Two pixels per dword
-        uint32 all_planes = CRTCReadVRAMPlanes(address_counter++, row_scan_counter);
-        uint32 color1, color2;
-        if (is_16bpp)
+        if (m_dac_ctrl & 0x40)
         {
-          color1 = ConvertBGR565ToRGB24(Truncate16(all_planes));
-          color2 = ConvertBGR565ToRGB24(Truncate16(all_planes >> 16));
+          RenderScanline(dst, screen_width, 0, 1, 2, address_counter, row_scan_counter,
+                         [](uint32* out, const uint32* fetches, uint32 count) {
+                           VGAScanline::ExpandBGR565(out, fetches, count);
+                         });
         }
         else
         {
-          color1 = ConvertBGR555ToRGB24(Truncate16(all_planes));
-          color2 = ConvertBGR555ToRGB24(Truncate16(all_planes >> 16));
+          RenderScanline(dst, screen_width, 0, 1, 2, address_counter, row_scan_counter,
+                         [](uint32* out, const uint32* fetches, uint32 count) {
+                           VGAScanline::ExpandBGR555(out, fetches, count);
+                         });
         }
-
-        m_display->SetPixel(col++, scanline, color1);
-        m_display->SetPixel(col++, scanline, color2);
       }
-    }
-    // 4 or 16 color mode?
-    else if (!m_graphics_registers.mode.shift_256)
-    {
-      if (m_graphics_registers.mode.shift_reg)
+      // 4 or 16 color mode?
+      else if (!m_graphics_registers.mode.shift_256)
       {
-        // CGA mode - Shift register in interleaved mode, odd bits from odd maps and even bits from even maps
-        for (uint32 col = 0; col < screen_width;)
+        if (m_graphics_registers.mode.shift_reg)
         {
-          uint32 all_planes = CRTCReadVRAMPlanes(address_counter, row_scan_counter);
-          address_counter++;
-
-          uint8 pl0 = Truncate8((all_planes >> 0) & 0xFF);
-          uint8 pl1 = Truncate8((all_planes >> 8) & 0xFF);
-          uint8 pl2 = Truncate8((all_planes >> 16) & 0xFF);
-          uint8 pl3 = Truncate8((all_planes >> 24) & 0xFF);
-          uint8 index;
-
-          // One pixel per input pixel
-          index = ((pl0 >> 6) & 3) | (((pl2 >> 6) & 3) << 2);
-          m_display->SetPixel(col++, scanline, m_output_palette[index]);
-          index = ((pl0 >> 4) & 3) | (((pl2 >> 6) & 3) << 2);
-          m_display->SetPixel(col++, scanline, m_output_palette[index]);
-          index = ((pl0 >> 2) & 3) | (((pl2 >> 6) & 3) << 2);
-          m_display->SetPixel(col++, scanline, m_output_palette[index]);
-          index = ((pl0 >> 0) & 3) | (((pl2 >> 6) & 3) << 2);
-          m_display->SetPixel(col++, scanline, m_output_palette[index]);
-
-          index = ((pl1 >> 6) & 3) | (((pl3 >> 6) & 3) << 2);
-          m_display->SetPixel(col++, scanline, m_output_palette[index]);
-          index = ((pl1 >> 4) & 3) | (((pl3 >> 6) & 3) << 2);
-          m_display->SetPixel(col++, scanline, m_output_palette[index]);
-          index = ((pl1 >> 2) & 3) | (((pl3 >> 6) & 3) << 2);
-          m_display->SetPixel(col++, scanline, m_output_palette[index]);
-          index = ((pl1 >> 0) & 3) | (((pl3 >> 6) & 3) << 2);
-          m_display->SetPixel(col++, scanline, m_output_palette[index]);
+          // CGA mode - Shift register in interleaved mode, odd bits from odd maps and even bits from even maps
+          RenderScanline(dst, screen_width, 0, 1, 8, address_counter, row_scan_counter,
+                         [this](uint32* out, const uint32* fetches, uint32 count) {
+                           VGAScanline::ExpandInterleaved4(out, fetches, count, m_output_palette.data());
+                         });
         }
-      }
-      else
-      {
-        // 16 color mode.
-        // Output 8 pixels for one dword
-        for (int32 col = -(int32)horizontal_pan; col < (int32)screen_width;)
-        {
-          uint32 all_planes = CRTCReadVRAMPlanes(address_counter, row_scan_counter);
-          address_counter++;
-
-          uint8 pl0 = Truncate8((all_planes >> 0) & 0xFF);
-          uint8 pl1 = Truncate8((all_planes >> 8) & 0xFF);
-          uint8 pl2 = Truncate8((all_planes >> 16) & 0xFF);
-          uint8 pl3 = Truncate8((all_planes >> 24) & 0xFF);
-
-          uint8 indices[8] = {
-            uint8(((pl0 >> 7) & 1u) | (((pl1 >> 7) & 1u) << 1) | (((pl2 >> 7) & 1u) << 2) | (((pl3 >> 7) & 1u) << 3)),
-            uint8(((pl0 >> 6) & 1u) | (((pl1 >> 6) & 1u) << 1) | (((pl2 >> 6) & 1u) << 2) | (((pl3 >> 6) & 1u) << 3)),
-            uint8(((pl0 >> 5) & 1u) | (((pl1 >> 5) & 1u) << 1) | (((pl2 >> 5) & 1u) << 2) | (((pl3 >> 5) & 1u) << 3)),
-            uint8(((pl0 >> 4) & 1u) | (((pl1 >> 4) & 1u) << 1) | (((pl2 >> 4) & 1u) << 2) | (((pl3 >> 4) & 1u) << 3)),
-            uint8(((pl0 >> 3) & 1u) | (((pl1 >> 3) & 1u) << 1) | (((pl2 >> 3) & 1u) << 2) | (((pl3 >> 3) & 1u) << 3)),
-            uint8(((pl0 >> 2) & 1u) | (((pl1 >> 2) & 1u) << 1) | (((pl2 >> 2) & 1u) << 2) | (((pl3 >> 2) & 1u) << 3)),
-            uint8(((pl0 >> 1) & 1u) | (((pl1 >> 1) & 1u) << 1) | (((pl2 >> 1) & 1u) << 2) | (((pl3 >> 1) & 1u) << 3)),
-            uint8(((pl0 >> 0) & 1u) | (((pl1 >> 0) & 1u) << 1) | (((pl2 >> 0) & 1u) << 2) | (((pl3 >> 0) & 1u) << 3))};
-
-          for (uint32 subindex = 0; col < (int32)screen_width && subindex < 8;)
-          {
-            if (col >= 0 && col < (int32)screen_width)
-              m_display->SetPixel(col, scanline, m_output_palette[indices[subindex]]);
-
-            col++;
-            subindex++;
-          }
-        }
-      }
-    }
-    else
-    {
-      uint32 pan_pixels = (horizontal_pan & 7) / 2;
-
-      // Slow loop with panning part
-      int32 col = -int32(pan_pixels * 2);
-      int32 screen_width_div2 = int32(screen_width);
-      while (col < 0)
-      {
-        uint32 indices = CRTCReadVRAMPlanes(address_counter, row_scan_counter);
-        address_counter++;
-
-        for (uint32 i = 0; i < 4; i++)
+        else
         {
-          uint8 index = Truncate8(indices);
-          uint32 color = m_output_palette[index];
-          indices >>= 8;
-
-          if (col >= 0)
-            m_display->SetPixel(col, scanline, color);
-
-          col++;
+          // 16 color mode.
+          // Output 8 pixels for one dword
+          RenderScanline(dst, screen_width, horizontal_pan, 1, 8, address_counter, row_scan_counter,
+                         [this](uint32* out, const uint32* fetches, uint32 count) {
+                           VGAScanline::ExpandPlanar16(out, fetches, count, m_output_palette.data());
+                         });
         }
       }
-
-      // Fast loop without partial panning
-      while ((col + 4) <= screen_width_div2)
+      else
       {
         // Load 4 pixels, one from each plane
-        // Duplicate horizontally twice, this is the shift_256 stuff
-        uint32 indices = CRTCReadVRAMPlanes(address_counter, row_scan_counter);
-        address_counter++;
-
-        m_display->SetPixel(col++, scanline, m_output_palette[(indices >> 0) & 0xFF]);
-        m_display->SetPixel(col++, scanline, m_output_palette[(indices >> 8) & 0xFF]);
-        m_display->SetPixel(col++, scanline, m_output_palette[(indices >> 16) & 0xFF]);
-        m_display->SetPixel(col++, scanline, m_output_palette[(indices >> 24) & 0xFF]);
-      }
-
-      // Slow loop to handle misaligned buffer when panning
-      while (col < screen_width_div2)
-      {
-        uint32 indices = CRTCReadVRAMPlanes(address_counter, row_scan_counter);
-        address_counter++;
-
-        for (uint32 i = 0; i < 4; i++)
-        {
-          uint8 index = Truncate8(indices);
-          uint32 color = m_output_palette[index];
-          indices >>= 8;
-
-          if (col < screen_width_div2)
-            m_display->SetPixel(col, scanline, color);
-          else
-            break;
-
-          col++;
-        }
+        uint32 pan_pixels = (horizontal_pan & 7) / 2;
+        RenderScanline(dst, screen_width, pan_pixels * 2, 1, 4, address_counter, row_scan_counter,
+                       [this](uint32* out, const uint32* fetches, uint32 count) {
+                         VGAScanline::Expand256(out, fetches, count, m_output_palette.data());
+                       });
       }
     }
 
     row_scan_counter++;
-    if (row_scan_counter == scanlines_per_row)
+    if (row_scan_counter == m_frame.scanlines_per_row)
     {
       row_scan_counter = 0;
       row_counter++;
     }
   }
 
-  m_display->SwapFramebuffer();
+  m_frame.data_base_address = data_base_address;
+  m_frame.row_counter = row_counter;
+  m_frame.row_scan_counter = row_scan_counter;
+  m_frame.next_line = end_line;
 }
 } // namespace HW
\ No newline at end of file
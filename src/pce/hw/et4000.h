@@ -1,12 +1,18 @@
 #pragma once
+#include "YBaseLib/TaskQueue.h"
 #include "common/bitfield.h"
 #include "common/clock.h"
+#include "common/triple_buffer.h"
 #include "pce/component.h"
 #include "pce/system.h"
 #include <array>
+#include <atomic>
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
+
+#define ET4000_USE_RENDER_THREAD 1
 
 class Display;
 class ByteStream;
@@ -45,18 +51,19 @@ public:
 private:
   void ConnectIOPorts();
 
-  uint32 CRTCReadVRAMPlanes(uint32 address_counter, uint32 row_scan_counter) const;
-  uint32 CRTCWrapAddress(uint32 address_counter, uint32 row_scan_counter) const;
-
   void Render();
-  void RenderTextMode();
-  void RenderGraphicsMode();
 
-  void DrawTextGlyph8(uint32 fb_x, uint32 fb_y, const uint8* glyph, uint32 rows, uint32 fg_color, uint32 bg_color,
-                      int32 dup9);
-  void DrawTextGlyph16(uint32 fb_x, uint32 fb_y, const uint8* glyph, uint32 rows, uint32 fg_color, uint32 bg_color);
-
-  // void DrawGraphicsLine
+  // Frames are drawn by the renderer (see below), normally on a separate thread. The registers are captured for each
+  // span of scanlines between register writes which affect the output, so that mid-frame changes (palette, panning,
+  // line compare) are still visible without capturing state at every scanline.
+  void BeginFrame();
+  void FinishFrame();
+  void CloseRenderSpan();
+  void AddRenderSpan(uint32 end_line);
+  void MarkDisplayDirty();
+  void QueueRenderFrame();
+  void RenderPendingFrames();
+  void FlushRenderThread();
 
   std::unique_ptr<Display> m_display;
 
@@ -512,18 +519,37 @@ private:
   uint8 m_vram[VRAM_SIZE];
   MMIO* m_vram_mmio = nullptr;
   bool MapToVRAMOffset(uint32* offset);
+  bool MapToVRAMOffsetRange(uint32* offset, uint32 length);
   void HandleVRAMRead(uint32 offset, uint8* value);
   void HandleVRAMWrite(uint32 offset, uint8 value);
+  void HandleVRAMReadBlock(uint32 offset, uint32 length, void* destination);
+  void HandleVRAMWriteBlock(uint32 offset, uint32 length, const void* source);
   bool IsBIOSAddressMapped(uint32 offset, uint32 size);
   bool LoadBIOSROM();
   void RegisterVRAMMMIO();
 
+  // Dirty tracking, so that unchanged frames and scanlines do not have to be redrawn.
+  // Each bit covers 64 bytes of interleaved VRAM, i.e. 16 character clocks.
+  static constexpr uint32 VRAM_DIRTY_SHIFT = 6;
+  void MarkVRAMDirty(uint32 vram_offset)
+  {
+    const uint32 page = (vram_offset & (VRAM_SIZE - 1)) >> VRAM_DIRTY_SHIFT;
+    m_vram_dirty_bits[page / 64] |= UINT64_C(1) << (page % 64);
+    m_vram_dirty = true;
+  }
+  void MarkVRAMDirtyRange(uint32 vram_offset, uint32 length);
+  void ClearDirtyState();
+  using VRAMDirtyBits = std::array<uint64, (VRAM_SIZE >> VRAM_DIRTY_SHIFT) / 64>;
+  VRAMDirtyBits m_vram_dirty_bits = {};
+  bool m_vram_dirty = false;
+
+  // Set by register writes which change how VRAM is displayed, forces the whole frame to be redrawn.
+  bool m_display_dirty = true;
+
   // latch for vram reads
   uint32 m_latch = 0;
 
-  // palette used when rendering
-  void SetOutputPalette16();
-  void SetOutputPalette256();
+  // Only kept for the save state format, the renderer builds its own output palette.
   std::array<uint32, 256> m_output_palette;
 
   // retrace event
@@ -552,9 +578,140 @@ private:
   };
   ScanoutInfo GetScanoutInfo();
 
-  // We only keep this for stats purposes currently, but it could be extended to when we need to redraw for per-scanline
-  // rendering.
+  // Registers which affect the output, captured for each span of scanlines.
+  struct RenderRegisters
+  {
+    decltype(ET4000::m_crtc_registers) crtc_registers;
+    decltype(ET4000::m_graphics_registers) graphics_registers;
+    decltype(ET4000::m_attribute_registers) attribute_registers;
+    decltype(ET4000::m_sequencer_registers) sequencer_registers;
+    std::array<uint32, 256> dac_palette;
+    uint8 dac_ctrl;
+  };
+  void CaptureRenderRegisters(RenderRegisters* registers) const;
+
+  // Everything the renderer needs to draw a frame. VRAM is copied once per frame, at retrace.
+  struct FrameSnapshot
+  {
+    static constexpr uint32 MAX_SPANS = 32;
+    static constexpr uint32 END_OF_FRAME = 0xFFFFFFFFu;
+
+    struct Span
+    {
+      // Spans end at a displayed line (CRTC scanline, not framebuffer line), exclusive.
+      uint32 end_line;
+      RenderRegisters registers;
+    };
+
+    std::array<Span, MAX_SPANS> spans;
+    uint32 num_spans;
+    bool graphics_mode;
+    bool cursor_state;
+    bool display_dirty;
+    bool vram_dirty;
+    VRAMDirtyBits vram_dirty_bits;
+    std::array<uint8, VRAM_SIZE> vram;
+  };
+
+  // Draws snapshots into the display. Only the render thread touches this once it is running. The register members
+  // share their names with the emulated ones, as the drawing code was written against those.
+  class Renderer
+  {
+  public:
+    void SetDisplay(Display* display) { m_display = display; }
+
+    // Framebuffer size of the last frame drawn, width in the upper 16 bits.
+    uint32 GetScreenSize() const { return m_screen_size.load(std::memory_order_relaxed); }
+
+    void DrawFrame(const FrameSnapshot& frame);
+
+  private:
+    // Progress of the frame currently being drawn.
+    struct FrameState
+    {
+      bool line_compare_reached;
+      bool halve_line_compare;
+      uint32 screen_width;
+      uint32 screen_height;
+      uint32 display_lines;
+      uint32 scanlines_per_row;
+      uint32 data_base_address;
+      uint32 row_counter;
+      uint32 row_scan_counter;
+      uint32 next_line;
+      uint32 lines_rendered;
+    };
+
+    void LoadRegisters(const RenderRegisters& registers);
+
+    uint32 CRTCReadVRAMPlanes(uint32 address_counter, uint32 row_scan_counter) const;
+    uint32 CRTCWrapAddress(uint32 address_counter, uint32 row_scan_counter) const;
+
+    bool IsVRAMDirty(uint32 vram_offset) const
+    {
+      const uint32 page = (vram_offset & (VRAM_SIZE - 1)) >> VRAM_DIRTY_SHIFT;
+      return (((*m_vram_dirty_bits)[page / 64] >> (page % 64)) & 1) != 0;
+    }
+    bool IsScanlineDirty(uint32 address_counter, uint32 row_scan_counter, uint32 count) const;
+
+    void SetOutputPalette16();
+    void SetOutputPalette256();
+    void SetScreenSize(uint32 width, uint32 height);
+
+    void RenderTextMode();
+    void BeginGraphicsFrame();
+    void RenderGraphicsLines(uint32 end_line);
+
+    void DrawTextGlyph8(uint32 fb_x, uint32 fb_y, const uint8* glyph, uint32 rows, uint32 fg_color, uint32 bg_color,
+                        int32 dup9);
+    void DrawTextGlyph16(uint32 fb_x, uint32 fb_y, const uint8* glyph, uint32 rows, uint32 fg_color,
+                         uint32 bg_color);
+
+    // Scratch space for converting a scanline, used when the line can't be converted straight into the framebuffer.
+    template<typename Converter>
+    void RenderScanline(uint32* dst, uint32 width, uint32 skip_pixels, uint32 pixel_repeat, uint32 pixels_per_fetch,
+                        uint32 address_counter, uint32 row_scan_counter, const Converter& convert);
+    std::vector<uint32> m_scanline_fetches;
+    std::vector<uint32> m_scanline_pixels;
+
+    Display* m_display = nullptr;
+
+    decltype(ET4000::m_crtc_registers) m_crtc_registers;
+    decltype(ET4000::m_graphics_registers) m_graphics_registers;
+    decltype(ET4000::m_attribute_registers) m_attribute_registers;
+    decltype(ET4000::m_sequencer_registers) m_sequencer_registers;
+    std::array<uint32, 256> m_dac_palette = {};
+    uint8 m_dac_ctrl = 0;
+    std::array<uint32, 256> m_output_palette = {};
+
+    // Point into the snapshot being drawn.
+    const uint8* m_vram = nullptr;
+    const VRAMDirtyBits* m_vram_dirty_bits = nullptr;
+    bool m_vram_dirty = false;
+    bool m_display_dirty = false;
+    bool m_cursor_state = false;
+
+    FrameState m_frame = {};
+    std::atomic<uint32> m_screen_size{0};
+  };
+
+  // Frames are handed to the render thread through a triple buffer, so neither thread waits on the other. When the
+  // render thread falls behind, unread frames are replaced rather than queued, and their dirty state is carried over.
+  // Each buffer keeps its own copy of VRAM, which is brought up to date with the pages written since it was last used.
+  TripleBuffer<FrameSnapshot> m_render_frames;
+  std::array<VRAMDirtyBits, 3> m_render_stale_vram_bits;
+  bool m_render_merge_dropped_frame = false;
+  bool m_frame_in_progress = false;
+  Renderer m_renderer;
+
+#ifdef ET4000_USE_RENDER_THREAD
+  mutable TaskQueue m_render_thread;
+  std::atomic<bool> m_render_task_queued{false};
+#endif
+
+  // We only keep this for stats purposes currently, the renderer reports the size of the frames it draws.
   float m_last_rendered_vertical_frequency = 0.0f;
+  uint32 m_last_reported_screen_size = 0;
 
   // Cursor state for text modes
   uint8 m_cursor_counter = 0;
@@ -891,7 +891,10 @@ void FDC::ConnectIOPorts(Bus* bus)
     m_dma->ConnectDMAChannel(
       DMA_CHANNEL,
       std::bind(&FDC::DMAReadCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
-      std::bind(&FDC::DMAWriteCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+      std::bind(&FDC::DMAWriteCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+      std::bind(&FDC::DMABlockReadCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+      std::bind(&FDC::DMABlockWriteCallback, this, std::placeholders::_1, std::placeholders::_2,
+                std::placeholders::_3));
   }
 }
 
@@ -1143,6 +1146,19 @@ bool FDC::MoveToNextTransferSector()
 }
 
 void FDC::DMAReadCallback(IOPortDataSize size, uint32* value, uint32 remaining_bytes)
+{
+  uint8 data = 0;
+  DMABlockReadCallback(&data, sizeof(data), remaining_bytes == 0);
+  *value = ZeroExtend32(data);
+}
+
+void FDC::DMAWriteCallback(IOPortDataSize size, uint32 value, uint32 remaining_bytes)
+{
+  const uint8 data = Truncate8(value);
+  DMABlockWriteCallback(&data, sizeof(data), remaining_bytes == 0);
+}
+
+uint32 FDC::DMABlockReadCallback(void* data, uint32 size, bool terminal_count)
 {
   Assert(m_current_transfer.active);
 
@@ -1151,22 +1167,28 @@ void FDC::DMAReadCallback(IOPortDataSize size, uint32* value, uint32 remaining_b
   {
     Log_ErrorPrintf("DMA read with write command");
     EndTransfer(m_current_transfer.drive, ST0_IC_AT, ST1_ND, 0);
-    return;
+    return 0;
   }
 
   if (m_current_transfer.sector_offset == 0)
     ReadCurrentSector(m_current_transfer.drive, m_current_transfer.sector_buffer);
 
-  *value = m_current_transfer.sector_buffer[m_current_transfer.sector_offset];
+  // Blocks stop at the end of the sector, since the request is dropped while the next sector is read. Anything past
+  // the end of the sector buffer reads as zero.
+  const uint32 offset = m_current_transfer.sector_offset;
+  const uint32 count = std::min(size, m_current_transfer.bytes_per_sector - offset);
+  const uint32 count_in_buffer = (offset < SECTOR_SIZE) ? std::min(count, SECTOR_SIZE - offset) : 0;
+  std::memcpy(data, &m_current_transfer.sector_buffer[offset], count_in_buffer);
+  std::memset(static_cast<byte*>(data) + count_in_buffer, 0, count - count_in_buffer);
 
   // Check for early exit of transfer
-  if (remaining_bytes == 0)
+  if (terminal_count && count == size)
   {
     EndTransfer(m_current_transfer.drive, ST0_IC_NT, 0, 0);
-    return;
+    return count;
   }
 
-  m_current_transfer.sector_offset++;
+  m_current_transfer.sector_offset += count;
   if (m_current_transfer.sector_offset >= m_current_transfer.bytes_per_sector)
   {
     m_current_transfer.sector_offset = 0;
@@ -1175,15 +1197,17 @@ void FDC::DMAReadCallback(IOPortDataSize size, uint32* value, uint32 remaining_b
     if (!MoveToNextTransferSector())
     {
       EndTransfer(m_current_transfer.drive, ST0_IC_AT, ST1_EN, 0);
-      return;
+      return count;
     }
 
     // Clear the request flag, while we're reading the next sector. EndCommand() will re-enable it.
     m_dma->SetDMAState(DMA_CHANNEL, false);
   }
+
+  return count;
 }
 
-void FDC::DMAWriteCallback(IOPortDataSize size, uint32 value, uint32 remaining_bytes)
+uint32 FDC::DMABlockWriteCallback(const void* data, uint32 size, bool terminal_count)
 {
   Assert(m_current_transfer.active);
 
@@ -1192,10 +1216,15 @@ void FDC::DMAWriteCallback(IOPortDataSize size, uint32 value, uint32 remaining_b
   {
     Log_ErrorPrintf("DMA write with read command");
     EndTransfer(m_current_transfer.drive, ST0_IC_AT, ST1_ND, 0);
-    return;
+    return 0;
   }
 
-  m_current_transfer.sector_buffer[m_current_transfer.sector_offset++] = Truncate8(value);
+  // Anything past the end of the sector buffer is dropped, as is done when the sector is written.
+  const uint32 offset = m_current_transfer.sector_offset;
+  const uint32 count = std::min(size, m_current_transfer.bytes_per_sector - offset);
+  const uint32 count_in_buffer = (offset < SECTOR_SIZE) ? std::min(count, SECTOR_SIZE - offset) : 0;
+  std::memcpy(&m_current_transfer.sector_buffer[offset], data, count_in_buffer);
+  m_current_transfer.sector_offset += count;
   if (m_current_transfer.sector_offset >= m_current_transfer.bytes_per_sector)
   {
     // Data will be lost if the sector size doesn't match..
@@ -1207,13 +1236,13 @@ void FDC::DMAWriteCallback(IOPortDataSize size, uint32 value, uint32 remaining_b
   }
 
   // Check for early exit of transfer.
-  if (remaining_bytes == 0)
+  if (terminal_count && count == size)
   {
     if (m_current_transfer.sector_offset != 0)
       Log_ErrorPrintf("Incomplete sector DMA transfer, data will be lost");
 
     EndTransfer(m_current_transfer.drive, ST0_IC_NT, 0, 0);
-    return;
+    return count;
   }
 
   // Move to next sector if there's still sectors remaining
@@ -1222,12 +1251,14 @@ void FDC::DMAWriteCallback(IOPortDataSize size, uint32 value, uint32 remaining_b
     if (!MoveToNextTransferSector())
     {
       EndTransfer(m_current_transfer.drive, ST0_IC_AT, ST1_EN, 0);
-      return;
+      return count;
     }
 
     // Clear the request flag, while we're writing the next sector. EndCommand() will re-enable it.
     m_dma->SetDMAState(DMA_CHANNEL, false);
   }
+
+  return count;
 }
 
 uint8 FDC::GetST0(uint32 drive, uint8 bits) const
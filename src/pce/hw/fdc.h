@@ -243,6 +243,8 @@ protected:
   bool MoveToNextTransferSector();
   void DMAReadCallback(IOPortDataSize size, uint32* value, uint32 remaining_bytes);
   void DMAWriteCallback(IOPortDataSize size, uint32 value, uint32 remaining_bytes);
+  uint32 DMABlockReadCallback(void* data, uint32 size, bool terminal_count);
+  uint32 DMABlockWriteCallback(const void* data, uint32 size, bool terminal_count);
 
   // Status code values
   // http://www.threedee.com/jcm/terak/docs/Intel%208272A%20Floppy%20Controller.pdf
@@ -129,7 +129,9 @@ bool i8237_DMA::SaveState(BinaryWriter& writer)
 }
 
 bool i8237_DMA::ConnectDMAChannel(uint32 channel_index, DMAReadCallback&& read_callback,
-                                  DMAWriteCallback&& write_callback)
+                                  DMAWriteCallback&& write_callback,
+                                  DMABlockReadCallback&& block_read_callback /* = {} */,
+                                  DMABlockWriteCallback&& block_write_callback /* = {} */)
 {
   if (channel_index >= NUM_CHANNELS || m_channels[channel_index].read_callback)
     return false;
@@ -137,6 +139,8 @@ bool i8237_DMA::ConnectDMAChannel(uint32 channel_index, DMAReadCallback&& read_c
   Channel* channel = &m_channels[channel_index];
   channel->read_callback = read_callback;
   channel->write_callback = write_callback;
+  channel->block_read_callback = block_read_callback;
+  channel->block_write_callback = block_write_callback;
   return true;
 }
 
@@ -277,6 +281,14 @@ void i8237_DMA::RescheduleTickEvent()
   {
     if (channel.IsActive())
     {
+      if (channel.HasBlockCallbacks())
+      {
+        // Several units can be moved in one callback, so these don't need to be ticked every cycle.
+        downcount =
+          std::min(downcount, std::min(BLOCK_TRANSFER_CYCLES, CycleCount(ZeroExtend32(channel.bytes_remaining) + 1)));
+        continue;
+      }
+
       if (channel.HasCallbacks())
       {
         downcount = 1;
@@ -330,6 +342,12 @@ void i8237_DMA::Transfer(uint32 channel_index, size_t count)
   if (channel->mode == DMAMode_Demand || channel->mode == DMAMode_Block)
     count = size_t(channel->bytes_remaining + 1);
 
+  if (channel->CanTransferBlocks())
+  {
+    TransferBlocks(channel_index, count);
+    return;
+  }
+
   for (size_t i = 0; i < count && channel->request; i++)
   {
     if (use_word_transfers)
@@ -409,6 +427,60 @@ void i8237_DMA::Transfer(uint32 channel_index, size_t count)
   }
 }
 
+void i8237_DMA::TransferBlocks(uint32 channel_index, size_t count)
+{
+  Channel* channel = &m_channels[channel_index];
+  const bool use_word_transfers = (channel_index >= NUM_CHANNELS_PER_CONTROLLER);
+  const uint32 unit_size = use_word_transfers ? 2 : 1;
+
+  while (count > 0 && channel->request)
+  {
+    // Same addressing as Transfer(), the address wraps within the page.
+    const uint32 page_offset =
+      use_word_transfers ? uint32(uint16(channel->address << 1)) : uint32(channel->address);
+    const PhysicalMemoryAddress address = (uint32(channel->page_address) << 16) | page_offset;
+
+    const uint32 units_to_terminal_count = ZeroExtend32(channel->bytes_remaining) + 1;
+    const uint32 units = std::min({static_cast<uint32>(std::min(count, size_t(BLOCK_BUFFER_SIZE / unit_size))),
+                                   (0x10000 - page_offset) / unit_size, units_to_terminal_count});
+    const bool terminal_count = (units == units_to_terminal_count);
+    const uint32 size = units * unit_size;
+
+    uint32 transferred_size;
+    if (channel->transfer_type == DMATransferType_MemoryToDevice)
+    {
+      m_bus->ReadMemoryBlock(address, size, m_block_buffer);
+      transferred_size = channel->block_write_callback(m_block_buffer, size, terminal_count);
+    }
+    else
+    {
+      transferred_size = channel->block_read_callback(m_block_buffer, size, terminal_count);
+      if (channel->transfer_type == DMATransferType_DeviceToMemory)
+        m_bus->WriteMemoryBlock(address, transferred_size, m_block_buffer);
+    }
+
+    const uint32 transferred_units = std::min(transferred_size / unit_size, units);
+    if (transferred_units == 0)
+      break;
+
+    channel->address += Truncate16(transferred_units);
+    count -= transferred_units;
+    if (transferred_units < units_to_terminal_count)
+    {
+      channel->bytes_remaining -= Truncate16(transferred_units);
+      continue;
+    }
+
+    channel->bytes_remaining = 0;
+    channel->transfer_complete = true;
+    if (!channel->auto_reset)
+      break;
+
+    channel->address = channel->start_address;
+    channel->bytes_remaining = channel->count;
+  }
+}
+
 void i8237_DMA::IOReadStartAddress(uint32 channel_index, uint8* value)
 {
   Channel* channel = &m_channels[channel_index];
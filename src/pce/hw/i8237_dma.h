@@ -38,8 +38,9 @@ public:
   bool LoadState(BinaryReader& reader) override;
   bool SaveState(BinaryWriter& writer) override;
 
-  bool ConnectDMAChannel(uint32 channel_index, DMAReadCallback&& read_callback,
-                         DMAWriteCallback&& write_callback) override;
+  bool ConnectDMAChannel(uint32 channel_index, DMAReadCallback&& read_callback, DMAWriteCallback&& write_callback,
+                         DMABlockReadCallback&& block_read_callback = {},
+                         DMABlockWriteCallback&& block_write_callback = {}) override;
   bool GetDMAState(uint32 channel_index) override;
   void SetDMAState(uint32 channel_index, bool request) override;
 
@@ -48,6 +49,10 @@ private:
   static constexpr uint32 NUM_CHANNELS = 8;
   static constexpr uint32 NUM_CHANNELS_PER_CONTROLLER = 4;
 
+  // Channels with block callbacks are ticked at most this many cycles apart, rather than every cycle.
+  static constexpr CycleCount BLOCK_TRANSFER_CYCLES = 32;
+  static constexpr uint32 BLOCK_BUFFER_SIZE = 4096;
+
   struct Channel
   {
     // count refers to the number of bytes in the transfer
@@ -67,8 +72,20 @@ private:
 
     DMAReadCallback read_callback;
     DMAWriteCallback write_callback;
+    DMABlockReadCallback block_read_callback;
+    DMABlockWriteCallback block_write_callback;
 
     bool HasCallbacks() const { return (read_callback || write_callback); }
+    bool HasBlockCallbacks() const { return (block_read_callback || block_write_callback); }
+
+    bool CanTransferBlocks() const
+    {
+      if (decrement)
+        return false;
+
+      return (transfer_type == DMATransferType_MemoryToDevice) ? static_cast<bool>(block_write_callback) :
+                                                                 static_cast<bool>(block_read_callback);
+    }
 
     bool IsActive() const
     {
@@ -87,6 +104,7 @@ private:
   void RescheduleTickEvent();
 
   void Transfer(uint32 channel_index, size_t count);
+  void TransferBlocks(uint32 channel_index, size_t count);
 
   void IOReadStartAddress(uint32 channel_index, uint8* value);
   void IOWriteStartAddress(uint32 channel_index, uint8 value);
@@ -110,6 +128,8 @@ private:
 
   uint8 m_unused_page_registers[9] = {};
 
+  byte m_block_buffer[BLOCK_BUFFER_SIZE];
+
   TimingEvent::Pointer m_tick_event;
   bool m_tick_in_progress = false;
 };
@@ -6,6 +6,7 @@
 #include "YBaseLib/Log.h"
 #include "ata_device.h"
 #include <cinttypes>
+#include <cstring>
 Log_SetChannel(PCIIDE);
 
 // TODO: Implement native mode.
@@ -14,6 +15,7 @@ namespace HW {
 DEFINE_OBJECT_TYPE_INFO(PCIIDE);
 DEFINE_GENERIC_COMPONENT_FACTORY(PCIIDE);
 BEGIN_OBJECT_PROPERTY_MAP(PCIIDE)
+PROPERTY_TABLE_MEMBER_UINT("DMATransferRate", 0, offsetof(PCIIDE, m_dma_transfer_rate), nullptr, 0)
 END_OBJECT_PROPERTY_MAP()
 
 PCIIDE::PCIIDE(const String& identifier, Model model /* = Model::PIIX */,
@@ -408,24 +410,56 @@ u32 PCIIDE::DMATransfer(u32 channel, u32 drive, bool is_write, void* data, u32 s
     Log_DebugPrintf("DMA %s %u bytes at 0x%08X for %u/%u", is_write ? "write" : "read", transfer_size,
                     ds.current_physical_address, channel, drive);
 
-    if (is_write)
-      BaseClass::m_bus->WriteMemoryBlock(ds.current_physical_address, transfer_size, data_ptr);
-    else
-      BaseClass::m_bus->ReadMemoryBlock(ds.current_physical_address, transfer_size, data_ptr);
-
+    TransferPRDTRange(ds.current_physical_address, is_write, data_ptr, transfer_size);
     ds.current_physical_address += transfer_size;
     ds.remaining_byte_count -= transfer_size;
     data_ptr += transfer_size;
     remaining -= transfer_size;
-
-    // TODO: Stall CPU.
   }
 
   if (ds.eot)
     ds.status.bus_dma_mode = false;
 
+  // The bus is held for the whole transfer, rather than for each PRD entry.
+  const u32 transferred = size - remaining;
+  if (m_dma_transfer_rate > 0 && transferred > 0)
+  {
+    BaseClass::m_bus->Stall(
+      static_cast<SimulationTime>((u64(transferred) * SecondsToSimulationTime(1)) / m_dma_transfer_rate));
+  }
+
   UpdateHostInterruptLine(channel);
-  return size - remaining;
+  return transferred;
+}
+
+void PCIIDE::TransferPRDTRange(PhysicalMemoryAddress address, bool is_write, byte* data, u32 size)
+{
+  // PRD ranges are almost always in RAM, so copy directly to or from as many pages at once as possible. Anything
+  // else, e.g. MMIO, goes through the bus.
+  Bus* bus = BaseClass::m_bus;
+  while (size > 0)
+  {
+    u32 span_length;
+    byte* ram_ptr = bus->GetDMARAMPointer(address, size, is_write, &span_length);
+    if (ram_ptr)
+    {
+      if (is_write)
+        std::memcpy(ram_ptr, data, span_length);
+      else
+        std::memcpy(data, ram_ptr, span_length);
+    }
+    else
+    {
+      if (is_write)
+        bus->WriteMemoryBlock(address, span_length, data);
+      else
+        bus->ReadMemoryBlock(address, span_length, data);
+    }
+
+    address += span_length;
+    data += span_length;
+    size -= span_length;
+  }
 }
 
 } // namespace HW
\ No newline at end of file
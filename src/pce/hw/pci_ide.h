@@ -39,6 +39,9 @@ public:
 protected:
   static constexpr u32 INVALID_PRDT_INDEX = 0;
 
+  // Multiword DMA mode 2.
+  static constexpr u32 DEFAULT_DMA_TRANSFER_RATE = 16666666;
+
   struct DMAState
   {
     union CommandRegister
@@ -84,10 +87,14 @@ protected:
 
   void OnDMAStateChanged(u32 channel);
   void ReadNextPRDT(u32 channel);
+  void TransferPRDTRange(PhysicalMemoryAddress address, bool is_write, byte* data, u32 size);
 
   Model m_model;
   DMAState m_dma_state[MAX_CHANNELS];
 
+  // Bytes per second moved by the bus master, the CPU is stalled for the duration of each transfer. Zero disables it.
+  u32 m_dma_transfer_rate = DEFAULT_DMA_TRANSFER_RATE;
+
 private:
   static constexpr u32 SERIALIZATION_ID = Component::MakeSerializationID('P', 'I', 'I', 'X');
 };
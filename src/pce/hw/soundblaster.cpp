@@ -7,6 +7,7 @@
 #include "pce/host_interface.h"
 #include "pce/hw/soundblaster_adpcm.inl"
 #include "pce/interrupt_controller.h"
+#include <cstring>
 Log_SetChannel(HW::SoundBlaster);
 
 // https://courses.engr.illinois.edu/ece390/resources/sound/sbdsp.txt.html
@@ -148,6 +149,10 @@ bool SoundBlaster::Initialize(System* system, Bus* bus)
                                       std::bind(&SoundBlaster::DMAReadCallback, this, std::placeholders::_1,
                                                 std::placeholders::_2, std::placeholders::_3, false),
                                       std::bind(&SoundBlaster::DMAWriteCallback, this, std::placeholders::_1,
+                                                std::placeholders::_2, std::placeholders::_3, false),
+                                      std::bind(&SoundBlaster::DMABlockReadCallback, this, std::placeholders::_1,
+                                                std::placeholders::_2, std::placeholders::_3, false),
+                                      std::bind(&SoundBlaster::DMABlockWriteCallback, this, std::placeholders::_1,
                                                 std::placeholders::_2, std::placeholders::_3, false));
   if (Has16BitDMA())
   {
@@ -155,6 +160,10 @@ bool SoundBlaster::Initialize(System* system, Bus* bus)
                                         std::bind(&SoundBlaster::DMAReadCallback, this, std::placeholders::_1,
                                                   std::placeholders::_2, std::placeholders::_3, true),
                                         std::bind(&SoundBlaster::DMAWriteCallback, this, std::placeholders::_1,
+                                                  std::placeholders::_2, std::placeholders::_3, true),
+                                        std::bind(&SoundBlaster::DMABlockReadCallback, this, std::placeholders::_1,
+                                                  std::placeholders::_2, std::placeholders::_3, true),
+                                        std::bind(&SoundBlaster::DMABlockWriteCallback, this, std::placeholders::_1,
                                                   std::placeholders::_2, std::placeholders::_3, true));
   }
 
@@ -1221,102 +1230,134 @@ void SoundBlaster::StopDMA(bool dma16)
 }
 
 void SoundBlaster::DMAReadCallback(IOPortDataSize size, uint32* value, uint32 remaining_bytes, bool is_16_bit)
+{
+  uint8 data[2] = {};
+  DMABlockReadCallback(data, is_16_bit ? 2 : 1, remaining_bytes == 0, is_16_bit);
+  *value = ZeroExtend32(data[0]) | (ZeroExtend32(data[1]) << 8);
+}
+
+void SoundBlaster::DMAWriteCallback(IOPortDataSize size, uint32 value, uint32 remaining_bytes, bool is_16_bit)
+{
+  const uint8 data[2] = {Truncate8(value), Truncate8(value >> 8)};
+  DMABlockWriteCallback(data, is_16_bit ? 2 : 1, remaining_bytes == 0, is_16_bit);
+}
+
+uint32 SoundBlaster::DMABlockReadCallback(void* data, uint32 size, bool terminal_count, bool is_16_bit)
 {
   DMAState& state = is_16_bit ? m_dma_16_state : m_dma_state;
   if (!state.dma_to_host)
   {
     Log_WarningPrintf("Incorrect DMA direction configured");
-    *value = 0;
-    return;
+    std::memset(data, 0, size);
+    return size;
   }
 
-  uint32 data_size = is_16_bit ? sizeof(uint16) : sizeof(uint8);
-  if (m_adc_state.fifo.size() >= data_size)
+  // Units are moved until the FIFO runs dry or the DMA block ends.
+  const uint32 data_size = is_16_bit ? sizeof(uint16) : sizeof(uint8);
+  byte* data_ptr = static_cast<byte*>(data);
+  uint32 transferred = 0;
+  while ((transferred + data_size) <= size)
   {
-    *value = ZeroExtend32(m_adc_state.fifo.front());
-    m_adc_state.fifo.pop_front();
-    if (is_16_bit)
+    if (m_adc_state.fifo.size() >= data_size)
     {
-      *value |= (ZeroExtend32(m_adc_state.fifo.front()) << 8);
-      m_adc_state.fifo.pop_front();
+      for (uint32 i = 0; i < data_size; i++)
+      {
+        data_ptr[transferred + i] = m_adc_state.fifo.front();
+        m_adc_state.fifo.pop_front();
+      }
     }
-  }
-  else
-  {
-    Log_WarningPrintf("Insufficient data in ADC fifo");
-    m_adc_state.fifo.clear();
-  }
+    else
+    {
+      Log_WarningPrintf("Insufficient data in ADC fifo");
+      m_adc_state.fifo.clear();
+      std::memset(data_ptr + transferred, 0, data_size);
+    }
+    transferred += data_size;
 
-  // End of block?
-  if (data_size >= state.remaining_bytes)
-  {
-    // Apparently we don't raise interrupts for ADC?
-    state.remaining_bytes = 0;
+    // End of block?
+    if (data_size >= state.remaining_bytes)
+    {
+      // Apparently we don't raise interrupts for ADC?
+      state.remaining_bytes = 0;
+
+      // Not autoinit?
+      if (!state.autoinit)
+      {
+        m_adc_state.dma_active = false;
+        StopDMA(is_16_bit);
+        break;
+      }
 
-    // Not autoinit?
-    if (!state.autoinit)
+      // Autoinit
+      state.remaining_bytes = state.length;
+    }
+    else
     {
-      m_adc_state.dma_active = false;
-      StopDMA(is_16_bit);
-      return;
+      state.remaining_bytes -= data_size;
     }
 
-    // Autoinit
-    state.remaining_bytes = state.length;
-  }
-  else
-  {
-    state.remaining_bytes -= data_size;
+    // Update request state if fifo is empty
+    if (m_adc_state.fifo.empty())
+    {
+      SetDMARequest(is_16_bit, false);
+      break;
+    }
   }
 
-  // Update request state if fifo is empty
-  if (m_adc_state.fifo.empty())
-    SetDMARequest(is_16_bit, false);
+  return transferred;
 }
 
-void SoundBlaster::DMAWriteCallback(IOPortDataSize size, uint32 value, uint32 remaining_bytes, bool is_16_bit)
+uint32 SoundBlaster::DMABlockWriteCallback(const void* data, uint32 size, bool terminal_count, bool is_16_bit)
 {
   DMAState& state = is_16_bit ? m_dma_16_state : m_dma_state;
   if (state.dma_to_host)
   {
     Log_WarningPrintf("Incorrect DMA direction configured");
-    return;
+    return size;
   }
 
-  // Append to FIFO
-  m_dac_state.fifo.push_back(Truncate8(value));
-  if (is_16_bit)
-    m_dac_state.fifo.push_back(Truncate8(value >> 8));
-
-  // End of block?
-  uint32 data_size = is_16_bit ? sizeof(uint16) : sizeof(uint8);
-  if (data_size >= state.remaining_bytes)
+  // Units are moved until the FIFO fills or the DMA block ends.
+  const uint32 data_size = is_16_bit ? sizeof(uint16) : sizeof(uint8);
+  const byte* data_ptr = static_cast<const byte*>(data);
+  uint32 transferred = 0;
+  while ((transferred + data_size) <= size)
   {
-    state.remaining_bytes = 0;
-    RaiseInterrupt(is_16_bit);
+    // Append to FIFO
+    m_dac_state.fifo.insert(m_dac_state.fifo.end(), data_ptr + transferred, data_ptr + transferred + data_size);
+    transferred += data_size;
+
+    // End of block?
+    if (data_size >= state.remaining_bytes)
+    {
+      state.remaining_bytes = 0;
+      RaiseInterrupt(is_16_bit);
 
-    // Not autoinit?
-    if (!state.autoinit)
+      // Not autoinit?
+      if (!state.autoinit)
+      {
+        m_dac_state.dma_active = false;
+        StopDMA(is_16_bit);
+        break;
+      }
+
+      // Autoinit
+      state.remaining_bytes = state.length;
+    }
+    else
     {
-      m_dac_state.dma_active = false;
-      StopDMA(is_16_bit);
-      return;
+      state.remaining_bytes -= data_size;
     }
 
-    // Autoinit
-    state.remaining_bytes = state.length;
-  }
-  else
-  {
-    state.remaining_bytes -= data_size;
+    // FIFO full?
+    if (IsDACFIFOFull())
+    {
+      // Set DMA to inactive until we need a new byte
+      SetDMARequest(is_16_bit, false);
+      break;
+    }
   }
 
-  // FIFO full?
-  if (IsDACFIFOFull())
-  {
-    // Set DMA to inactive until we need a new byte
-    SetDMARequest(is_16_bit, false);
-  }
+  return transferred;
 }
 
 uint8 SoundBlaster::ReadMixerIndexPort()
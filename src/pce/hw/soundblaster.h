@@ -269,6 +269,8 @@ private:
 
   void DMAReadCallback(IOPortDataSize size, uint32* value, uint32 remaining_bytes, bool is_16_bit);
   void DMAWriteCallback(IOPortDataSize size, uint32 value, uint32 remaining_bytes, bool is_16_bit);
+  uint32 DMABlockReadCallback(void* data, uint32 size, bool terminal_count, bool is_16_bit);
+  uint32 DMABlockWriteCallback(const void* data, uint32 size, bool terminal_count, bool is_16_bit);
 
   struct MixerState
   {
@@ -7,8 +7,10 @@
 #include "common/display.h"
 #include "pce/bus.h"
 #include "pce/host_interface.h"
+#include "pce/hw/vga_scanline.h"
 #include "pce/mmio.h"
 #include "pce/system.h"
+#include <algorithm>
 Log_SetChannel(HW::VGA);
 
 namespace HW {
@@ -26,6 +28,9 @@ VGA::VGA(const String& identifier, const ObjectTypeInfo* type_info /* = &s_type_
 
 VGA::~VGA()
 {
+#ifdef VGA_USE_RENDER_THREAD
+  m_render_thread.ExitWorkers();
+#endif
   SAFE_RELEASE(m_vram_mmio);
 }
 
@@ -39,6 +44,7 @@ bool VGA::Initialize(System* system, Bus* bus)
   if (!m_display)
     return false;
 
+  m_renderer.SetDisplay(m_display.get());
   m_display->SetDisplayAspectRatio(4, 3);
 
   m_clock.SetManager(system->GetTimingManager());
@@ -51,6 +57,15 @@ bool VGA::Initialize(System* system, Bus* bus)
 
   // Retrace event will be scheduled after timing is calculated.
   m_retrace_event = m_clock.NewEvent("Retrace", 1, std::bind(&VGA::Render, this), false);
+
+  // Every buffer's copy of VRAM starts out of date.
+  for (VRAMDirtyBits& bits : m_render_stale_vram_bits)
+    bits.fill(~UINT64_C(0));
+
+#ifdef VGA_USE_RENDER_THREAD
+  m_render_thread.Initialize(TaskQueue::DefaultQueueSize, 1);
+#endif
+
   return true;
 }
 
@@ -117,6 +132,8 @@ void VGA::Reset()
 
   m_cursor_counter = 0;
   m_cursor_state = false;
+  m_display_dirty = true;
+  m_frame_in_progress = false;
 
   RecalculateEventTiming();
   m_retrace_event->Reset();
@@ -153,6 +170,9 @@ bool VGA::LoadState(BinaryReader& reader)
   reader.SafeReadBool(&m_cursor_state);
 
   // Force re-render after loading state
+  MarkVRAMDirtyRange(0, VRAM_SIZE);
+  m_display_dirty = true;
+  m_frame_in_progress = false;
   RecalculateEventTiming();
   Render();
 
@@ -265,15 +285,191 @@ void VGA::Render()
   {
     m_cursor_counter = 0;
     m_cursor_state ^= true;
+
+    // The cursor and blinking attributes are only drawn in text modes.
+    if (!m_graphics_registers.misc.text_mode_disable)
+      m_display_dirty = true;
   }
 
   if (!m_display->IsActive())
+  {
+    // Redraw everything once the display is shown again.
+    m_frame_in_progress = false;
+    m_display_dirty = true;
     return;
+  }
+
+  // Finish off the frame which has just been scanned out, and start the next one. If there is no frame in progress,
+  // because the display was off or state was just loaded, the whole frame is drawn from the current state.
+  if (!m_frame_in_progress)
+    BeginFrame();
+
+  FinishFrame();
+  BeginFrame();
+
+  // The renderer only reports the size of the frames it draws, messages are sent from the emulation thread.
+  const uint32 screen_size = m_renderer.GetScreenSize();
+  if (screen_size != 0 && (screen_size != m_last_reported_screen_size ||
+                           m_last_rendered_vertical_frequency != m_timing.vertical_frequency))
+  {
+    m_system->GetHostInterface()->ReportFormattedMessage("Screen format changed: %ux%u @ %.1f hz", screen_size >> 16,
+                                                         screen_size & 0xFFFF, m_timing.vertical_frequency);
+
+    m_last_reported_screen_size = screen_size;
+    m_last_rendered_vertical_frequency = m_timing.vertical_frequency;
+  }
+}
+
+void VGA::BeginFrame()
+{
+  // The write buffer can still hold the dirty state of a dropped frame, which is merged in FinishFrame().
+  FrameSnapshot& frame = m_render_frames.GetWriteBuffer();
+  frame.num_spans = 0;
+  frame.graphics_mode = m_graphics_registers.misc.text_mode_disable;
+  m_frame_in_progress = true;
+}
+
+void VGA::FinishFrame()
+{
+  FrameSnapshot& frame = m_render_frames.GetWriteBuffer();
+
+  // The last span runs to the end of the frame. Text modes are drawn whole, so they only have this span.
+  AddRenderSpan(FrameSnapshot::END_OF_FRAME);
+  frame.cursor_state = m_cursor_state;
 
-  if (m_graphics_registers.misc.text_mode_disable)
-    RenderGraphicsMode();
+  if (m_render_merge_dropped_frame)
+  {
+    frame.display_dirty |= m_display_dirty;
+    frame.vram_dirty |= m_vram_dirty;
+    for (size_t i = 0; i < frame.vram_dirty_bits.size(); i++)
+      frame.vram_dirty_bits[i] |= m_vram_dirty_bits[i];
+  }
   else
-    RenderTextMode();
+  {
+    frame.display_dirty = m_display_dirty;
+    frame.vram_dirty = m_vram_dirty;
+    frame.vram_dirty_bits = m_vram_dirty_bits;
+  }
+
+  // Pages written this frame are out of date in every buffer's copy of VRAM. Bring this buffer's copy up to date.
+  if (m_vram_dirty)
+  {
+    for (VRAMDirtyBits& stale_bits : m_render_stale_vram_bits)
+    {
+      for (size_t i = 0; i < stale_bits.size(); i++)
+        stale_bits[i] |= m_vram_dirty_bits[i];
+    }
+  }
+
+  VRAMDirtyBits& stale_bits = m_render_stale_vram_bits[m_render_frames.GetWriteIndex()];
+  constexpr uint32 num_pages = VRAM_SIZE >> VRAM_DIRTY_SHIFT;
+  uint32 page = 0;
+  while (page < num_pages)
+  {
+    if (stale_bits[page / 64] == 0)
+    {
+      page = (page | 63) + 1;
+      continue;
+    }
+
+    if (((stale_bits[page / 64] >> (page % 64)) & 1) == 0)
+    {
+      page++;
+      continue;
+    }
+
+    // Copy runs of stale pages in one go.
+    uint32 end_page = page + 1;
+    while (end_page < num_pages && ((stale_bits[end_page / 64] >> (end_page % 64)) & 1) != 0)
+      end_page++;
+
+    const uint32 offset = page << VRAM_DIRTY_SHIFT;
+    std::memcpy(&frame.vram[offset], &m_vram[offset], (end_page - page) << VRAM_DIRTY_SHIFT);
+    page = end_page;
+  }
+  stale_bits.fill(0);
+
+  ClearDirtyState();
+  m_frame_in_progress = false;
+
+  // If the render thread never picked up the previous frame, its buffer comes back with that frame still in it.
+  m_render_merge_dropped_frame = !m_render_frames.Publish();
+  QueueRenderFrame();
+}
+
+void VGA::CloseRenderSpan()
+{
+  // Text modes are drawn with the registers at the end of the frame.
+  if (!m_frame_in_progress || !m_render_frames.GetWriteBuffer().graphics_mode)
+    return;
+
+  // Scanlines above the beam have been displayed with the current register values. In horizontal blank, the current
+  // line is complete as well.
+  const ScanoutInfo si = GetScanoutInfo();
+  if (si.in_vertical_blank)
+    AddRenderSpan(FrameSnapshot::END_OF_FRAME);
+  else
+    AddRenderSpan(si.current_line + BoolToUInt32(si.in_horizontal_blank));
+}
+
+void VGA::AddRenderSpan(uint32 end_line)
+{
+  FrameSnapshot& frame = m_render_frames.GetWriteBuffer();
+  const uint32 start_line = (frame.num_spans > 0) ? frame.spans[frame.num_spans - 1].end_line : 0;
+  if (end_line <= start_line)
+    return;
+
+  // With too many changes in one frame, the last span is extended and drawn with the most recent registers.
+  if (frame.num_spans == FrameSnapshot::MAX_SPANS)
+    frame.num_spans--;
+
+  FrameSnapshot::Span& span = frame.spans[frame.num_spans++];
+  span.end_line = end_line;
+  CaptureRenderRegisters(&span.registers);
+}
+
+void VGA::MarkDisplayDirty()
+{
+  CloseRenderSpan();
+  m_display_dirty = true;
+}
+
+void VGA::CaptureRenderRegisters(RenderRegisters* registers) const
+{
+  // BitField deletes copy assignment, so the register unions are copied through their index arrays.
+  std::memcpy(registers->crtc_registers.index, m_crtc_registers.index, sizeof(m_crtc_registers.index));
+  std::memcpy(registers->graphics_registers.index, m_graphics_registers.index, sizeof(m_graphics_registers.index));
+  std::memcpy(registers->attribute_registers.index, m_attribute_registers.index, sizeof(m_attribute_registers.index));
+  std::memcpy(registers->sequencer_registers.index, m_sequencer_registers.index, sizeof(m_sequencer_registers.index));
+  registers->dac_palette = m_dac_palette;
+}
+
+void VGA::QueueRenderFrame()
+{
+#ifdef VGA_USE_RENDER_THREAD
+  // A queued task draws every frame published before it runs, so there is never more than one in the queue.
+  if (!m_render_task_queued.exchange(true))
+    m_render_thread.QueueLambdaTask([this]() { RenderPendingFrames(); });
+#else
+  RenderPendingFrames();
+#endif
+}
+
+void VGA::RenderPendingFrames()
+{
+#ifdef VGA_USE_RENDER_THREAD
+  m_render_task_queued.store(false);
+#endif
+
+  while (m_render_frames.Acquire())
+    m_renderer.DrawFrame(m_render_frames.GetReadBuffer());
+}
+
+void VGA::FlushRenderThread()
+{
+#ifdef VGA_USE_RENDER_THREAD
+  m_render_thread.QueueBlockingLambdaTask([]() {});
+#endif
 }
 
 void VGA::IOReadStatusRegister1(uint8* value)
@@ -312,6 +508,7 @@ void VGA::IOCRTCDataRegisterRead(uint8* value)
 
 void VGA::IOCRTCDataRegisterWrite(uint8 value)
 {
+  MarkDisplayDirty();
   if (m_crtc_index_register >= countof(m_crtc_registers.index))
   {
     Log_ErrorPrintf("Out-of-range CRTC register write: %u", uint32(m_crtc_index_register));
@@ -345,6 +542,7 @@ void VGA::IOGraphicsDataRegisterRead(uint8* value)
 
 void VGA::IOGraphicsDataRegisterWrite(uint8 value)
 {
+  MarkDisplayDirty();
   static const uint8_t gr_mask[16] = {
     0x0f, /* 0x00 */
     0x0f, /* 0x01 */
@@ -378,6 +576,7 @@ void VGA::IOGraphicsDataRegisterWrite(uint8 value)
 
 void VGA::IOMiscOutputRegisterWrite(uint8 value)
 {
+  MarkDisplayDirty();
   Log_TracePrintf("Misc output register write: 0x%02X", uint32(value));
   m_misc_output_register.bits = value;
   RecalculateEventTiming();
@@ -406,6 +605,7 @@ void VGA::IOAttributeDataRead(uint8* value)
 
 void VGA::IOAttributeAddressDataWrite(uint8 value)
 {
+  MarkDisplayDirty();
   if (!m_crtc_registers.attribute_register_flipflop)
   {
     bool video_enable = !!(value & 0x20);
@@ -462,6 +662,7 @@ void VGA::IOSequencerDataRegisterRead(uint8* value)
 
 void VGA::IOSequencerDataRegisterWrite(uint8 value)
 {
+  MarkDisplayDirty();
   /* force some bits to zero */
   const uint8_t sr_mask[8] = {
     0x03, 0x3d, 0x0f, 0x3f, 0x0e, 0x00, 0x00, 0xff,
@@ -512,6 +713,7 @@ void VGA::IODACDataRegisterRead(uint8* value)
 
 void VGA::IODACDataRegisterWrite(uint8 value)
 {
+  MarkDisplayDirty();
   Log_TracePrintf("DAC palette write %u/%u: %u", uint32(m_dac_write_address), uint32(m_dac_color_index), uint32(value));
 
   // Mask away higher bits
@@ -678,6 +880,7 @@ void VGA::HandleVRAMWrite(uint32 offset, uint8 value)
       offset = ((offset & ~uint32(3)) * 4) | ZeroExtend32(plane);
       DebugAssert(offset < VRAM_SIZE);
       m_vram[offset] = value;
+      MarkVRAMDirty(offset);
     }
   }
   else if (!m_sequencer_registers.sequencer_memory_mode.odd_even_host_memory)
@@ -689,6 +892,7 @@ void VGA::HandleVRAMWrite(uint32 offset, uint8 value)
       offset = ((offset & ~uint32(1)) * 4) | ZeroExtend32(plane);
       DebugAssert(offset < VRAM_SIZE);
       m_vram[offset] = value;
+      MarkVRAMDirty(offset);
     }
   }
   else
@@ -773,7 +977,162 @@ void VGA::HandleVRAMWrite(uint32 offset, uint8 value)
     std::memcpy(&current_value, &m_vram[offset * 4], sizeof(current_value));
     all_planes_value = (all_planes_value & write_mask) | (current_value & ~write_mask);
     std::memcpy(&m_vram[offset * 4], &all_planes_value, sizeof(current_value));
+    MarkVRAMDirty(offset * 4);
+  }
+}
+
+bool VGA::MapToVRAMOffsetRange(uint32* offset, uint32 length)
+{
+  // The windows are contiguous, so if both ends map with the same distance between them, the whole range does.
+  uint32 start = *offset;
+  uint32 end = *offset + length - 1;
+  if (!MapToVRAMOffset(&start) || !MapToVRAMOffset(&end) || (end - start) != (length - 1))
+    return false;
+
+  *offset = start;
+  return true;
+}
+
+void VGA::HandleVRAMReadBlock(uint32 offset, uint32 length, void* destination)
+{
+  uint8* destination_ptr = static_cast<uint8*>(destination);
+  uint32 vram_offset = offset;
+  if (length == 0)
+    return;
+
+  if (!MapToVRAMOffsetRange(&vram_offset, length))
+  {
+    // Partially out of the window, take the slow path.
+    for (uint32 i = 0; i < length; i++)
+      HandleVRAMRead(offset + i, &destination_ptr[i]);
+    return;
+  }
+
+  uint32 last_latch_address;
+  if (m_sequencer_registers.sequencer_memory_mode.chain_4_enable)
+  {
+    // Chain4 - each group of four bytes is the same address in all four planes.
+    for (uint32 i = 0; i < length; i++)
+    {
+      const uint32 address = vram_offset + i;
+      destination_ptr[i] = m_vram[(((address & ~uint32(3)) << 2) & (VRAM_SIZE - 1)) | (address & 3)];
+    }
+
+    last_latch_address = (((vram_offset + length - 1) & ~uint32(3)) << 2) & (VRAM_SIZE - 1);
+  }
+  else if (m_graphics_registers.mode.read_mode == 0 && !m_graphics_registers.mode.host_odd_even)
+  {
+    // Planar, read mode 0 - a single plane is returned.
+    const uint32 read_plane = m_graphics_registers.read_map_select & 3;
+    for (uint32 i = 0; i < length; i++)
+      destination_ptr[i] = m_vram[(((vram_offset + i) << 2) & (VRAM_SIZE - 1)) | read_plane];
+
+    last_latch_address = ((vram_offset + length - 1) << 2) & (VRAM_SIZE - 1);
   }
+  else
+  {
+    for (uint32 i = 0; i < length; i++)
+      HandleVRAMRead(offset + i, &destination_ptr[i]);
+    return;
+  }
+
+  // The latches hold the value of the last read.
+  std::memcpy(&m_latch, &m_vram[last_latch_address], sizeof(m_latch));
+}
+
+void VGA::HandleVRAMWriteBlock(uint32 offset, uint32 length, const void* source)
+{
+  const uint8* source_ptr = static_cast<const uint8*>(source);
+  uint32 vram_offset = offset;
+  if (length == 0)
+    return;
+
+  if (!MapToVRAMOffsetRange(&vram_offset, length))
+  {
+    for (uint32 i = 0; i < length; i++)
+      HandleVRAMWrite(offset + i, source_ptr[i]);
+    return;
+  }
+
+  // Both chained and planar addresses span four bytes of interleaved VRAM.
+  MarkVRAMDirtyRange(vram_offset * 4, length * 4);
+
+  const uint8 plane_write_enable = m_sequencer_registers.memory_plane_write_enable & 0xF;
+  if (m_sequencer_registers.sequencer_memory_mode.chain_4_enable)
+  {
+    if (plane_write_enable == 0xF)
+    {
+      // All planes enabled, so each aligned group of four bytes is a single store.
+      for (uint32 i = 0; i < length; i++)
+      {
+        const uint32 address = vram_offset + i;
+        if ((address & 3) == 0 && (i + 4) <= length)
+        {
+          std::memcpy(&m_vram[(address << 2) & (VRAM_SIZE - 1)], &source_ptr[i], 4);
+          i += 3;
+          continue;
+        }
+
+        m_vram[(((address & ~uint32(3)) << 2) & (VRAM_SIZE - 1)) | (address & 3)] = source_ptr[i];
+      }
+      return;
+    }
+
+    for (uint32 i = 0; i < length; i++)
+    {
+      const uint32 address = vram_offset + i;
+      if (plane_write_enable & (1 << (address & 3)))
+        m_vram[(((address & ~uint32(3)) << 2) & (VRAM_SIZE - 1)) | (address & 3)] = source_ptr[i];
+    }
+    return;
+  }
+
+  if (m_sequencer_registers.sequencer_memory_mode.odd_even_host_memory)
+  {
+    // Planar - only handle the common cases of host data or latches being written through unmodified here.
+    const bool passthrough = (m_graphics_registers.mode.write_mode == 0 && m_graphics_registers.rotate_count == 0 &&
+                              (m_graphics_registers.enable_set_reset & 0xF) == 0 &&
+                              m_graphics_registers.logic_op == 0 && m_graphics_registers.bit_mask == 0xFF);
+    if (passthrough || m_graphics_registers.mode.write_mode == 1)
+    {
+      const uint32 write_mask = mask16[plane_write_enable];
+      for (uint32 i = 0; i < length; i++)
+      {
+        const uint32 all_planes_value = passthrough ? VGAExpandMask(source_ptr[i]) : m_latch;
+        uint8* vram_ptr = &m_vram[((vram_offset + i) << 2) & (VRAM_SIZE - 1)];
+        uint32 current_value;
+        std::memcpy(&current_value, vram_ptr, sizeof(current_value));
+        current_value = (all_planes_value & write_mask) | (current_value & ~write_mask);
+        std::memcpy(vram_ptr, &current_value, sizeof(current_value));
+      }
+      return;
+    }
+  }
+
+  for (uint32 i = 0; i < length; i++)
+    HandleVRAMWrite(offset + i, source_ptr[i]);
+}
+
+void VGA::MarkVRAMDirtyRange(uint32 vram_offset, uint32 length)
+{
+  if (length == 0)
+    return;
+
+  const uint32 first_page = vram_offset >> VRAM_DIRTY_SHIFT;
+  const uint32 last_page = (vram_offset + length - 1) >> VRAM_DIRTY_SHIFT;
+  for (uint32 page = first_page; page <= last_page; page++)
+    MarkVRAMDirty(page << VRAM_DIRTY_SHIFT);
+}
+
+void VGA::ClearDirtyState()
+{
+  if (m_vram_dirty)
+  {
+    m_vram_dirty_bits.fill(0);
+    m_vram_dirty = false;
+  }
+
+  m_display_dirty = false;
 }
 
 void VGA::RegisterVRAMMMIO()
@@ -812,6 +1171,12 @@ void VGA::RegisterVRAMMMIO()
   handlers.write_byte = std::bind(write_byte_handler, 0, std::placeholders::_1, std::placeholders::_2);
   handlers.write_word = std::bind(write_word_handler, 0, std::placeholders::_1, std::placeholders::_2);
   handlers.write_dword = std::bind(write_dword_handler, 0, std::placeholders::_1, std::placeholders::_2);
+  handlers.read_block = [this](uint32 offset, uint32 length, void* destination) {
+    HandleVRAMReadBlock(offset, length, destination);
+  };
+  handlers.write_block = [this](uint32 offset, uint32 length, const void* source) {
+    HandleVRAMWriteBlock(offset, length, source);
+  };
 
   // Map the entire range (0xA0000 - 0xCFFFF), then throw the writes out in the handler.
   m_vram_mmio = MMIO::CreateComplex(0xA0000, 0x20000, std::move(handlers));
@@ -831,10 +1196,11 @@ inline uint32 Convert6BitColorTo8Bit(uint32 color)
   g = (g << 2) | (g >> 4);
   b = (b << 2) | (b >> 4);
 
-  return (color & 0xFF000000) | ZeroExtend32(r) | (ZeroExtend32(g) << 8) | (ZeroExtend32(b) << 16);
+  // The scanline converters write the palette straight to the framebuffer, so the alpha channel has to be set.
+  return UINT32_C(0xFF000000) | ZeroExtend32(r) | (ZeroExtend32(g) << 8) | (ZeroExtend32(b) << 16);
 }
 
-void VGA::SetOutputPalette16()
+void VGA::Renderer::SetOutputPalette16()
 {
   for (uint32 i = 0; i < 16; i++)
   {
@@ -850,7 +1216,7 @@ void VGA::SetOutputPalette16()
   }
 }
 
-void VGA::SetOutputPalette256()
+void VGA::Renderer::SetOutputPalette256()
 {
   for (uint32 i = 0; i < 256; i++)
   {
@@ -922,8 +1288,11 @@ void VGA::RecalculateEventTiming()
     Log_DebugPrintf("VGA: Horizontal frequency: %.4f kHz, vertical frequency: %.4f hz out of range.",
                     horizontal_frequency / 1000.0, vertical_frequency);
 
-    // Clear the screen
+    // Clear the screen, once the render thread is done with the display.
+    FlushRenderThread();
     m_display->ClearFramebuffer();
+    m_display_dirty = true;
+    m_frame_in_progress = false;
 
     // And prevent it from refreshing
     if (m_retrace_event->IsActive())
@@ -932,7 +1301,7 @@ void VGA::RecalculateEventTiming()
     return;
   }
 
-  // TODO: Per-scanline rendering
+  // Graphics modes are drawn in spans as registers change, the retrace event only finishes off each frame.
   if (m_timing.vertical_frequency != m_retrace_event->GetInterval())
     m_retrace_event->SetFrequency(m_timing.vertical_frequency);
   if (!m_retrace_event->IsActive())
@@ -973,7 +1342,70 @@ VGA::ScanoutInfo VGA::GetScanoutInfo()
   return si;
 }
 
-uint32 VGA::CRTCReadVRAMPlanes(uint32 address_counter, uint32 row_scan_counter) const
+void VGA::Renderer::LoadRegisters(const RenderRegisters& registers)
+{
+  std::memcpy(m_crtc_registers.index, registers.crtc_registers.index, sizeof(m_crtc_registers.index));
+  std::memcpy(m_graphics_registers.index, registers.graphics_registers.index, sizeof(m_graphics_registers.index));
+  std::memcpy(m_attribute_registers.index, registers.attribute_registers.index, sizeof(m_attribute_registers.index));
+  std::memcpy(m_sequencer_registers.index, registers.sequencer_registers.index, sizeof(m_sequencer_registers.index));
+  m_dac_palette = registers.dac_palette;
+}
+
+void VGA::Renderer::SetScreenSize(uint32 width, uint32 height)
+{
+  m_screen_size.store((width << 16) | height, std::memory_order_relaxed);
+}
+
+void VGA::Renderer::DrawFrame(const FrameSnapshot& frame)
+{
+  DebugAssert(frame.num_spans > 0);
+  m_vram = frame.vram.data();
+  m_vram_dirty_bits = &frame.vram_dirty_bits;
+  m_vram_dirty = frame.vram_dirty;
+  m_display_dirty = frame.display_dirty;
+  m_cursor_state = frame.cursor_state;
+
+  // Text modes are drawn in one go, with the registers at the end of the frame.
+  if (!frame.graphics_mode)
+  {
+    if (m_display_dirty || m_vram_dirty)
+    {
+      LoadRegisters(frame.spans[frame.num_spans - 1].registers);
+      RenderTextMode();
+    }
+    else
+    {
+      m_display->RepeatFrame();
+    }
+
+    return;
+  }
+
+  // The first span holds the registers at the start of the frame, which latch the geometry and start address.
+  LoadRegisters(frame.spans[0].registers);
+  BeginGraphicsFrame();
+  if (m_frame.screen_height > 0)
+  {
+    for (uint32 i = 0; i < frame.num_spans; i++)
+    {
+      const FrameSnapshot::Span& span = frame.spans[i];
+      if (i > 0)
+        LoadRegisters(span.registers);
+
+      // Spans end at displayed lines, the framebuffer can have fewer lines than the CRTC displays.
+      const uint32 end_line = std::min(span.end_line, m_frame.display_lines);
+      RenderGraphicsLines((end_line * m_frame.screen_height) / m_frame.display_lines);
+    }
+  }
+
+  // If none of the scanlines changed, present the previous frame again.
+  if (m_frame.lines_rendered > 0)
+    m_display->SwapFramebuffer(true);
+  else
+    m_display->RepeatFrame();
+}
+
+uint32 VGA::Renderer::CRTCReadVRAMPlanes(uint32 address_counter, uint32 row_scan_counter) const
 {
   uint32 address = CRTCWrapAddress(address_counter, row_scan_counter);
   uint32 vram_offset = address * 4;
@@ -985,7 +1417,7 @@ uint32 VGA::CRTCReadVRAMPlanes(uint32 address_counter, uint32 row_scan_counter)
   return all_planes & plane_mask;
 }
 
-uint32 VGA::CRTCWrapAddress(uint32 address_counter, uint32 row_scan_counter) const
+uint32 VGA::Renderer::CRTCWrapAddress(uint32 address_counter, uint32 row_scan_counter) const
 {
   uint32 address;
   if (m_crtc_registers.underline_location & 0x40)
@@ -1020,7 +1452,19 @@ uint32 VGA::CRTCWrapAddress(uint32 address_counter, uint32 row_scan_counter) con
   return address;
 }
 
-void VGA::RenderTextMode()
+bool VGA::Renderer::IsScanlineDirty(uint32 address_counter, uint32 row_scan_counter, uint32 count) const
+{
+  // Addresses aren't necessarily linear in VRAM (byte/word modes, wrapping), so check each one the CRTC will fetch.
+  for (uint32 i = 0; i < count; i++)
+  {
+    if (IsVRAMDirty(CRTCWrapAddress(address_counter + i, row_scan_counter) * 4))
+      return true;
+  }
+
+  return false;
+}
+
+void VGA::Renderer::RenderTextMode()
 {
   uint32 character_height = (m_crtc_registers.maximum_scan_lines & 0x1F) + 1;
   uint32 character_width = 8;
@@ -1048,16 +1492,12 @@ void VGA::RenderTextMode()
   if (screen_width == 0 || screen_height == 0)
     return;
 
-  if (m_display->GetFramebufferWidth() != screen_width || m_display->GetFramebufferHeight() != screen_height ||
-      m_last_rendered_vertical_frequency != m_timing.vertical_frequency)
+  if (m_display->GetFramebufferWidth() != screen_width || m_display->GetFramebufferHeight() != screen_height)
   {
-    m_system->GetHostInterface()->ReportFormattedMessage("Screen format changed: %ux%u @ %.1f hz", screen_width,
-                                                         screen_height, m_timing.vertical_frequency);
-
-    m_last_rendered_vertical_frequency = m_timing.vertical_frequency;
     m_display->ResizeFramebuffer(screen_width, screen_height);
     m_display->ResizeDisplay();
   }
+  SetScreenSize(screen_width, screen_height);
 
   // preset_row_scan[4:0] contains the starting row scan number, cleared when it hits max.
   // uint32 row_counter = 0;
@@ -1120,6 +1560,10 @@ void VGA::RenderTextMode()
   //                           (ZeroExtend32(m_crtc_registers.maximum_scan_lines & 0x40) << 3);
   uint32 row_pitch = ZeroExtend32(m_crtc_registers.offset) * 2;
 
+  // The glyphs and cursor are written directly to the framebuffer.
+  DebugAssert(m_display->GetFramebufferFormat() == Display::FramebufferFormat::RGBX8);
+  const uint32 framebuffer_stride = m_display->GetFramebufferStride();
+
   // Cursor setup
   uint32 cursor_address =
     (ZeroExtend32(m_crtc_registers.cursor_location_high) << 8) | (ZeroExtend32(m_crtc_registers.cursor_location_low));
@@ -1184,8 +1628,10 @@ void VGA::RenderTextMode()
         cursor_end_line = std::min(cursor_end_line, character_height);
         for (uint32 cursor_line = cursor_start_line; cursor_line < cursor_end_line; cursor_line++)
         {
-          for (uint32 i = 0; i < character_width; i++)
-            m_display->SetPixel(col * character_width + i, row * character_height + cursor_line, foreground_color);
+          uint32* cursor_ptr = reinterpret_cast<uint32*>(m_display->GetFramebufferPointer() +
+                                                         (row * character_height + cursor_line) * framebuffer_stride) +
+                               (col * character_width);
+          std::fill_n(cursor_ptr, character_width, foreground_color);
         }
       }
     }
@@ -1194,59 +1640,79 @@ void VGA::RenderTextMode()
   m_display->SwapFramebuffer();
 }
 
-void VGA::DrawTextGlyph8(uint32 fb_x, uint32 fb_y, const uint8* glyph, uint32 rows, uint32 fg_color, uint32 bg_color,
-                         int32 dup9)
+void VGA::Renderer::DrawTextGlyph8(uint32 fb_x, uint32 fb_y, const uint8* glyph, uint32 rows, uint32 fg_color,
+                                   uint32 bg_color, int32 dup9)
 {
-  const uint32 colors[2] = {bg_color, fg_color};
+  const uint32 stride = m_display->GetFramebufferStride();
+  byte* fb_ptr = m_display->GetFramebufferPointer() + (fb_y * stride) + (fb_x * sizeof(uint32));
 
   for (uint32 row = 0; row < rows; row++)
   {
     uint8 source_row = *glyph;
-    m_display->SetPixel(fb_x + 0, fb_y + row, colors[(source_row >> 7) & 1]);
-    m_display->SetPixel(fb_x + 1, fb_y + row, colors[(source_row >> 6) & 1]);
-    m_display->SetPixel(fb_x + 2, fb_y + row, colors[(source_row >> 5) & 1]);
-    m_display->SetPixel(fb_x + 3, fb_y + row, colors[(source_row >> 4) & 1]);
-    m_display->SetPixel(fb_x + 4, fb_y + row, colors[(source_row >> 3) & 1]);
-    m_display->SetPixel(fb_x + 5, fb_y + row, colors[(source_row >> 2) & 1]);
-    m_display->SetPixel(fb_x + 6, fb_y + row, colors[(source_row >> 1) & 1]);
-    m_display->SetPixel(fb_x + 7, fb_y + row, colors[(source_row >> 0) & 1]);
+    uint32* row_ptr = reinterpret_cast<uint32*>(fb_ptr);
+    VGAScanline::ExpandGlyphRow8(row_ptr, source_row, fg_color, bg_color);
 
     if (dup9 == 0)
-      m_display->SetPixel(fb_x + 8, fb_y + row, bg_color);
+      row_ptr[8] = bg_color;
     else if (dup9 > 0)
-      m_display->SetPixel(fb_x + 8, fb_y + row, colors[(source_row >> 0) & 1]);
+      row_ptr[8] = row_ptr[7];
 
     // Have to read the second plane, so offset by 4
     glyph += 4;
+    fb_ptr += stride;
   }
 }
 
-void VGA::DrawTextGlyph16(uint32 fb_x, uint32 fb_y, const uint8* glyph, uint32 rows, uint32 fg_color, uint32 bg_color)
+void VGA::Renderer::DrawTextGlyph16(uint32 fb_x, uint32 fb_y, const uint8* glyph, uint32 rows, uint32 fg_color,
+                                    uint32 bg_color)
 {
-  const uint32 colors[2] = {bg_color, fg_color};
+  const uint32 stride = m_display->GetFramebufferStride();
+  byte* fb_ptr = m_display->GetFramebufferPointer() + (fb_y * stride) + (fb_x * sizeof(uint32));
 
   for (uint32 row = 0; row < rows; row++)
   {
-    uint8 source_row = *glyph;
-    m_display->SetPixel(fb_x + 0, fb_y + row, colors[(source_row >> 7) & 1]);
-    m_display->SetPixel(fb_x + 1, fb_y + row, colors[(source_row >> 7) & 1]);
-    m_display->SetPixel(fb_x + 2, fb_y + row, colors[(source_row >> 6) & 1]);
-    m_display->SetPixel(fb_x + 3, fb_y + row, colors[(source_row >> 6) & 1]);
-    m_display->SetPixel(fb_x + 4, fb_y + row, colors[(source_row >> 5) & 1]);
-    m_display->SetPixel(fb_x + 5, fb_y + row, colors[(source_row >> 5) & 1]);
-    m_display->SetPixel(fb_x + 6, fb_y + row, colors[(source_row >> 4) & 1]);
-    m_display->SetPixel(fb_x + 7, fb_y + row, colors[(source_row >> 4) & 1]);
-    m_display->SetPixel(fb_x + 8, fb_y + row, colors[(source_row >> 3) & 1]);
-    m_display->SetPixel(fb_x + 9, fb_y + row, colors[(source_row >> 3) & 1]);
-    m_display->SetPixel(fb_x + 10, fb_y + row, colors[(source_row >> 2) & 1]);
-    m_display->SetPixel(fb_x + 11, fb_y + row, colors[(source_row >> 2) & 1]);
-    m_display->SetPixel(fb_x + 12, fb_y + row, colors[(source_row >> 1) & 1]);
-    m_display->SetPixel(fb_x + 13, fb_y + row, colors[(source_row >> 1) & 1]);
-    m_display->SetPixel(fb_x + 14, fb_y + row, colors[(source_row >> 0) & 1]);
-    m_display->SetPixel(fb_x + 15, fb_y + row, colors[(source_row >> 0) & 1]);
+    VGAScanline::ExpandGlyphRow16(reinterpret_cast<uint32*>(fb_ptr), *glyph, fg_color, bg_color);
 
     // Have to read the second plane, so offset by 4
     glyph += 4;
+    fb_ptr += stride;
+  }
+}
+
+template<typename Converter>
+void VGA::Renderer::RenderScanline(uint32* dst, uint32 width, uint32 skip_pixels, uint32 pixel_repeat,
+                                   uint32 pixels_per_fetch, uint32 address_counter, uint32 row_scan_counter,
+                                   const Converter& convert)
+{
+  const uint32 source_pixels = skip_pixels + (width + pixel_repeat - 1) / pixel_repeat;
+  const uint32 fetch_count = (source_pixels + pixels_per_fetch - 1) / pixels_per_fetch;
+  if (m_scanline_fetches.size() < fetch_count)
+    m_scanline_fetches.resize(fetch_count);
+
+  for (uint32 i = 0; i < fetch_count; i++)
+    m_scanline_fetches[i] = CRTCReadVRAMPlanes(address_counter + i, row_scan_counter);
+
+  // Lines which aren't panned or doubled can be converted straight into the framebuffer.
+  if (skip_pixels == 0 && pixel_repeat == 1 && (width % pixels_per_fetch) == 0)
+  {
+    convert(dst, m_scanline_fetches.data(), fetch_count);
+    return;
+  }
+
+  if (m_scanline_pixels.size() < (fetch_count * pixels_per_fetch))
+    m_scanline_pixels.resize(fetch_count * pixels_per_fetch);
+
+  convert(m_scanline_pixels.data(), m_scanline_fetches.data(), fetch_count);
+  const uint32* src = m_scanline_pixels.data() + skip_pixels;
+  if (pixel_repeat == 1)
+  {
+    std::memcpy(dst, src, sizeof(uint32) * width);
+  }
+  else
+  {
+    VGAScanline::DoublePixels(dst, src, width / 2);
+    if (width & 1)
+      dst[width - 1] = src[width / 2];
   }
 }
 
@@ -1254,8 +1720,13 @@ void VGA::DrawTextGlyph16(uint32 fb_x, uint32 fb_y, const uint8* glyph, uint32 r
 
 // https://ia801809.us.archive.org/11/items/bitsavers_ibmpccardseferenceManualMay92_1756350/IBM_VGA_XGA_Technical_Reference_Manual_May92.pdf
 
-void VGA::RenderGraphicsMode()
+void VGA::Renderer::BeginGraphicsFrame()
 {
+  m_frame.screen_width = 0;
+  m_frame.screen_height = 0;
+  m_frame.next_line = 0;
+  m_frame.lines_rendered = 0;
+
   uint32 screen_width = (uint32(m_crtc_registers.end_horizontal_display) + 1) * 8;
   uint32 screen_height =
     (m_crtc_registers.vertical_display_end | (uint32(m_crtc_registers.overflow_register & 0x02) << 7) |
@@ -1266,44 +1737,79 @@ void VGA::RenderGraphicsMode()
 
   // Horizontal resolution must always be divisible by 8, this is an assumption made by the line rendering code.
   Assert((screen_width % 8) == 0);
+  m_frame.display_lines = screen_height;
 
   // Maximum scan line determines the number of scanlines per row of bytes
-  uint32 scanlines_per_row = ZeroExtend32(m_crtc_registers.maximum_scan_lines & 0x1F) + 1;
+  m_frame.scanlines_per_row = ZeroExtend32(m_crtc_registers.maximum_scan_lines & 0x1F) + 1;
 
   // Scan doubling, used for CGA modes
   // This causes the row scan counter to increment at half the rate, so when scanlines_per_row = 1,
   // address counter is always divided by two as well (for CGA modes).
-  bool double_scan = !!(m_crtc_registers.maximum_scan_lines & 0x80);
+  m_frame.double_scan = !!(m_crtc_registers.maximum_scan_lines & 0x80);
 
 #ifdef FAST_VGA_RENDER
   // We can skip rendering the doubled scanlines by dividing the height by 2.
-  if (double_scan)
+  if (m_frame.double_scan)
     screen_height /= 2;
   if (m_graphics_registers.mode.shift_256)
     screen_width /= 2;
 #endif
 
   // Non-divided clock multiplies by 2
-  uint32 pixels_per_col = 1;
+  m_frame.pixels_per_col = 1;
   if (!m_graphics_registers.mode.shift_256 && m_sequencer_registers.clocking_mode.dot_clock_rate)
   {
-    pixels_per_col = 2;
+    m_frame.pixels_per_col = 2;
     screen_width *= 2;
   }
   // attribute register used here too
 
   // Update framebuffer size before drawing to it
-  if (m_display->GetFramebufferWidth() != screen_width || m_display->GetFramebufferHeight() != screen_height ||
-      m_last_rendered_vertical_frequency != m_timing.vertical_frequency)
+  if (m_display->GetFramebufferWidth() != screen_width || m_display->GetFramebufferHeight() != screen_height)
   {
-    m_system->GetHostInterface()->ReportFormattedMessage("Screen format changed: %ux%u @ %.1f hz", screen_width,
-                                                         screen_height, m_timing.vertical_frequency);
-
-    m_last_rendered_vertical_frequency = m_timing.vertical_frequency;
     m_display->ResizeFramebuffer(screen_width, screen_height);
     m_display->ResizeDisplay();
+    m_display_dirty = true;
   }
+  SetScreenSize(screen_width, screen_height);
+
+  m_frame.screen_width = screen_width;
+  m_frame.screen_height = screen_height;
+
+  // Determine the starting address in VRAM of the data from the CRTC registers
+  // This should be multiplied by 4 when accessing because we store interleave all planes.
+  // The start address is latched at the start of the frame, so changing it mid-frame takes effect on the next frame.
+  m_frame.data_base_address =
+    (ZeroExtend32(m_crtc_registers.start_address_high) << 8) | (ZeroExtend32(m_crtc_registers.start_address_low));
+  m_frame.data_base_address += (m_crtc_registers.preset_row_scan >> 5) & 0x03;
+
+  // preset_row_scan[4:0] contains the starting row scan number, cleared when it hits max.
+  m_frame.row_counter = 0;
+  m_frame.row_scan_counter = ZeroExtend32(m_crtc_registers.preset_row_scan & 0x1F);
+  m_frame.line_compare_reached = false;
+}
+
+void VGA::Renderer::RenderGraphicsLines(uint32 end_line)
+{
+  end_line = std::min(end_line, m_frame.screen_height);
+  if (m_frame.next_line >= end_line)
+    return;
 
+  const uint32 screen_width = m_frame.screen_width;
+  const uint32 pixels_per_col = m_frame.pixels_per_col;
+
+  // If only VRAM has changed, the backbuffer still holds the previous frame, and we only need to redraw the
+  // scanlines which fetch from dirty VRAM. Each fetch produces at least four pixels, plus some slack for panning.
+  const bool render_all = m_display_dirty;
+  const bool check_vram = m_vram_dirty;
+  const uint32 fetches_per_scanline = screen_width / 4 + 2;
+
+  // Scanlines are converted directly into the framebuffer.
+  DebugAssert(m_display->GetFramebufferFormat() == Display::FramebufferFormat::RGBX8);
+  byte* framebuffer = m_display->GetFramebufferPointer();
+  const uint32 framebuffer_stride = m_display->GetFramebufferStride();
+
+  // Everything below is read from the registers for each span, so that changes between spans are visible.
   // 4 or 16 color mode?
   if (!m_graphics_registers.mode.shift_256)
   {
@@ -1316,12 +1822,6 @@ void VGA::RenderGraphicsMode()
     SetOutputPalette256();
   }
 
-  // Determine the starting address in VRAM of the data from the CRTC registers
-  // This should be multiplied by 4 when accessing because we store interleave all planes.
-  uint32 data_base_address =
-    (ZeroExtend32(m_crtc_registers.start_address_high) << 8) | (ZeroExtend32(m_crtc_registers.start_address_low));
-  data_base_address += (m_crtc_registers.preset_row_scan >> 5) & 0x03;
-
   // Line compare, address resets to zero at this line
   uint32 line_compare = (ZeroExtend32(m_crtc_registers.line_compare)) |
                         (ZeroExtend32(m_crtc_registers.overflow_register & 0x10) << 4) |
@@ -1335,16 +1835,16 @@ void VGA::RenderGraphicsMode()
   // data_width /= 2;
 
   uint32 horizontal_pan = m_attribute_registers.horizontal_pixel_panning;
-  if (horizontal_pan >= 8)
+  if (horizontal_pan >= 8 || m_frame.line_compare_reached)
     horizontal_pan = 0;
   horizontal_pan *= pixels_per_col;
 
-  // preset_row_scan[4:0] contains the starting row scan number, cleared when it hits max.
-  uint32 row_counter = 0;
-  uint32 row_scan_counter = ZeroExtend32(m_crtc_registers.preset_row_scan & 0x1F);
+  uint32 data_base_address = m_frame.data_base_address;
+  uint32 row_counter = m_frame.row_counter;
+  uint32 row_scan_counter = m_frame.row_scan_counter;
 
   // Draw lines
-  for (uint32 scanline = 0; scanline < screen_height; scanline++)
+  for (uint32 scanline = m_frame.next_line; scanline < end_line; scanline++)
   {
     if (scanline == line_compare)
     {
@@ -1353,226 +1853,63 @@ void VGA::RenderGraphicsMode()
       row_counter = 0;
       row_scan_counter = 0;
       horizontal_pan = 0;
+      m_frame.line_compare_reached = true;
     }
 
     uint32 address_counter = (data_base_address + (row_pitch * row_counter));
+    const bool scanline_dirty =
+      render_all || (check_vram && IsScanlineDirty(address_counter, row_scan_counter, fetches_per_scanline));
 
-    // 4 or 16 color mode?
-    if (!m_graphics_registers.mode.shift_256)
+    if (scanline_dirty)
     {
-      if (m_graphics_registers.mode.shift_reg)
-      {
-        // CGA mode - Shift register in interleaved mode, odd bits from odd maps and even bits from even maps
-        for (uint32 col = 0; col < screen_width;)
-        {
-          uint32 all_planes = CRTCReadVRAMPlanes(address_counter, row_scan_counter);
-          address_counter++;
-
-          uint8 pl0 = Truncate8((all_planes >> 0) & 0xFF);
-          uint8 pl1 = Truncate8((all_planes >> 8) & 0xFF);
-          uint8 pl2 = Truncate8((all_planes >> 16) & 0xFF);
-          uint8 pl3 = Truncate8((all_planes >> 24) & 0xFF);
-          uint8 index;
-
-          // Low-resolution graphics, 2 bits per pixel
-          if (!m_sequencer_registers.clocking_mode.dot_clock_rate)
-          {
-            // One pixel per input pixel
-            index = ((pl0 >> 6) & 3) | (((pl2 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            index = ((pl0 >> 4) & 3) | (((pl2 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            index = ((pl0 >> 2) & 3) | (((pl2 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            index = ((pl0 >> 0) & 3) | (((pl2 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-
-            index = ((pl1 >> 6) & 3) | (((pl3 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            index = ((pl1 >> 4) & 3) | (((pl3 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            index = ((pl1 >> 2) & 3) | (((pl3 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            index = ((pl1 >> 0) & 3) | (((pl3 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-          }
-          else
-          {
-            // Two pixels per input pixel
-            index = ((pl0 >> 6) & 3) | (((pl2 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            index = ((pl0 >> 4) & 3) | (((pl2 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            index = ((pl0 >> 2) & 3) | (((pl2 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            index = ((pl0 >> 0) & 3) | (((pl2 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-
-            index = ((pl1 >> 6) & 3) | (((pl3 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            index = ((pl1 >> 4) & 3) | (((pl3 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            index = ((pl1 >> 2) & 3) | (((pl3 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            index = ((pl1 >> 0) & 3) | (((pl3 >> 6) & 3) << 2);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-            m_display->SetPixel(col++, scanline, m_output_palette[index]);
-          }
-        }
-      }
-      else
+      uint32* dst = reinterpret_cast<uint32*>(framebuffer + scanline * framebuffer_stride);
+      m_frame.lines_rendered++;
+
+      // 4 or 16 color mode?
+      if (!m_graphics_registers.mode.shift_256)
       {
-        // 16 color mode.
-        // Output 8 pixels for one dword
-        for (int32 col = -(int32)horizontal_pan; col < (int32)screen_width;)
+        if (m_graphics_registers.mode.shift_reg)
         {
-          uint32 all_planes = CRTCReadVRAMPlanes(address_counter, row_scan_counter);
-          address_counter++;
-
-          uint8 pl0 = Truncate8((all_planes >> 0) & 0xFF);
-          uint8 pl1 = Truncate8((all_planes >> 8) & 0xFF);
-          uint8 pl2 = Truncate8((all_planes >> 16) & 0xFF);
-          uint8 pl3 = Truncate8((all_planes >> 24) & 0xFF);
-
-          uint8 indices[8] = {
-            uint8(((pl0 >> 7) & 1u) | (((pl1 >> 7) & 1u) << 1) | (((pl2 >> 7) & 1u) << 2) | (((pl3 >> 7) & 1u) << 3)),
-            uint8(((pl0 >> 6) & 1u) | (((pl1 >> 6) & 1u) << 1) | (((pl2 >> 6) & 1u) << 2) | (((pl3 >> 6) & 1u) << 3)),
-            uint8(((pl0 >> 5) & 1u) | (((pl1 >> 5) & 1u) << 1) | (((pl2 >> 5) & 1u) << 2) | (((pl3 >> 5) & 1u) << 3)),
-            uint8(((pl0 >> 4) & 1u) | (((pl1 >> 4) & 1u) << 1) | (((pl2 >> 4) & 1u) << 2) | (((pl3 >> 4) & 1u) << 3)),
-            uint8(((pl0 >> 3) & 1u) | (((pl1 >> 3) & 1u) << 1) | (((pl2 >> 3) & 1u) << 2) | (((pl3 >> 3) & 1u) << 3)),
-            uint8(((pl0 >> 2) & 1u) | (((pl1 >> 2) & 1u) << 1) | (((pl2 >> 2) & 1u) << 2) | (((pl3 >> 2) & 1u) << 3)),
-            uint8(((pl0 >> 1) & 1u) | (((pl1 >> 1) & 1u) << 1) | (((pl2 >> 1) & 1u) << 2) | (((pl3 >> 1) & 1u) << 3)),
-            uint8(((pl0 >> 0) & 1u) | (((pl1 >> 0) & 1u) << 1) | (((pl2 >> 0) & 1u) << 2) | (((pl3 >> 0) & 1u) << 3))};
-
-          for (uint32 subcol = 0, subindex = 0; col < (int32)screen_width && subindex < 8;)
-          {
-            if (col >= 0 && col < (int32)screen_width)
-              m_display->SetPixel(col, scanline, m_output_palette[indices[subindex]]);
-
-            col++;
-            subcol++;
-            if (subcol == pixels_per_col)
-            {
-              subindex++;
-              subcol = 0;
-            }
-          }
+          // CGA mode - Shift register in interleaved mode, odd bits from odd maps and even bits from even maps
+          // Low-resolution graphics outputs two pixels per input pixel.
+          const uint32 pixel_repeat = m_sequencer_registers.clocking_mode.dot_clock_rate ? 2 : 1;
+          RenderScanline(dst, screen_width, 0, pixel_repeat, 8, address_counter, row_scan_counter,
+                         [this](uint32* out, const uint32* fetches, uint32 count) {
+                           VGAScanline::ExpandInterleaved4(out, fetches, count, m_output_palette.data());
+                         });
         }
-      }
-    }
-    else
-    {
-      uint32 pan_pixels = (horizontal_pan & 7) / 2;
-
-      // Slow loop with panning part
-#ifdef FAST_VGA_RENDER
-      int32 col = -int32(pan_pixels * 2);
-      int32 screen_width_div2 = int32(screen_width);
-#else
-      int32 col = -int32(pan_pixels);
-      int32 screen_width_div2 = int32(screen_width / 2);
-#endif
-      while (col < 0)
-      {
-        uint32 indices = CRTCReadVRAMPlanes(address_counter, row_scan_counter);
-        address_counter++;
-
-        for (uint32 i = 0; i < 4; i++)
+        else
         {
-          uint8 index = Truncate8(indices);
-          uint32 color = m_output_palette[index];
-          indices >>= 8;
-
-          if (col >= 0)
-          {
-#ifdef FAST_VGA_RENDER
-            m_display->SetPixel(col, scanline, color);
-#else
-            m_display->SetPixel(col * 2 + 0, scanline, color);
-            m_display->SetPixel(col * 2 + 1, scanline, color);
-#endif
-          }
-
-          col++;
+          // 16 color mode.
+          // Output 8 pixels for one dword
+          RenderScanline(dst, screen_width, horizontal_pan / pixels_per_col, pixels_per_col, 8, address_counter,
+                         row_scan_counter, [this](uint32* out, const uint32* fetches, uint32 count) {
+                           VGAScanline::ExpandPlanar16(out, fetches, count, m_output_palette.data());
+                         });
         }
       }
-
-      // Fast loop without partial panning
-      while ((col + 4) <= screen_width_div2)
+      else
       {
         // Load 4 pixels, one from each plane
         // Duplicate horizontally twice, this is the shift_256 stuff
-        uint32 indices = CRTCReadVRAMPlanes(address_counter, row_scan_counter);
-        address_counter++;
-
-#ifdef FAST_VGA_RENDER
-        m_display->SetPixel(col++, scanline, m_output_palette[(indices >> 0) & 0xFF]);
-        m_display->SetPixel(col++, scanline, m_output_palette[(indices >> 8) & 0xFF]);
-        m_display->SetPixel(col++, scanline, m_output_palette[(indices >> 16) & 0xFF]);
-        m_display->SetPixel(col++, scanline, m_output_palette[(indices >> 24) & 0xFF]);
-#else
-        m_display->SetPixel(col * 2 + 0, scanline, m_output_palette[(indices >> 0) & 0xFF]);
-        m_display->SetPixel(col * 2 + 1, scanline, m_output_palette[(indices >> 0) & 0xFF]);
-        col++;
-
-        m_display->SetPixel(col * 2 + 0, scanline, m_output_palette[(indices >> 8) & 0xFF]);
-        m_display->SetPixel(col * 2 + 1, scanline, m_output_palette[(indices >> 8) & 0xFF]);
-        col++;
-
-        m_display->SetPixel(col * 2 + 0, scanline, m_output_palette[(indices >> 16) & 0xFF]);
-        m_display->SetPixel(col * 2 + 1, scanline, m_output_palette[(indices >> 16) & 0xFF]);
-        col++;
-
-        m_display->SetPixel(col * 2 + 0, scanline, m_output_palette[(indices >> 24) & 0xFF]);
-        m_display->SetPixel(col * 2 + 1, scanline, m_output_palette[(indices >> 24) & 0xFF]);
-        col++;
-#endif
-      }
-
-      // Slow loop to handle misaligned buffer when panning
-      while (col < screen_width_div2)
-      {
-        uint32 indices = CRTCReadVRAMPlanes(address_counter, row_scan_counter);
-        address_counter++;
-
-        for (uint32 i = 0; i < 4; i++)
-        {
-          uint8 index = Truncate8(indices);
-          uint32 color = m_output_palette[index];
-          indices >>= 8;
-
-          if (col < screen_width_div2)
-          {
+        uint32 pan_pixels = (horizontal_pan & 7) / 2;
+        const auto expand_256 = [this](uint32* out, const uint32* fetches, uint32 count) {
+          VGAScanline::Expand256(out, fetches, count, m_output_palette.data());
+        };
 #ifdef FAST_VGA_RENDER
-            m_display->SetPixel(col, scanline, color);
+        RenderScanline(dst, screen_width, pan_pixels * 2, 1, 4, address_counter, row_scan_counter, expand_256);
 #else
-            m_display->SetPixel(col * 2 + 0, scanline, color);
-            m_display->SetPixel(col * 2 + 1, scanline, color);
+        RenderScanline(dst, screen_width, pan_pixels, 2, 4, address_counter, row_scan_counter, expand_256);
 #endif
-          }
-          else
-          {
-            break;
-          }
-
-          col++;
-        }
       }
     }
 
 #ifndef FAST_VGA_RENDER
-    if (!double_scan || (scanline & 1) != 0)
+    if (!m_frame.double_scan || (scanline & 1) != 0)
 #endif
     {
       row_scan_counter++;
-      if (row_scan_counter == scanlines_per_row)
+      if (row_scan_counter == m_frame.scanlines_per_row)
       {
         row_scan_counter = 0;
         row_counter++;
@@ -1580,6 +1917,9 @@ void VGA::RenderGraphicsMode()
     }
   }
 
-  m_display->SwapFramebuffer();
+  m_frame.data_base_address = data_base_address;
+  m_frame.row_counter = row_counter;
+  m_frame.row_scan_counter = row_scan_counter;
+  m_frame.next_line = end_line;
 }
 } // namespace HW
\ No newline at end of file
@@ -0,0 +1,346 @@
+#include "pce/hw/vga_scanline.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VGA_SCANLINE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define VGA_SCANLINE_AVX2 1
+#include <immintrin.h>
+#ifdef Y_COMPILER_MSVC
+#include <intrin.h>
+#define AVX2_FUNCTION
+#else
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace HW {
+namespace VGAScanline {
+
+static constexpr uint32 ALPHA_MASK = UINT32_C(0xFF000000);
+
+// Spreads the bits of a plane byte out to the low bit of each byte in a qword, leftmost pixel first.
+// OR-ing the four planes together shifted by their plane number gives eight palette indices at once.
+struct PlanarExpandTable
+{
+  constexpr PlanarExpandTable() : entries()
+  {
+    for (uint32 value = 0; value < 256; value++)
+    {
+      uint64 entry = 0;
+      for (uint32 bit = 0; bit < 8; bit++)
+      {
+        if (value & (0x80u >> bit))
+          entry |= UINT64_C(1) << (bit * 8);
+      }
+      entries[value] = entry;
+    }
+  }
+
+  uint64 entries[256];
+};
+static constexpr PlanarExpandTable s_planar_expand_table;
+
+static void ExpandPlanar16_Scalar(uint32* dst, const uint32* fetches, uint32 count, const uint32* palette)
+{
+  for (uint32 i = 0; i < count; i++)
+  {
+    const uint32 all_planes = fetches[i];
+    const uint64 indices = s_planar_expand_table.entries[(all_planes >> 0) & 0xFF] |
+                           (s_planar_expand_table.entries[(all_planes >> 8) & 0xFF] << 1) |
+                           (s_planar_expand_table.entries[(all_planes >> 16) & 0xFF] << 2) |
+                           (s_planar_expand_table.entries[(all_planes >> 24) & 0xFF] << 3);
+
+    dst[0] = palette[(indices >> 0) & 0xFF];
+    dst[1] = palette[(indices >> 8) & 0xFF];
+    dst[2] = palette[(indices >> 16) & 0xFF];
+    dst[3] = palette[(indices >> 24) & 0xFF];
+    dst[4] = palette[(indices >> 32) & 0xFF];
+    dst[5] = palette[(indices >> 40) & 0xFF];
+    dst[6] = palette[(indices >> 48) & 0xFF];
+    dst[7] = palette[(indices >> 56) & 0xFF];
+    dst += 8;
+  }
+}
+
+static void Expand256_Scalar(uint32* dst, const uint32* fetches, uint32 count, const uint32* palette)
+{
+  for (uint32 i = 0; i < count; i++)
+  {
+    const uint32 indices = fetches[i];
+    dst[0] = palette[(indices >> 0) & 0xFF];
+    dst[1] = palette[(indices >> 8) & 0xFF];
+    dst[2] = palette[(indices >> 16) & 0xFF];
+    dst[3] = palette[(indices >> 24) & 0xFF];
+    dst += 4;
+  }
+}
+
+#ifdef VGA_SCANLINE_AVX2
+
+AVX2_FUNCTION static void ExpandPlanar16_AVX2(uint32* dst, const uint32* fetches, uint32 count,
+                                              const uint32* palette)
+{
+  // Shifting the fetch right by (7 - pixel) leaves the pixel's bit of plane N in bit N * 8 of its lane.
+  const __m256i shifts = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+  const __m256i bit0 = _mm256_set1_epi32(1);
+  const __m256i bit1 = _mm256_set1_epi32(2);
+  const __m256i bit2 = _mm256_set1_epi32(4);
+  const __m256i bit3 = _mm256_set1_epi32(8);
+  const int* palette_ptr = reinterpret_cast<const int*>(palette);
+
+  for (uint32 i = 0; i < count; i++)
+  {
+    const __m256i bits = _mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(fetches[i])), shifts);
+    __m256i indices = _mm256_and_si256(bits, bit0);
+    indices = _mm256_or_si256(indices, _mm256_and_si256(_mm256_srli_epi32(bits, 7), bit1));
+    indices = _mm256_or_si256(indices, _mm256_and_si256(_mm256_srli_epi32(bits, 14), bit2));
+    indices = _mm256_or_si256(indices, _mm256_and_si256(_mm256_srli_epi32(bits, 21), bit3));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_i32gather_epi32(palette_ptr, indices, 4));
+    dst += 8;
+  }
+}
+
+AVX2_FUNCTION static void Expand256_AVX2(uint32* dst, const uint32* fetches, uint32 count, const uint32* palette)
+{
+  const int* palette_ptr = reinterpret_cast<const int*>(palette);
+
+  // Two fetches give eight indices.
+  uint32 i = 0;
+  for (; (i + 2) <= count; i += 2)
+  {
+    const __m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&fetches[i])));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_i32gather_epi32(palette_ptr, indices, 4));
+    dst += 8;
+  }
+
+  if (i < count)
+    Expand256_Scalar(dst, &fetches[i], count - i, palette);
+}
+
+static bool HostSupportsAVX2()
+{
+#ifdef Y_COMPILER_MSVC
+  int regs[4];
+  __cpuid(regs, 0);
+  if (regs[0] < 7)
+    return false;
+
+  // OSXSAVE and AVX, and the OS has to be saving the YMM registers.
+  __cpuid(regs, 1);
+  if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+    return false;
+
+  __cpuidex(regs, 7, 0);
+  return (regs[1] & (1 << 5)) != 0;
+#else
+  // The dispatch table is built during static initialization, possibly before libgcc has run its own constructor.
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+struct DispatchTable
+{
+  void (*expand_planar16)(uint32* dst, const uint32* fetches, uint32 count, const uint32* palette);
+  void (*expand_256)(uint32* dst, const uint32* fetches, uint32 count, const uint32* palette);
+};
+
+static DispatchTable CreateDispatchTable()
+{
+  DispatchTable table = {ExpandPlanar16_Scalar, Expand256_Scalar};
+#ifdef VGA_SCANLINE_AVX2
+  if (HostSupportsAVX2())
+  {
+    table.expand_planar16 = ExpandPlanar16_AVX2;
+    table.expand_256 = Expand256_AVX2;
+  }
+#endif
+  return table;
+}
+
+static const DispatchTable s_dispatch_table = CreateDispatchTable();
+
+void ExpandPlanar16(uint32* dst, const uint32* fetches, uint32 count, const uint32* palette)
+{
+  s_dispatch_table.expand_planar16(dst, fetches, count, palette);
+}
+
+void ExpandInterleaved4(uint32* dst, const uint32* fetches, uint32 count, const uint32* palette)
+{
+  // This mode is only used by CGA-compatible modes, so it's not worth vectorizing.
+  for (uint32 i = 0; i < count; i++)
+  {
+    const uint32 pl0 = (fetches[i] >> 0) & 0xFF;
+    const uint32 pl1 = (fetches[i] >> 8) & 0xFF;
+    const uint32 pl2 = (fetches[i] >> 16) & 0xFF;
+    const uint32 pl3 = (fetches[i] >> 24) & 0xFF;
+    const uint32 high02 = ((pl2 >> 6) & 3) << 2;
+    const uint32 high13 = ((pl3 >> 6) & 3) << 2;
+
+    dst[0] = palette[((pl0 >> 6) & 3) | high02];
+    dst[1] = palette[((pl0 >> 4) & 3) | high02];
+    dst[2] = palette[((pl0 >> 2) & 3) | high02];
+    dst[3] = palette[((pl0 >> 0) & 3) | high02];
+    dst[4] = palette[((pl1 >> 6) & 3) | high13];
+    dst[5] = palette[((pl1 >> 4) & 3) | high13];
+    dst[6] = palette[((pl1 >> 2) & 3) | high13];
+    dst[7] = palette[((pl1 >> 0) & 3) | high13];
+    dst += 8;
+  }
+}
+
+void Expand256(uint32* dst, const uint32* fetches, uint32 count, const uint32* palette)
+{
+  s_dispatch_table.expand_256(dst, fetches, count, palette);
+}
+
+// Same bit replication as the framebuffer converters: 00012345 -> 12345123, 00123456 -> 12345612
+static inline uint32 Expand5To8(uint32 value)
+{
+  return ((value << 3) | (value >> 2)) & 0xFF;
+}
+static inline uint32 Expand6To8(uint32 value)
+{
+  return ((value << 2) | (value >> 4)) & 0xFF;
+}
+
+template<bool is_565>
+static void ExpandHiColor(uint32* dst, const uint32* fetches, uint32 count)
+{
+  constexpr uint32 green_mask = is_565 ? 0x3F : 0x1F;
+  constexpr uint32 red_shift = is_565 ? 11 : 10;
+
+  // Pixels are converted as 16-bit lanes, eight at a time.
+  uint32 i = 0;
+#ifdef VGA_SCANLINE_SSE2
+  const __m128i mask5 = _mm_set1_epi16(0x1F);
+  const __m128i green_mask_vec = _mm_set1_epi16(green_mask);
+  const __m128i alpha = _mm_set1_epi16(static_cast<short>(0xFF00));
+  for (; (i + 4) <= count; i += 4)
+  {
+    const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&fetches[i]));
+    __m128i b = _mm_and_si128(pixels, mask5);
+    __m128i g = _mm_and_si128(_mm_srli_epi16(pixels, 5), green_mask_vec);
+    __m128i r = _mm_and_si128(_mm_srli_epi16(pixels, red_shift), mask5);
+    b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+    r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+    if constexpr (is_565)
+      g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+    else
+      g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+
+    // Interleave R|G<<8 with B|0xFF<<8 to get RGBX.
+    const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+    const __m128i ba = _mm_or_si128(b, alpha);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4), _mm_unpackhi_epi16(rg, ba));
+    dst += 8;
+  }
+#endif
+
+  for (; i < count; i++)
+  {
+    for (uint32 half = 0; half < 2; half++)
+    {
+      const uint32 color = (fetches[i] >> (half * 16)) & 0xFFFF;
+      const uint32 b = Expand5To8(color & 0x1F);
+      const uint32 g = is_565 ? Expand6To8((color >> 5) & green_mask) : Expand5To8((color >> 5) & green_mask);
+      const uint32 r = Expand5To8((color >> red_shift) & 0x1F);
+      *(dst++) = ALPHA_MASK | r | (g << 8) | (b << 16);
+    }
+  }
+}
+
+void ExpandBGR555(uint32* dst, const uint32* fetches, uint32 count)
+{
+  ExpandHiColor<false>(dst, fetches, count);
+}
+
+void ExpandBGR565(uint32* dst, const uint32* fetches, uint32 count)
+{
+  ExpandHiColor<true>(dst, fetches, count);
+}
+
+void DoublePixels(uint32* dst, const uint32* src, uint32 count)
+{
+  uint32 i = 0;
+#ifdef VGA_SCANLINE_SSE2
+  for (; (i + 4) <= count; i += 4)
+  {
+    const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi32(pixels, pixels));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4), _mm_unpackhi_epi32(pixels, pixels));
+    dst += 8;
+  }
+#endif
+
+  for (; i < count; i++)
+  {
+    dst[0] = src[i];
+    dst[1] = src[i];
+    dst += 2;
+  }
+}
+
+#ifdef VGA_SCANLINE_SSE2
+
+// Selects the foreground colour for lanes where the masked bit is set, otherwise the background colour.
+static inline __m128i SelectGlyphColors(__m128i bits, __m128i mask, __m128i fg, __m128i bg)
+{
+  const __m128i set = _mm_cmpeq_epi32(_mm_and_si128(bits, mask), mask);
+  return _mm_or_si128(_mm_and_si128(set, fg), _mm_andnot_si128(set, bg));
+}
+
+void ExpandGlyphRow8(uint32* dst, uint8 bits, uint32 fg_color, uint32 bg_color)
+{
+  const __m128i bits_vec = _mm_set1_epi32(bits);
+  const __m128i fg = _mm_set1_epi32(static_cast<int>(fg_color));
+  const __m128i bg = _mm_set1_epi32(static_cast<int>(bg_color));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 0),
+                   SelectGlyphColors(bits_vec, _mm_setr_epi32(0x80, 0x40, 0x20, 0x10), fg, bg));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4),
+                   SelectGlyphColors(bits_vec, _mm_setr_epi32(0x08, 0x04, 0x02, 0x01), fg, bg));
+}
+
+void ExpandGlyphRow16(uint32* dst, uint8 bits, uint32 fg_color, uint32 bg_color)
+{
+  const __m128i bits_vec = _mm_set1_epi32(bits);
+  const __m128i fg = _mm_set1_epi32(static_cast<int>(fg_color));
+  const __m128i bg = _mm_set1_epi32(static_cast<int>(bg_color));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 0),
+                   SelectGlyphColors(bits_vec, _mm_setr_epi32(0x80, 0x80, 0x40, 0x40), fg, bg));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4),
+                   SelectGlyphColors(bits_vec, _mm_setr_epi32(0x20, 0x20, 0x10, 0x10), fg, bg));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8),
+                   SelectGlyphColors(bits_vec, _mm_setr_epi32(0x08, 0x08, 0x04, 0x04), fg, bg));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 12),
+                   SelectGlyphColors(bits_vec, _mm_setr_epi32(0x02, 0x02, 0x01, 0x01), fg, bg));
+}
+
+#else
+
+void ExpandGlyphRow8(uint32* dst, uint8 bits, uint32 fg_color, uint32 bg_color)
+{
+  for (uint32 i = 0; i < 8; i++)
+    dst[i] = ((bits >> (7 - i)) & 1) ? fg_color : bg_color;
+}
+
+void ExpandGlyphRow16(uint32* dst, uint8 bits, uint32 fg_color, uint32 bg_color)
+{
+  for (uint32 i = 0; i < 8; i++)
+  {
+    const uint32 color = ((bits >> (7 - i)) & 1) ? fg_color : bg_color;
+    dst[i * 2 + 0] = color;
+    dst[i * 2 + 1] = color;
+  }
+}
+
+#endif
+
+} // namespace VGAScanline
+} // namespace HW
@@ -0,0 +1,34 @@
+#pragma once
+#include "pce/types.h"
+
+namespace HW {
+
+// Per-scanline pixel converters shared by the VGA-compatible adapters.
+// The input is the sequence of dwords fetched by the CRTC for a line, with one byte per plane, already masked by the
+// colour plane enable register. The output is RGBX8 pixels, written straight into the framebuffer row.
+// SSE2 is used where it is available at compile time, and AVX2 is selected at runtime for the palette lookups.
+namespace VGAScanline {
+
+// 16 colour planar mode, 8 pixels per fetch. Bit 7 of each plane is the leftmost pixel.
+void ExpandPlanar16(uint32* dst, const uint32* fetches, uint32 count, const uint32* palette);
+
+// CGA-compatible interleaved shift mode, 8 pixels per fetch, 2 bits per pixel from planes 0/1 with 2/3 as the upper
+// bits of the palette index.
+void ExpandInterleaved4(uint32* dst, const uint32* fetches, uint32 count, const uint32* palette);
+
+// 256 colour mode (chain-4 or linear), 4 pixels per fetch.
+void Expand256(uint32* dst, const uint32* fetches, uint32 count, const uint32* palette);
+
+// 15/16-bit direct colour, 2 pixels per fetch. Red is in the high bits.
+void ExpandBGR555(uint32* dst, const uint32* fetches, uint32 count);
+void ExpandBGR565(uint32* dst, const uint32* fetches, uint32 count);
+
+// Writes each source pixel twice, for modes where the dot clock is halved.
+void DoublePixels(uint32* dst, const uint32* src, uint32 count);
+
+// Text glyph row expansion, 8 pixels (or 16 pixels with each bit doubled). Bit 7 is the leftmost pixel.
+void ExpandGlyphRow8(uint32* dst, uint8 bits, uint32 fg_color, uint32 bg_color);
+void ExpandGlyphRow16(uint32* dst, uint8 bits, uint32 fg_color, uint32 bg_color);
+
+} // namespace VGAScanline
+} // namespace HW
@@ -18,6 +18,7 @@ PROPERTY_TABLE_MEMBER_UINT("Type", 0, offsetof(Voodoo, m_type), nullptr, 0)
 PROPERTY_TABLE_MEMBER_UINT("FBMemoryMB", 0, offsetof(Voodoo, m_fb_mem_size), nullptr, 0)
 PROPERTY_TABLE_MEMBER_UINT("TMUMemoryMB", 0, offsetof(Voodoo, m_tmu_mem_size), nullptr, 0)
 PROPERTY_TABLE_MEMBER_BOOL("PrimaryDisplay", 0, offsetof(Voodoo, m_primary_display), nullptr, 0)
+PROPERTY_TABLE_MEMBER_UINT("RasterizerThreads", 0, offsetof(Voodoo, m_rasterizer_threads), nullptr, 0)
 END_OBJECT_PROPERTY_MAP()
 
 Voodoo::Voodoo(const String& identifier, const ObjectTypeInfo* type_info /* = &s_type_info */)
@@ -72,6 +73,7 @@ bool Voodoo::Initialize(System* system, Bus* bus)
   m_display->SetEnable(false);
 
   m_device = std::make_unique<voodoo_device>(freq, type);
+  m_device->set_rasterizer_threads(static_cast<int>(m_rasterizer_threads));
   m_device->initialize(bus, system->GetTimingManager(), m_display.get());
   return true;
 }
@@ -53,6 +53,10 @@ protected:
   u32 m_tmu_mem_size = 4;
   bool m_primary_display = true;
 
+  // Threads used to draw triangles, including the emulation thread. 0 sizes the pool from the host processor count,
+  // and 1 draws everything on the emulation thread.
+  u32 m_rasterizer_threads = 0;
+
   std::unique_ptr<Display> m_display;
 
   std::unique_ptr<voodoo_device> m_device;
@@ -273,7 +273,7 @@ void MMIO::DefaultReadBlockHandler(uint32 offset_from_base, uint32 length, void*
   }
 
   // Issue DWORD reads.
-  while (length > sizeof(uint32))
+  while (length >= sizeof(uint32))
   {
     uint32 value;
     m_handlers.read_dword(offset_from_base, &value);
@@ -307,8 +307,8 @@ void MMIO::DefaultWriteDWordHandler(uint32 offset_from_base, uint32 value)
 
 void MMIO::DefaultWriteQWordHandler(uint32 offset_from_base, uint64 value)
 {
-  m_handlers.write_qword(offset_from_base + 0, Truncate32(value));
-  m_handlers.write_qword(offset_from_base + 4, Truncate32(value >> 32));
+  m_handlers.write_dword(offset_from_base + 0, Truncate32(value));
+  m_handlers.write_dword(offset_from_base + 4, Truncate32(value >> 32));
 }
 
 void MMIO::DefaultWriteBlockHandler(uint32 offset_from_base, uint32 length, const void* source)
@@ -323,7 +323,7 @@ void MMIO::DefaultWriteBlockHandler(uint32 offset_from_base, uint32 length, cons
   }
 
   // Issue DWORD writes.
-  while (length > sizeof(uint32))
+  while (length >= sizeof(uint32))
   {
     uint32 value;
     std::memcpy(&value, source_ptr, sizeof(value));
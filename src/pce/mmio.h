@@ -25,6 +25,8 @@ public:
     ReadWordHandler read_word;
     ReadDWordHandler read_dword;
     ReadQWordHandler read_qword;
+    // Block handlers receive whole ranges from Bus::ReadMemoryBlock/WriteMemoryBlock, including REP MOVS to/from
+    // RAM. If not provided, CreateComplex() falls back to DWORD/byte accesses.
     ReadBlockHandler read_block;
     WriteByteHandler write_byte;
     WriteWordHandler write_word;
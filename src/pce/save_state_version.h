@@ -2,4 +2,4 @@
 #include "pce/types.h"
 
 const uint32 SAVE_STATE_SIGNATURE = 0x53534350;
-const uint32 SAVE_STATE_VERSION = 1;
+const uint32 SAVE_STATE_VERSION = 2;
@@ -1,6 +1,8 @@
 #include "system.h"
 #include "YBaseLib/BinaryReader.h"
 #include "YBaseLib/BinaryWriter.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Error.h"
 #include "YBaseLib/Log.h"
 #include "bus.h"
 #include "component.h"
@@ -10,6 +12,8 @@ Log_SetChannel(System);
 
 DEFINE_OBJECT_TYPE_INFO(System);
 BEGIN_OBJECT_PROPERTY_MAP(System)
+PROPERTY_TABLE_MEMBER_BOOL("RAMHugePages", 0, offsetof(System, m_ram_huge_pages), nullptr, 0)
+PROPERTY_TABLE_MEMBER_STRING("RAMImageFile", 0, offsetof(System, m_ram_image_filename), nullptr, 0)
 END_OBJECT_PROPERTY_MAP()
 
 System::System(const ObjectTypeInfo* type_info /* = &s_type_info */) : BaseClass(type_info) {}
@@ -40,6 +44,7 @@ bool System::Initialize()
 {
   Assert(m_state == State::Initializing);
 
+  m_bus->SetRAMBackingOptions(m_ram_huge_pages, m_ram_image_filename);
   m_bus->Initialize(this);
   for (Component* component : m_components)
   {
@@ -111,6 +116,32 @@ static bool SaveComponentStateHelper(BinaryWriter& writer, Callback callback)
 }
 
 bool System::LoadState(BinaryReader& reader)
+{
+  return DoLoadState(reader, true);
+}
+
+bool System::SaveState(BinaryWriter& writer)
+{
+  return DoSaveState(writer, true);
+}
+
+bool System::LoadState(BinaryReader& reader, const char* ram_image_filename)
+{
+  if (!m_bus->LoadRAMImage(ram_image_filename))
+    return false;
+
+  return DoLoadState(reader, false);
+}
+
+bool System::SaveState(BinaryWriter& writer, const char* ram_image_filename)
+{
+  if (!m_bus->SaveRAMImage(ram_image_filename))
+    return false;
+
+  return DoSaveState(writer, false);
+}
+
+bool System::DoLoadState(BinaryReader& reader, bool include_ram)
 {
   uint32 signature, version;
   if (!reader.SafeReadUInt32(&signature) || !reader.SafeReadUInt32(&version))
@@ -132,7 +163,7 @@ bool System::LoadState(BinaryReader& reader)
     return false;
 
   // Load bus state next
-  if (!LoadComponentStateHelper(reader, [&]() { return m_bus->LoadState(reader); }))
+  if (!LoadComponentStateHelper(reader, [&]() { return m_bus->LoadState(reader, include_ram); }))
     return false;
 
   // And finally the components
@@ -150,7 +181,7 @@ bool System::LoadState(BinaryReader& reader)
   return !reader.GetErrorState();
 }
 
-bool System::SaveState(BinaryWriter& writer)
+bool System::DoSaveState(BinaryWriter& writer, bool include_ram)
 {
   if (!writer.SafeWriteUInt32(SAVE_STATE_SIGNATURE) || !writer.SafeWriteUInt32(SAVE_STATE_VERSION))
   {
@@ -162,7 +193,7 @@ bool System::SaveState(BinaryWriter& writer)
     return false;
 
   // Save bus state next
-  if (!SaveComponentStateHelper(writer, [&]() { return m_bus->SaveState(writer); }))
+  if (!SaveComponentStateHelper(writer, [&]() { return m_bus->SaveState(writer, include_ram); }))
     return false;
 
   // And finally the components
@@ -229,8 +260,56 @@ bool System::SaveComponentsState(BinaryWriter& writer)
   return true;
 }
 
+std::unique_ptr<System> System::Fork(HostInterface* host_interface, Error* error)
+{
+  Log_InfoPrintf("Forking system '%s'...", GetTypeInfo()->GetTypeName());
+
+  // Build the same machine from the config file. Components can look at the parent while initializing.
+  std::unique_ptr<System> child = ParseConfig(m_config_filename, error);
+  if (!child)
+    return nullptr;
+
+  child->SetHostInterface(host_interface);
+  child->m_fork_parent = this;
+  const bool initialize_result = child->Initialize();
+  child->m_fork_parent = nullptr;
+  if (!initialize_result)
+  {
+    error->SetErrorUserFormatted(0, "Forked system initialization failed.");
+    return nullptr;
+  }
+
+  // Share RAM, then transfer everything else through a memory stream.
+  child->m_bus->ForkRAM(m_bus);
+
+  GrowableMemoryByteStream* stream = ByteStream_CreateGrowableMemoryStream();
+  bool result;
+  {
+    BinaryWriter writer(stream);
+    result = DoSaveState(writer, false);
+  }
+  if (result)
+  {
+    stream->SeekAbsolute(0);
+    BinaryReader reader(stream);
+    result = child->DoLoadState(reader, false);
+  }
+  stream->Release();
+
+  if (!result)
+  {
+    error->SetErrorUserFormatted(0, "Failed to transfer state to forked system.");
+    return nullptr;
+  }
+
+  return child;
+}
+
 SimulationTime System::ExecuteSlice(SimulationTime time)
 {
+  // RAM is about to change, so any snapshot taken for forking is stale.
+  m_bus->InvalidateRAMSnapshot();
+
   const SimulationTime start_timestamp = m_timing_manager.GetTotalEmulatedTime();
 
   // Convert time into CPU cycles, since that drives things currently.
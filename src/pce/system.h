@@ -42,6 +42,14 @@ public:
   // Parse a config file, and return the resulting system, if successful.
   static std::unique_ptr<System> ParseConfig(const char* filename, Error* error);
 
+  // Creates an initialized copy of this system from the same config file, in the current state.
+  // Guest RAM is shared copy-on-write where possible, and disk images get an in-memory replay log on top of the
+  // same base image. Must be called on the simulation thread, between slices.
+  std::unique_ptr<System> Fork(HostInterface* host_interface, Error* error);
+
+  // The system being forked from, only valid while a forked system is initializing.
+  System* GetForkParent() const { return m_fork_parent; }
+
   // Host outputs
   HostInterface* GetHostInterface() const { return m_host_interface; }
   void SetHostInterface(HostInterface* iface) { m_host_interface = iface; }
@@ -93,6 +101,11 @@ public:
   bool LoadState(BinaryReader& reader);
   bool SaveState(BinaryWriter& writer);
 
+  // State loading/saving with RAM kept in a separate raw image file. Loading maps the image copy-on-write
+  // where supported, so restoring a state does not need to read all of RAM up front.
+  bool LoadState(BinaryReader& reader, const char* ram_image_filename);
+  bool SaveState(BinaryWriter& writer, const char* ram_image_filename);
+
   // Returns the base path for the system, based on the ini path.
   const String& GetConfigBasePath() const { return m_base_path; }
 
@@ -101,6 +114,8 @@ public:
   String GetMiscDataFilename(const char* suffix) const;
 
 private:
+  bool DoLoadState(BinaryReader& reader, bool include_ram);
+  bool DoSaveState(BinaryWriter& writer, bool include_ram);
   bool LoadComponentsState(BinaryReader& reader);
   bool SaveComponentsState(BinaryWriter& writer);
 
@@ -115,7 +130,13 @@ private:
 
   PODArray<Component*> m_components;
   State m_state = State::Initializing;
+  String m_config_filename;
   String m_base_path;
+  System* m_fork_parent = nullptr;
+
+  // RAM backing options, see Bus::SetRAMBackingOptions().
+  bool m_ram_huge_pages = false;
+  String m_ram_image_filename;
 };
 
 template<typename T, typename... Args>
@@ -185,6 +185,7 @@ std::unique_ptr<System> System::ParseConfig(const char* filename, Error* error)
       return nullptr;
   }
 
+  system->m_config_filename = filename;
   system->m_base_path = GetBasePath(filename);
   return system;
 }
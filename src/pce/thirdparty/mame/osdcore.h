@@ -137,6 +137,10 @@ typedef void* (*osd_work_callback)(void* param, int threadid);
                 general, this implies doing some spin-waiting internally
                 before falling back to OS-specific synchronization
 
+        max_threads - if nonzero, the number of threads that should work
+            on the queue, including the calling thread for multi queues;
+            this takes precedence over the processor count
+
     Return value:
 
         A pointer to an allocated osd_work_queue object.
@@ -147,7 +151,7 @@ typedef void* (*osd_work_callback)(void* param, int threadid);
         can be performed. If no threading support is available, it is a
         simple matter to execute the work items as they are queued.
 -----------------------------------------------------------------------------*/
-osd_work_queue* osd_work_queue_alloc(int flags);
+osd_work_queue* osd_work_queue_alloc(int flags, int max_threads = 0);
 
 /*-----------------------------------------------------------------------------
     osd_work_queue_items: return the number of pending items in the queue
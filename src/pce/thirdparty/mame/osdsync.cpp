@@ -250,7 +250,7 @@ int thread_adjust_priority(std::thread* thread, int adjust)
 //  osd_work_queue_alloc
 //============================================================
 
-osd_work_queue* osd_work_queue_alloc(int flags)
+osd_work_queue* osd_work_queue_alloc(int flags, int max_threads)
 {
   int threadnum;
   int numprocs = effective_num_processors();
@@ -278,13 +278,17 @@ osd_work_queue* osd_work_queue_alloc(int flags)
       threadnum > osdthreadnum)
     threadnum = osdthreadnum;
 
+  // an explicit count from the caller overrides all of the above
+  if (max_threads > 0)
+    threadnum = (flags & WORK_QUEUE_FLAG_MULTI) ? (max_threads - 1) : max_threads;
+
 #if defined(SDLMAME_EMSCRIPTEN)
   // threads are not supported at all
   threadnum = 0;
 #endif
 
-  // clamp to the maximum
-  queue->threads = std::min(threadnum, WORK_MAX_THREADS);
+  // clamp to the maximum, leaving room for the calling thread's id on multi queues
+  queue->threads = std::min(threadnum, (flags & WORK_QUEUE_FLAG_MULTI) ? (WORK_MAX_THREADS - 1) : WORK_MAX_THREADS);
 
   // allocate memory for thread array (+1 to count the calling thread if WORK_QUEUE_FLAG_MULTI)
   if (flags & WORK_QUEUE_FLAG_MULTI)
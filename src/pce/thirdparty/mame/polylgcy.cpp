@@ -297,7 +297,7 @@ static inline polygon_info* allocate_polygon(legacy_poly_manager* poly, int miny
     manager
 -------------------------------------------------*/
 
-legacy_poly_manager* poly_alloc(int max_polys, size_t extra_data_size, u8 flags)
+legacy_poly_manager* poly_alloc(int max_polys, size_t extra_data_size, u8 flags, int max_threads)
 {
   /* allocate the manager itself */
   legacy_poly_manager* poly = new legacy_poly_manager();
@@ -324,7 +324,7 @@ legacy_poly_manager* poly_alloc(int max_polys, size_t extra_data_size, u8 flags)
 
   /* create the work queue */
   if (!(flags & POLYLGCY_FLAG_NO_WORK_QUEUE))
-    poly->queue = osd_work_queue_alloc(WORK_QUEUE_FLAG_MULTI | WORK_QUEUE_FLAG_HIGH_FREQ);
+    poly->queue = osd_work_queue_alloc(WORK_QUEUE_FLAG_MULTI | WORK_QUEUE_FLAG_HIGH_FREQ, max_threads);
 
   return poly;
 }
@@ -88,7 +88,7 @@ typedef void (*poly_draw_scanline_func)(void* dest, s32 scanline, const poly_ext
 /* ----- initialization/teardown ----- */
 
 /* allocate a new poly manager that can render triangles */
-legacy_poly_manager* poly_alloc(int max_polys, size_t extra_data_size, u8 flags);
+legacy_poly_manager* poly_alloc(int max_polys, size_t extra_data_size, u8 flags, int max_threads = 0);
 
 /* free a poly manager */
 void poly_free(legacy_poly_manager* poly);
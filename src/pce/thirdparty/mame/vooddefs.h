@@ -574,16 +574,16 @@ static inline rgbaint_t /*ATTR_FORCE_INLINE*/ clampARGB(const rgbaint_t& iterarg
     }                                                                                                                  \
   } while (0)
 
-inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::chromaKeyTest(voodoo_device* vd, stats_block* stats, u32 fbzModeReg,
-                                                               rgbaint_t rgbaIntColor)
+inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::chromaKeyTest(const raster_regs& regs, stats_block* stats,
+                                                               u32 fbzModeReg, rgbaint_t rgbaIntColor)
 {
   {
     rgb_union color;
     color.u = rgbaIntColor.to_rgba();
     /* non-range version */
-    if (!CHROMARANGE_ENABLE(vd->reg[chromaRange].u))
+    if (!CHROMARANGE_ENABLE(regs.chroma_range.u))
     {
-      if (((color.u ^ vd->reg[chromaKey].u) & 0xffffff) == 0)
+      if (((color.u ^ regs.chroma_key.u) & 0xffffff) == 0)
       {
         stats->chroma_fail++;
         return false;
@@ -597,30 +597,30 @@ inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::chromaKeyTest(voodoo_device* vd
       int results;
 
       /* check blue */
-      low = vd->reg[chromaKey].rgb.b;
-      high = vd->reg[chromaRange].rgb.b;
+      low = regs.chroma_key.rgb.b;
+      high = regs.chroma_range.rgb.b;
       test = color.rgb.b;
       results = (test >= low && test <= high);
-      results ^= CHROMARANGE_BLUE_EXCLUSIVE(vd->reg[chromaRange].u);
+      results ^= CHROMARANGE_BLUE_EXCLUSIVE(regs.chroma_range.u);
       results <<= 1;
 
       /* check green */
-      low = vd->reg[chromaKey].rgb.g;
-      high = vd->reg[chromaRange].rgb.g;
+      low = regs.chroma_key.rgb.g;
+      high = regs.chroma_range.rgb.g;
       test = color.rgb.g;
       results |= (test >= low && test <= high);
-      results ^= CHROMARANGE_GREEN_EXCLUSIVE(vd->reg[chromaRange].u);
+      results ^= CHROMARANGE_GREEN_EXCLUSIVE(regs.chroma_range.u);
       results <<= 1;
 
       /* check red */
-      low = vd->reg[chromaKey].rgb.r;
-      high = vd->reg[chromaRange].rgb.r;
+      low = regs.chroma_key.rgb.r;
+      high = regs.chroma_range.rgb.r;
       test = color.rgb.r;
       results |= (test >= low && test <= high);
-      results ^= CHROMARANGE_RED_EXCLUSIVE(vd->reg[chromaRange].u);
+      results ^= CHROMARANGE_RED_EXCLUSIVE(regs.chroma_range.u);
 
       /* final result */
-      if (CHROMARANGE_UNION_MODE(vd->reg[chromaRange].u))
+      if (CHROMARANGE_UNION_MODE(regs.chroma_range.u))
       {
         if (results != 0)
         {
@@ -1290,13 +1290,14 @@ static inline void /*ATTR_FORCE_INLINE*/ alphaBlend(u32 FBZMODE, u32 ALPHAMODE,
     }                                                                                                                  \
   } while (0)
 
-static inline void /*ATTR_FORCE_INLINE*/ applyFogging(voodoo_device* vd, u32 fbzModeReg, u32 fogModeReg, u32 fbzCpReg,
-                                                      s32 x, const u8* dither4, s32 wFloat, rgbaint_t& color, s32 iterz,
+static inline void /*ATTR_FORCE_INLINE*/ applyFogging(voodoo_device* vd, const voodoo_device::raster_regs& regs,
+                                                      u32 fbzModeReg, u32 fogModeReg, u32 fbzCpReg, s32 x,
+                                                      const u8* dither4, s32 wFloat, rgbaint_t& color, s32 iterz,
                                                       s64 iterw, const rgbaint_t& iterargb)
 {
   {
     /* constant fog bypasses everything else */
-    rgbaint_t fogColorLocal(vd->reg[fogColor].u);
+    rgbaint_t fogColorLocal(regs.fog_color.u);
 
     if (FOGMODE_FOG_CONSTANT(fogModeReg))
     {
@@ -1345,7 +1346,7 @@ static inline void /*ATTR_FORCE_INLINE*/ applyFogging(voodoo_device* vd, u32 fbz
           /* add the bias for fog selection*/
           if (FBZMODE_ENABLE_DEPTH_BIAS(fbzModeReg))
           {
-            fogDepth += (int16_t)vd->reg[zaColor].u;
+            fogDepth += (int16_t)regs.za_color.u;
             CLAMP(fogDepth, 0, 0xffff);
           }
           s32 delta = vd->fbi.fogdelta[fogDepth >> 10];
@@ -1764,7 +1765,7 @@ static inline void /*ATTR_FORCE_INLINE*/ applyFogging(voodoo_device* vd, u32 fbz
    *
    *************************************/
 
-#define PIXEL_PIPELINE_BEGIN(vd, STATS, XX, YY, FBZCOLORPATH, FBZMODE, ITERZ, ITERW)                                   \
+#define PIXEL_PIPELINE_BEGIN(vd, REGS, STATS, XX, YY, FBZCOLORPATH, FBZMODE, ITERZ, ITERW)                             \
   do                                                                                                                   \
   {                                                                                                                    \
     s32 depthval, wfloat, biasdepth;                                                                                   \
@@ -1846,7 +1847,7 @@ static inline void /*ATTR_FORCE_INLINE*/ applyFogging(voodoo_device* vd, u32 fbz
     biasdepth = depthval;                                                                                              \
     if (FBZMODE_ENABLE_DEPTH_BIAS(FBZMODE))                                                                            \
     {                                                                                                                  \
-      biasdepth += (int16_t)vd->reg[zaColor].u;                                                                        \
+      biasdepth += (int16_t)(REGS).za_color.u;                                                                         \
       CLAMP(biasdepth, 0, 0xffff);                                                                                     \
     }
 
@@ -2331,9 +2332,9 @@ inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::depthTest(uint16_t zaColorReg,
     }                                                                                                                  \
   } while (0)
 
-inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::combineColor(voodoo_device* vd, stats_block* STATS, u32 FBZCOLORPATH,
-                                                              u32 FBZMODE, rgbaint_t TEXELARGB, s32 ITERZ, s64 ITERW,
-                                                              rgbaint_t& srcColor)
+inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::combineColor(const raster_regs& regs, stats_block* STATS,
+                                                              u32 FBZCOLORPATH, u32 FBZMODE, rgbaint_t TEXELARGB,
+                                                              s32 ITERZ, s64 ITERW, rgbaint_t& srcColor)
 {
   rgbaint_t c_other;
   rgbaint_t c_local;
@@ -2352,7 +2353,7 @@ inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::combineColor(voodoo_device* vd,
       break;
 
     case 2: /* color1 RGB */
-      c_other.set(vd->reg[color1].u);
+      c_other.set(regs.color_1.u);
       break;
 
     default: /* reserved - voodoo3 LFB RGB */
@@ -2362,7 +2363,7 @@ inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::combineColor(voodoo_device* vd,
 
   /* handle chroma key */
   if (FBZMODE_ENABLE_CHROMAKEY(FBZMODE))
-    if (!chromaKeyTest(vd, STATS, FBZMODE, c_other))
+    if (!chromaKeyTest(regs, STATS, FBZMODE, c_other))
       return false;
   // APPLY_CHROMAKEY(vd->m_vds, STATS, FBZMODE, c_other);
 
@@ -2378,7 +2379,7 @@ inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::combineColor(voodoo_device* vd,
       break;
 
     case 2: /* color1 alpha */
-      c_other.set_a16(vd->reg[color1].rgb.a);
+      c_other.set_a16(regs.color_1.rgb.a);
       break;
 
     default: /* reserved - voodoo3  LFB Alpha*/
@@ -2398,14 +2399,14 @@ inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::combineColor(voodoo_device* vd,
     if (FBZCP_CC_LOCALSELECT(FBZCOLORPATH) == 0) /* iterated RGB */
       c_local.set(srcColor);
     else /* color0 RGB */
-      c_local.set(vd->reg[color0].u);
+      c_local.set(regs.color_0.u);
   }
   else
   {
     if (!(TEXELARGB.get_a() & 0x80)) /* iterated RGB */
       c_local.set(srcColor);
     else /* color0 RGB */
-      c_local.set(vd->reg[color0].u);
+      c_local.set(regs.color_0.u);
   }
 
   /* compute a_local */
@@ -2417,7 +2418,7 @@ inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::combineColor(voodoo_device* vd,
       break;
 
     case 1: /* color0 alpha */
-      c_local.set_a16(vd->reg[color0].rgb.a);
+      c_local.set_a16(regs.color_0.rgb.a);
       break;
 
     case 2: /* clamped iterated Z[27:20] */
@@ -2587,9 +2588,14 @@ inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::combineColor(voodoo_device* vd,
                                                                                                                        \
   void voodoo_device::raster_##name(void* destbase, s32 y, const poly_extent* extent, const void* extradata,           \
                                     int threadid)                                                                      \
+    RASTERIZER_BODY(TMUS, FBZCOLORPATH, FBZMODE, ALPHAMODE, FOGMODE, TEXMODE0, TEXMODE1)
+
+/* the body is separate so that it can also be used for the specialized rasterizer templates */
+#define RASTERIZER_BODY(TMUS, FBZCOLORPATH, FBZMODE, ALPHAMODE, FOGMODE, TEXMODE0, TEXMODE1)                           \
   {                                                                                                                    \
     const poly_extra_data* extra = (const poly_extra_data*)extradata;                                                  \
     voodoo_device* vd = extra->device;                                                                                 \
+    const raster_regs& regs = extra->regs;                                                                             \
     stats_block* stats = &vd->thread_stats[threadid];                                                                  \
     DECLARE_DITHER_POINTERS;                                                                                           \
     s32 startx = extent->startx;                                                                                       \
@@ -2619,7 +2625,7 @@ inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::combineColor(voodoo_device* vd,
       s32 tempclip;                                                                                                    \
                                                                                                                        \
       /* Y clipping buys us the whole scanline */                                                                      \
-      if (scry < ((vd->reg[clipLowYHighY].u >> 16) & 0x3ff) || scry >= (vd->reg[clipLowYHighY].u & 0x3ff))             \
+      if (scry < ((regs.clip_low_y_high_y.u >> 16) & 0x3ff) || scry >= (regs.clip_low_y_high_y.u & 0x3ff))             \
       {                                                                                                                \
         stats->pixels_in += stopx - startx;                                                                            \
         stats->clip_fail += stopx - startx;                                                                            \
@@ -2627,7 +2633,7 @@ inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::combineColor(voodoo_device* vd,
       }                                                                                                                \
                                                                                                                        \
       /* X clipping */                                                                                                 \
-      tempclip = vd->reg[clipLeftRight].u & 0x3ff;                                                                     \
+      tempclip = regs.clip_left_right.u & 0x3ff;                                                                       \
       /* Check for start outsize of clipping boundary */                                                               \
       if (startx >= tempclip)                                                                                          \
       {                                                                                                                \
@@ -2641,7 +2647,7 @@ inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::combineColor(voodoo_device* vd,
         vd->stats.total_clipped += stopx - tempclip;                                                                   \
         stopx = tempclip;                                                                                              \
       }                                                                                                                \
-      tempclip = (vd->reg[clipLeftRight].u >> 16) & 0x3ff;                                                             \
+      tempclip = (regs.clip_left_right.u >> 16) & 0x3ff;                                                               \
       if (startx < tempclip)                                                                                           \
       {                                                                                                                \
         stats->pixels_in += tempclip - startx;                                                                         \
@@ -2688,10 +2694,10 @@ inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::combineColor(voodoo_device* vd,
       rgbaint_t color, preFog;                                                                                         \
                                                                                                                        \
       /* pixel pipeline part 1 handles depth setup and stippling */                                                    \
-      PIXEL_PIPELINE_BEGIN(vd, stats, x, y, FBZCOLORPATH, FBZMODE, iterz, iterw);                                      \
+      PIXEL_PIPELINE_BEGIN(vd, regs, stats, x, y, FBZCOLORPATH, FBZMODE, iterz, iterw);                                \
       /* depth testing */                                                                                              \
       if (FBZMODE_ENABLE_DEPTHBUF(FBZMODE))                                                                            \
-        if (!depthTest((uint16_t)vd->reg[zaColor].u, stats, depth[x], FBZMODE, biasdepth))                             \
+        if (!depthTest((uint16_t)regs.za_color.u, stats, depth[x], FBZMODE, biasdepth))                                \
           goto skipdrawdepth;                                                                                          \
                                                                                                                        \
       /* run the texture pipeline on TMU1 to produce a value in texel */                                               \
@@ -2723,17 +2729,17 @@ inline bool /*ATTR_FORCE_INLINE*/ voodoo_device::combineColor(voodoo_device* vd,
                                                                                                                        \
       /* colorpath pipeline selects source colors and does blending */                                                 \
       color = clampARGB(iterargb, FBZCOLORPATH);                                                                       \
-      if (!combineColor(vd, stats, FBZCOLORPATH, FBZMODE, texel, iterz, iterw, color))                                 \
+      if (!combineColor(regs, stats, FBZCOLORPATH, FBZMODE, texel, iterz, iterw, color))                               \
         goto skipdrawdepth;                                                                                            \
       /* handle alpha test */                                                                                          \
       if (ALPHAMODE_ALPHATEST(ALPHAMODE))                                                                              \
-        if (!alphaTest(vd->reg[alphaMode].rgb.a, stats, ALPHAMODE, color.get_a()))                                     \
+        if (!alphaTest(regs.alpha_mode.rgb.a, stats, ALPHAMODE, color.get_a()))                                        \
           goto skipdrawdepth;                                                                                          \
                                                                                                                        \
       /* perform fogging */                                                                                            \
       preFog.set(color);                                                                                               \
       if (FOGMODE_ENABLE_FOG(FOGMODE))                                                                                 \
-        applyFogging(vd, FBZMODE, FOGMODE, FBZCOLORPATH, x, dither4, wfloat, color, iterz, iterw, iterargb);           \
+        applyFogging(vd, regs, FBZMODE, FOGMODE, FBZCOLORPATH, x, dither4, wfloat, color, iterz, iterw, iterargb);     \
                                                                                                                        \
       /* perform alpha blending */                                                                                     \
       if (ALPHAMODE_ALPHABLEND(ALPHAMODE))                                                                             \
@@ -180,6 +180,7 @@ inline s32 mul_32x32_shift(s32 a, s32 b, s8 shift)
 #define LOG_LFB (0)
 #define LOG_TEXTURE_RAM (0)
 #define LOG_RASTERIZERS (0)
+#define USE_SPECIALIZED_RASTERIZERS (1)
 #define LOG_CMDFIFO (0)
 #define LOG_CMDFIFO_VERBOSE (0)
 #define LOG_BANSHEE_2D (0)
@@ -223,6 +224,8 @@ struct voodoo_device::poly_extra_data
   s32 lodbase1;         // used during rasterization
 
   uint16_t dither[16]; // dither matrix, for fastfill
+
+  raster_regs regs; // pixel pipeline registers at the time the triangle was queued
 };
 
 /*************************************
@@ -274,6 +277,41 @@ const voodoo_device::raster_info voodoo_device::predef_raster_table[] = {
 
 #undef RASTERIZER_ENTRY
 
+/* pipeline enables which are fixed at compile time in the specialized rasterizers */
+static constexpr u32 RASTER_FEATURE_DEPTHBUF = 0x01;    /* fbzMode bit 4 */
+static constexpr u32 RASTER_FEATURE_CHROMAKEY = 0x02;   /* fbzMode bit 1 */
+static constexpr u32 RASTER_FEATURE_ALPHATEST = 0x04;   /* alphaMode bit 0 */
+static constexpr u32 RASTER_FEATURE_ALPHABLEND = 0x08;  /* alphaMode bit 4 */
+static constexpr u32 RASTER_FEATURE_FOG = 0x10;         /* fogMode bit 0 */
+static constexpr u32 RASTER_FEATURE_PERSPECTIVE = 0x20; /* textureMode bit 0 on TMU 0 */
+static constexpr u32 RASTER_FEATURE_COUNT = 0x40;
+
+static constexpr u32 FBZMODE_FEATURE_MASK = (1 << 4) | (1 << 1);
+static constexpr u32 ALPHAMODE_FEATURE_MASK = (1 << 4) | (1 << 0);
+static constexpr u32 FOGMODE_FEATURE_MASK = (1 << 0);
+static constexpr u32 TEXMODE_FEATURE_MASK = (1 << 0);
+
+static constexpr u32 specialized_fbz_mode_bits(u32 features)
+{
+  return ((features & RASTER_FEATURE_DEPTHBUF) ? (1 << 4) : 0) | ((features & RASTER_FEATURE_CHROMAKEY) ? (1 << 1) : 0);
+}
+
+static constexpr u32 specialized_alpha_mode_bits(u32 features)
+{
+  return ((features & RASTER_FEATURE_ALPHABLEND) ? (1 << 4) : 0) |
+         ((features & RASTER_FEATURE_ALPHATEST) ? (1 << 0) : 0);
+}
+
+static constexpr u32 specialized_fog_mode_bits(u32 features) { return (features & RASTER_FEATURE_FOG) ? (1 << 0) : 0; }
+
+static constexpr u32 specialized_tex_mode_bits(u32 features)
+{
+  return (features & RASTER_FEATURE_PERSPECTIVE) ? (1 << 0) : 0;
+}
+
+/* replace the bits in MASK with the compile-time constant BITS, so that tests on them fold away */
+#define SPECIALIZE_BITS(VALUE, MASK, BITS) (((VALUE) & ~(MASK)) | (BITS))
+
 /***************************************************************************
     INLINE FUNCTIONS
 ***************************************************************************/
@@ -870,6 +908,9 @@ void voodoo_device::swap_buffers(voodoo_device* vd)
     statsptr += sprintf(statsptr, "LFBW:%6d\n", vd->stats.lfb_writes);
     statsptr += sprintf(statsptr, "LFBR:%6d\n", vd->stats.lfb_reads);
     statsptr += sprintf(statsptr, "TexW:%6d\n", vd->stats.tex_writes);
+    statsptr += sprintf(statsptr, "RHit:%6d\n", vd->stats.raster_hits);
+    statsptr += sprintf(statsptr, "RMis:%6d\n", vd->stats.raster_misses);
+    statsptr += sprintf(statsptr, "RGen:%6d\n", vd->stats.raster_generic);
     statsptr += sprintf(statsptr, "TexM:");
     for (i = 0; i < 16; i++)
       if (vd->stats.texture_mode[i])
@@ -892,6 +933,9 @@ void voodoo_device::swap_buffers(voodoo_device* vd)
   vd->stats.lfb_writes = 0;
   vd->stats.lfb_reads = 0;
   vd->stats.tex_writes = 0;
+  vd->stats.raster_hits = 0;
+  vd->stats.raster_misses = 0;
+  vd->stats.raster_generic = 0;
   memset(vd->stats.texture_mode, 0, sizeof(vd->stats.texture_mode));
 }
 
@@ -2443,7 +2487,6 @@ s32 voodoo_device::register_w(voodoo_device* vd, u32 offset, u32 data)
 
     /* mask off invalid bits for different cards */
     case fbzColorPath:
-      poly_wait(vd->poly, vd->regnames[regnum]);
       if (vd->vd_type < TYPE_VOODOO_2)
         data &= 0x0fffffff;
       if (chips & 1)
@@ -2451,7 +2494,6 @@ s32 voodoo_device::register_w(voodoo_device* vd, u32 offset, u32 data)
       break;
 
     case fbzMode:
-      poly_wait(vd->poly, vd->regnames[regnum]);
       if (vd->vd_type < TYPE_VOODOO_2)
         data &= 0x001fffff;
       if (chips & 1)
@@ -2459,7 +2501,6 @@ s32 voodoo_device::register_w(voodoo_device* vd, u32 offset, u32 data)
       break;
 
     case fogMode:
-      poly_wait(vd->poly, vd->regnames[regnum]);
       if (vd->vd_type < TYPE_VOODOO_2)
         data &= 0x0000003f;
       if (chips & 1)
@@ -2895,17 +2936,9 @@ s32 voodoo_device::register_w(voodoo_device* vd, u32 offset, u32 data)
       vd->send_config = (TREXINIT_SEND_TMU_CONFIG(data) > 0);
       goto default_case;
 
-    /* these registers are referenced in the renderer; we must wait for pending work before changing */
-    case chromaRange:
-    case chromaKey:
-    case alphaMode:
-    case fogColor:
+    /* the rasterizer rotates the stipple register as it draws; we must wait for pending work before changing */
+    /* the other pipeline registers are captured into raster_regs when each triangle is queued */
     case stipple:
-    case zaColor:
-    case color1:
-    case color0:
-    case clipLowYHighY:
-    case clipLeftRight:
       poly_wait(vd->poly, vd->regnames[regnum]);
       /* fall through to default implementation */
 
@@ -3301,6 +3334,8 @@ s32 voodoo_device::lfb_w(voodoo_device* vd, u32 offset, u32 data, u32 mem_mask)
   else
   {
     DECLARE_DITHER_POINTERS;
+    raster_regs regs;
+    regs.capture(vd->reg);
 
     if (LOG_LFB)
     {
@@ -3407,7 +3442,7 @@ s32 voodoo_device::lfb_w(voodoo_device* vd, u32 offset, u32 data, u32 mem_mask)
 
         /* handle chroma key */
         if (FBZMODE_ENABLE_CHROMAKEY(vd->reg[fbzMode].u))
-          if (!chromaKeyTest(vd, stats, vd->reg[fbzMode].u, color))
+          if (!chromaKeyTest(regs, stats, vd->reg[fbzMode].u, color))
             goto nextpixel;
         /* handle alpha mask */
         if (FBZMODE_ENABLE_ALPHA_MASK(vd->reg[fbzMode].u))
@@ -3421,8 +3456,8 @@ s32 voodoo_device::lfb_w(voodoo_device* vd, u32 offset, u32 data, u32 mem_mask)
         /* perform fogging */
         preFog.set(color);
         if (FOGMODE_ENABLE_FOG(vd->reg[fogMode].u))
-          applyFogging(vd, vd->reg[fbzMode].u, vd->reg[fogMode].u, vd->reg[fbzColorPath].u, x, dither4, biasdepth,
-                       color, iterz, iterw, iterargb);
+          applyFogging(vd, regs, vd->reg[fbzMode].u, vd->reg[fogMode].u, vd->reg[fbzColorPath].u, x, dither4,
+                       biasdepth, color, iterz, iterw, iterargb);
 
         /* wait for any outstanding work to finish */
         poly_wait(vd->poly, "LFB Write");
@@ -4191,8 +4226,9 @@ s32 voodoo_device::lfb_w(voodoo_device* vd, u32 offset, u32 data, u32 mem_mask)
     /* validate configuration */
     Assert(m_fbmem > 0);
 
-    /* create a multiprocessor work queue */
-    poly = poly_alloc(64, sizeof(poly_extra_data), 0);
+    /* create a multiprocessor work queue, unless we were asked to rasterize on this thread only */
+    poly = poly_alloc(64, sizeof(poly_extra_data), (m_rasterizer_threads == 1) ? POLYLGCY_FLAG_NO_WORK_QUEUE : 0,
+                      m_rasterizer_threads);
     thread_stats = static_cast<stats_block*>(std::calloc(WORK_MAX_THREADS, sizeof(stats_block)));
 
     /* create a table of precomputed 1/n and log2(n) values */
@@ -4380,6 +4416,7 @@ s32 voodoo_device::lfb_w(voodoo_device* vd, u32 offset, u32 data, u32 mem_mask)
       int count = (std::min)(ey - y, int(countof(extents)));
 
       extra->device = vd;
+      extra->regs.capture(vd->reg);
       memcpy(extra->dither, dithermatrix, sizeof(extra->dither));
 
       pixels += poly_render_triangle_custom(vd->poly, drawbuf, global_cliprect, raster_fastfill, y, count, extents);
@@ -4728,6 +4765,27 @@ s32 voodoo_device::lfb_w(voodoo_device* vd, u32 offset, u32 data, u32 mem_mask)
     return triangle(vd);
   }
 
+  /*-------------------------------------------------
+      raster_regs::capture - copy the registers
+      used by the pixel pipeline
+  -------------------------------------------------*/
+
+  void voodoo_device::raster_regs::capture(const voodoo_reg* reg)
+  {
+    fbz_color_path = reg[fbzColorPath];
+    fbz_mode = reg[fbzMode];
+    alpha_mode = reg[alphaMode];
+    fog_mode = reg[fogMode];
+    fog_color = reg[fogColor];
+    za_color = reg[zaColor];
+    color_0 = reg[color0];
+    color_1 = reg[color1];
+    chroma_key = reg[chromaKey];
+    chroma_range = reg[chromaRange];
+    clip_left_right = reg[clipLeftRight];
+    clip_low_y_high_y = reg[clipLowYHighY];
+  }
+
   /*-------------------------------------------------
       triangle_create_work_item - finish triangle
       setup and create the work item
@@ -4751,6 +4809,7 @@ s32 voodoo_device::lfb_w(voodoo_device* vd, u32 offset, u32 data, u32 mem_mask)
     /* fill in the extra data */
     extra->device = vd;
     extra->info = info;
+    extra->regs.capture(vd->reg);
 
     /* fill in triangle parameters */
     extra->ax = vd->fbi.ax;
@@ -4888,14 +4947,39 @@ s32 voodoo_device::lfb_w(voodoo_device* vd, u32 offset, u32 data, u32 mem_mask)
         }
 
         /* return the result */
+        vd->stats.raster_hits++;
+        if (info->is_generic)
+          vd->stats.raster_generic++;
         return info;
       }
     }
 
-    /* generate a new one using the generic entry */
-    curinfo.callback =
-      (texcount == 0) ? raster_generic_0tmu : (texcount == 1) ? raster_generic_1tmu : raster_generic_2tmu;
-    curinfo.is_generic = true;
+    vd->stats.raster_misses++;
+
+    /* generate a new one using the specialized templates, or the generic entry */
+    if (USE_SPECIALIZED_RASTERIZERS)
+    {
+      u32 features = 0;
+      features |= FBZMODE_ENABLE_DEPTHBUF(curinfo.eff_fbz_mode) ? RASTER_FEATURE_DEPTHBUF : 0;
+      features |= FBZMODE_ENABLE_CHROMAKEY(curinfo.eff_fbz_mode) ? RASTER_FEATURE_CHROMAKEY : 0;
+      features |= ALPHAMODE_ALPHATEST(curinfo.eff_alpha_mode) ? RASTER_FEATURE_ALPHATEST : 0;
+      features |= ALPHAMODE_ALPHABLEND(curinfo.eff_alpha_mode) ? RASTER_FEATURE_ALPHABLEND : 0;
+      features |= FOGMODE_ENABLE_FOG(curinfo.eff_fog_mode) ? RASTER_FEATURE_FOG : 0;
+      if (texcount >= 1 && TEXMODE_ENABLE_PERSPECTIVE(curinfo.eff_tex_mode_0))
+        features |= RASTER_FEATURE_PERSPECTIVE;
+
+      curinfo.callback = get_specialized_rasterizer(texcount, features);
+      curinfo.is_generic = false;
+      curinfo.is_specialized = true;
+    }
+    else
+    {
+      curinfo.callback =
+        (texcount == 0) ? raster_generic_0tmu : (texcount == 1) ? raster_generic_1tmu : raster_generic_2tmu;
+      curinfo.is_generic = true;
+      curinfo.is_specialized = false;
+      vd->stats.raster_generic++;
+    }
     curinfo.display = 0;
     curinfo.polys = 0;
     curinfo.hits = 0;
@@ -4937,7 +5021,8 @@ s32 voodoo_device::lfb_w(voodoo_device* vd, u32 offset, u32 data, u32 mem_mask)
       /* print it */
       printf("RASTERIZER_ENTRY( 0x%08X, 0x%08X, 0x%08X, 0x%08X, 0x%08X, 0x%08X ) /* %c %2d %8d %10d */\n",
              best->eff_color_path, best->eff_alpha_mode, best->eff_fog_mode, best->eff_fbz_mode, best->eff_tex_mode_0,
-             best->eff_tex_mode_1, best->is_generic ? '*' : ' ', best->hash, best->polys, best->hits);
+             best->eff_tex_mode_1, best->is_generic ? '*' : (best->is_specialized ? '+' : ' '), best->hash,
+             best->polys, best->hits);
 
       /* reset */
       best->display = display_index;
@@ -5044,13 +5129,13 @@ s32 voodoo_device::lfb_w(voodoo_device* vd, u32 offset, u32 data, u32 mem_mask)
 
     /* determine the screen Y */
     scry = y;
-    if (FBZMODE_Y_ORIGIN(vd->reg[fbzMode].u))
+    if (FBZMODE_Y_ORIGIN(extra->regs.fbz_mode.u))
       scry = (vd->fbi.yorigin - y);
 
     // Log_DevPrintf("fastfill: %d %d %d", scry, startx, stopx);
 
     /* fill this RGB row */
-    if (FBZMODE_RGB_BUFFER_MASK(vd->reg[fbzMode].u))
+    if (FBZMODE_RGB_BUFFER_MASK(extra->regs.fbz_mode.u))
     {
       const uint16_t* ditherow = &extra->dither[(y & 3) * 4];
       u64 expanded = *(u64*)ditherow;
@@ -5066,9 +5151,9 @@ s32 voodoo_device::lfb_w(voodoo_device* vd, u32 offset, u32 data, u32 mem_mask)
     }
 
     /* fill this dest buffer row */
-    if (FBZMODE_AUX_BUFFER_MASK(vd->reg[fbzMode].u) && vd->fbi.auxoffs != ~0)
+    if (FBZMODE_AUX_BUFFER_MASK(extra->regs.fbz_mode.u) && vd->fbi.auxoffs != ~0)
     {
-      uint16_t depth = vd->reg[zaColor].u;
+      uint16_t depth = extra->regs.za_color.u;
       u64 expanded = ((u64)depth << 48) | ((u64)depth << 32) | ((u64)depth << 16) | (u64)depth;
       uint16_t* dest = (uint16_t*)(vd->fbi.ram + vd->fbi.auxoffs) + scry * vd->fbi.rowpixels;
 
@@ -5085,19 +5170,63 @@ s32 voodoo_device::lfb_w(voodoo_device* vd, u32 offset, u32 data, u32 mem_mask)
       generic_0tmu - generic rasterizer for 0 TMUs
   -------------------------------------------------*/
 
-  RASTERIZER(generic_0tmu, 0, vd->reg[fbzColorPath].u, vd->reg[fbzMode].u, vd->reg[alphaMode].u, vd->reg[fogMode].u, 0,
-             0)
+  RASTERIZER(generic_0tmu, 0, regs.fbz_color_path.u, regs.fbz_mode.u, regs.alpha_mode.u, regs.fog_mode.u, 0, 0)
 
   /*-------------------------------------------------
       generic_1tmu - generic rasterizer for 1 TMU
   -------------------------------------------------*/
 
-  RASTERIZER(generic_1tmu, 1, vd->reg[fbzColorPath].u, vd->reg[fbzMode].u, vd->reg[alphaMode].u, vd->reg[fogMode].u,
+  RASTERIZER(generic_1tmu, 1, regs.fbz_color_path.u, regs.fbz_mode.u, regs.alpha_mode.u, regs.fog_mode.u,
              vd->tmu[0].reg[textureMode].u, 0)
 
   /*-------------------------------------------------
       generic_2tmu - generic rasterizer for 2 TMUs
   -------------------------------------------------*/
 
-  RASTERIZER(generic_2tmu, 2, vd->reg[fbzColorPath].u, vd->reg[fbzMode].u, vd->reg[alphaMode].u, vd->reg[fogMode].u,
+  RASTERIZER(generic_2tmu, 2, regs.fbz_color_path.u, regs.fbz_mode.u, regs.alpha_mode.u, regs.fog_mode.u,
              vd->tmu[0].reg[textureMode].u, vd->tmu[1].reg[textureMode].u)
+
+  /*-------------------------------------------------
+      raster_specialized - rasterizers for mode
+      combinations without a predefined entry, with
+      the pipeline enables fixed at compile time
+  -------------------------------------------------*/
+
+  template<int TMUS, u32 FEATURES>
+  void voodoo_device::raster_specialized(void* destbase, s32 y, const poly_extent* extent, const void* extradata,
+                                         int threadid)
+    RASTERIZER_BODY(TMUS, regs.fbz_color_path.u,
+                    SPECIALIZE_BITS(regs.fbz_mode.u, FBZMODE_FEATURE_MASK, specialized_fbz_mode_bits(FEATURES)),
+                    SPECIALIZE_BITS(regs.alpha_mode.u, ALPHAMODE_FEATURE_MASK, specialized_alpha_mode_bits(FEATURES)),
+                    SPECIALIZE_BITS(regs.fog_mode.u, FOGMODE_FEATURE_MASK, specialized_fog_mode_bits(FEATURES)),
+                    SPECIALIZE_BITS(vd->tmu[0].reg[textureMode].u, TEXMODE_FEATURE_MASK,
+                                    specialized_tex_mode_bits(FEATURES)),
+                    vd->tmu[1].reg[textureMode].u)
+
+#define SPECIALIZED_ENTRIES_8(TMUS, BASE)                                                                              \
+  raster_specialized<TMUS, BASE + 0>, raster_specialized<TMUS, BASE + 1>, raster_specialized<TMUS, BASE + 2>,          \
+    raster_specialized<TMUS, BASE + 3>, raster_specialized<TMUS, BASE + 4>, raster_specialized<TMUS, BASE + 5>,        \
+    raster_specialized<TMUS, BASE + 6>, raster_specialized<TMUS, BASE + 7>
+#define SPECIALIZED_ENTRIES_32(TMUS, BASE)                                                                             \
+  SPECIALIZED_ENTRIES_8(TMUS, BASE + 0), SPECIALIZED_ENTRIES_8(TMUS, BASE + 8),                                        \
+    SPECIALIZED_ENTRIES_8(TMUS, BASE + 16), SPECIALIZED_ENTRIES_8(TMUS, BASE + 24)
+
+  poly_draw_scanline_func voodoo_device::get_specialized_rasterizer(int texcount, u32 features)
+  {
+    /* without textures the perspective bit is meaningless, so only half of the table is instantiated */
+    static const poly_draw_scanline_func table_0tmu[RASTER_FEATURE_COUNT / 2] = {SPECIALIZED_ENTRIES_32(0, 0)};
+    static const poly_draw_scanline_func table_1tmu[RASTER_FEATURE_COUNT] = {SPECIALIZED_ENTRIES_32(1, 0),
+                                                                              SPECIALIZED_ENTRIES_32(1, 32)};
+    static const poly_draw_scanline_func table_2tmu[RASTER_FEATURE_COUNT] = {SPECIALIZED_ENTRIES_32(2, 0),
+                                                                              SPECIALIZED_ENTRIES_32(2, 32)};
+
+    if (texcount == 0)
+      return table_0tmu[features & ~RASTER_FEATURE_PERSPECTIVE];
+    else if (texcount == 1)
+      return table_1tmu[features];
+    else
+      return table_2tmu[features];
+  }
+
+#undef SPECIALIZED_ENTRIES_32
+#undef SPECIALIZED_ENTRIES_8
@@ -930,6 +930,7 @@ public:
   void reset();
 
   void set_fbmem(int value) { m_fbmem = value; }
+  void set_rasterizer_threads(int value) { m_rasterizer_threads = value; }
   void set_tmumem(int value1, int value2)
   {
     m_tmumem0 = value1;
@@ -945,6 +946,9 @@ public:
   u8 m_tmumem0 = 8;
   u8 m_tmumem1 = 8;
 
+  // Number of threads drawing triangles, including the emulation thread. 0 picks a count from the host processors.
+  int m_rasterizer_threads = 0;
+
   // This is for internally generated PCI interrupts in Voodoo3
   std::function<void()> m_pciint;
 
@@ -979,6 +983,9 @@ protected:
     s32 reg_reads;         // register reads
     s32 tex_writes;        // texture writes
     s32 texture_mode[16];  // 16 different texture modes
+    s32 raster_hits;       // triangles whose rasterizer was already in the hash table
+    s32 raster_misses;     // triangles which needed a new rasterizer entry
+    s32 raster_generic;    // triangles drawn with a generic rasterizer
     u8 render_override;    // render override
     char buffer[1024];     // string
   };
@@ -1212,8 +1219,31 @@ protected:
     u32 eff_tex_mode_0;               // effective textureMode value for TMU #0
     u32 eff_tex_mode_1;               // effective textureMode value for TMU #1
     u32 hash;
+    bool is_specialized; // true if this is one of the feature-specialized rasterizers
   };
 
+public:
+  // Registers read by the pixel pipeline. A copy is taken when each triangle is queued, so that writes to these
+  // registers do not have to wait for the rasterizer threads to drain.
+  struct raster_regs
+  {
+    void capture(const voodoo_reg* reg);
+
+    voodoo_reg fbz_color_path;
+    voodoo_reg fbz_mode;
+    voodoo_reg alpha_mode;
+    voodoo_reg fog_mode;
+    voodoo_reg fog_color;
+    voodoo_reg za_color;
+    voodoo_reg color_0;
+    voodoo_reg color_1;
+    voodoo_reg chroma_key;
+    voodoo_reg chroma_range;
+    voodoo_reg clip_left_right;
+    voodoo_reg clip_low_y_high_y;
+  };
+
+protected:
   struct poly_extra_data;
 
   static const raster_info predef_raster_table[];
@@ -1263,6 +1293,13 @@ protected:
   static void raster_generic_2tmu(void* dest, s32 scanline, const poly_extent* extent, const void* extradata,
                                   int threadid);
 
+  // Rasterizers with the pipeline enable bits fixed at compile time, used for any mode combination which does not
+  // have a predefined rasterizer. FEATURES is a combination of the RASTER_FEATURE_* bits.
+  template<int TMUS, u32 FEATURES>
+  static void raster_specialized(void* dest, s32 scanline, const poly_extent* extent, const void* extradata,
+                                 int threadid);
+  static poly_draw_scanline_func get_specialized_rasterizer(int texcount, u32 features);
+
 #define RASTERIZER_HEADER(name)                                                                                        \
   static void raster_##name(void* destbase, s32 y, const poly_extent* extent, const void* extradata, int threadid);
 #define RASTERIZER_ENTRY(fbzcp, alpha, fog, fbz, tex0, tex1)                                                           \
@@ -1271,12 +1308,12 @@ protected:
 
 #undef RASTERIZER_ENTRY
 
-  static bool chromaKeyTest(voodoo_device* vd, stats_block* stats, u32 fbzModeReg, rgbaint_t rgaIntColor);
+  static bool chromaKeyTest(const raster_regs& regs, stats_block* stats, u32 fbzModeReg, rgbaint_t rgaIntColor);
   static bool alphaMaskTest(stats_block* stats, u32 fbzModeReg, u8 alpha);
   static bool alphaTest(u8 alpharef, stats_block* stats, u32 alphaModeReg, u8 alpha);
   static bool depthTest(uint16_t zaColorReg, stats_block* stats, s32 destDepth, u32 fbzModeReg, s32 biasdepth);
-  static bool combineColor(voodoo_device* vd, stats_block* STATS, u32 FBZCOLORPATH, u32 FBZMODE, rgbaint_t TEXELARGB,
-                           s32 ITERZ, s64 ITERW, rgbaint_t& srcColor);
+  static bool combineColor(const raster_regs& regs, stats_block* STATS, u32 FBZCOLORPATH, u32 FBZMODE,
+                           rgbaint_t TEXELARGB, s32 ITERZ, s64 ITERW, rgbaint_t& srcColor);
 
   // FIXME: this stuff should not be public
 public: